@@ -13,7 +13,8 @@ INCLUDEPATH += src \
     libs/opus/include \
     libs/opus/celt \
     libs/opus/silk \
-    libs/opus/silk/float
+    libs/opus/silk/float \
+    libs/mixtap
 
 DEFINES += APP_VERSION=\\\"$$VERSION\\\" \
     OPUS_BUILD \
@@ -59,6 +60,9 @@ win32 {
     # we assume that stdint.h is always present in a Linux system
     DEFINES += HAVE_STDINT_H
 
+    # POSIX shared memory of the mix tap
+    LIBS += -lrt
+
     # only include jack support if CONFIG nosound is not set
     nosoundoption = $$find(CONFIG, "nosound")
     count(nosoundoption, 0) {
@@ -102,10 +106,16 @@ HEADERS += src/audiomixerboard.h \
     src/connectdlg.h \
     src/global.h \
     src/clientdlg.h \
+    src/listener.h \
+    src/mixstream.h \
+    src/recorder.h \
+    src/mixtap.h \
     src/serverdlg.h \
     src/multicolorled.h \
     src/multicolorledbar.h \
     src/protocol.h \
+    src/protschema.h \
+    src/resample.h \
     src/server.h \
     src/serverlist.h \
     src/serverlogging.h \
@@ -113,6 +123,7 @@ HEADERS += src/audiomixerboard.h \
     src/socket.h \
     src/soundbase.h \
     src/testbench.h \
+    src/uplink.h \
     src/util.h \
     src/analyzerconsole.h \
     libs/celt/cc6_celt.h \
@@ -146,6 +157,7 @@ HEADERS += src/audiomixerboard.h \
     libs/celt/cc6_rate.h \
     libs/celt/cc6_stack_alloc.h \
     libs/celt/cc6_vq.h \
+    libs/mixtap/mixtaplayout.h \
     libs/opus/include/opus.h \
     libs/opus/include/opus_multistream.h \
     libs/opus/include/opus_custom.h \
@@ -226,17 +238,23 @@ SOURCES += src/audiomixerboard.cpp \
     src/clientsettingsdlg.cpp \
     src/connectdlg.cpp \
     src/clientdlg.cpp \
+    src/listener.cpp \
+    src/mixstream.cpp \
+    src/recorder.cpp \
+    src/mixtap.cpp \
     src/serverdlg.cpp \
     src/main.cpp \
     src/multicolorled.cpp \
     src/multicolorledbar.cpp \
     src/protocol.cpp \
+    src/resample.cpp \
     src/server.cpp \
     src/serverlist.cpp \
     src/serverlogging.cpp \
     src/settings.cpp \
     src/socket.cpp \
     src/soundbase.cpp \
+    src/uplink.cpp \
     src/util.cpp \
     src/analyzerconsole.cpp \
     libs/celt/cc6_bands.c \
@@ -412,6 +430,8 @@ DISTFILES += AUTHORS \
     libs/celt/README \
     libs/celt/README_LLCON \
     libs/celt/TODO \
+    libs/mixtap/mixtapreader.c \
+    libs/mixtap/mixtapreader.h \
     libs/opus/AUTHORS \
     libs/opus/ChangeLog \
     libs/opus/COPYING \
@@ -497,3 +517,21 @@ DISTFILES += AUTHORS \
     src/res/instrtuba.png \
     src/res/instrviolin.png \
     src/res/instrvocal.png
+
+# protocol fuzzing and throughput benchmark harness, this is a separate target
+# which is built with: qmake "CONFIG+=protfuzz" (add "libfuzzer" to the CONFIG
+# for a libFuzzer build with clang)
+contains(CONFIG, "protfuzz") {
+    message(Protocol fuzzing harness target.)
+
+    TARGET = jamulusprotfuzz
+    CONFIG += console
+    SOURCES -= src/main.cpp
+    SOURCES += src/protfuzz.cpp
+
+    contains(CONFIG, "libfuzzer") {
+        DEFINES += PROTOCOL_FUZZER_LIBFUZZER
+        QMAKE_CXXFLAGS += -fsanitize=fuzzer,address
+        QMAKE_LFLAGS += -fsanitize=fuzzer,address
+    }
+}
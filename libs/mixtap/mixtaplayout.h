@@ -0,0 +1,125 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2014
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+/*
+ * Layout of the shared memory mix tap of the Jamulus server
+ * =========================================================
+ *
+ * The server publishes the audio of each timer tick in a POSIX shared memory
+ * object (see the server option --mixtap). The object consists of a header
+ * followed by a ring of slots, one slot per timer tick:
+ *
+ *   +--------------------+  offset 0
+ *   | MIX_TAP_HEADER     |
+ *   +--------------------+  offset iHeaderSize
+ *   | slot 0             |
+ *   +--------------------+  offset iHeaderSize + iSlotSize
+ *   | slot 1             |
+ *   | ...                |
+ *   | slot iNumSlots - 1 |
+ *   +--------------------+
+ *
+ * Each slot consists of a MIX_TAP_SLOT_HEADER followed by iNumStreams
+ * streams, each of iStreamSize bytes:
+ *
+ *   MIX_TAP_SLOT_HEADER | stream 0 | stream 1 | ... | stream iNumStreams - 1
+ *
+ * Stream 0 is the room mix (all sources with unity gain, always stereo),
+ * stream n (n > 0) is the decoded audio of the client on channel n - 1 (the
+ * same numbering as the faders). Each stream consists of a
+ * MIX_TAP_STREAM_HEADER followed by iFrameSizeSamples interleaved samples of
+ * iNumAudioChannels channels (signed 16 bit, native byte order). The space
+ * of a stream is always large enough for stereo. A stream with zero audio
+ * channels is not connected and contains no audio.
+ *
+ * All values are in native byte order, the tap is only meant for processes
+ * on the same machine.
+ *
+ * Synchronization: there is exactly one writer (the mixer of the server)
+ * which never waits for the readers. The audio of the tick with the sequence
+ * number t (counted from zero) is written in slot t % iNumSlots:
+ *
+ *   1. iSeq of the slot is set to 2 * t + 1 (the slot is being written)
+ *   2. the streams are written
+ *   3. iSeq of the slot is set to 2 * t + 2 (the slot is complete)
+ *   4. iWriteSeq of the header is set to t + 1
+ *
+ * with memory barriers between the steps. A reader copies the streams it is
+ * interested in and accepts the copy only if iSeq of the slot was 2 * t + 2
+ * before and after the copy. Otherwise the writer has overtaken the reader.
+ * The sequence numbers are 32 bit values which wrap around.
+ *
+ * Readers map the object read-only, therefore they cannot block or corrupt
+ * the mixer. The object is only readable by the user of the server (and
+ * optionally by its group, see the server option --mixtapgroup). The reader library in this directory (mixtapreader.h/.c)
+ * implements the protocol described above.
+ */
+
+#if !defined ( MIXTAPLAYOUT_HOIHGE7LKJH83JH8_3_4344HGT65ZTEIUHF1912__INCLUDED_ )
+#define MIXTAPLAYOUT_HOIHGE7LKJH83JH8_3_4344HGT65ZTEIUHF1912__INCLUDED_
+
+#include <stdint.h>
+
+
+/* Definitions ****************************************************************/
+// "JMTP" in little endian byte order
+#define MIX_TAP_MAGIC                       0x50544D4A
+
+// the version is incremented on any change of the layout
+#define MIX_TAP_VERSION                     1
+
+// the room mix is always the first stream
+#define MIX_TAP_ROOM_MIX_STREAM             0
+
+
+/* Types **********************************************************************/
+typedef struct
+{
+    uint32_t          iMagic;
+    uint32_t          iVersion;
+    uint32_t          iHeaderSize;       // offset of the first slot in bytes
+    uint32_t          iSampleRate;       // samples per second
+    uint32_t          iFrameSizeSamples; // samples per audio channel and tick
+    uint32_t          iNumStreams;       // room mix and one stream per channel
+    uint32_t          iNumSlots;         // number of ticks in the ring
+    uint32_t          iSlotSize;         // size of a slot in bytes
+    uint32_t          iStreamSize;       // size of a stream in bytes
+    volatile uint32_t iWriteSeq;         // number of completely written ticks
+    uint32_t          iWriterPid;        // process ID of the server
+    uint32_t          iReserved[5];
+} MIX_TAP_HEADER;
+
+typedef struct
+{
+    volatile uint32_t iSeq;              // 2 * t + 1 while written, then 2 * t + 2
+    uint32_t          iReserved;
+} MIX_TAP_SLOT_HEADER;
+
+typedef struct
+{
+    uint32_t          iNumAudioChannels; // 0 (not connected), 1 or 2
+    uint32_t          iReserved;
+} MIX_TAP_STREAM_HEADER;
+
+#endif /* !defined ( MIXTAPLAYOUT_HOIHGE7LKJH83JH8_3_4344HGT65ZTEIUHF1912__INCLUDED_ ) */
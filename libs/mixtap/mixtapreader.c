@@ -0,0 +1,182 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2014
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#include "mixtapreader.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/* Implementation *************************************************************/
+int MixTapOpen ( MIX_TAP_READER* pReader,
+                 const char*     strName )
+{
+    struct stat           FileStat;
+    const MIX_TAP_HEADER* pHeader;
+    void*                 pMap;
+    int                   iFd;
+
+    memset ( pReader, 0, sizeof ( MIX_TAP_READER ) );
+
+    /* the object is mapped read-only, the reader cannot modify it */
+    iFd = shm_open ( strName, O_RDONLY, 0 );
+
+    if ( iFd < 0 )
+    {
+        return MIX_TAP_ERROR;
+    }
+
+    if ( ( fstat ( iFd, &FileStat ) != 0 ) ||
+         ( FileStat.st_size < ( off_t ) sizeof ( MIX_TAP_HEADER ) ) )
+    {
+        close ( iFd );
+        return MIX_TAP_ERROR;
+    }
+
+    pMap = mmap ( NULL, FileStat.st_size, PROT_READ, MAP_SHARED, iFd, 0 );
+
+    /* the mapping stays valid after the file descriptor is closed */
+    close ( iFd );
+
+    if ( pMap == MAP_FAILED )
+    {
+        return MIX_TAP_ERROR;
+    }
+
+    pHeader = ( const MIX_TAP_HEADER* ) pMap;
+
+    /* check that the layout is known and matches the size of the object */
+    if ( ( pHeader->iMagic != MIX_TAP_MAGIC ) ||
+         ( pHeader->iVersion != MIX_TAP_VERSION ) ||
+         ( ( size_t ) pHeader->iHeaderSize +
+           ( size_t ) pHeader->iNumSlots * pHeader->iSlotSize >
+           ( size_t ) FileStat.st_size ) ||
+         ( pHeader->iNumSlots == 0 ) ||
+         ( pHeader->iStreamSize < sizeof ( MIX_TAP_STREAM_HEADER ) +
+           2 * pHeader->iFrameSizeSamples * sizeof ( int16_t ) ) )
+    {
+        munmap ( pMap, FileStat.st_size );
+        return MIX_TAP_ERROR;
+    }
+
+    pReader->pHeader  = pHeader;
+    pReader->pSlots   = ( const uint8_t* ) pMap + pHeader->iHeaderSize;
+    pReader->iMapSize = FileStat.st_size;
+    pReader->iNextSeq = pHeader->iWriteSeq;
+
+    return MIX_TAP_OK;
+}
+
+void MixTapClose ( MIX_TAP_READER* pReader )
+{
+    if ( pReader->pHeader != NULL )
+    {
+        munmap ( ( void* ) pReader->pHeader, pReader->iMapSize );
+        pReader->pHeader = NULL;
+    }
+}
+
+int MixTapGetFrameSize ( const MIX_TAP_READER* pReader )
+{
+    return ( int ) pReader->pHeader->iFrameSizeSamples;
+}
+
+int MixTapGetNumStreams ( const MIX_TAP_READER* pReader )
+{
+    return ( int ) pReader->pHeader->iNumStreams;
+}
+
+int MixTapRead ( MIX_TAP_READER* pReader,
+                 const int       iStream,
+                 int16_t*        psData,
+                 int*            piNumAudioChannels )
+{
+    const MIX_TAP_HEADER*        pHeader = pReader->pHeader;
+    const MIX_TAP_SLOT_HEADER*   pSlot;
+    const MIX_TAP_STREAM_HEADER* pStream;
+    uint32_t                     iWriteSeq;
+    uint32_t                     iSeqBefore;
+    uint32_t                     iSeqAfter;
+    uint32_t                     iNumAudioChannels;
+
+    if ( ( iStream < 0 ) || ( ( uint32_t ) iStream >= pHeader->iNumStreams ) )
+    {
+        return MIX_TAP_ERROR;
+    }
+
+    iWriteSeq = pHeader->iWriteSeq;
+    __sync_synchronize();
+
+    if ( iWriteSeq == pReader->iNextSeq )
+    {
+        return MIX_TAP_NO_DATA;
+    }
+
+    /* the slot after the latest tick may already be overwritten (the
+       difference also handles the wrap around of the sequence numbers) */
+    if ( iWriteSeq - pReader->iNextSeq >= pHeader->iNumSlots )
+    {
+        pReader->iNextSeq = iWriteSeq - 1;
+        return MIX_TAP_OVERRUN;
+    }
+
+    pSlot = ( const MIX_TAP_SLOT_HEADER* ) ( pReader->pSlots +
+        ( size_t ) ( pReader->iNextSeq % pHeader->iNumSlots ) * pHeader->iSlotSize );
+
+    pStream = ( const MIX_TAP_STREAM_HEADER* ) ( ( const uint8_t* ) pSlot +
+        sizeof ( MIX_TAP_SLOT_HEADER ) + ( size_t ) iStream * pHeader->iStreamSize );
+
+    /* copy the stream and check that the writer did not modify the slot in
+       the meantime */
+    iSeqBefore = pSlot->iSeq;
+    __sync_synchronize();
+
+    iNumAudioChannels = pStream->iNumAudioChannels;
+
+    if ( iNumAudioChannels > 2 )
+    {
+        iNumAudioChannels = 0;
+    }
+
+    memcpy ( psData,
+             ( const uint8_t* ) pStream + sizeof ( MIX_TAP_STREAM_HEADER ),
+             iNumAudioChannels * pHeader->iFrameSizeSamples * sizeof ( int16_t ) );
+
+    __sync_synchronize();
+    iSeqAfter = pSlot->iSeq;
+
+    if ( ( iSeqBefore != iSeqAfter ) ||
+         ( iSeqBefore != 2 * pReader->iNextSeq + 2 ) )
+    {
+        pReader->iNextSeq = pHeader->iWriteSeq;
+        return MIX_TAP_OVERRUN;
+    }
+
+    *piNumAudioChannels = ( int ) iNumAudioChannels;
+    pReader->iNextSeq++;
+
+    return MIX_TAP_OK;
+}
@@ -0,0 +1,114 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2014
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+/*
+ * Reader library for the shared memory mix tap of the Jamulus server (see
+ * mixtaplayout.h for the layout). It is plain C without further dependencies
+ * and can be compiled into any program on a POSIX system, e.g.:
+ *
+ *   cc -O2 -c mixtapreader.c
+ *   cc -o myreader myreader.c mixtapreader.o -lrt
+ *
+ * Example (read the room mix of a server started with "--mixtap /jamulus"):
+ *
+ *   MIX_TAP_READER Reader;
+ *   int16_t        sData[2 * 256];
+ *   int            iNumAudioChannels;
+ *
+ *   if ( MixTapOpen ( &Reader, "/jamulus" ) == MIX_TAP_OK )
+ *   {
+ *       for ( ;; )
+ *       {
+ *           const int iRet = MixTapRead ( &Reader, MIX_TAP_ROOM_MIX_STREAM,
+ *                                         sData, &iNumAudioChannels );
+ *
+ *           if ( iRet == MIX_TAP_NO_DATA )
+ *           {
+ *               usleep ( 1000 ); // wait for the next tick
+ *           }
+ *           else if ( iRet == MIX_TAP_OK )
+ *           {
+ *               // process MixTapGetFrameSize ( &Reader ) samples
+ *           }
+ *       }
+ *   }
+ *
+ * A reader never blocks and never writes to the shared memory. If it falls
+ * behind by more than the ring size, the audio is lost and MIX_TAP_OVERRUN
+ * is returned once, after which the reader continues with the latest tick.
+ */
+
+#if !defined ( MIXTAPREADER_HOIHGE7LKJH83JH8_3_4344HGT65ZTEIUHF1912__INCLUDED_ )
+#define MIXTAPREADER_HOIHGE7LKJH83JH8_3_4344HGT65ZTEIUHF1912__INCLUDED_
+
+#include <stddef.h>
+#include "mixtaplayout.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Definitions ****************************************************************/
+// return values
+#define MIX_TAP_OK                          0
+#define MIX_TAP_NO_DATA                     1  // the next tick is not yet written
+#define MIX_TAP_OVERRUN                     2  // audio was lost, the reader continues
+#define MIX_TAP_ERROR                       ( -1 )
+
+
+/* Types **********************************************************************/
+typedef struct
+{
+    const MIX_TAP_HEADER* pHeader;
+    const uint8_t*        pSlots;
+    size_t                iMapSize;
+    uint32_t              iNextSeq;
+} MIX_TAP_READER;
+
+
+/* Functions ******************************************************************/
+// maps the shared memory object with the given name (e.g. "/jamulus"), the
+// reader starts with the latest tick
+int MixTapOpen ( MIX_TAP_READER* pReader, const char* strName );
+
+void MixTapClose ( MIX_TAP_READER* pReader );
+
+// number of samples per audio channel of each tick and number of streams
+int MixTapGetFrameSize ( const MIX_TAP_READER* pReader );
+int MixTapGetNumStreams ( const MIX_TAP_READER* pReader );
+
+// Copies the next tick of the given stream in psData which must have space
+// for two times the frame size samples. A reader is intended for one stream,
+// use one reader for each stream (the mapping is cheap).
+int MixTapRead ( MIX_TAP_READER* pReader,
+                 const int       iStream,
+                 int16_t*        psData,
+                 int*            piNumAudioChannels );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !defined ( MIXTAPREADER_HOIHGE7LKJH83JH8_3_4344HGT65ZTEIUHF1912__INCLUDED_ ) */
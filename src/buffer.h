@@ -25,6 +25,7 @@
 #if !defined ( BUFFER_H__3B123453_4344_BB23945IUHF1912__INCLUDED_ )
 #define BUFFER_H__3B123453_4344_BB23945IUHF1912__INCLUDED_
 
+#include <QAtomicInt>
 #include "util.h"
 #include "global.h"
 
@@ -484,4 +485,120 @@ protected:
     int            iPutPos;
 };
 
+
+// Lock-free ring buffer (single producer, single consumer) ---------------------
+// Used for handing data from the real-time timer of the server to a worker
+// thread: neither side ever waits for the other one. If the buffer is full,
+// the put call fails and the caller drops the data.
+template<class TData> class CSpscRingBuffer
+{
+public:
+    CSpscRingBuffer() : iMemSize ( 0 ), iPutPos ( 0 ), iGetPos ( 0 ) {}
+
+    // must not be called while the producer or the consumer is active
+    void Init ( const int iNewMemSize )
+    {
+        // one element is always unused to distinguish a full from an empty
+        // buffer
+        iMemSize = iNewMemSize + 1;
+        vecMemory.Init ( iMemSize );
+        iPutPos.fetchAndStoreRelease ( 0 );
+        iGetPos.fetchAndStoreRelease ( 0 );
+    }
+
+    int GetAvailSpace()
+    {
+        return ( iGetPos.fetchAndAddAcquire ( 0 ) -
+            iPutPos.fetchAndAddAcquire ( 0 ) - 1 + iMemSize ) % iMemSize;
+    }
+
+    int GetAvailData()
+    {
+        return ( iPutPos.fetchAndAddAcquire ( 0 ) -
+            iGetPos.fetchAndAddAcquire ( 0 ) + iMemSize ) % iMemSize;
+    }
+
+    // producer side
+    bool Put ( const TData* pData,
+               const int    iNumData )
+    {
+        const int iCurPutPos = iPutPos.fetchAndAddAcquire ( 0 );
+
+        if ( ( iMemSize == 0 ) || ( iNumData > GetAvailSpace() ) )
+        {
+            return false;
+        }
+
+        // copy in up to two parts because of the wrap around
+        const int iFirstPartLen = min ( iNumData, iMemSize - iCurPutPos );
+
+        std::copy ( pData, pData + iFirstPartLen, &vecMemory[iCurPutPos] );
+        std::copy ( pData + iFirstPartLen, pData + iNumData, &vecMemory[0] );
+
+        // the data must be written before the consumer sees the new position
+        iPutPos.fetchAndStoreRelease ( ( iCurPutPos + iNumData ) % iMemSize );
+
+        return true;
+    }
+
+    // puts the given number of elements with the same value
+    bool PutValue ( const TData tValue,
+                    const int   iNumData )
+    {
+        const int iCurPutPos = iPutPos.fetchAndAddAcquire ( 0 );
+
+        if ( ( iMemSize == 0 ) || ( iNumData > GetAvailSpace() ) )
+        {
+            return false;
+        }
+
+        const int iFirstPartLen = min ( iNumData, iMemSize - iCurPutPos );
+
+        std::fill ( vecMemory.begin() + iCurPutPos,
+                    vecMemory.begin() + iCurPutPos + iFirstPartLen,
+                    tValue );
+
+        std::fill ( vecMemory.begin(),
+                    vecMemory.begin() + ( iNumData - iFirstPartLen ),
+                    tValue );
+
+        iPutPos.fetchAndStoreRelease ( ( iCurPutPos + iNumData ) % iMemSize );
+
+        return true;
+    }
+
+    // consumer side
+    bool Get ( TData*    pData,
+               const int iNumData )
+    {
+        const int iCurGetPos = iGetPos.fetchAndAddAcquire ( 0 );
+
+        if ( ( iMemSize == 0 ) || ( iNumData > GetAvailData() ) )
+        {
+            return false;
+        }
+
+        const int iFirstPartLen = min ( iNumData, iMemSize - iCurGetPos );
+
+        std::copy ( &vecMemory[iCurGetPos],
+                    &vecMemory[iCurGetPos] + iFirstPartLen,
+                    pData );
+
+        std::copy ( &vecMemory[0],
+                    &vecMemory[0] + ( iNumData - iFirstPartLen ),
+                    pData + iFirstPartLen );
+
+        // the data must be read before the producer may overwrite it
+        iGetPos.fetchAndStoreRelease ( ( iCurGetPos + iNumData ) % iMemSize );
+
+        return true;
+    }
+
+protected:
+    CVector<TData> vecMemory;
+    int            iMemSize;
+    QAtomicInt     iPutPos;
+    QAtomicInt     iGetPos;
+};
+
 #endif /* !defined ( BUFFER_H__3B123453_4344_BB23945IUHF1912__INCLUDED_ ) */
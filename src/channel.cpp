@@ -27,14 +27,28 @@
 
 // CChannel implementation *****************************************************
 CChannel::CChannel ( const bool bNIsServer ) :
-    vecdGains          ( MAX_NUM_CHANNELS, (double) 1.0 ),
-    bDoAutoSockBufSize ( true ),
-    bIsEnabled         ( false ),
-    bIsServer          ( bNIsServer )
+    vecdGains                 ( MAX_NUM_CHANNELS, (double) 1.0 ),
+    bDoAutoSockBufSize        ( true ),
+    bIsEnabled                ( false ),
+    bIsServer                 ( bNIsServer ),
+    bSmallFrameSizeSupported  ( false ),
+    iSendPacketCnt            ( 0 ),
+    iLastRecPacketCnt         ( 0 ),
+    bRecPacketCntValid        ( false ),
+    iNumUnderrunsSinceLastPut ( 0 ),
+    iRecStatNumFrames         ( 0 ),
+    iRecStatNumLostFrames     ( 0 ),
+    vecConClientList          ( 0 ),
+    iConClientListVersion     ( 0 )
 {
     // reset network transport properties
     ResetNetworkTransportProperties();
 
+    // the jitter buffer slots hold the frames of the initial network
+    // transport properties
+    iSockBufFrameSize = iNetwFrameSize;
+    vecbySockBufPacket.Init ( GetSockBufSlotSize() * iNetwFrameSizeFact );
+
     // initial value for connection time out counter, we calculate the total
     // number of samples here and subtract the number of samples of the block
     // which we take out of the buffer to be independent of block sizes
@@ -84,6 +98,10 @@ qRegisterMetaType<CHostAddress> ( "CHostAddress" );
         SIGNAL ( ConClientListMesReceived ( CVector<CChannelInfo> ) ),
         SIGNAL ( ConClientListMesReceived ( CVector<CChannelInfo> ) ) );
 
+    QObject::connect ( &Protocol,
+        SIGNAL ( ConClientListDeltaMesReceived ( int, int, CVector<int>, CVector<CChannelInfo> ) ),
+        this, SLOT ( OnConClientListDeltaMesReceived ( int, int, CVector<int>, CVector<CChannelInfo> ) ) );
+
     QObject::connect( &Protocol, SIGNAL ( ChangeChanGain ( int, double ) ),
         this, SLOT ( OnChangeChanGain ( int, double ) ) );
 
@@ -109,6 +127,26 @@ QObject::connect ( &Protocol,
     QObject::connect ( &Protocol,
         SIGNAL ( ReqNetTranspProps() ),
         this, SLOT ( OnReqNetTranspProps() ) );
+
+    QObject::connect ( &Protocol,
+        SIGNAL ( SupportedFeaturesReceived ( int ) ),
+        this, SLOT ( OnSupportedFeaturesReceived ( int ) ) );
+
+    QObject::connect ( &Protocol,
+        SIGNAL ( ReceiverReportReceived ( int, int ) ),
+        SIGNAL ( ReceiverReportReceived ( int, int ) ) );
+
+    // the statistics and the frame size change are signalled from the audio
+    // thread, the protocol messages must be sent from our own thread
+    QObject::connect ( this,
+        SIGNAL ( RecStatisticsReady ( int, int ) ),
+        this, SLOT ( OnRecStatisticsReady ( int, int ) ),
+        Qt::QueuedConnection );
+
+    QObject::connect ( this,
+        SIGNAL ( NetwFrameSizeChanged() ),
+        this, SLOT ( OnReqNetTranspProps() ),
+        Qt::QueuedConnection );
 }
 
 bool CChannel::ProtocolIsEnabled()
@@ -139,13 +177,22 @@ void CChannel::SetEnable ( const bool bNEnStat )
     {
         iConTimeOut = 0;
         Protocol.Reset();
+
+        // the features of the other side are unknown until the next
+        // connection is established
+        iRemoteFeatures = 0;
+
+        // the connected clients list is received again on the next connection
+        iConClientListVersion = 0;
     }
 }
 
 void CChannel::SetAudioStreamProperties ( const EAudComprType eNewAudComprType,
                                           const int iNewNetwFrameSize,
                                           const int iNewNetwFrameSizeFact,
-                                          const int iNewNumAudioChannels )
+                                          const int iNewNumAudioChannels,
+                                          const int iNewNumRedundantPackets,
+                                          const int iNewAudioFrameSizeSamples )
 {
 /*
     this function is intended for the client (not the server)
@@ -160,18 +207,24 @@ void CChannel::SetAudioStreamProperties ( const EAudComprType eNewAudComprType,
         iNumAudioChannels     = iNewNumAudioChannels;
         iNetwFrameSize        = iNewNetwFrameSize;
         iNetwFrameSizeFact    = iNewNetwFrameSizeFact;
+        iNumRedundantPackets  = iNewNumRedundantPackets;
+
+        iAudioFrameSizeSamples = iNewAudioFrameSizeSamples;
 
         MutexSocketBuf.lock();
         {
             // init socket buffer
-            SockBuf.Init ( iNetwFrameSize, iCurSockBufNumFrames );
+            InitSockBuf();
         }
         MutexSocketBuf.unlock();
 
         MutexConvBuf.lock();
         {
             // init conversion buffer
-            ConvBuf.Init ( iNetwFrameSize * iNetwFrameSizeFact );
+            iSendNetwFrameSize = iNetwFrameSize;
+            iPendNetwFrameSize = 0;
+            ConvBuf.Init ( iSendNetwFrameSize * iNetwFrameSizeFact );
+            InitRedundancySend();
         }
         MutexConvBuf.unlock();
 
@@ -185,6 +238,49 @@ void CChannel::SetAudioStreamProperties ( const EAudComprType eNewAudComprType,
     Protocol.CreateNetwTranspPropsMes ( NetworkTransportProps );
 }
 
+void CChannel::SetNetwFrameSize ( const int iNewNetwFrameSize )
+{
+/*
+    this function is intended for the client (not the server)
+*/
+
+    Mutex.lock();
+    {
+        MutexSocketBuf.lock();
+        {
+            // the server sends frames of the old size until it has received
+            // our new network transport properties, these frames are still
+            // accepted and the buffered frames are kept (only a frame larger
+            // than the jitter buffer slots requires a new buffer)
+            iPrevNetwFrameSize = iNetwFrameSize;
+            iNetwFrameSize     = iNewNetwFrameSize;
+
+            if ( iNetwFrameSize > iSockBufFrameSize )
+            {
+                InitSockBuf();
+            }
+        }
+        MutexSocketBuf.unlock();
+
+        MutexConvBuf.lock();
+        {
+            // the audio thread calls this function at a packet boundary, i.e.
+            // the conversion buffer is empty and can be initialized with the
+            // new size without losing audio data
+            iSendNetwFrameSize = iNetwFrameSize;
+            iPendNetwFrameSize = 0;
+            ConvBuf.Init ( iSendNetwFrameSize * iNetwFrameSizeFact );
+            InitRedundancySend();
+        }
+        MutexConvBuf.unlock();
+    }
+    Mutex.unlock();
+
+    // tell the server about the new network settings (the message is sent
+    // from the thread of the channel object)
+    emit NetwFrameSizeChanged();
+}
+
 bool CChannel::SetSockBufNumFrames ( const int  iNewNumFrames,
                                      const bool bPreserve )
 {
@@ -203,9 +299,9 @@ bool CChannel::SetSockBufNumFrames ( const int  iNewNumFrames,
                 // store new value
                 iCurSockBufNumFrames = iNewNumFrames;
 
-                // the network block size is a multiple of the minimum network
-                // block size
-                SockBuf.Init ( iNetwFrameSize, iNewNumFrames, bPreserve );
+                // the block size of the jitter buffer is the slot size of one
+                // network frame
+                SockBuf.Init ( GetSockBufSlotSize(), iNewNumFrames, bPreserve );
 
                 // store current auto socket buffer size setting in the mutex
                 // region since if we use the current parameter below in the
@@ -234,6 +330,14 @@ bool CChannel::SetSockBufNumFrames ( const int  iNewNumFrames,
     return ReturnValue; // set error flag
 }
 
+double CChannel::GetSockBufFillLevel()
+{
+    QMutexLocker locker ( &MutexSocketBuf );
+
+    // the block size of the jitter buffer is the slot size of one frame
+    return static_cast<double> ( SockBuf.GetAvailData() ) / GetSockBufSlotSize();
+}
+
 void CChannel::SetGain ( const int    iChanID,
                          const double dNewGain )
 {
@@ -304,7 +408,7 @@ QString CChannel::GetName()
     return ChannelInfo.strName;
 }
 
-void CChannel::OnSendProtMessage ( CVector<uint8_t> vecMessage )
+void CChannel::OnSendProtMessage ( const CVector<uint8_t>& vecMessage )
 {
     // only send messages if protocol is enabled, otherwise delete complete
     // queue
@@ -380,41 +484,271 @@ void CChannel::OnNetTranspPropsReceived ( CNetworkTransportProps NetworkTranspor
     // only the server shall act on network transport properties message
     if ( bIsServer )
     {
-        Mutex.lock();
+        const int iNewAudioFrameSizeSamples =
+            NetworkTransportProps.GetFrameSizeSamples();
+
+        // the client must not use the small frame size if we did not tell
+        // him that we support it, ignore the message in this case
+        if ( ( iNewAudioFrameSizeSamples != SYSTEM_FRAME_SIZE_SAMPLES ) &&
+             !bSmallFrameSizeSupported )
         {
-            // store received parameters
-            eAudioCompressionType = NetworkTransportProps.eAudioCodingType;
-            iNumAudioChannels     = NetworkTransportProps.iNumAudioChannels;
-            iNetwFrameSizeFact    = NetworkTransportProps.iBlockSizeFact;
-            iNetwFrameSize =
-                NetworkTransportProps.iBaseNetworkPacketSize;
+            return;
+        }
 
-            MutexSocketBuf.lock();
+        Mutex.lock();
+        {
+            const int iNewNetwFrameSize =
+                static_cast<int> ( NetworkTransportProps.iBaseNetworkPacketSize );
+
+            // if only the coded frame size of the running stream is changed
+            // (bit rate adaptation of the client), the buffers are kept
+            const bool bOnlyFrameSizeChanged =
+                ( eAudioCompressionType != CT_NONE ) &&
+                ( eAudioCompressionType  == NetworkTransportProps.eAudioCodingType ) &&
+                ( iAudioFrameSizeSamples == iNewAudioFrameSizeSamples ) &&
+                ( iNumAudioChannels      == static_cast<int> ( NetworkTransportProps.iNumAudioChannels ) ) &&
+                ( iNetwFrameSizeFact     == static_cast<int> ( NetworkTransportProps.iBlockSizeFact ) ) &&
+                ( iNumRedundantPackets   == static_cast<int> ( NetworkTransportProps.iNumRedundantPackets ) ) &&
+                ( iNewNetwFrameSize      <= iSockBufFrameSize );
+
+            if ( bOnlyFrameSizeChanged )
             {
-                // update socket buffer (the network block size is a multiple of the
-                // minimum network frame size
-                SockBuf.Init ( iNetwFrameSize, iCurSockBufNumFrames );
+                if ( iNewNetwFrameSize != iNetwFrameSize )
+                {
+                    MutexSocketBuf.lock();
+                    {
+                        // frames of the old size which are still on the way
+                        // are accepted until the first frame of the new size
+                        // is received
+                        iPrevNetwFrameSize = iNetwFrameSize;
+                        iNetwFrameSize     = iNewNetwFrameSize;
+                    }
+                    MutexSocketBuf.unlock();
+
+                    MutexConvBuf.lock();
+                    {
+                        // the conversion buffer may hold a part of a packet,
+                        // the new size is applied when the packet is sent
+                        iPendNetwFrameSize = iNewNetwFrameSize;
+                    }
+                    MutexConvBuf.unlock();
+                }
             }
-            MutexSocketBuf.unlock();
-
-            MutexConvBuf.lock();
+            else
             {
-                // init conversion buffer
-                ConvBuf.Init ( iNetwFrameSize * iNetwFrameSizeFact );
+                // store received parameters
+                eAudioCompressionType  = NetworkTransportProps.eAudioCodingType;
+                iAudioFrameSizeSamples = iNewAudioFrameSizeSamples;
+                iNumAudioChannels      = NetworkTransportProps.iNumAudioChannels;
+                iNetwFrameSizeFact     = NetworkTransportProps.iBlockSizeFact;
+                iNetwFrameSize         = iNewNetwFrameSize;
+
+                // the redundancy is used for both directions
+                iNumRedundantPackets =
+                    NetworkTransportProps.iNumRedundantPackets;
+
+                MutexSocketBuf.lock();
+                {
+                    // update socket buffer
+                    InitSockBuf();
+                }
+                MutexSocketBuf.unlock();
+
+                MutexConvBuf.lock();
+                {
+                    // init conversion buffer
+                    iSendNetwFrameSize = iNetwFrameSize;
+                    iPendNetwFrameSize = 0;
+                    ConvBuf.Init ( iSendNetwFrameSize * iNetwFrameSizeFact );
+                    InitRedundancySend();
+                }
+                MutexConvBuf.unlock();
             }
-            MutexConvBuf.unlock();
         }
         Mutex.unlock();
 
         // if old CELT codec is used, inform the client that the new OPUS codec
         // is supported
-        if ( NetworkTransportProps.eAudioCodingType != CT_OPUS )
+        if ( NetworkTransportProps.eAudioCodingType == CT_CELT )
         {
             Protocol.CreateOpusSupportedMes();
         }
     }
 }
 
+void CChannel::OnSupportedFeaturesReceived ( int iFeatures )
+{
+    // store the features of the other side and inform the client/server
+    iRemoteFeatures = iFeatures;
+
+    // from now on multiple protocol messages may be sent in one datagram
+    Protocol.SetMessContainerEnabled (
+        ( iFeatures & PROT_FEATURE_MESS_CONTAINER ) != 0 );
+
+    emit SupportedFeaturesReceived();
+}
+
+void CChannel::OnConClientListDeltaMesReceived ( int                   iBaseVersion,
+                                                 int                   iVersion,
+                                                 CVector<int>          veciRemovedChanIDs,
+                                                 CVector<CChannelInfo> vecChanInfo )
+{
+    int i, j;
+
+    if ( iBaseVersion == 0 )
+    {
+        // the message contains the complete list
+        vecConClientList.Init ( vecChanInfo.Size() );
+        vecConClientList = vecChanInfo;
+    }
+    else
+    {
+        if ( iBaseVersion != iConClientListVersion )
+        {
+            // the changes do not apply to our list (e.g. we have received the
+            // list with the old message before), request the complete list
+            Protocol.CreateReqConnClientsList();
+            return;
+        }
+
+        // take all entries of the current list which are not removed or
+        // changed (the list is ordered by the channel ID)
+        CVector<CChannelInfo> vecNewList ( 0 );
+
+        for ( i = 0; i < vecConClientList.Size(); i++ )
+        {
+            const int iCurChanID = vecConClientList[i].iChanID;
+            bool      bKeep      = true;
+
+            for ( j = 0; j < veciRemovedChanIDs.Size(); j++ )
+            {
+                if ( veciRemovedChanIDs[j] == iCurChanID )
+                {
+                    bKeep = false;
+                }
+            }
+
+            for ( j = 0; j < vecChanInfo.Size(); j++ )
+            {
+                if ( vecChanInfo[j].iChanID == iCurChanID )
+                {
+                    bKeep = false;
+                }
+            }
+
+            if ( bKeep )
+            {
+                vecNewList.Add ( vecConClientList[i] );
+            }
+        }
+
+        // insert the changed and added entries at the correct position
+        for ( i = 0; i < vecChanInfo.Size(); i++ )
+        {
+            j = 0;
+
+            while ( ( j < vecNewList.Size() ) &&
+                    ( vecNewList[j].iChanID < vecChanInfo[i].iChanID ) )
+            {
+                j++;
+            }
+
+            vecNewList.insert ( vecNewList.begin() + j, vecChanInfo[i] );
+        }
+
+        vecConClientList.Init ( vecNewList.Size() );
+        vecConClientList = vecNewList;
+    }
+
+    iConClientListVersion = iVersion;
+
+    // the client only sees the complete list
+    emit ConClientListMesReceived ( vecConClientList );
+}
+
+void CChannel::OnRecStatisticsReady ( int iNumFrames,
+                                      int iNumLostFrames )
+{
+    // only the client adapts the network transport properties, therefore
+    // only the server reports its receive statistics
+    if ( bIsServer && ( iRemoteFeatures & PROT_FEATURE_RECEIVER_REPORT ) &&
+         ProtocolIsEnabled() )
+    {
+        Protocol.CreateReceiverReportMes ( iNumFrames, iNumLostFrames );
+    }
+}
+
+void CChannel::InitSockBuf()
+{
+/*
+    note that this function must be called with locked socket buffer mutex
+*/
+    // the slots of the jitter buffer can hold frames up to the current
+    // network frame size
+    iSockBufFrameSize  = iNetwFrameSize;
+    iPrevNetwFrameSize = 0;
+
+    vecbySockBufPacket.Init ( GetSockBufSlotSize() * iNetwFrameSizeFact );
+
+    SockBuf.Init ( GetSockBufSlotSize(), iCurSockBufNumFrames );
+    InitRedundancyRec();
+}
+
+bool CChannel::PutSockBufFrames ( const CVector<uint8_t>& vecbyData,
+                                  const int               iStartPos,
+                                  const int               iFrameSize,
+                                  const int               iNumFrames )
+{
+/*
+    note that this function must be called with locked socket buffer mutex
+*/
+    const int iSlotSize = GetSockBufSlotSize();
+
+    // check that the frames fit in the jitter buffer slots
+    if ( ( iFrameSize > iSockBufFrameSize ) ||
+         ( iNumFrames * iSlotSize > vecbySockBufPacket.Size() ) )
+    {
+        return false;
+    }
+
+    // store each frame with its size in one slot
+    for ( int i = 0; i < iNumFrames; i++ )
+    {
+        const int iSlotPos = i * iSlotSize;
+
+        vecbySockBufPacket[iSlotPos]     = static_cast<uint8_t> ( iFrameSize & 0xFF );
+        vecbySockBufPacket[iSlotPos + 1] = static_cast<uint8_t> ( iFrameSize >> 8 );
+
+        std::copy ( vecbyData.begin() + iStartPos + i * iFrameSize,
+                    vecbyData.begin() + iStartPos + ( i + 1 ) * iFrameSize,
+                    vecbySockBufPacket.begin() + iSlotPos + SOCK_BUF_SLOT_HEADER_SIZE );
+    }
+
+    // all frames of a packet are put at once in the jitter buffer
+    return SockBuf.Put ( vecbySockBufPacket, iNumFrames * iSlotSize );
+}
+
+void CChannel::InitRedundancyRec()
+{
+/*
+    note that this function must be called with locked socket buffer mutex
+*/
+    bRecPacketCntValid        = false;
+    iNumUnderrunsSinceLastPut = 0;
+}
+
+void CChannel::InitRedundancySend()
+{
+/*
+    note that this function must be called with locked conversion buffer mutex
+*/
+    // the redundant packet buffer also stores the history of the previous
+    // packets (at their positions in the packet)
+    vecbyRedundantPacket.Init ( GetAudioPacketSize ( iSendNetwFrameSize ) );
+
+    iSendPacketCnt = 0;
+}
+
 void CChannel::OnReqNetTranspProps()
 {
     // fill network transport properties struct from current settings and send it
@@ -432,7 +766,9 @@ CNetworkTransportProps CChannel::GetNetworkTransportPropsFromCurrentSettings()
         SYSTEM_SAMPLE_RATE_HZ,
         eAudioCompressionType,
         0, // version of the codec
-        0 );
+        ( iAudioFrameSizeSamples == SYSTEM_FRAME_SIZE_SAMPLES ) ?
+            0 : iAudioFrameSizeSamples, // the default frame size is signalled by 0
+        iNumRedundantPackets );
 }
 
 void CChannel::Disconnect()
@@ -480,11 +816,40 @@ EPutDataStat CChannel::PutAudioData ( const CVector<uint8_t>& vecbyData,
     {
         MutexSocketBuf.lock();
         {
-            // only process audio if packet has correct size
-            if ( iNumBytes == ( iNetwFrameSize * iNetwFrameSizeFact ) )
+            // while the coded frame size is changed, the packets of the old
+            // frame size are accepted until the first packet of the new frame
+            // size is received (switch point)
+            int iFrameSize = iNetwFrameSize;
+
+            if ( iPrevNetwFrameSize > 0 )
+            {
+                if ( ( iNumBytes == GetAudioPacketSize ( iNetwFrameSize ) ) ||
+                     ( iNumBytes == iNetwFrameSize * iNetwFrameSizeFact ) )
+                {
+                    // the packet counter of the redundancy starts again with
+                    // the new frame size
+                    iPrevNetwFrameSize = 0;
+                    bRecPacketCntValid = false;
+                }
+                else if ( ( iNumBytes == GetAudioPacketSize ( iPrevNetwFrameSize ) ) ||
+                          ( iNumBytes == iPrevNetwFrameSize * iNetwFrameSizeFact ) )
+                {
+                    iFrameSize = iPrevNetwFrameSize;
+                }
+            }
+
+            // only process audio if packet has correct size (packets without
+            // redundancy are still accepted since the other side may not
+            // have applied the redundancy setting yet)
+            if ( ( iNumRedundantPackets > 0 ) &&
+                 ( iNumBytes == GetAudioPacketSize ( iFrameSize ) ) )
+            {
+                eRet = PutRedundantAudioData ( vecbyData, iFrameSize );
+            }
+            else if ( iNumBytes == ( iFrameSize * iNetwFrameSizeFact ) )
             {
                 // store new packet in jitter buffer
-                if ( SockBuf.Put ( vecbyData, iNumBytes ) )
+                if ( PutSockBufFrames ( vecbyData, 0, iFrameSize, iNetwFrameSizeFact ) )
                 {
                     eRet = PS_AUDIO_OK;
                 }
@@ -492,6 +857,8 @@ EPutDataStat CChannel::PutAudioData ( const CVector<uint8_t>& vecbyData,
                 {
                     eRet = PS_AUDIO_ERR;
                 }
+
+                iNumUnderrunsSinceLastPut = 0;
             }
             else
             {
@@ -512,6 +879,15 @@ EPutDataStat CChannel::PutAudioData ( const CVector<uint8_t>& vecbyData,
             {
                 // overwrite status
                 eRet = PS_NEW_CONNECTION;
+
+                // the channels of the server are reused for new clients, the
+                // protocol state of the previous client must not be applied
+                // to the new connection (the client resets its protocol when
+                // its channel is disabled)
+                if ( bIsServer )
+                {
+                    Protocol.Reset();
+                }
             }
 
             // reset time-out counter (note that this must be done after the
@@ -528,15 +904,111 @@ EPutDataStat CChannel::PutAudioData ( const CVector<uint8_t>& vecbyData,
     return eRet;
 }
 
+EPutDataStat CChannel::PutRedundantAudioData ( const CVector<uint8_t>& vecbyData,
+                                               const int               iFrameSize )
+{
+/*
+    note that this function must be called with locked socket buffer mutex
+*/
+    const int iAudioSize   = iFrameSize * iNetwFrameSizeFact;
+    const int iCurCnt      = vecbyData[GetAudioPacketSize ( iFrameSize ) - 1];
+    int       iNumRecovPck = 0;
+    int       iNumSkipFra  = 0;
+
+    if ( bRecPacketCntValid )
+    {
+        // the packet counter wraps around at 255
+        const int iCntDiff = ( iCurCnt - iLastRecPacketCnt + 256 ) % 256;
+
+        // a duplicated or a late packet (reordering) is dropped since the
+        // audio data were already recovered or concealed
+        if ( ( iCntDiff == 0 ) || ( iCntDiff > 128 ) )
+        {
+            return PS_AUDIO_OK;
+        }
+
+        // we can only recover the lost packets which are still contained
+        // in the current packet
+        const int iNumLostPck = iCntDiff - 1;
+        iNumRecovPck          = std::min ( iNumLostPck, iNumRedundantPackets );
+
+        // the frames of the lost packets which were already concealed by
+        // the decoder (jitter buffer underruns) must not be inserted anymore,
+        // the oldest lost packets are the ones which cannot be recovered
+        iNumSkipFra = std::max ( 0, iNumUnderrunsSinceLastPut -
+            ( iNumLostPck - iNumRecovPck ) * iNetwFrameSizeFact );
+    }
+
+    iLastRecPacketCnt  = iCurCnt;
+    bRecPacketCntValid = true;
+
+    bool bPutOK = true;
+
+    // put the recovered packets in the jitter buffer, oldest first (the
+    // previous packets are stored newest first after the current data)
+    for ( int i = iNumRecovPck; i > 0; i-- )
+    {
+        for ( int j = 0; j < iNetwFrameSizeFact; j++ )
+        {
+            if ( iNumSkipFra > 0 )
+            {
+                iNumSkipFra--;
+            }
+            else
+            {
+                bPutOK &= PutSockBufFrames ( vecbyData,
+                                             i * iAudioSize + j * iFrameSize,
+                                             iFrameSize,
+                                             1 );
+            }
+        }
+    }
+
+    // store current packet in jitter buffer
+    bPutOK &= PutSockBufFrames ( vecbyData, 0, iFrameSize, iNetwFrameSizeFact );
+
+    iNumUnderrunsSinceLastPut = 0;
+
+    if ( bPutOK )
+    {
+        return PS_AUDIO_OK;
+    }
+    else
+    {
+        return PS_AUDIO_ERR;
+    }
+}
+
 EGetDataStat CChannel::GetData ( CVector<uint8_t>& vecbyData,
-                                 const int         iNumBytes )
+                                 int&              iNumBytes )
 {
     EGetDataStat eGetStatus;
+    bool         bRecStatReady         = false;
+    int          iCurRecStatNumFrames  = 0;
+    int          iCurRecStatNumLostFra = 0;
 
     MutexSocketBuf.lock();
     {
-        // the socket access must be inside a mutex
-        const bool bSockBufState = SockBuf.Get ( vecbyData, iNumBytes );
+        // the socket access must be inside a mutex, the size of the frame is
+        // stored in front of the frame in the jitter buffer slot (the frames
+        // may have different sizes while the coded frame size is changed)
+        bool bSockBufState = SockBuf.Get ( vecbySockBufPacket, GetSockBufSlotSize() );
+
+        if ( bSockBufState )
+        {
+            iNumBytes = vecbySockBufPacket[0] | ( vecbySockBufPacket[1] << 8 );
+
+            if ( ( iNumBytes > 0 ) && ( iNumBytes <= vecbyData.Size() ) )
+            {
+                std::copy ( vecbySockBufPacket.begin() + SOCK_BUF_SLOT_HEADER_SIZE,
+                            vecbySockBufPacket.begin() + SOCK_BUF_SLOT_HEADER_SIZE + iNumBytes,
+                            vecbyData.begin() );
+            }
+            else
+            {
+                bSockBufState = false;
+            }
+        }
 
         // decrease time-out counter
         if ( iConTimeOut > 0 )
@@ -544,12 +1016,9 @@ EGetDataStat CChannel::GetData ( CVector<uint8_t>& vecbyData,
             // subtract the number of samples of the current block since the
             // time out counter is based on samples not on blocks (definition:
             // always one atomic block is get by using the GetData() function
-            // where the atomic block size is "SYSTEM_FRAME_SIZE_SAMPLES")
-
-// TODO this code only works with the above assumption -> better
-// implementation so that we are not depending on assumptions
-
-            iConTimeOut -= SYSTEM_FRAME_SIZE_SAMPLES;
+            // where the atomic block size is the audio frame size of the
+            // channel)
+            iConTimeOut -= iAudioFrameSizeSamples;
 
             if ( iConTimeOut <= 0 )
             {
@@ -562,6 +1031,23 @@ EGetDataStat CChannel::GetData ( CVector<uint8_t>& vecbyData,
             }
             else
             {
+                // update audio receive statistics
+                iRecStatNumFrames++;
+
+                if ( !bSockBufState )
+                {
+                    iRecStatNumLostFrames++;
+                }
+
+                if ( iRecStatNumFrames * iAudioFrameSizeSamples >= REC_STAT_NUM_SAMPLES )
+                {
+                    bRecStatReady         = true;
+                    iCurRecStatNumFrames  = iRecStatNumFrames;
+                    iCurRecStatNumLostFra = iRecStatNumLostFrames;
+                    iRecStatNumFrames     = 0;
+                    iRecStatNumLostFrames = 0;
+                }
+
                 if ( bSockBufState )
                 {
                     // everything is ok
@@ -571,6 +1057,9 @@ EGetDataStat CChannel::GetData ( CVector<uint8_t>& vecbyData,
                 {
                     // channel is not yet disconnected but no data in buffer
                     eGetStatus = GS_BUFFER_UNDERRUN;
+
+                    // count the concealed frames for the packet recovery
+                    iNumUnderrunsSinceLastPut++;
                 }
             }
         }
@@ -589,6 +1078,11 @@ EGetDataStat CChannel::GetData ( CVector<uint8_t>& vecbyData,
         emit Disconnected();
     }
 
+    if ( bRecStatReady )
+    {
+        emit RecStatisticsReady ( iCurRecStatNumFrames, iCurRecStatNumLostFra );
+    }
+
     return eGetStatus;
 }
 
@@ -602,13 +1096,50 @@ void CChannel::PrepAndSendPacket ( CHighPrioSocket*        pSocket,
     // block size
     if ( ConvBuf.Put ( vecbyNPacket, iNPacketLen ) )
     {
-        pSocket->SendPacket ( ConvBuf.Get(), GetAddress() );
+        if ( iNumRedundantPackets > 0 )
+        {
+            const int iAudioSize = iSendNetwFrameSize * iNetwFrameSizeFact;
+
+            // shift the history of the previous packets by one packet (the
+            // oldest packet is dropped) and put the current data in front
+            std::copy_backward ( vecbyRedundantPacket.begin(),
+                                 vecbyRedundantPacket.begin() + iNumRedundantPackets * iAudioSize,
+                                 vecbyRedundantPacket.begin() + ( iNumRedundantPackets + 1 ) * iAudioSize );
+
+            const CVector<uint8_t>& vecbyCurPacket = ConvBuf.Get();
+
+            std::copy ( vecbyCurPacket.begin(),
+                        vecbyCurPacket.begin() + iAudioSize,
+                        vecbyRedundantPacket.begin() );
+
+            // the packet counter is the last byte of the packet
+            vecbyRedundantPacket[vecbyRedundantPacket.Size() - 1] =
+                static_cast<uint8_t> ( iSendPacketCnt );
+
+            iSendPacketCnt = ( iSendPacketCnt + 1 ) % 256;
+
+            pSocket->SendPacket ( vecbyRedundantPacket, GetAddress() );
+        }
+        else
+        {
+            pSocket->SendPacket ( ConvBuf.Get(), GetAddress() );
+        }
+
+        // a new frame size is applied at the packet boundary so that no
+        // packet contains frames of different sizes
+        if ( iPendNetwFrameSize > 0 )
+        {
+            iSendNetwFrameSize = iPendNetwFrameSize;
+            iPendNetwFrameSize = 0;
+            ConvBuf.Init ( iSendNetwFrameSize * iNetwFrameSizeFact );
+            InitRedundancySend();
+        }
     }
 }
 
 int CChannel::GetUploadRateKbps()
 {
-    const int iAudioSizeOut = iNetwFrameSizeFact * SYSTEM_FRAME_SIZE_SAMPLES;
+    const int iAudioSizeOut = iNetwFrameSizeFact * iAudioFrameSizeSamples;
 
     // we assume that the UDP packet which is transported via IP has an
     // additional header size of ("Network Music Performance (NMP) in narrow
@@ -616,7 +1147,7 @@ int CChannel::GetUploadRateKbps()
     // 8 (UDP) + 20 (IP without optional fields) = 28 bytes
     // 2 (PPP) + 6 (PPPoE) + 18 (MAC)            = 26 bytes
     // 5 (RFC1483B) + 8 (AAL) + 10 (ATM)         = 23 bytes
-    return ( iNetwFrameSize * iNetwFrameSizeFact + 28 + 26 + 23 /* header */ ) *
+    return ( GetAudioPacketSize ( iSendNetwFrameSize ) + 28 + 26 + 23 /* header */ ) *
         8 /* bits per byte */ *
         SYSTEM_SAMPLE_RATE_HZ / iAudioSizeOut / 1000;
 }
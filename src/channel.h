@@ -42,6 +42,14 @@
 // correction is implemented)
 #define CON_TIME_OUT_SEC_MAX                30 // seconds
 
+// number of samples for the audio receive statistics (one second)
+#define REC_STAT_NUM_SAMPLES                SYSTEM_SAMPLE_RATE_HZ
+
+// each coded frame in the jitter buffer is stored in a slot which starts
+// with the size of the frame (two bytes) so that frames of different sizes
+// can be buffered while the coded frame size is changed
+#define SOCK_BUF_SLOT_HEADER_SIZE           2
+
 enum EPutDataStat
 {
     PS_GEN_ERROR,
@@ -51,7 +59,9 @@ enum EPutDataStat
     PS_PROT_OK,
     PS_PROT_OK_MESS_NOT_EVALUATED,
     PS_PROT_ERR,
-    PS_NEW_CONNECTION
+    PS_NEW_CONNECTION,
+    PS_UNKNOWN_SENDER, // server only: connection challenge must be sent
+    PS_SERVER_FULL     // server only: no free channel available
 };
 
 
@@ -75,7 +85,7 @@ public:
                                 CHostAddress            RecHostAddr );
 
     EGetDataStat GetData ( CVector<uint8_t>& vecbyData,
-                           const int         iNumBytes );
+                           int&              iNumBytes );
 
     void PrepAndSendPacket ( CHighPrioSocket*        pSocket,
                              const CVector<uint8_t>& vecbyNPacket,
@@ -118,6 +128,12 @@ Protocol.CreateChanNameMes ( ChInfo.strName );
                                const bool bPreserve = false );
     int GetSockBufNumFrames() const { return iCurSockBufNumFrames; }
 
+    // jitter buffer fill level in number of frames (used for the clock drift
+    // compensation), the target is half the buffer size
+    double GetSockBufFillLevel();
+    double GetSockBufTargetFillLevel() const
+        { return static_cast<double> ( iCurSockBufNumFrames ) / 2; }
+
     void UpdateSocketBufferSize();
 
     int GetUploadRateKbps();
@@ -126,7 +142,14 @@ Protocol.CreateChanNameMes ( ChInfo.strName );
     void SetAudioStreamProperties ( const EAudComprType eNewAudComprType,
                                     const int iNewNetwFrameSize,
                                     const int iNewNetwFrameSizeFact,
-                                    const int iNewNumAudioChannels );
+                                    const int iNewNumAudioChannels,
+                                    const int iNewNumRedundantPackets = 0,
+                                    const int iNewAudioFrameSizeSamples = SYSTEM_FRAME_SIZE_SAMPLES );
+
+    // change the coded audio frame size of a running stream (e.g. for bit
+    // rate adaptation), may be called from the audio thread at a packet
+    // boundary, the buffered audio is kept
+    void SetNetwFrameSize ( const int iNewNetwFrameSize );
 
     void SetDoAutoSockBufSize ( const bool bValue )
         { bDoAutoSockBufSize = bValue; }
@@ -134,13 +157,23 @@ Protocol.CreateChanNameMes ( ChInfo.strName );
     bool GetDoAutoSockBufSize() const { return bDoAutoSockBufSize; }
 
     int GetNetwFrameSizeFact() const { return iNetwFrameSizeFact; }
-    int GetNetwFrameSize() const { return iNetwFrameSize; }
+    // the frame size which must be used for coding the next frame to be sent
+    int GetNetwFrameSize() const { return iSendNetwFrameSize; }
+    int GetAudioFrameSizeSamples() const { return iAudioFrameSizeSamples; }
+
+    // the server only accepts the small frame size if it is enabled
+    void SetSmallFrameSizeSupported ( const bool bValue )
+        { bSmallFrameSizeSupported = bValue; }
 
     void GetBufErrorRates ( CVector<double>& vecErrRates, double& dLimit )
         { SockBuf.GetErrorRates ( vecErrRates, dLimit ); }
 
     EAudComprType GetAudioCompressionType() { return eAudioCompressionType; }
     int GetNumAudioChannels() const { return iNumAudioChannels; }
+    int GetNumRedundantPackets() const { return iNumRedundantPackets; }
+
+    // features supported by the other side (PROT_FEATURE_x flags)
+    int GetRemoteFeatures() const { return iRemoteFeatures; }
 
     // network protocol interface
     void CreateJitBufMes ( const int iJitBufSize )
@@ -154,6 +187,7 @@ Protocol.CreateChanNameMes ( ChInfo.strName );
     void CreateReqJitBufMes()                             { Protocol.CreateReqJitBufMes(); }
     void CreateReqConnClientsList()                       { Protocol.CreateReqConnClientsList(); }
     void CreateChatTextMes ( const QString& strChatText ) { Protocol.CreateChatTextMes ( strChatText ); }
+    void CreateSupportedFeaturesMes ( const int iFeatures ) { Protocol.CreateSupportedFeaturesMes ( iFeatures ); }
 
 // #### COMPATIBILITY OLD VERSION, TO BE REMOVED ####
 void CreateConClientListNameMes ( const CVector<CChannelInfo>& vecChanInfo )
@@ -162,6 +196,16 @@ void CreateConClientListNameMes ( const CVector<CChannelInfo>& vecChanInfo )
     void CreateConClientListMes ( const CVector<CChannelInfo>& vecChanInfo )
         { Protocol.CreateConClientListMes ( vecChanInfo ); }
 
+// #### COMPATIBILITY OLD VERSION, TO BE REMOVED ####
+void CreatePreparedConClientListNameMes ( const CVector<uint8_t>& vecData )
+    { Protocol.CreatePreparedConClientListNameMes ( vecData ); }
+
+    void CreatePreparedConClientListMes ( const CVector<uint8_t>& vecData )
+        { Protocol.CreatePreparedConClientListMes ( vecData ); }
+
+    void CreatePreparedConClientListDeltaMes ( const CVector<uint8_t>& vecData )
+        { Protocol.CreatePreparedConClientListDeltaMes ( vecData ); }
+
     CNetworkTransportProps GetNetworkTransportPropsFromCurrentSettings();
 
 protected:
@@ -172,12 +216,47 @@ protected:
         // set it to a state were no decoding is ever possible (since we want
         // only to decode data when a network transport property message is
         // received with the correct values)
-        eAudioCompressionType = CT_NONE;
-        iNetwFrameSizeFact    = FRAME_SIZE_FACTOR_PREFERRED;
-        iNetwFrameSize        = CELT_MINIMUM_NUM_BYTES;
-        iNumAudioChannels     = 1; // mono
+        eAudioCompressionType  = CT_NONE;
+        iNetwFrameSizeFact     = FRAME_SIZE_FACTOR_PREFERRED;
+        iNetwFrameSize         = CELT_MINIMUM_NUM_BYTES;
+        iPrevNetwFrameSize     = 0;
+        iSendNetwFrameSize     = CELT_MINIMUM_NUM_BYTES;
+        iPendNetwFrameSize     = 0;
+        iAudioFrameSizeSamples = SYSTEM_FRAME_SIZE_SAMPLES;
+        iNumAudioChannels      = 1; // mono
+        iNumRedundantPackets   = 0; // no redundancy
+        iRemoteFeatures        = 0; // no features known
     }
 
+    int GetAudioPacketSize ( const int iFrameSize ) const
+    {
+        // with redundancy, the previous packets and the packet counter are
+        // appended to the current coded audio data
+        if ( iNumRedundantPackets > 0 )
+        {
+            return iFrameSize * iNetwFrameSizeFact *
+                ( 1 + iNumRedundantPackets ) + 1 /* packet cnt */;
+        }
+        else
+        {
+            return iFrameSize * iNetwFrameSizeFact;
+        }
+    }
+
+    int GetSockBufSlotSize() const
+        { return iSockBufFrameSize + SOCK_BUF_SLOT_HEADER_SIZE; }
+
+    void InitSockBuf();
+    bool PutSockBufFrames ( const CVector<uint8_t>& vecbyData,
+                            const int               iStartPos,
+                            const int               iFrameSize,
+                            const int               iNumFrames );
+
+    void InitRedundancyRec();
+    void InitRedundancySend();
+    EPutDataStat PutRedundantAudioData ( const CVector<uint8_t>& vecbyData,
+                                         const int               iFrameSize );
+
     // connection parameters
     CHostAddress      InetAddr;
 
@@ -191,6 +270,8 @@ protected:
     CNetBufWithStats  SockBuf;
     int               iCurSockBufNumFrames;
     bool              bDoAutoSockBufSize;
+    int               iSockBufFrameSize;
+    CVector<uint8_t>  vecbySockBufPacket;
 
     // network output conversion buffer
     CConvBuf<uint8_t> ConvBuf;
@@ -206,22 +287,51 @@ protected:
 
     int               iNetwFrameSizeFact;
     int               iNetwFrameSize;
+    int               iPrevNetwFrameSize; // accepted until the switch point
+    int               iSendNetwFrameSize;
+    int               iPendNetwFrameSize; // applied at the next packet boundary
+    int               iAudioFrameSizeSamples;
+    bool              bSmallFrameSizeSupported;
 
     EAudComprType     eAudioCompressionType;
     int               iNumAudioChannels;
+    int               iRemoteFeatures;
+
+    // redundancy for recovering lost audio packets
+    int               iNumRedundantPackets;
+    CVector<uint8_t>  vecbyRedundantPacket;
+    int               iSendPacketCnt;
+    int               iLastRecPacketCnt;
+    bool              bRecPacketCntValid;
+    int               iNumUnderrunsSinceLastPut;
+
+    // audio receive statistics
+    int               iRecStatNumFrames;
+    int               iRecStatNumLostFrames;
+
+    // connected clients list which is updated by the list changes (the
+    // version zero means that no valid list is available)
+    CVector<CChannelInfo> vecConClientList;
+    int                   iConClientListVersion;
 
     QMutex            Mutex;
     QMutex            MutexSocketBuf;
     QMutex            MutexConvBuf;
 
 public slots:
-    void OnSendProtMessage ( CVector<uint8_t> vecMessage );
+    void OnSendProtMessage ( const CVector<uint8_t>& vecMessage );
     void OnJittBufSizeChange ( int iNewJitBufSize );
     void OnChangeChanGain ( int iChanID, double dNewGain );
     void OnChangeChanName ( QString strName );
     void OnChangeChanInfo ( CChannelCoreInfo ChanInfo );
     void OnNetTranspPropsReceived ( CNetworkTransportProps NetworkTransportProps );
     void OnReqNetTranspProps();
+    void OnSupportedFeaturesReceived ( int iFeatures );
+    void OnRecStatisticsReady ( int iNumFrames, int iNumLostFrames );
+    void OnConClientListDeltaMesReceived ( int                   iBaseVersion,
+                                           int                   iVersion,
+                                           CVector<int>          veciRemovedChanIDs,
+                                           CVector<CChannelInfo> vecChanInfo );
 
     void OnParseMessageBody ( CVector<uint8_t> vecbyMesBodyData,
                               int              iRecCounter,
@@ -249,7 +359,7 @@ public slots:
     void OnNewConnection() { emit NewConnection(); }
 
 signals:
-    void MessReadyForSending ( CVector<uint8_t> vecMessage );
+    void MessReadyForSending ( const CVector<uint8_t>& vecMessage );
     void NewConnection();
     void ReqJittBufSize();
     void JittBufSizeChanged ( int iNewJitBufSize );
@@ -260,6 +370,10 @@ signals:
     void ChanInfoHasChanged();
     void ReqChanInfo();
     void OpusSupported();
+    void SupportedFeaturesReceived();
+    void RecStatisticsReady ( int iNumFrames, int iNumLostFrames );
+    void ReceiverReportReceived ( int iNumFrames, int iNumLostFrames );
+    void NetwFrameSizeChanged();
     void ChatTextReceived ( QString strChatText );
     void ReqNetTranspProps();
     void Disconnected();
@@ -44,6 +44,13 @@ CClient::CClient ( const quint16 iPortNumber ) :
     iCeltNumCodedBytes               ( CELT_NUM_BYTES_MONO_LOW_QUALITY ),
     eAudioQuality                    ( AQ_LOW ),
     eAudioChannelConf                ( CC_MONO ),
+    iAudioRedundancy                 ( 0 ),
+    bAudioUncompressed               ( false ),
+    bBitrateAdaptation               ( true ),
+    bSmallFrameSize                  ( false ),
+    iFrameSizeSamples                ( SYSTEM_FRAME_SIZE_SAMPLES ),
+    veciAdaptNumCodedBytes           (),
+    iAdaptNumCodedBytes              ( 0 ),
     bIsInitializationPhase           ( true ),
     Socket                           ( &Channel, iPortNumber ),
     Sound                            ( AudioCallback, this ),
@@ -139,6 +146,56 @@ CClient::CClient ( const quint16 iPortNumber ) :
                               OPUS_SET_COMPLEXITY ( 1 ) );
 #endif
 
+    // init OPUS encoder/decoder for the small frame size (mono and stereo)
+    OpusModeSmall = opus_custom_mode_create ( SYSTEM_SAMPLE_RATE_HZ,
+                                              SYSTEM_FRAME_SIZE_SAMPLES_SMALL,
+                                              &iOpusError );
+
+    OpusEncoderMonoSmall = opus_custom_encoder_create ( OpusModeSmall,
+                                                        1,
+                                                        &iOpusError );
+
+    OpusDecoderMonoSmall = opus_custom_decoder_create ( OpusModeSmall,
+                                                        1,
+                                                        &iOpusError );
+
+    OpusEncoderStereoSmall = opus_custom_encoder_create ( OpusModeSmall,
+                                                          2,
+                                                          &iOpusError );
+
+    OpusDecoderStereoSmall = opus_custom_decoder_create ( OpusModeSmall,
+                                                          2,
+                                                          &iOpusError );
+
+    // same settings as for the encoders with the default frame size
+    opus_custom_encoder_ctl ( OpusEncoderMonoSmall,
+                              OPUS_SET_VBR ( 0 ) );
+
+    opus_custom_encoder_ctl ( OpusEncoderMonoSmall,
+                              OPUS_SET_APPLICATION ( OPUS_APPLICATION_RESTRICTED_LOWDELAY ) );
+
+    opus_custom_encoder_ctl ( OpusEncoderStereoSmall,
+                              OPUS_SET_VBR ( 0 ) );
+
+    opus_custom_encoder_ctl ( OpusEncoderStereoSmall,
+                              OPUS_SET_APPLICATION ( OPUS_APPLICATION_RESTRICTED_LOWDELAY ) );
+
+#ifdef USE_LOW_COMPLEXITY_CELT_ENC
+    // set encoder low complexity
+    opus_custom_encoder_ctl ( OpusEncoderMonoSmall,
+                              OPUS_SET_COMPLEXITY ( 1 ) );
+
+    opus_custom_encoder_ctl ( OpusEncoderStereoSmall,
+                              OPUS_SET_COMPLEXITY ( 1 ) );
+#endif
+
+    // the default frame size is used until we know that the server supports
+    // the small frame size
+    pCurOpusEncoderMono   = OpusEncoderMono;
+    pCurOpusDecoderMono   = OpusDecoderMono;
+    pCurOpusEncoderStereo = OpusEncoderStereo;
+    pCurOpusDecoderStereo = OpusDecoderStereo;
+
 
     // Connections -------------------------------------------------------------
     // connections for the protocol mechanism
@@ -174,6 +231,21 @@ CClient::CClient ( const quint16 iPortNumber ) :
     QObject::connect ( &Channel, SIGNAL ( NewConnection() ),
         this, SLOT ( OnNewConnection() ) );
 
+    QObject::connect ( &Channel, SIGNAL ( SupportedFeaturesReceived() ),
+        this, SLOT ( OnSupportedFeaturesReceived() ) );
+
+    QObject::connect ( &Channel,
+        SIGNAL ( RecStatisticsReady ( int, int ) ),
+        this, SLOT ( OnRecStatisticsReady ( int, int ) ) );
+
+    QObject::connect ( &Channel,
+        SIGNAL ( ReceiverReportReceived ( int, int ) ),
+        this, SLOT ( OnReceiverReportReceived ( int, int ) ) );
+
+    QObject::connect ( &Channel,
+        SIGNAL ( NetwFrameSizeChanged() ),
+        SIGNAL ( UpstreamRateChanged() ) );
+
     QObject::connect ( &Channel,
         SIGNAL ( ChatTextReceived ( QString ) ),
         SIGNAL ( ChatTextReceived ( QString ) ) );
@@ -190,6 +262,10 @@ QObject::connect ( &Channel, SIGNAL ( OpusSupported() ),
         SIGNAL ( CLServerListReceived ( CHostAddress, CVector<CServerInfo> ) ),
         SIGNAL ( CLServerListReceived ( CHostAddress, CVector<CServerInfo> ) ) );
 
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLGroupServerReceived ( CHostAddress, CHostAddress ) ),
+        SIGNAL ( CLGroupServerReceived ( CHostAddress, CHostAddress ) ) );
+
     QObject::connect ( &ConnLessProtocol,
         SIGNAL ( CLPingReceived ( CHostAddress, int ) ),
         this, SLOT ( OnCLPingReceived ( CHostAddress, int ) ) );
@@ -198,6 +274,10 @@ QObject::connect ( &Channel, SIGNAL ( OpusSupported() ),
         SIGNAL ( CLPingWithNumClientsReceived ( CHostAddress, int, int ) ),
         this, SLOT ( OnCLPingWithNumClientsReceived ( CHostAddress, int, int ) ) );
 
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLConnChallengeReceived ( CHostAddress, quint32 ) ),
+        this, SLOT ( OnCLConnChallengeReceived ( CHostAddress, quint32 ) ) );
+
 #ifdef ENABLE_CLIENT_VERSION_AND_OS_DEBUGGING
     QObject::connect ( &ConnLessProtocol,
         SIGNAL ( CLVersionAndOSReceived ( CHostAddress, COSUtil::EOpSystemType, QString ) ),
@@ -217,15 +297,15 @@ QObject::connect ( &Channel, SIGNAL ( OpusSupported() ),
     Socket.Start();
 }
 
-void CClient::OnSendProtMessage ( CVector<uint8_t> vecMessage )
+void CClient::OnSendProtMessage ( const CVector<uint8_t>& vecMessage )
 {
     // the protocol queries me to call the function to send the message
     // send it through the network
     Socket.SendPacket ( vecMessage, Channel.GetAddress() );
 }
 
-void CClient::OnSendCLProtMessage ( CHostAddress     InetAddr,
-                                    CVector<uint8_t> vecMessage )
+void CClient::OnSendCLProtMessage ( CHostAddress            InetAddr,
+                                    const CVector<uint8_t>& vecMessage )
 {
     // the protocol queries me to call the function to send the message
     // send it through the network
@@ -244,6 +324,16 @@ void CClient::OnInvalidPacketReceived ( CHostAddress RecHostAddr )
     }
 }
 
+void CClient::OnCLConnChallengeReceived ( CHostAddress InetAddr,
+                                         quint32      iCookie )
+{
+    // only answer the challenge of the server we want to connect to
+    if ( IsRunning() && ( InetAddr == Channel.GetAddress() ) )
+    {
+        ConnLessProtocol.CreateCLConnChallengeRespMes ( InetAddr, iCookie );
+    }
+}
+
 void CClient::OnDetectedCLMessage ( CVector<uint8_t> vecbyMesBodyData,
                                     int              iRecID,
                                     CHostAddress     RecHostAddr )
@@ -281,6 +371,41 @@ void CClient::OnNewConnection()
     // Same problem is with the jitter buffer message.
     Channel.CreateReqConnClientsList();
     CreateServerJitterBufferMessage();
+
+    // tell the server which features this client supports
+    Channel.CreateSupportedFeaturesMes ( PROT_SUPPORTED_FEATURES );
+}
+
+void CClient::OnSupportedFeaturesReceived()
+{
+    // the redundancy, the uncompressed audio and the small frame size can
+    // only be used if the server supports it, since we now know the server
+    // features we have to re-initialize
+    const int iRemoteFeatures = Channel.GetRemoteFeatures();
+
+    if ( ( ( iAudioRedundancy > 0 ) &&
+           ( iRemoteFeatures & PROT_FEATURE_AUDIO_REDUNDANCY ) ) ||
+         ( bAudioUncompressed &&
+           ( iRemoteFeatures & PROT_FEATURE_AUDIO_PCM ) ) ||
+         ( bSmallFrameSize &&
+           ( iRemoteFeatures & PROT_FEATURE_SMALL_FRAME_SIZE ) ) )
+    {
+        const bool bWasRunning = Sound.IsRunning();
+        if ( bWasRunning )
+        {
+            Sound.Stop();
+        }
+
+        Init();
+
+        if ( bWasRunning )
+        {
+            Sound.Start();
+        }
+
+        // inform the GUI about the change of the network rate
+        emit UpstreamRateChanged();
+    }
 }
 
 void CClient::CreateServerJitterBufferMessage()
@@ -421,7 +546,7 @@ void CClient::SetSndCrdPrefFrameSizeFactor ( const int iNewFactor )
 // #### COMPATIBILITY OLD VERSION, TO BE REMOVED ####
 void CClient::OnOpusSupported()
 {
-    if ( eAudioCompressionType != CT_OPUS )
+    if ( eAudioCompressionType == CT_CELT )
     {
         SetAudoCompressiontype ( CT_OPUS );
     }
@@ -471,6 +596,111 @@ void CClient::SetAudioQuality ( const EAudioQuality eNAudioQuality )
     }
 }
 
+void CClient::OnReceiverReportReceived ( int iNumFrames,
+                                         int iNumLostFrames )
+{
+    // the server reports the receive statistics of our audio stream
+    BitrateAdaptation.PutRemoteStatistics ( iNumFrames, iNumLostFrames );
+}
+
+void CClient::OnRecStatisticsReady ( int iNumFrames,
+                                     int iNumLostFrames )
+{
+    // the bit rate adaptation is only supported for the OPUS codec
+    if ( bBitrateAdaptation &&
+         ( eAudioCompressionType == CT_OPUS ) &&
+         Channel.IsConnected() )
+    {
+        if ( BitrateAdaptation.PutLocalStatistics ( iNumFrames, iNumLostFrames ) )
+        {
+            // the new number of coded bytes is applied in the audio thread
+            // since the audio coding is done there
+            iAdaptNumCodedBytes.fetchAndStoreRelease (
+                veciAdaptNumCodedBytes[BitrateAdaptation.GetLevel()] );
+        }
+    }
+}
+
+void CClient::SetAudioUncompressed ( const bool bNAudioUncompr )
+{
+    // init with new parameter, if client was running then first
+    // stop it and restart again after new initialization
+    const bool bWasRunning = Sound.IsRunning();
+    if ( bWasRunning )
+    {
+        Sound.Stop();
+    }
+
+    // set new parameter
+    bAudioUncompressed = bNAudioUncompr;
+    Init();
+
+    if ( bWasRunning )
+    {
+        Sound.Start();
+    }
+}
+
+void CClient::SetSmallFrameSize ( const bool bNSmallFrameSize )
+{
+    // init with new parameter, if client was running then first
+    // stop it and restart again after new initialization
+    const bool bWasRunning = Sound.IsRunning();
+    if ( bWasRunning )
+    {
+        Sound.Stop();
+    }
+
+    // set new parameter
+    bSmallFrameSize = bNSmallFrameSize;
+    Init();
+
+    if ( bWasRunning )
+    {
+        Sound.Start();
+    }
+}
+
+void CClient::SetBitrateAdaptation ( const bool bNBitrateAdapt )
+{
+    // init with new parameter, if client was running then first
+    // stop it and restart again after new initialization
+    const bool bWasRunning = Sound.IsRunning();
+    if ( bWasRunning )
+    {
+        Sound.Stop();
+    }
+
+    // set new parameter
+    bBitrateAdaptation = bNBitrateAdapt;
+    Init();
+
+    if ( bWasRunning )
+    {
+        Sound.Start();
+    }
+}
+
+void CClient::SetAudioRedundancy ( const int iNAudioRedundancy )
+{
+    // init with new parameter, if client was running then first
+    // stop it and restart again after new initialization
+    const bool bWasRunning = Sound.IsRunning();
+    if ( bWasRunning )
+    {
+        Sound.Stop();
+    }
+
+    // set new parameter
+    iAudioRedundancy = iNAudioRedundancy;
+    Init();
+
+    if ( bWasRunning )
+    {
+        Sound.Start();
+    }
+}
+
 void CClient::SetAudioChannels ( const EAudChanConf eNAudChanConf )
 {
     // init with new parameter, if client was running then first
@@ -687,28 +917,60 @@ void CClient::Stop()
 
 void CClient::Init()
 {
+    // the uncompressed audio is only used if the server supports it,
+    // otherwise we fall back to the OPUS codec
+    if ( bAudioUncompressed &&
+         ( Channel.GetRemoteFeatures() & PROT_FEATURE_AUDIO_PCM ) )
+    {
+        eAudioCompressionType = CT_PCM;
+    }
+    else if ( eAudioCompressionType == CT_PCM )
+    {
+        eAudioCompressionType = CT_OPUS;
+    }
+
+    // the small frame size is only used if the server supports it (the old
+    // CELT codec only supports the default frame size)
+    if ( bSmallFrameSize && ( eAudioCompressionType != CT_CELT ) &&
+         ( Channel.GetRemoteFeatures() & PROT_FEATURE_SMALL_FRAME_SIZE ) )
+    {
+        iFrameSizeSamples     = SYSTEM_FRAME_SIZE_SAMPLES_SMALL;
+        pCurOpusEncoderMono   = OpusEncoderMonoSmall;
+        pCurOpusDecoderMono   = OpusDecoderMonoSmall;
+        pCurOpusEncoderStereo = OpusEncoderStereoSmall;
+        pCurOpusDecoderStereo = OpusDecoderStereoSmall;
+    }
+    else
+    {
+        iFrameSizeSamples     = SYSTEM_FRAME_SIZE_SAMPLES;
+        pCurOpusEncoderMono   = OpusEncoderMono;
+        pCurOpusDecoderMono   = OpusDecoderMono;
+        pCurOpusEncoderStereo = OpusEncoderStereo;
+        pCurOpusDecoderStereo = OpusDecoderStereo;
+    }
+
     // check if possible frame size factors are supported
     const int iFraSizePreffered =
-        FRAME_SIZE_FACTOR_PREFERRED * SYSTEM_FRAME_SIZE_SAMPLES;
+        FRAME_SIZE_FACTOR_PREFERRED * iFrameSizeSamples;
 
     bFraSiFactPrefSupported =
         ( Sound.Init ( iFraSizePreffered ) == iFraSizePreffered );
 
     const int iFraSizeDefault =
-        FRAME_SIZE_FACTOR_DEFAULT * SYSTEM_FRAME_SIZE_SAMPLES;
+        FRAME_SIZE_FACTOR_DEFAULT * iFrameSizeSamples;
 
     bFraSiFactDefSupported =
         ( Sound.Init ( iFraSizeDefault ) == iFraSizeDefault );
 
     const int iFraSizeSafe =
-        FRAME_SIZE_FACTOR_SAFE * SYSTEM_FRAME_SIZE_SAMPLES;
+        FRAME_SIZE_FACTOR_SAFE * iFrameSizeSamples;
 
     bFraSiFactSafeSupported =
         ( Sound.Init ( iFraSizeSafe ) == iFraSizeSafe );
 
     // translate block size index in actual block size
     const int iPrefMonoFrameSize =
-        iSndCrdPrefFrameSizeFactor * SYSTEM_FRAME_SIZE_SAMPLES;
+        iSndCrdPrefFrameSizeFactor * iFrameSizeSamples;
 
     // get actual sound card buffer size using preferred size
     iMonoBlockSizeSam = Sound.Init ( iPrefMonoFrameSize );
@@ -716,12 +978,12 @@ void CClient::Init()
     // Calculate the current sound card frame size factor. In case
     // the current mono block size is not a multiple of the system
     // frame size, we have to use a sound card conversion buffer.
-    if ( ( iMonoBlockSizeSam == ( SYSTEM_FRAME_SIZE_SAMPLES * FRAME_SIZE_FACTOR_PREFERRED ) ) ||
-         ( iMonoBlockSizeSam == ( SYSTEM_FRAME_SIZE_SAMPLES * FRAME_SIZE_FACTOR_DEFAULT ) ) ||
-         ( iMonoBlockSizeSam == ( SYSTEM_FRAME_SIZE_SAMPLES * FRAME_SIZE_FACTOR_SAFE ) ) )
+    if ( ( iMonoBlockSizeSam == ( iFrameSizeSamples * FRAME_SIZE_FACTOR_PREFERRED ) ) ||
+         ( iMonoBlockSizeSam == ( iFrameSizeSamples * FRAME_SIZE_FACTOR_DEFAULT ) ) ||
+         ( iMonoBlockSizeSam == ( iFrameSizeSamples * FRAME_SIZE_FACTOR_SAFE ) ) )
     {
         // regular case: one of our predefined buffer sizes is available
-        iSndCrdFrameSizeFactor = iMonoBlockSizeSam / SYSTEM_FRAME_SIZE_SAMPLES;
+        iSndCrdFrameSizeFactor = iMonoBlockSizeSam / iFrameSizeSamples;
 
         // no sound card conversion buffer required
         bSndCrdConversionBufferRequired  = false;
@@ -739,7 +1001,7 @@ void CClient::Init()
         // overwrite block size by smallest supported buffer size
         iSndCrdFrameSizeFactor = FRAME_SIZE_FACTOR_PREFERRED;
         iMonoBlockSizeSam =
-            SYSTEM_FRAME_SIZE_SAMPLES * FRAME_SIZE_FACTOR_PREFERRED;
+            iFrameSizeSamples * FRAME_SIZE_FACTOR_PREFERRED;
 
         iStereoBlockSizeSam = 2 * iMonoBlockSizeSam;
 
@@ -766,12 +1028,35 @@ void CClient::Init()
 
     vecsAudioSndCrdMono.Init ( iMonoBlockSizeSam );
 
+    // init clock drift compensation
+    if ( eAudioChannelConf == CC_MONO )
+    {
+        DriftComp.Init ( 1, iFrameSizeSamples );
+    }
+    else
+    {
+        DriftComp.Init ( 2, iFrameSizeSamples );
+    }
+
     // init reverberation
     AudioReverbL.Init ( SYSTEM_SAMPLE_RATE_HZ );
     AudioReverbR.Init ( SYSTEM_SAMPLE_RATE_HZ );
 
     // inits for audio coding
-    if ( eAudioCompressionType == CT_CELT )
+    if ( eAudioCompressionType == CT_PCM )
+    {
+        if ( eAudioChannelConf == CC_MONO )
+        {
+            iCeltNumCodedBytes =
+                PCM_NUM_BYTES_PER_SAMPLE * iFrameSizeSamples;
+        }
+        else
+        {
+            iCeltNumCodedBytes =
+                PCM_NUM_BYTES_PER_SAMPLE * 2 * iFrameSizeSamples;
+        }
+    }
+    else if ( eAudioCompressionType == CT_CELT )
     {
         if ( eAudioChannelConf == CC_MONO )
         {
@@ -798,68 +1083,59 @@ void CClient::Init()
     }
     else
     {
-        if ( eAudioChannelConf == CC_MONO )
-        {
-            switch ( eAudioQuality )
-            {
-            case AQ_LOW:
-                iCeltNumCodedBytes = OPUS_NUM_BYTES_MONO_LOW_QUALITY;
-                break;
-
-            case AQ_NORMAL:
-                iCeltNumCodedBytes = OPUS_NUM_BYTES_MONO_NORMAL_QUALITY;
-                break;
-
-            case AQ_HIGH:
-                iCeltNumCodedBytes = OPUS_NUM_BYTES_MONO_HIGH_QUALITY;
-                break;
-            }
-        }
-        else
-        {
-            switch ( eAudioQuality )
-            {
-            case AQ_LOW:
-                iCeltNumCodedBytes = OPUS_NUM_BYTES_STEREO_LOW_QUALITY;
-                break;
+        iCeltNumCodedBytes = GetOpusNumCodedBytes ( eAudioQuality );
+    }
+    vecCeltData.Init ( iCeltNumCodedBytes );
 
-            case AQ_NORMAL:
-                iCeltNumCodedBytes = OPUS_NUM_BYTES_STEREO_NORMAL_QUALITY;
-                break;
+    // init bit rate adaptation: the quality selected by the user is the
+    // highest level, the adaptation can only reduce the bit rate (note that
+    // therefore the size of the coded data vectors is sufficient)
+    veciAdaptNumCodedBytes.Init ( static_cast<int> ( eAudioQuality ) + 1 );
 
-            case AQ_HIGH:
-                iCeltNumCodedBytes = OPUS_NUM_BYTES_STEREO_HIGH_QUALITY;
-                break;
-            }
-        }
+    for ( int iLevel = 0; iLevel < veciAdaptNumCodedBytes.Size(); iLevel++ )
+    {
+        veciAdaptNumCodedBytes[iLevel] =
+            GetOpusNumCodedBytes ( static_cast<EAudioQuality> ( iLevel ) );
     }
-    vecCeltData.Init ( iCeltNumCodedBytes );
+
+    BitrateAdaptation.Init ( veciAdaptNumCodedBytes.Size() );
+    iAdaptNumCodedBytes.fetchAndStoreRelease ( iCeltNumCodedBytes );
 
     if ( eAudioChannelConf == CC_MONO )
     {
-        opus_custom_encoder_ctl ( OpusEncoderMono,
+        opus_custom_encoder_ctl ( pCurOpusEncoderMono,
                                   OPUS_SET_BITRATE (
                                       CalcBitRateBitsPerSecFromCodedBytes (
-                                          iCeltNumCodedBytes ) ) );
+                                          iCeltNumCodedBytes, iFrameSizeSamples ) ) );
     }
     else
     {
-        opus_custom_encoder_ctl ( OpusEncoderStereo,
+        opus_custom_encoder_ctl ( pCurOpusEncoderStereo,
                                   OPUS_SET_BITRATE (
                                       CalcBitRateBitsPerSecFromCodedBytes (
-                                          iCeltNumCodedBytes ) ) );
+                                          iCeltNumCodedBytes, iFrameSizeSamples ) ) );
     }
 
     // inits for network and channel
     vecbyNetwData.Init ( iCeltNumCodedBytes );
 
+    // the redundant audio packets are only used if the server supports them
+    int iNumRedundantPackets = 0;
+
+    if ( Channel.GetRemoteFeatures() & PROT_FEATURE_AUDIO_REDUNDANCY )
+    {
+        iNumRedundantPackets = iAudioRedundancy;
+    }
+
     if ( eAudioChannelConf == CC_MONO )
     {
         // set the channel network properties
         Channel.SetAudioStreamProperties ( eAudioCompressionType,
                                            iCeltNumCodedBytes,
                                            iSndCrdFrameSizeFactor,
-                                           1 );
+                                           1,
+                                           iNumRedundantPackets,
+                                           iFrameSizeSamples );
     }
     else
     {
@@ -867,13 +1143,59 @@ void CClient::Init()
         Channel.SetAudioStreamProperties ( eAudioCompressionType,
                                            iCeltNumCodedBytes,
                                            iSndCrdFrameSizeFactor,
-                                           2 );
+                                           2,
+                                           iNumRedundantPackets,
+                                           iFrameSizeSamples );
     }
 
     // reset initialization phase flag
     bIsInitializationPhase = true;
 }
 
+int CClient::GetOpusNumCodedBytes ( const EAudioQuality eQuality ) const
+{
+    int iNumCodedBytes = OPUS_NUM_BYTES_MONO_LOW_QUALITY; // should never be used
+
+    if ( eAudioChannelConf == CC_MONO )
+    {
+        switch ( eQuality )
+        {
+        case AQ_LOW:
+            iNumCodedBytes = OPUS_NUM_BYTES_MONO_LOW_QUALITY;
+            break;
+
+        case AQ_NORMAL:
+            iNumCodedBytes = OPUS_NUM_BYTES_MONO_NORMAL_QUALITY;
+            break;
+
+        case AQ_HIGH:
+            iNumCodedBytes = OPUS_NUM_BYTES_MONO_HIGH_QUALITY;
+            break;
+        }
+    }
+    else
+    {
+        switch ( eQuality )
+        {
+        case AQ_LOW:
+            iNumCodedBytes = OPUS_NUM_BYTES_STEREO_LOW_QUALITY;
+            break;
+
+        case AQ_NORMAL:
+            iNumCodedBytes = OPUS_NUM_BYTES_STEREO_NORMAL_QUALITY;
+            break;
+
+        case AQ_HIGH:
+            iNumCodedBytes = OPUS_NUM_BYTES_STEREO_HIGH_QUALITY;
+            break;
+        }
+    }
+
+    // the number of bytes per packet is defined for the default frame size,
+    // with the small frame size we send twice as many packets
+    return iNumCodedBytes * iFrameSizeSamples / SYSTEM_FRAME_SIZE_SAMPLES;
+}
+
 void CClient::AudioCallback ( CVector<int16_t>& psData, void* arg )
 {
     // get the pointer to the object
@@ -916,7 +1238,7 @@ void CClient::ProcessSndCrdAudioData ( CVector<int16_t>& vecsStereoSndCrd )
 
 void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
 {
-    int i, j;
+    int i, j, k;
 
     // Transmit signal ---------------------------------------------------------
     // update stereo signal level meter
@@ -1064,24 +1386,59 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
         }
     }
 
-    for ( i = 0; i < iSndCrdFrameSizeFactor; i++ )
+    // apply a new number of coded bytes requested by the bit rate adaptation
+    // (the stream is not re-initialized, only the encoder bit rate and the
+    // network frame size of the channel are changed)
+    const int iNewNumCodedBytes = iAdaptNumCodedBytes.fetchAndAddAcquire ( 0 );
+
+    if ( iNewNumCodedBytes != iCeltNumCodedBytes )
     {
+        iCeltNumCodedBytes = iNewNumCodedBytes;
+
         if ( eAudioChannelConf == CC_MONO )
+        {
+            opus_custom_encoder_ctl ( pCurOpusEncoderMono,
+                                      OPUS_SET_BITRATE (
+                                          CalcBitRateBitsPerSecFromCodedBytes (
+                                              iCeltNumCodedBytes, iFrameSizeSamples ) ) );
+        }
+        else
+        {
+            opus_custom_encoder_ctl ( pCurOpusEncoderStereo,
+                                      OPUS_SET_BITRATE (
+                                          CalcBitRateBitsPerSecFromCodedBytes (
+                                              iCeltNumCodedBytes, iFrameSizeSamples ) ) );
+        }
+
+        Channel.SetNetwFrameSize ( iCeltNumCodedBytes );
+    }
+
+    for ( i = 0; i < iSndCrdFrameSizeFactor; i++ )
+    {
+        if ( eAudioCompressionType == CT_PCM )
+        {
+            // uncompressed audio, no encoding required (for mono, the
+            // samples are stored in the first half of the vector)
+            PcmEncode ( &vecsStereoSndCrd[i * iCeltNumCodedBytes / PCM_NUM_BYTES_PER_SAMPLE],
+                        &vecCeltData[0],
+                        iCeltNumCodedBytes / PCM_NUM_BYTES_PER_SAMPLE );
+        }
+        else if ( eAudioChannelConf == CC_MONO )
         {
             // encode current audio frame
             if ( eAudioCompressionType == CT_CELT )
             {
                 cc6_celt_encode ( CeltEncoderMono,
-                                  &vecsStereoSndCrd[i * SYSTEM_FRAME_SIZE_SAMPLES],
+                                  &vecsStereoSndCrd[i * iFrameSizeSamples],
                                   NULL,
                                   &vecCeltData[0],
                                   iCeltNumCodedBytes );
             }
             else
             {
-                opus_custom_encode ( OpusEncoderMono,
-                                     &vecsStereoSndCrd[i * SYSTEM_FRAME_SIZE_SAMPLES],
-                                     SYSTEM_FRAME_SIZE_SAMPLES,
+                opus_custom_encode ( pCurOpusEncoderMono,
+                                     &vecsStereoSndCrd[i * iFrameSizeSamples],
+                                     iFrameSizeSamples,
                                      &vecCeltData[0],
                                      iCeltNumCodedBytes );
             }
@@ -1092,16 +1449,16 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
             if ( eAudioCompressionType == CT_CELT )
             {
                 cc6_celt_encode ( CeltEncoderStereo,
-                                  &vecsStereoSndCrd[i * 2 * SYSTEM_FRAME_SIZE_SAMPLES],
+                                  &vecsStereoSndCrd[i * 2 * iFrameSizeSamples],
                                   NULL,
                                   &vecCeltData[0],
                                   iCeltNumCodedBytes );
             }
             else
             {
-                opus_custom_encode ( OpusEncoderStereo,
-                                     &vecsStereoSndCrd[i * 2 * SYSTEM_FRAME_SIZE_SAMPLES],
-                                     SYSTEM_FRAME_SIZE_SAMPLES,
+                opus_custom_encode ( pCurOpusEncoderStereo,
+                                     &vecsStereoSndCrd[i * 2 * iFrameSizeSamples],
+                                     iFrameSizeSamples,
                                      &vecCeltData[0],
                                      iCeltNumCodedBytes );
             }
@@ -1117,100 +1474,155 @@ void CClient::ProcessAudioDataIntern ( CVector<int16_t>& vecsStereoSndCrd )
     // Receive signal ----------------------------------------------------------
     for ( i = 0; i < iSndCrdFrameSizeFactor; i++ )
     {
-        // receive a new block
-        const bool bReceiveDataOk =
-            ( Channel.GetData ( vecbyNetwData, iCeltNumCodedBytes ) == GS_BUFFER_OK );
+        // the decoded audio is stored in the mono buffer for mono and directly
+        // in the sound card buffer for stereo
+        int16_t* psCurDecodedBlock;
 
-        // invalidate the buffer OK status flag if necessary
-        if ( !bReceiveDataOk )
+        if ( eAudioChannelConf == CC_MONO )
+        {
+            psCurDecodedBlock = &vecsAudioSndCrdMono[i * iFrameSizeSamples];
+        }
+        else
         {
-            bJitterBufferOK = false;
+            psCurDecodedBlock = &vecsStereoSndCrd[i * 2 * iFrameSizeSamples];
         }
 
-        // CELT decoding
-        if ( bReceiveDataOk )
+        // The server timer is not synchronized with our sound card clock. The
+        // clock drift compensation tells us how many blocks must be decoded to
+        // generate the current output block (this is usually one block but may
+        // sometimes be zero or two blocks).
+        const int iNumBlocksToDecode =
+            DriftComp.Update ( Channel.GetSockBufFillLevel(),
+                               Channel.GetSockBufTargetFillLevel() );
+
+        for ( k = 0; k < iNumBlocksToDecode; k++ )
         {
-            // on any valid received packet, we clear the initialization phase
-            // flag
-            bIsInitializationPhase = false;
+            // receive a new block (the received frame may still have the
+            // old size if the number of coded bytes was just changed)
+            int iNumRecCodedBytes = iCeltNumCodedBytes;
+
+            const bool bReceiveDataOk =
+                ( Channel.GetData ( vecbyNetwData, iNumRecCodedBytes ) == GS_BUFFER_OK );
 
-            if ( eAudioChannelConf == CC_MONO )
+            // invalidate the buffer OK status flag if necessary
+            if ( !bReceiveDataOk )
             {
-                if ( eAudioCompressionType == CT_CELT )
-                {
-                    cc6_celt_decode ( CeltDecoderMono,
-                                      &vecbyNetwData[0],
-                                      iCeltNumCodedBytes,
-                                      &vecsAudioSndCrdMono[i * SYSTEM_FRAME_SIZE_SAMPLES] );
-                }
-                else
-                {
-                    opus_custom_decode ( OpusDecoderMono,
-                                         &vecbyNetwData[0],
-                                         iCeltNumCodedBytes,
-                                         &vecsAudioSndCrdMono[i * SYSTEM_FRAME_SIZE_SAMPLES],
-                                         SYSTEM_FRAME_SIZE_SAMPLES );
-                }
+                bJitterBufferOK = false;
             }
-            else
+
+            // CELT decoding
+            if ( bReceiveDataOk )
             {
-                if ( eAudioCompressionType == CT_CELT )
-                {
-                    cc6_celt_decode ( CeltDecoderStereo,
-                                      &vecbyNetwData[0],
-                                      iCeltNumCodedBytes,
-                                      &vecsStereoSndCrd[i * 2 * SYSTEM_FRAME_SIZE_SAMPLES] );
-                }
-                else
+                // on any valid received packet, we clear the initialization phase
+                // flag
+                bIsInitializationPhase = false;
+
+                if ( eAudioCompressionType == CT_PCM )
                 {
-                    opus_custom_decode ( OpusDecoderStereo,
-                                         &vecbyNetwData[0],
-                                         iCeltNumCodedBytes,
-                                         &vecsStereoSndCrd[i * 2 * SYSTEM_FRAME_SIZE_SAMPLES],
-                                         SYSTEM_FRAME_SIZE_SAMPLES );
+                    // uncompressed audio, no decoding required
+                    PcmDecode ( &vecbyNetwData[0],
+                                psCurDecodedBlock,
+                                iNumRecCodedBytes / PCM_NUM_BYTES_PER_SAMPLE );
                 }
-            }
-        }
-        else
-        {
-            // lost packet
-            if ( eAudioChannelConf == CC_MONO )
-            {
-                if ( eAudioCompressionType == CT_CELT )
+                else if ( eAudioChannelConf == CC_MONO )
                 {
-                    cc6_celt_decode ( CeltDecoderMono,
-                                      NULL,
-                                      0,
-                                      &vecsAudioSndCrdMono[i * SYSTEM_FRAME_SIZE_SAMPLES] );
+                    if ( eAudioCompressionType == CT_CELT )
+                    {
+                        cc6_celt_decode ( CeltDecoderMono,
+                                          &vecbyNetwData[0],
+                                          iNumRecCodedBytes,
+                                          &vecsAudioSndCrdMono[i * iFrameSizeSamples] );
+                    }
+                    else
+                    {
+                        opus_custom_decode ( pCurOpusDecoderMono,
+                                             &vecbyNetwData[0],
+                                             iNumRecCodedBytes,
+                                             &vecsAudioSndCrdMono[i * iFrameSizeSamples],
+                                             iFrameSizeSamples );
+                    }
                 }
                 else
                 {
-                    opus_custom_decode ( OpusDecoderMono,
-                                         NULL,
-                                         iCeltNumCodedBytes,
-                                         &vecsAudioSndCrdMono[i * SYSTEM_FRAME_SIZE_SAMPLES],
-                                         SYSTEM_FRAME_SIZE_SAMPLES );
+                    if ( eAudioCompressionType == CT_CELT )
+                    {
+                        cc6_celt_decode ( CeltDecoderStereo,
+                                          &vecbyNetwData[0],
+                                          iNumRecCodedBytes,
+                                          &vecsStereoSndCrd[i * 2 * iFrameSizeSamples] );
+                    }
+                    else
+                    {
+                        opus_custom_decode ( pCurOpusDecoderStereo,
+                                             &vecbyNetwData[0],
+                                             iNumRecCodedBytes,
+                                             &vecsStereoSndCrd[i * 2 * iFrameSizeSamples],
+                                             iFrameSizeSamples );
+                    }
                 }
             }
             else
             {
-                if ( eAudioCompressionType == CT_CELT )
+                // lost packet
+                if ( eAudioCompressionType == CT_PCM )
                 {
-                    cc6_celt_decode ( CeltDecoderStereo,
-                                      NULL,
-                                      0,
-                                      &vecsStereoSndCrd[i * 2 * SYSTEM_FRAME_SIZE_SAMPLES] );
+                    // uncompressed audio has no packet loss concealment, use
+                    // silence instead
+                    std::fill ( psCurDecodedBlock,
+                                psCurDecodedBlock + iCeltNumCodedBytes / PCM_NUM_BYTES_PER_SAMPLE,
+                                0 );
+                }
+                else if ( eAudioChannelConf == CC_MONO )
+                {
+                    if ( eAudioCompressionType == CT_CELT )
+                    {
+                        cc6_celt_decode ( CeltDecoderMono,
+                                          NULL,
+                                          0,
+                                          &vecsAudioSndCrdMono[i * iFrameSizeSamples] );
+                    }
+                    else
+                    {
+                        opus_custom_decode ( pCurOpusDecoderMono,
+                                             NULL,
+                                             iCeltNumCodedBytes,
+                                             &vecsAudioSndCrdMono[i * iFrameSizeSamples],
+                                             iFrameSizeSamples );
+                    }
                 }
                 else
                 {
-                    opus_custom_decode ( OpusDecoderStereo,
-                                         NULL,
-                                         iCeltNumCodedBytes,
-                                         &vecsStereoSndCrd[i * 2 * SYSTEM_FRAME_SIZE_SAMPLES],
-                                         SYSTEM_FRAME_SIZE_SAMPLES );
+                    if ( eAudioCompressionType == CT_CELT )
+                    {
+                        cc6_celt_decode ( CeltDecoderStereo,
+                                          NULL,
+                                          0,
+                                          &vecsStereoSndCrd[i * 2 * iFrameSizeSamples] );
+                    }
+                    else
+                    {
+                        opus_custom_decode ( pCurOpusDecoderStereo,
+                                             NULL,
+                                             iCeltNumCodedBytes,
+                                             &vecsStereoSndCrd[i * 2 * iFrameSizeSamples],
+                                             iFrameSizeSamples );
+                    }
                 }
             }
+
+            // store the decoded block in the clock drift compensation
+            DriftComp.Put ( psCurDecodedBlock );
         }
+
+        // get the resampled block
+        DriftComp.Get ( psCurDecodedBlock );
+    }
+
+    // if not connected, the next connection starts with a new clock drift
+    // estimation
+    if ( !Channel.IsConnected() )
+    {
+        DriftComp.Reset();
     }
 
 
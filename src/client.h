@@ -29,6 +29,7 @@
 #include <QHostInfo>
 #include <QString>
 #include <QDateTime>
+#include <QAtomicInt>
 #include <QMessageBox>
 #include "cc6_celt.h"
 #include "opus_custom.h"
@@ -37,6 +38,7 @@
 #include "channel.h"
 #include "util.h"
 #include "buffer.h"
+#include "resample.h"
 #ifdef LLCON_VST_PLUGIN
 # include "vstsound.h"
 #else
@@ -89,7 +91,8 @@
 // calculation to get from the number of bytes to the code rate in bps:
 // rate [pbs] = Fs / L * N * 8, where
 // Fs: sampling rate (SYSTEM_SAMPLE_RATE_HZ)
-// L:  number of samples per packet (SYSTEM_FRAME_SIZE_SAMPLES)
+// L:  number of samples per packet (SYSTEM_FRAME_SIZE_SAMPLES, for the small
+//     frame size the number of bytes is halved to get the same bit rate)
 // N:  number of bytes per packet (values below)
 #define OPUS_NUM_BYTES_MONO_LOW_QUALITY         25
 #define OPUS_NUM_BYTES_MONO_NORMAL_QUALITY      45
@@ -129,6 +132,22 @@ public:
     EAudChanConf GetAudioChannels() const { return eAudioChannelConf; }
     void SetAudioChannels ( const EAudChanConf eNAudChanConf );
 
+    int GetAudioRedundancy() const { return iAudioRedundancy; }
+    void SetAudioRedundancy ( const int iNAudioRedundancy );
+
+    bool GetAudioUncompressed() const { return bAudioUncompressed; }
+    void SetAudioUncompressed ( const bool bNAudioUncompr );
+
+    bool GetBitrateAdaptation() const { return bBitrateAdaptation; }
+    void SetBitrateAdaptation ( const bool bNBitrateAdapt );
+
+    bool GetSmallFrameSize() const { return bSmallFrameSize; }
+    void SetSmallFrameSize ( const bool bNSmallFrameSize );
+
+    // frame size which is actually used (the small frame size is only used
+    // if the server supports it)
+    int GetFrameSizeSamples() const { return iFrameSizeSamples; }
+
     void SetServerListCentralServerAddress ( const QString& sNCentServAddr )
         { strCentralServerAddress = sNCentServAddr; }
 
@@ -265,6 +284,12 @@ public:
     void CreateCLReqServerListMes ( const CHostAddress& InetAddr )
         { ConnLessProtocol.CreateCLReqServerListMes ( InetAddr ); }
 
+    // request the least loaded server of a group from the central server
+    void CreateCLReqGroupServerMes ( const CHostAddress& InetAddr,
+                                     const QString&      strGroup,
+                                     const int           iNumClients = 1 )
+        { ConnLessProtocol.CreateCLReqGroupServerMes ( InetAddr, strGroup, iNumClients ); }
+
     int EstimatedOverallDelay ( const int iPingTimeMs );
 
     void GetBufErrorRates ( CVector<double>& vecErrRates, double& dLimit )
@@ -302,6 +327,7 @@ protected:
     int         PreparePingMessage();
     int         EvaluatePingMessage ( const int iMs );
     void        CreateServerJitterBufferMessage();
+    int         GetOpusNumCodedBytes ( const EAudioQuality eQuality ) const;
 
 // #### COMPATIBILITY OLD VERSION, TO BE REMOVED ####
 void SetAudoCompressiontype ( const EAudComprType eNAudCompressionType );
@@ -322,12 +348,30 @@ void SetAudoCompressiontype ( const EAudComprType eNAudCompressionType );
     OpusCustomDecoder*      OpusDecoderMono;
     OpusCustomEncoder*      OpusEncoderStereo;
     OpusCustomDecoder*      OpusDecoderStereo;
+    OpusCustomMode*         OpusModeSmall;
+    OpusCustomEncoder*      OpusEncoderMonoSmall;
+    OpusCustomDecoder*      OpusDecoderMonoSmall;
+    OpusCustomEncoder*      OpusEncoderStereoSmall;
+    OpusCustomDecoder*      OpusDecoderStereoSmall;
+    OpusCustomEncoder*      pCurOpusEncoderMono;
+    OpusCustomDecoder*      pCurOpusDecoderMono;
+    OpusCustomEncoder*      pCurOpusEncoderStereo;
+    OpusCustomDecoder*      pCurOpusDecoderStereo;
     EAudComprType           eAudioCompressionType;
     int                     iCeltNumCodedBytes;
     EAudioQuality           eAudioQuality;
     EAudChanConf            eAudioChannelConf;
+    int                     iAudioRedundancy;
+    bool                    bAudioUncompressed;
+    bool                    bBitrateAdaptation;
+    bool                    bSmallFrameSize;
+    int                     iFrameSizeSamples;
+    CBitrateAdaptation      BitrateAdaptation;
+    CVector<int>            veciAdaptNumCodedBytes;
+    QAtomicInt              iAdaptNumCodedBytes; // written by the main thread, read by the audio thread
     bool                    bIsInitializationPhase;
     CVector<unsigned char>  vecCeltData;
+    CClockDriftComp         DriftComp;
 
     CHighPrioSocket         Socket;
     CSound                  Sound;
@@ -373,7 +417,7 @@ void SetAudoCompressiontype ( const EAudComprType eNAudCompressionType );
     CPreciseTime            PreciseTime;
 
 public slots:
-    void OnSendProtMessage ( CVector<uint8_t> vecMessage );
+    void OnSendProtMessage ( const CVector<uint8_t>& vecMessage );
     void OnInvalidPacketReceived ( CHostAddress RecHostAddr );
 
     void OnDetectedCLMessage ( CVector<uint8_t> vecbyMesBodyData,
@@ -384,16 +428,22 @@ public slots:
     void OnJittBufSizeChanged ( int iNewJitBufSize );
     void OnReqChanInfo() { Channel.SetRemoteInfo ( ChannelInfo ); }
     void OnNewConnection();
+    void OnSupportedFeaturesReceived();
+    void OnRecStatisticsReady ( int iNumFrames, int iNumLostFrames );
+    void OnReceiverReportReceived ( int iNumFrames, int iNumLostFrames );
     void OnCLPingReceived ( CHostAddress InetAddr,
                             int          iMs );
 
-    void OnSendCLProtMessage ( CHostAddress     InetAddr,
-                               CVector<uint8_t> vecMessage );
+    void OnSendCLProtMessage ( CHostAddress            InetAddr,
+                               const CVector<uint8_t>& vecMessage );
 
     void OnCLPingWithNumClientsReceived ( CHostAddress InetAddr,
                                           int          iMs,
                                           int          iNumClients );
 
+    void OnCLConnChallengeReceived ( CHostAddress InetAddr,
+                                     quint32      iCookie );
+
     void OnSndCrdReinitRequest ( int iSndCrdResetType );
 
 // #### COMPATIBILITY OLD VERSION, TO BE REMOVED ####
@@ -408,6 +458,9 @@ signals:
     void CLServerListReceived ( CHostAddress         InetAddr,
                                 CVector<CServerInfo> vecServerInfo );
 
+    void CLGroupServerReceived ( CHostAddress InetAddr,
+                                 CHostAddress ServerInetAddr );
+
     void CLPingTimeWithNumClientsReceived ( CHostAddress InetAddr,
                                             int          iPingTime,
                                             int          iNumClients );
@@ -326,17 +326,6 @@ CClientSettingsDlg::CClientSettingsDlg ( CClient* pNCliP, QWidget* parent,
     }
     UpdateCentralServerDependency();
 
-    // set text for sound card buffer delay radio buttons
-    rbtBufferDelayPreferred->setText ( GenSndCrdBufferDelayString (
-        FRAME_SIZE_FACTOR_PREFERRED * SYSTEM_FRAME_SIZE_SAMPLES,
-        ", preferred" ) );
-
-    rbtBufferDelayDefault->setText ( GenSndCrdBufferDelayString (
-        FRAME_SIZE_FACTOR_DEFAULT * SYSTEM_FRAME_SIZE_SAMPLES ) );
-
-    rbtBufferDelaySafe->setText ( GenSndCrdBufferDelayString (
-        FRAME_SIZE_FACTOR_SAFE * SYSTEM_FRAME_SIZE_SAMPLES ) );
-
     // sound card buffer delay inits
     SndCrdBufferDelayButtonGroup.addButton ( rbtBufferDelayPreferred );
     SndCrdBufferDelayButtonGroup.addButton ( rbtBufferDelayDefault );
@@ -447,6 +436,21 @@ void CClientSettingsDlg::UpdateSoundCardFrame()
     const int iCurActualBufSize =
         pClient->GetSndCrdActualMonoBlSize();
 
+    // the buffer sizes depend on the frame size which is currently used
+    // (the small frame size is used if the server supports it)
+    const int iFrameSize = pClient->GetFrameSizeSamples();
+
+    // set text for sound card buffer delay radio buttons
+    rbtBufferDelayPreferred->setText ( GenSndCrdBufferDelayString (
+        FRAME_SIZE_FACTOR_PREFERRED * iFrameSize,
+        ", preferred" ) );
+
+    rbtBufferDelayDefault->setText ( GenSndCrdBufferDelayString (
+        FRAME_SIZE_FACTOR_DEFAULT * iFrameSize ) );
+
+    rbtBufferDelaySafe->setText ( GenSndCrdBufferDelayString (
+        FRAME_SIZE_FACTOR_SAFE * iFrameSize ) );
+
     // Set radio buttons according to current value (To make it possible
     // to have all radio buttons unchecked, we have to disable the
     // exclusive check for the radio button group. We require all radio
@@ -456,13 +460,13 @@ void CClientSettingsDlg::UpdateSoundCardFrame()
     SndCrdBufferDelayButtonGroup.setExclusive ( false );
 
     rbtBufferDelayPreferred->setChecked ( iCurActualBufSize ==
-        SYSTEM_FRAME_SIZE_SAMPLES * FRAME_SIZE_FACTOR_PREFERRED );
+        iFrameSize * FRAME_SIZE_FACTOR_PREFERRED );
 
     rbtBufferDelayDefault->setChecked ( iCurActualBufSize ==
-        SYSTEM_FRAME_SIZE_SAMPLES * FRAME_SIZE_FACTOR_DEFAULT );
+        iFrameSize * FRAME_SIZE_FACTOR_DEFAULT );
 
     rbtBufferDelaySafe->setChecked ( iCurActualBufSize ==
-        SYSTEM_FRAME_SIZE_SAMPLES * FRAME_SIZE_FACTOR_SAFE );
+        iFrameSize * FRAME_SIZE_FACTOR_SAFE );
 
     SndCrdBufferDelayButtonGroup.setExclusive ( true );
 
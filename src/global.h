@@ -106,6 +106,11 @@ LED bar:      lbr
 // All other block sizes must be a multiple of this size
 #define SYSTEM_FRAME_SIZE_SAMPLES       128
 
+// small system block size for low latency operation, the server decides at
+// runtime if it supports it (only possible with the OPUS codec and the
+// uncompressed audio transport since CELT is fixed to the default size)
+#define SYSTEM_FRAME_SIZE_SAMPLES_SMALL 64
+
 #define SYSTEM_BLOCK_DURATION_MS_FLOAT  \
     ( static_cast<double> ( SYSTEM_FRAME_SIZE_SAMPLES ) / \
     SYSTEM_SAMPLE_RATE_HZ * 1000 )
@@ -124,6 +129,9 @@ LED bar:      lbr
 // gets in trouble if the value is too low)
 #define CELT_MINIMUM_NUM_BYTES          10
 
+// number of bytes per sample for the uncompressed audio transport (PCM)
+#define PCM_NUM_BYTES_PER_SAMPLE        2
+
 // define the maximum mono audio buffer size at a sample rate
 // of 48 kHz, this is important for defining the maximum number
 // of bytes to be expected from the network interface
@@ -144,6 +152,10 @@ LED bar:      lbr
 // default network buffer size
 #define DEF_NET_BUF_SIZE_NUM_BL         10 // number of blocks
 
+// maximum number of previous audio packets which are repeated in each audio
+// packet if the redundancy mode is used (for recovering lost packets)
+#define MAX_NUM_REDUNDANT_PACKETS       2
+
 // audio mixer fader maximum value
 #define AUD_MIX_FADER_MAX               100
 
@@ -181,7 +193,11 @@ LED bar:      lbr
 #define DEFAULT_USED_NUM_CHANNELS       7 // default used number channels for server
 
 // maximum number of servers registered in the server list
-#define MAX_NUM_SERVERS_IN_SERVER_LIST  100
+#define MAX_NUM_SERVERS_IN_SERVER_LIST  5000
+
+// maximum number of servers in the server list which is sent to old clients
+// which do not support the fragmented server list
+#define MAX_NUM_SERVERS_IN_LEGACY_SERVER_LIST 100
 
 // defines the time interval at which the ping time is updated in the GUI
 #define PING_UPDATE_TIME_MS             500 // ms
@@ -218,6 +234,7 @@ LED bar:      lbr
 #define MAX_LEN_SERVER_NAME             20
 #define MAX_LEN_SERVER_TOPIC            32
 #define MAX_LEN_SERVER_CITY             20
+#define MAX_LEN_SERVER_GROUP            32
 #define MAX_LEN_VERSION_TEXT            20
 
 // common tool tip bottom line text
@@ -257,6 +274,8 @@ typedef unsigned char      uint8_t;
 /* Pseudo enum definitions -------------------------------------------------- */
 // definition for custom event
 #define MS_PACKET_RECEIVED              0
+#define MS_SERVER_IDLE                  1
+#define MS_CHAN_LIST_CHANGED            2
 
 
 /* Classes ********************************************************************/
@@ -324,4 +343,7 @@ bool    GetNumericArgument ( QTextStream& tsConsole,
                              double       rRangeStop,
                              double&      rValue);
 
+QString GetRoomFileName ( const QString& strFileName,
+                          const int      iRoom );
+
 #endif /* !defined ( GLOBAL_H__3B123453_4344_BB2B_23E7A0D31912__INCLUDED_ ) */
@@ -0,0 +1,592 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2014
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#include "listener.h"
+
+
+/* Implementation *************************************************************/
+CServerListeners::CServerListeners ( const int iNTickFrameSizeSamples,
+                                     const int iNMaxNumListeners ) :
+    iTickFrameSizeSamples ( iNTickFrameSizeSamples ),
+    iMaxNumListeners      ( min ( iNMaxNumListeners, MAX_NUM_LISTENERS ) ),
+    iNumListeners         ( 0 )
+{
+    int iOpusError;
+
+    vecListeners.Init ( iMaxNumListeners );
+    vecFormats.Init   ( MAX_NUM_LISTENER_FORMATS );
+
+    // the encoders of the formats are created as soon as a listener requests
+    // the format, the modes are shared by all encoders
+    OpusMode = opus_custom_mode_create ( SYSTEM_SAMPLE_RATE_HZ,
+                                         SYSTEM_FRAME_SIZE_SAMPLES,
+                                         &iOpusError );
+
+    OpusModeSmall = opus_custom_mode_create ( SYSTEM_SAMPLE_RATE_HZ,
+                                              SYSTEM_FRAME_SIZE_SAMPLES_SMALL,
+                                              &iOpusError );
+}
+
+CServerListeners::~CServerListeners()
+{
+    for ( int i = 0; i < vecFormats.Size(); i++ )
+    {
+        if ( vecFormats[i].OpusEncoder != NULL )
+        {
+            opus_custom_encoder_destroy ( vecFormats[i].OpusEncoder );
+        }
+    }
+
+    opus_custom_mode_destroy ( OpusModeSmall );
+    opus_custom_mode_destroy ( OpusMode );
+}
+
+bool CServerListeners::Put ( const CHostAddress& HostAddr,
+                             const EAudComprType eAudComprType,
+                             const int           iNumAudioChannels,
+                             const int           iNetwFrameSize,
+                             const int           iFrameSizeSamples )
+{
+    if ( !IsFormatValid ( eAudComprType,
+                          iNumAudioChannels,
+                          iNetwFrameSize,
+                          iFrameSizeSamples ) )
+    {
+        return false;
+    }
+
+    Mutex.lock();
+    {
+        const int iFormat = FindFormat ( eAudComprType,
+                                         iNumAudioChannels,
+                                         iNetwFrameSize,
+                                         iFrameSizeSamples );
+
+        int iIdx = FindListener ( HostAddr );
+
+        if ( iIdx != INVALID_LISTENER )
+        {
+            // a known listener which did not change its format only refreshes
+            // the time of its last request
+            if ( vecListeners[iIdx].iFormat == iFormat )
+            {
+                vecListeners[iIdx].iLastRequestMs = QDateTime::currentMSecsSinceEpoch();
+
+                Mutex.unlock();
+                return true;
+            }
+
+            FreeListener ( iIdx );
+        }
+
+        iIdx = FindFreeListener();
+
+        if ( ( iIdx != INVALID_LISTENER ) && ( iFormat != INVALID_LISTENER_FORMAT ) )
+        {
+            // the format is already in use
+            AddListener ( iIdx, HostAddr, iFormat );
+
+            Mutex.unlock();
+            return true;
+        }
+
+        if ( ( iIdx == INVALID_LISTENER ) || ( FindFreeFormat() == INVALID_LISTENER_FORMAT ) )
+        {
+            // no free entry or all formats are in use
+            Mutex.unlock();
+            return false;
+        }
+    }
+    Mutex.unlock();
+
+    // the listener requires a new format, the encoder is created without
+    // holding the mutex which is shared with the mixer
+    CFormat NewFormat;
+
+    InitFormat ( NewFormat,
+                 eAudComprType,
+                 iNumAudioChannels,
+                 iNetwFrameSize,
+                 iFrameSizeSamples );
+
+    bool bOK = false;
+
+    Mutex.lock();
+    {
+        // the listeners might have been changed by the mixer in the meantime
+        // (time-out) which only frees entries
+        const int iIdx = FindFreeListener();
+        int iFormat    = FindFormat ( eAudComprType,
+                                      iNumAudioChannels,
+                                      iNetwFrameSize,
+                                      iFrameSizeSamples );
+
+        if ( iFormat == INVALID_LISTENER_FORMAT )
+        {
+            iFormat = FindFreeFormat();
+
+            if ( iFormat != INVALID_LISTENER_FORMAT )
+            {
+                SwapFormat ( vecFormats[iFormat], NewFormat );
+            }
+        }
+
+        if ( ( iIdx != INVALID_LISTENER ) && ( iFormat != INVALID_LISTENER_FORMAT ) )
+        {
+            AddListener ( iIdx, HostAddr, iFormat );
+            bOK = true;
+        }
+    }
+    Mutex.unlock();
+
+    // the previous encoder of the format (or the new encoder if it was not
+    // used) is destroyed without holding the mutex, too
+    if ( NewFormat.OpusEncoder != NULL )
+    {
+        opus_custom_encoder_destroy ( NewFormat.OpusEncoder );
+    }
+
+    return bOK;
+}
+
+void CServerListeners::Remove ( const CHostAddress& HostAddr )
+{
+    QMutexLocker locker ( &Mutex );
+
+    const int iIdx = FindListener ( HostAddr );
+
+    if ( iIdx != INVALID_LISTENER )
+    {
+        FreeListener ( iIdx );
+    }
+}
+
+void CServerListeners::Process ( const CVector<int16_t>& vecsStereoMix,
+                                 const int               iTickCnt,
+                                 CHighPrioSocket&        Socket )
+{
+    int i, j, k;
+
+    QMutexLocker locker ( &Mutex );
+
+    if ( iNumListeners == 0 )
+    {
+        return;
+    }
+
+    // remove the listeners which did not repeat their request
+    const qint64 iCurTimeMs = QDateTime::currentMSecsSinceEpoch();
+
+    for ( i = 0; i < vecListeners.Size(); i++ )
+    {
+        if ( vecListeners[i].bUsed &&
+             ( iCurTimeMs - vecListeners[i].iLastRequestMs > LISTENER_TIMEOUT_MS ) )
+        {
+            FreeListener ( i );
+        }
+    }
+
+    for ( i = 0; i < vecFormats.Size(); i++ )
+    {
+        CFormat& CurFormat = vecFormats[i];
+
+        if ( CurFormat.iNumListeners == 0 )
+        {
+            continue;
+        }
+
+        // collect the room mix of all timer ticks of the current audio frame
+        // (same as for the channels of the server)
+        const int iNumTicksPerFrame  = CurFormat.iFrameSizeSamples / iTickFrameSizeSamples;
+        const int iCurTickPhase      = iTickCnt % iNumTicksPerFrame;
+        const int iCurTickNumSamples = CurFormat.iNumAudioChannels * iTickFrameSizeSamples;
+
+        int16_t* psCurFrame = &CurFormat.vecsFrame[iCurTickPhase * iCurTickNumSamples];
+
+        if ( CurFormat.iNumAudioChannels == 1 )
+        {
+            // stereo-to-mono attenuation
+            for ( j = 0, k = 0; j < iTickFrameSizeSamples; j++, k += 2 )
+            {
+                psCurFrame[j] = static_cast<int16_t> (
+                    ( static_cast<int> ( vecsStereoMix[k] ) + vecsStereoMix[k + 1] ) / 2 );
+            }
+        }
+        else
+        {
+            std::copy ( vecsStereoMix.begin(),
+                        vecsStereoMix.begin() + iCurTickNumSamples,
+                        psCurFrame );
+        }
+
+        // the audio frame is encoded and sent at its last timer tick
+        if ( iCurTickPhase != iNumTicksPerFrame - 1 )
+        {
+            continue;
+        }
+
+        if ( CurFormat.eAudComprType == CT_PCM )
+        {
+            PcmEncode ( &CurFormat.vecsFrame[0],
+                        &CurFormat.vecbyCodedData[0],
+                        CurFormat.iNumAudioChannels * CurFormat.iFrameSizeSamples );
+        }
+        else
+        {
+            opus_custom_encode ( CurFormat.OpusEncoder,
+                                 &CurFormat.vecsFrame[0],
+                                 CurFormat.iFrameSizeSamples,
+                                 &CurFormat.vecbyCodedData[0],
+                                 CurFormat.iNetwFrameSize );
+        }
+
+        // the same packet is sent to all listeners of this format
+        for ( j = 0; j < vecListeners.Size(); j++ )
+        {
+            if ( vecListeners[j].bUsed && ( vecListeners[j].iFormat == i ) )
+            {
+                Socket.SendPacket ( CurFormat.vecbyCodedData,
+                                    vecListeners[j].HostAddr );
+            }
+        }
+    }
+}
+
+bool CServerListeners::IsFormatValid ( const EAudComprType eAudComprType,
+                                       const int           iNumAudioChannels,
+                                       const int           iNetwFrameSize,
+                                       const int           iFrameSizeSamples ) const
+{
+    // the small frame size is only available if the server uses it
+    if ( ( iFrameSizeSamples != SYSTEM_FRAME_SIZE_SAMPLES ) &&
+         ( iFrameSizeSamples != iTickFrameSizeSamples ) )
+    {
+        return false;
+    }
+
+    if ( ( iNumAudioChannels != 1 ) && ( iNumAudioChannels != 2 ) )
+    {
+        return false;
+    }
+
+    if ( eAudComprType == CT_PCM )
+    {
+        // 16 bit per sample
+        return iNetwFrameSize == 2 * iNumAudioChannels * iFrameSizeSamples;
+    }
+
+    return ( eAudComprType == CT_OPUS ) &&
+           ( iNetwFrameSize > 0 ) &&
+           ( iNetwFrameSize <= MAX_SIZE_BYTES_NETW_BUF );
+}
+
+int CServerListeners::FindFormat ( const EAudComprType eAudComprType,
+                                   const int           iNumAudioChannels,
+                                   const int           iNetwFrameSize,
+                                   const int           iFrameSizeSamples ) const
+{
+    // only formats which are in use have a valid encoder
+    for ( int i = 0; i < vecFormats.Size(); i++ )
+    {
+        if ( ( vecFormats[i].iNumListeners     >  0 ) &&
+             ( vecFormats[i].eAudComprType     == eAudComprType ) &&
+             ( vecFormats[i].iNumAudioChannels == iNumAudioChannels ) &&
+             ( vecFormats[i].iNetwFrameSize    == iNetwFrameSize ) &&
+             ( vecFormats[i].iFrameSizeSamples == iFrameSizeSamples ) )
+        {
+            return i;
+        }
+    }
+
+    return INVALID_LISTENER_FORMAT;
+}
+
+int CServerListeners::FindFreeFormat() const
+{
+    for ( int i = 0; i < vecFormats.Size(); i++ )
+    {
+        if ( vecFormats[i].iNumListeners == 0 )
+        {
+            return i;
+        }
+    }
+
+    return INVALID_LISTENER_FORMAT;
+}
+
+void CServerListeners::InitFormat ( CFormat&            Format,
+                                    const EAudComprType eAudComprType,
+                                    const int           iNumAudioChannels,
+                                    const int           iNetwFrameSize,
+                                    const int           iFrameSizeSamples )
+{
+    int iOpusError;
+
+    Format.eAudComprType     = eAudComprType;
+    Format.iNumAudioChannels = iNumAudioChannels;
+    Format.iNetwFrameSize    = iNetwFrameSize;
+    Format.iFrameSizeSamples = iFrameSizeSamples;
+
+    Format.vecsFrame.Init      ( iNumAudioChannels * iFrameSizeSamples );
+    Format.vecbyCodedData.Init ( iNetwFrameSize );
+
+    if ( eAudComprType == CT_OPUS )
+    {
+        Format.OpusEncoder = opus_custom_encoder_create (
+            ( iFrameSizeSamples == SYSTEM_FRAME_SIZE_SAMPLES_SMALL ) ?
+            OpusModeSmall : OpusMode,
+            iNumAudioChannels,
+            &iOpusError );
+
+        // same settings as for the encoders of the channels
+        opus_custom_encoder_ctl ( Format.OpusEncoder,
+                                  OPUS_SET_VBR ( 0 ) );
+
+        opus_custom_encoder_ctl ( Format.OpusEncoder,
+                                  OPUS_SET_APPLICATION ( OPUS_APPLICATION_RESTRICTED_LOWDELAY ) );
+
+        opus_custom_encoder_ctl ( Format.OpusEncoder,
+                                  OPUS_SET_BITRATE (
+                                      CalcBitRateBitsPerSecFromCodedBytes (
+                                          iNetwFrameSize, iFrameSizeSamples ) ) );
+
+#ifdef USE_LOW_COMPLEXITY_CELT_ENC
+        // set encoder low complexity
+        opus_custom_encoder_ctl ( Format.OpusEncoder,
+                                  OPUS_SET_COMPLEXITY ( 1 ) );
+#endif
+    }
+}
+
+void CServerListeners::SwapFormat ( CFormat& CurFormat, CFormat& NewFormat )
+{
+    // the number of listeners is not swapped (the format is not in use)
+    std::swap ( CurFormat.eAudComprType,     NewFormat.eAudComprType );
+    std::swap ( CurFormat.iNumAudioChannels, NewFormat.iNumAudioChannels );
+    std::swap ( CurFormat.iNetwFrameSize,    NewFormat.iNetwFrameSize );
+    std::swap ( CurFormat.iFrameSizeSamples, NewFormat.iFrameSizeSamples );
+    std::swap ( CurFormat.OpusEncoder,       NewFormat.OpusEncoder );
+
+    CurFormat.vecsFrame.swap      ( NewFormat.vecsFrame );
+    CurFormat.vecbyCodedData.swap ( NewFormat.vecbyCodedData );
+}
+
+int CServerListeners::FindListener ( const CHostAddress& HostAddr ) const
+{
+    for ( int i = 0; i < vecListeners.Size(); i++ )
+    {
+        if ( vecListeners[i].bUsed && ( vecListeners[i].HostAddr == HostAddr ) )
+        {
+            return i;
+        }
+    }
+
+    return INVALID_LISTENER;
+}
+
+int CServerListeners::FindFreeListener() const
+{
+    for ( int i = 0; i < vecListeners.Size(); i++ )
+    {
+        if ( !vecListeners[i].bUsed )
+        {
+            return i;
+        }
+    }
+
+    return INVALID_LISTENER;
+}
+
+void CServerListeners::AddListener ( const int           iIdx,
+                                     const CHostAddress& HostAddr,
+                                     const int           iFormat )
+{
+    vecListeners[iIdx].HostAddr       = HostAddr;
+    vecListeners[iIdx].bUsed          = true;
+    vecListeners[iIdx].iFormat        = iFormat;
+    vecListeners[iIdx].iLastRequestMs = QDateTime::currentMSecsSinceEpoch();
+
+    vecFormats[iFormat].iNumListeners++;
+    iNumListeners++;
+}
+
+void CServerListeners::FreeListener ( const int iIdx )
+{
+    // the encoder of an unused format is kept until the format is used again
+    // since no memory shall be freed in the timer of the server
+    vecFormats[vecListeners[iIdx].iFormat].iNumListeners--;
+
+    vecListeners[iIdx].bUsed   = false;
+    vecListeners[iIdx].iFormat = INVALID_LISTENER_FORMAT;
+    iNumListeners--;
+}
+
+
+// Listener client -------------------------------------------------------------
+CListenerClient::CListenerClient() :
+    iCookie ( 0 )
+{
+    vecbyRecBuf.Init ( MAX_SIZE_BYTES_NETW_BUF );
+
+
+    // Connections -------------------------------------------------------------
+    QObject::connect ( &UdpSocket, SIGNAL ( readyRead() ),
+        this, SLOT ( OnReadyRead() ) );
+
+    QObject::connect ( &TimerRequest, SIGNAL ( timeout() ),
+        this, SLOT ( OnTimerRequest() ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLMessReadyForSending ( CHostAddress, CVector<uint8_t> ) ),
+        this, SLOT ( OnSendCLProtMessage ( CHostAddress, CVector<uint8_t> ) ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLConnChallengeReceived ( CHostAddress, quint32 ) ),
+        this, SLOT ( OnCLConnChallengeReceived ( CHostAddress, quint32 ) ) );
+}
+
+CListenerClient::~CListenerClient()
+{
+    // leave the server immediately instead of waiting for the time-out
+    Stop();
+}
+
+bool CListenerClient::Start ( const QString& strServerAddr )
+{
+    if ( !NetworkUtil::ParseNetworkAddress ( strServerAddr, ServerAddr ) )
+    {
+        return false; // invalid address
+    }
+
+    // the server only supports IPv4 (any free port)
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+    if ( !UdpSocket.bind ( QHostAddress ( QHostAddress::Any ), 0 ) )
+#else
+    if ( !UdpSocket.bind ( QHostAddress ( QHostAddress::AnyIPv4 ), 0 ) )
+#endif
+    {
+        return false;
+    }
+
+    if ( !CMixStreamWriter::OpenStdOut ( OutFile ) )
+    {
+        return false;
+    }
+
+    // the first request is answered with a connection challenge, the cookie
+    // of the challenge is then used for all further requests (if the server
+    // is full, the request is simply repeated by the timer)
+    SendRequest();
+    TimerRequest.start ( LISTENER_CLIENT_REQUEST_INTERV_MS );
+
+    return true;
+}
+
+void CListenerClient::Stop()
+{
+    if ( TimerRequest.isActive() )
+    {
+        TimerRequest.stop();
+
+        // if the message gets lost, the server removes us after the time-out
+        ConnLessProtocol.CreateCLDisconnection ( ServerAddr );
+    }
+}
+
+void CListenerClient::SendRequest()
+{
+    ConnLessProtocol.CreateCLReqListenMes ( ServerAddr,
+                                            iCookie,
+                                            CT_PCM,
+                                            2,
+                                            LISTENER_CLIENT_NETW_FRAME_SIZE,
+                                            SYSTEM_FRAME_SIZE_SAMPLES );
+}
+
+void CListenerClient::OnReadyRead()
+{
+    while ( UdpSocket.hasPendingDatagrams() )
+    {
+        QHostAddress SenderAddr;
+        quint16      iSenderPort;
+
+        const qint64 iNumBytesRead =
+            UdpSocket.readDatagram ( (char*) &vecbyRecBuf[0],
+                                     MAX_SIZE_BYTES_NETW_BUF,
+                                     &SenderAddr,
+                                     &iSenderPort );
+
+        const CHostAddress RecHostAddr ( SenderAddr, iSenderPort );
+
+        // only datagrams of our server are processed
+        if ( ( iNumBytesRead <= 0 ) || !( RecHostAddr == ServerAddr ) )
+        {
+            continue;
+        }
+
+        if ( CProtocol::IsProtocolMessage ( vecbyRecBuf, static_cast<int> ( iNumBytesRead ) ) )
+        {
+            CVector<uint8_t> vecbyMesBodyData;
+            int              iRecCounter;
+            int              iRecID;
+
+            if ( !CProtocol::ParseMessageFrame ( vecbyRecBuf,
+                                                 static_cast<int> ( iNumBytesRead ),
+                                                 vecbyMesBodyData,
+                                                 iRecCounter,
+                                                 iRecID ) &&
+                 CProtocol::IsConnectionLessMessageID ( iRecID ) )
+            {
+                ConnLessProtocol.ParseConnectionLessMessageBody ( vecbyMesBodyData,
+                                                                  iRecID,
+                                                                  RecHostAddr );
+            }
+        }
+        else if ( iNumBytesRead == LISTENER_CLIENT_NETW_FRAME_SIZE )
+        {
+            // the PCM transport format is already the output format
+            OutFile.write ( (const char*) &vecbyRecBuf[0], iNumBytesRead );
+        }
+    }
+}
+
+void CListenerClient::OnSendCLProtMessage ( CHostAddress     InetAddr,
+                                            CVector<uint8_t> vecMessage )
+{
+    UdpSocket.writeDatagram ( (const char*) &vecMessage[0],
+                              vecMessage.Size(),
+                              InetAddr.InetAddr,
+                              InetAddr.iPort );
+}
+
+void CListenerClient::OnCLConnChallengeReceived ( CHostAddress InetAddr,
+                                                  quint32      iNewCookie )
+{
+    // repeat the request with the cookie of the challenge right away
+    if ( InetAddr == ServerAddr )
+    {
+        iCookie = iNewCookie;
+        SendRequest();
+    }
+}
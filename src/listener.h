@@ -0,0 +1,203 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2014
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#if !defined ( LISTENER_HOIHGE7LKJH83JH8_3_4344JHZT56KJIUHF1912__INCLUDED_ )
+#define LISTENER_HOIHGE7LKJH83JH8_3_4344JHZT56KJIUHF1912__INCLUDED_
+
+#include <QObject>
+#include <QMutex>
+#include <QDateTime>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QFile>
+#include "opus_custom.h"
+#include "global.h"
+#include "socket.h"
+#include "protocol.h"
+#include "mixstream.h"
+#include "util.h"
+
+
+/* Definitions ****************************************************************/
+// maximum number of listeners of a server
+#define MAX_NUM_LISTENERS                   250
+
+// maximum number of different transport formats of the listeners (the room
+// mix is encoded once for each format)
+#define MAX_NUM_LISTENER_FORMATS            4
+
+// a listener is removed if it did not repeat its request within this time
+#define LISTENER_TIMEOUT_MS                 5000
+
+#define INVALID_LISTENER                    ( -1 )
+#define INVALID_LISTENER_FORMAT             ( -1 )
+
+// the listener client repeats its request well before the time-out
+#define LISTENER_CLIENT_REQUEST_INTERV_MS   ( LISTENER_TIMEOUT_MS / 4 )
+
+// the listener client receives the stereo mix uncompressed
+#define LISTENER_CLIENT_NETW_FRAME_SIZE     ( 2 * PCM_NUM_BYTES_PER_SAMPLE * \
+                                              SYSTEM_FRAME_SIZE_SAMPLES )
+
+
+/* Classes ********************************************************************/
+// Listeners only receive the room mix of the server. They do not send audio
+// and do not occupy a channel. The room mix is the same for all listeners,
+// therefore it is only encoded once per timer tick for each transport format.
+// A listener has to repeat its request (PROTMESSID_CLM_REQ_LISTEN) within
+// LISTENER_TIMEOUT_MS, see CListenerClient for a reference implementation.
+class CServerListeners
+{
+public:
+    CServerListeners ( const int iNTickFrameSizeSamples,
+                       const int iNMaxNumListeners );
+
+    virtual ~CServerListeners();
+
+    bool Put ( const CHostAddress& HostAddr,
+               const EAudComprType eAudComprType,
+               const int           iNumAudioChannels,
+               const int           iNetwFrameSize,
+               const int           iFrameSizeSamples );
+
+    void Remove ( const CHostAddress& HostAddr );
+
+    int GetNumListeners() const { return iNumListeners; }
+
+    // called by the timer of the server with the stereo room mix of one tick
+    void Process ( const CVector<int16_t>& vecsStereoMix,
+                   const int               iTickCnt,
+                   CHighPrioSocket&        Socket );
+
+protected:
+    class CFormat
+    {
+    public:
+        CFormat() : iNumListeners ( 0 ), eAudComprType ( CT_NONE ),
+            iNumAudioChannels ( 0 ), iNetwFrameSize ( 0 ),
+            iFrameSizeSamples ( 0 ), OpusEncoder ( NULL ) {}
+
+        int                iNumListeners;
+        EAudComprType      eAudComprType;
+        int                iNumAudioChannels;
+        int                iNetwFrameSize;
+        int                iFrameSizeSamples;
+        OpusCustomEncoder* OpusEncoder;
+        CVector<int16_t>   vecsFrame;
+        CVector<uint8_t>   vecbyCodedData;
+    };
+
+    class CListener
+    {
+    public:
+        CListener() : bUsed ( false ), iFormat ( INVALID_LISTENER_FORMAT ),
+            iLastRequestMs ( 0 ) {}
+
+        CHostAddress HostAddr;
+        bool         bUsed;
+        int          iFormat;
+        qint64       iLastRequestMs;
+    };
+
+    bool IsFormatValid ( const EAudComprType eAudComprType,
+                         const int           iNumAudioChannels,
+                         const int           iNetwFrameSize,
+                         const int           iFrameSizeSamples ) const;
+
+    int FindFormat ( const EAudComprType eAudComprType,
+                     const int           iNumAudioChannels,
+                     const int           iNetwFrameSize,
+                     const int           iFrameSizeSamples ) const;
+
+    int FindFreeFormat() const;
+
+    // creates the encoder of a format, must be called without holding the
+    // mutex since the mixer must not wait for it
+    void InitFormat ( CFormat&            Format,
+                      const EAudComprType eAudComprType,
+                      const int           iNumAudioChannels,
+                      const int           iNetwFrameSize,
+                      const int           iFrameSizeSamples );
+
+    // the previous encoder and buffers of the format are returned in the
+    // given format
+    void SwapFormat ( CFormat& CurFormat, CFormat& NewFormat );
+
+    int FindListener ( const CHostAddress& HostAddr ) const;
+    int FindFreeListener() const;
+    void AddListener ( const int           iIdx,
+                       const CHostAddress& HostAddr,
+                       const int           iFormat );
+    void FreeListener ( const int iIdx );
+
+    CVector<CListener> vecListeners;
+    CVector<CFormat>   vecFormats;
+    int                iTickFrameSizeSamples;
+    int                iMaxNumListeners;
+    int                iNumListeners;
+
+    OpusCustomMode*    OpusMode;
+    OpusCustomMode*    OpusModeSmall;
+
+    QMutex             Mutex;
+};
+
+
+
+// Reference implementation of a listener: the room mix of a server is
+// requested as uncompressed stereo audio and written as raw 16 bit little
+// endian PCM (48 kHz) to the standard output, e.g. for piping it into an
+// audio player.
+class CListenerClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    CListenerClient();
+    virtual ~CListenerClient();
+
+    bool Start ( const QString& strServerAddr );
+    void Stop();
+
+protected:
+    void SendRequest();
+
+    CHostAddress     ServerAddr;
+    QUdpSocket       UdpSocket;
+    QTimer           TimerRequest;
+    CProtocol        ConnLessProtocol;
+    QFile            OutFile;
+    CVector<uint8_t> vecbyRecBuf;
+    quint32          iCookie;
+
+public slots:
+    void OnReadyRead();
+    void OnTimerRequest() { SendRequest(); }
+    void OnSendCLProtMessage ( CHostAddress     InetAddr,
+                               CVector<uint8_t> vecMessage );
+    void OnCLConnChallengeReceived ( CHostAddress InetAddr,
+                                     quint32      iNewCookie );
+};
+
+#endif /* !defined ( LISTENER_HOIHGE7LKJH83JH8_3_4344JHZT56KJIUHF1912__INCLUDED_ ) */
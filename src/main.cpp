@@ -41,6 +41,24 @@ QDialog*      pMainWindow = NULL;
 
 int main ( int argc, char** argv )
 {
+    // if the mix stream (or the audio of the listener) is written to the
+    // standard output, the console output must go to the standard error (this must be done before anything is
+    // written to the console)
+    for ( int i = 1; i < argc - 1; i++ )
+    {
+        if ( ( !strcmp ( argv[i], "-M" ) || !strcmp ( argv[i], "--mixstream" ) ) &&
+             !strcmp ( argv[i + 1], "-" ) )
+        {
+            CMixStreamWriter::ReserveStdOut();
+        }
+
+        // the listener always writes the audio to the standard output
+        if ( !strcmp ( argv[i], "-k" ) || !strcmp ( argv[i], "--listen" ) )
+        {
+            CMixStreamWriter::ReserveStdOut();
+        }
+    }
+
 #ifdef _WIN32
     // no console on windows -> just write in string and dump it
     QString     strDummySink;
@@ -60,7 +78,12 @@ int main ( int argc, char** argv )
     bool    bShowComplRegConnList     = false;
     bool    bShowAnalyzerConsole      = false;
     bool    bCentServPingServerInList = false;
+    bool    bUseSmallFrameSize        = false;
+    bool    bRecordingSyncToDisk      = false;
+    bool    bMixTapGroupRead          = false;
     int     iNumServerChannels        = DEFAULT_USED_NUM_CHANNELS;
+    int     iNumServerListeners       = 0;
+    int     iNumServerRooms           = 1;
     quint16 iPortNumber               = LLCON_DEFAULT_PORT_NUMBER;
     QString strIniFileName            = "";
     QString strHTMLStatusFileName     = "";
@@ -69,7 +92,14 @@ int main ( int argc, char** argv )
     QString strHistoryFileName        = "";
     QString strCentralServer          = "";
     QString strServerInfo             = "";
+    QString strServerListFileName     = "";
+    QString strServerGroup            = "";
+    QString strUpstreamServer         = "";
+    QString strMixStreamFileName      = "";
+    QString strRecordingDirName       = "";
+    QString strMixTapName             = "";
     QString strWelcomeMessage         = "";
+    QString strListenServer           = "";
 
     // QT docu: argv()[0] is the program name, argv()[1] is the first
     // argument and argv()[argc()-1] is the last argument.
@@ -120,6 +150,45 @@ int main ( int argc, char** argv )
         }
 
 
+        // Maximum number of listeners -----------------------------------------
+        if ( GetNumericArgument ( tsConsole,
+                                  argc,
+                                  argv,
+                                  i,
+                                  "-L",
+                                  "--numlisteners",
+                                  0,
+                                  MAX_NUM_LISTENERS,
+                                  rDbleArgument ) )
+        {
+            iNumServerListeners = static_cast<int> ( rDbleArgument );
+
+            tsConsole << "- maximum number of listeners: "
+                << iNumServerListeners << endl;
+
+            continue;
+        }
+
+
+        // Number of rooms -----------------------------------------------------
+        if ( GetNumericArgument ( tsConsole,
+                                  argc,
+                                  argv,
+                                  i,
+                                  "-R",
+                                  "--numrooms",
+                                  1,
+                                  MAX_NUM_SERVER_ROOMS,
+                                  rDbleArgument ) )
+        {
+            iNumServerRooms = static_cast<int> ( rDbleArgument );
+
+            tsConsole << "- number of rooms: " << iNumServerRooms << endl;
+
+            continue;
+        }
+
+
 
         // Start minimized -----------------------------------------------------
         if ( GetFlagArgument ( argv,
@@ -145,6 +214,30 @@ int main ( int argc, char** argv )
         }
 
 
+        // Use small frame size for lower latency ------------------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "-F",
+                               "--fastupdate" ) )
+        {
+            bUseSmallFrameSize = true;
+            tsConsole << "- fast update (64 samples frame size) enabled" << endl;
+            continue;
+        }
+
+
+        // Flush the recorded audio to the disk --------------------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "-f",
+                               "--fsync" ) )
+        {
+            bRecordingSyncToDisk = true;
+            tsConsole << "- recording is synchronized to the disk" << endl;
+            continue;
+        }
+
+
         // Show all registered servers in the server list ----------------------
         // Undocumented debugging command line argument: Show all registered
         // servers in the server list regardless if a ping to the server is
@@ -279,6 +372,108 @@ int main ( int argc, char** argv )
         }
 
 
+        // Server list file ----------------------------------------------------
+        if ( GetStringArgument ( tsConsole,
+                                 argc,
+                                 argv,
+                                 i,
+                                 "-j",
+                                 "--serverlistfile",
+                                 strArgument ) )
+        {
+            strServerListFileName = strArgument;
+            tsConsole << "- server list file name: " << strServerListFileName << endl;
+            continue;
+        }
+
+
+        // Server group --------------------------------------------------------
+        if ( GetStringArgument ( tsConsole,
+                                 argc,
+                                 argv,
+                                 i,
+                                 "-G",
+                                 "--servergroup",
+                                 strArgument ) )
+        {
+            strServerGroup = strArgument;
+            tsConsole << "- server group: " << strServerGroup << endl;
+            continue;
+        }
+
+
+        // Upstream server for cascading ---------------------------------------
+        if ( GetStringArgument ( tsConsole,
+                                 argc,
+                                 argv,
+                                 i,
+                                 "-U",
+                                 "--upstream",
+                                 strArgument ) )
+        {
+            strUpstreamServer = strArgument;
+            tsConsole << "- upstream server: " << strUpstreamServer << endl;
+            continue;
+        }
+
+
+        // Encoded stream of the room mix --------------------------------------
+        if ( GetStringArgument ( tsConsole,
+                                 argc,
+                                 argv,
+                                 i,
+                                 "-M",
+                                 "--mixstream",
+                                 strArgument ) )
+        {
+            strMixStreamFileName = strArgument;
+            tsConsole << "- mix stream file name: " << strMixStreamFileName << endl;
+            continue;
+        }
+
+
+        // Multitrack recording directory --------------------------------------
+        if ( GetStringArgument ( tsConsole,
+                                 argc,
+                                 argv,
+                                 i,
+                                 "-r",
+                                 "--recording",
+                                 strArgument ) )
+        {
+            strRecordingDirName = strArgument;
+            tsConsole << "- recording directory: " << strRecordingDirName << endl;
+            continue;
+        }
+
+
+        // Shared memory mix tap -----------------------------------------------
+        if ( GetStringArgument ( tsConsole,
+                                 argc,
+                                 argv,
+                                 i,
+                                 "-T",
+                                 "--mixtap",
+                                 strArgument ) )
+        {
+            strMixTapName = strArgument;
+            tsConsole << "- mix tap shared memory name: " << strMixTapName << endl;
+            continue;
+        }
+
+
+        // Mix tap readable by the group ---------------------------------------
+        if ( GetFlagArgument ( argv,
+                               i,
+                               "-t",
+                               "--mixtapgroup" ) )
+        {
+            bMixTapGroupRead = true;
+            tsConsole << "- mix tap readable by the group" << endl;
+            continue;
+        }
+
+
         // Server welcome message ----------------------------------------------
         if ( GetStringArgument ( tsConsole,
                                  argc,
@@ -294,6 +489,21 @@ int main ( int argc, char** argv )
         }
 
 
+        // Listen to a server --------------------------------------------------
+        if ( GetStringArgument ( tsConsole,
+                                 argc,
+                                 argv,
+                                 i,
+                                 "-k",
+                                 "--listen",
+                                 strArgument ) )
+        {
+            strListenServer = strArgument;
+            tsConsole << "- listen to server: " << strListenServer << endl;
+            continue;
+        }
+
+
         // Initialization file -------------------------------------------------
         if ( GetStringArgument ( tsConsole,
                                  argc,
@@ -353,6 +563,19 @@ int main ( int argc, char** argv )
         strCentralServer = DEFAULT_SERVER_ADDRESS;
     }
 
+    // the listener has no GUI
+    if ( !strListenServer.isEmpty() )
+    {
+        bUseGUI = false;
+    }
+
+    // the multi-room mode is only supported without GUI
+    if ( !bIsClient && ( iNumServerRooms > 1 ) && bUseGUI )
+    {
+        bUseGUI = false;
+        tsConsole << "- no GUI mode chosen (multi-room mode)" << endl;
+    }
+
 
     // Application/GUI setup ---------------------------------------------------
     // Application object
@@ -379,7 +602,25 @@ int main ( int argc, char** argv )
 
     try
     {
-        if ( bIsClient )
+        if ( !strListenServer.isEmpty() )
+        {
+            // Listener:
+            // only receives the mix of the server (reference implementation
+            // of the listen request)
+            CListenerClient Listener;
+
+            if ( !Listener.Start ( strListenServer ) )
+            {
+                throw CGenErr ( "Cannot listen to the server " + strListenServer );
+            }
+
+            tsConsole << CAboutDlg::GetVersionAndNameStr ( false ) << endl;
+            tsConsole << "- writing 16 bit little endian stereo PCM at " <<
+                SYSTEM_SAMPLE_RATE_HZ << " Hz to the standard output" << endl;
+
+            app.exec();
+        }
+        else if ( bIsClient )
         {
             // Client:
             // actual client object
@@ -406,11 +647,96 @@ int main ( int argc, char** argv )
             ClientDlg.show();
             app.exec();
         }
+        else if ( iNumServerRooms > 1 )
+        {
+            // Multi-room server:
+            // all rooms are hosted by this process, each room uses its own
+            // port number (consecutive port numbers starting at the given
+            // port number) and the mixers of all rooms are called by the room
+            // mixer pool
+            CRoomMixerPool RoomMixerPool ( bUseSmallFrameSize ?
+                                           SYSTEM_FRAME_SIZE_SAMPLES_SMALL :
+                                           SYSTEM_FRAME_SIZE_SAMPLES,
+                                           iNumServerRooms );
+
+            CVector<CServer*> vecpRooms;
+
+            for ( int iRoom = 0; iRoom < iNumServerRooms; iRoom++ )
+            {
+                // if this process is the central server, only the first room
+                // is the central server and the other rooms register at it
+                // (the central server lists them with the address of this
+                // host instead of the loopback address)
+                QString strRoomCentralServer = strCentralServer;
+
+                if ( ( iRoom > 0 ) &&
+                     ( !strCentralServer.toLower().compare ( "localhost" ) ||
+                       !strCentralServer.compare ( "127.0.0.1" ) ) )
+                {
+                    strRoomCentralServer = QString ( "127.0.0.1:%1" ).arg ( iPortNumber );
+                }
+
+                CServer* pRoom = new CServer ( iNumServerChannels,
+                                               iNumServerListeners,
+                                               GetRoomFileName ( strLoggingFileName, iRoom ),
+                                               iPortNumber + iRoom,
+                                               GetRoomFileName ( strHTMLStatusFileName, iRoom ),
+                                               GetRoomFileName ( strHistoryFileName, iRoom ),
+                                               strServerName,
+                                               strRoomCentralServer,
+                                               strServerInfo,
+                                               ( iRoom == 0 ) ? strServerListFileName : "",
+                                               strServerGroup,
+                                               ( iRoom == 0 ) ? strUpstreamServer : "",
+                                               ( iRoom == 0 ) ? strMixStreamFileName : "",
+                                               GetRoomFileName ( strRecordingDirName, iRoom ),
+                                               GetRoomFileName ( strMixTapName, iRoom ),
+                                               strWelcomeMessage,
+                                               bCentServPingServerInList,
+                                               bUseSmallFrameSize,
+                                               bRecordingSyncToDisk,
+                                               bMixTapGroupRead,
+                                               RoomMixerPool.GetCodecModes() );
+
+                // the rooms are distinguished by the room number in the name
+                if ( iRoom > 0 )
+                {
+                    const QString strRoomNumber = " " + QString::number ( iRoom + 1 );
+
+                    pRoom->SetServerName ( pRoom->GetServerName().left (
+                        MAX_LEN_SERVER_NAME - strRoomNumber.length() ) + strRoomNumber );
+                }
+
+                pRoom->SetRoomMixerPool ( &RoomMixerPool );
+                RoomMixerPool.AddRoom ( pRoom );
+                vecpRooms.Add ( pRoom );
+
+                // update serverlist
+                pRoom->UpdateServerList();
+            }
+
+            // only start application without using the GUI
+            tsConsole << CAboutDlg::GetVersionAndNameStr ( false ) << endl;
+            tsConsole << "- rooms on ports " << iPortNumber << " to " <<
+                iPortNumber + iNumServerRooms - 1 << " with " <<
+                RoomMixerPool.GetNumWorkers() + 1 << " mixer threads" << endl;
+
+            app.exec();
+
+            // no mixer must be called anymore when the rooms are deleted
+            RoomMixerPool.Stop();
+
+            for ( int iRoom = 0; iRoom < vecpRooms.Size(); iRoom++ )
+            {
+                delete vecpRooms[iRoom];
+            }
+        }
         else
         {
             // Server:
             // actual server object
             CServer Server ( iNumServerChannels,
+                             iNumServerListeners,
                              strLoggingFileName,
                              iPortNumber,
                              strHTMLStatusFileName,
@@ -418,8 +744,17 @@ int main ( int argc, char** argv )
                              strServerName,
                              strCentralServer,
                              strServerInfo,
+                             strServerListFileName,
+                             strServerGroup,
+                             strUpstreamServer,
+                             strMixStreamFileName,
+                             strRecordingDirName,
+                             strMixTapName,
                              strWelcomeMessage,
-                             bCentServPingServerInList );
+                             bCentServPingServerInList,
+                             bUseSmallFrameSize,
+                             bRecordingSyncToDisk,
+                             bMixTapGroupRead );
 
             if ( bUseGUI )
             {
@@ -502,13 +837,30 @@ QString UsageArguments ( char **argv )
         "  -c, --connect         connect to last server on startup (client\n"
         "                        only)\n"
         "  -e, --centralserver   address of the central server (server only)\n"
+        "  -f, --fsync           flush the recorded audio to the disk after each\n"
+        "                        write (server only)\n"
+        "  -F, --fastupdate      use 64 samples frame size for lower latency\n"
+        "                        (server only)\n"
         "  -g, --pingservers     ping servers in list to keep NAT port open\n"
         "                        (central server only)\n"
+        "  -G, --servergroup     name of the group of servers which can host the\n"
+        "                        same sessions (server only)\n"
         "  -h, -?, --help        this help text\n"
         "  -i, --inifile         initialization file name (client only)\n"
+        "  -j, --serverlistfile  server list snapshot file name (central server\n"
+        "                        only)\n"
         "  -l, --log             enable logging, set file name\n"
+        "  -k, --listen          receive the mix of the server with this address\n"
+        "                        as listener and write it as raw 16 bit little\n"
+        "                        endian stereo PCM to the standard output\n"
+        "  -L, --numlisteners    maximum number of listeners which only receive\n"
+        "                        the mix of all clients (server only)\n"
         "  -m, --htmlstatus      enable HTML status file, set file name (server\n"
         "                        only)\n"
+        "  -M, --mixstream       write the mix of all clients as Ogg Opus stream\n"
+        "                        to a file or named pipe, \"-\" for the standard\n"
+        "                        output, the console output then goes to the\n"
+        "                        standard error (server only)\n"
         "  -n, --nogui           disable GUI (server only)\n"
         "  -o, --serverinfo      infos of the server(s) in the format:\n"
         "                        [name];[city];[country as QLocale ID]; ...\n"
@@ -517,8 +869,22 @@ QString UsageArguments ( char **argv )
         "                        [server1 country as QLocale ID]; ...\n"
         "                        [server2 address]; ... (server only)\n"
         "  -p, --port            local port number (server only)\n"
+        "  -r, --recording       record each client in a separate WAV file, set\n"
+        "                        the directory of the sessions (server only)\n"
+        "  -R, --numrooms        number of rooms hosted by this server process,\n"
+        "                        each room uses its own port number starting at\n"
+        "                        the local port number (server only, no GUI)\n"
         "  -s, --server          start server\n"
+        "  -T, --mixtap          publish the mix and the audio of all clients in\n"
+        "                        a POSIX shared memory object with this name,\n"
+        "                        e.g. /jamulus, only readable by the user of\n"
+        "                        the server (server only)\n"
+        "  -t, --mixtapgroup     the mix tap is also readable by the group of\n"
+        "                        the user of the server (server only)\n"
         "  -u, --numchannels     maximum number of channels (server only)\n"
+        "  -U, --upstream        address of an upstream server which gets the\n"
+        "                        mix of this server and whose mix is sent to\n"
+        "                        the clients of this server (server only)\n"
         "  -w, --welcomemessage  welcome message on connect (server only)\n"
         "  -y, --history         enable connection history and set file\n"
         "                        name (server only)\n"
@@ -616,3 +982,27 @@ bool GetNumericArgument ( QTextStream& tsConsole,
         return false;
     }
 }
+
+QString GetRoomFileName ( const QString& strFileName,
+                          const int      iRoom )
+{
+    // the first room uses the file name as it is, for the other rooms the
+    // room number is added to the file name (before the file extension)
+    if ( strFileName.isEmpty() || ( iRoom == 0 ) )
+    {
+        return strFileName;
+    }
+
+    const QString strRoomSuffix = QString ( "_room%1" ).arg ( iRoom + 1 );
+    const int     iExtPos       = strFileName.lastIndexOf ( '.' );
+
+    if ( ( iExtPos > 0 ) &&
+         ( iExtPos > strFileName.lastIndexOf ( '/' ) ) &&
+         ( iExtPos > strFileName.lastIndexOf ( '\\' ) ) )
+    {
+        return strFileName.left ( iExtPos ) + strRoomSuffix +
+            strFileName.mid ( iExtPos );
+    }
+
+    return strFileName + strRoomSuffix;
+}
@@ -0,0 +1,468 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2014
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#include "mixstream.h"
+#ifndef _WIN32
+# include <signal.h>
+# include <unistd.h>
+# include <fcntl.h>
+#endif
+#include <stdio.h>
+
+
+/* Implementation *************************************************************/
+int CMixStreamWriter::iStdOutFd = -1;
+
+
+// COggPageWriter implementation ***********************************************
+COggPageWriter::COggPageWriter() :
+    iSerialNumber ( 0 ),
+    iPageSeqNum   ( 0 ),
+    iNumPackets   ( 0 ),
+    iNumSegments  ( 0 ),
+    iBodySize     ( 0 )
+{
+    // a page has at most 255 segments of at most 255 bytes
+    vecbySegTable.Init ( 255 );
+    vecbyBody.Init     ( 255 * 255 );
+}
+
+void COggPageWriter::Init ( const quint32 iNSerialNumber )
+{
+    iSerialNumber = iNSerialNumber;
+    iPageSeqNum   = 0;
+    iNumPackets   = 0;
+    iNumSegments  = 0;
+    iBodySize     = 0;
+}
+
+bool COggPageWriter::AddPacket ( const uint8_t* pbyData,
+                                 const int      iNumBytes )
+{
+    // lacing values: a packet of n bytes uses n / 255 segments of 255 and one
+    // final segment with the rest (which is zero if n is a multiple of 255)
+    const int iNumNewSegments = iNumBytes / 255 + 1;
+
+    if ( iNumSegments + iNumNewSegments > vecbySegTable.Size() )
+    {
+        return false; // packet does not fit in the current page
+    }
+
+    for ( int i = 0; i < iNumNewSegments - 1; i++ )
+    {
+        vecbySegTable[iNumSegments++] = 255;
+    }
+
+    vecbySegTable[iNumSegments++] = static_cast<uint8_t> ( iNumBytes % 255 );
+
+    std::copy ( pbyData, pbyData + iNumBytes, &vecbyBody[iBodySize] );
+    iBodySize += iNumBytes;
+    iNumPackets++;
+
+    return true;
+}
+
+bool COggPageWriter::WritePage ( QIODevice&   Device,
+                                 const qint64 iGranulePos,
+                                 const bool   bIsFirstPage,
+                                 const bool   bIsLastPage )
+{
+    int i;
+
+    // page header (27 bytes) followed by the segment table and the body
+    CVector<uint8_t> vecbyPage ( 27 + iNumSegments + iBodySize );
+
+    vecbyPage[0] = 'O';
+    vecbyPage[1] = 'g';
+    vecbyPage[2] = 'g';
+    vecbyPage[3] = 'S';
+    vecbyPage[4] = 0; // stream structure version
+
+    // header type: beginning and end of stream flags
+    vecbyPage[5] = static_cast<uint8_t> ( ( bIsFirstPage ? 0x02 : 0 ) |
+                                          ( bIsLastPage  ? 0x04 : 0 ) );
+
+    // all values are stored in little endian byte order
+    for ( i = 0; i < 8; i++ )
+    {
+        vecbyPage[6 + i] = static_cast<uint8_t> (
+            ( static_cast<quint64> ( iGranulePos ) >> ( 8 * i ) ) & 0xFF );
+    }
+
+    for ( i = 0; i < 4; i++ )
+    {
+        vecbyPage[14 + i] = static_cast<uint8_t> ( ( iSerialNumber >> ( 8 * i ) ) & 0xFF );
+        vecbyPage[18 + i] = static_cast<uint8_t> ( ( iPageSeqNum >> ( 8 * i ) ) & 0xFF );
+        vecbyPage[22 + i] = 0; // the CRC is calculated with a zero CRC field
+    }
+
+    vecbyPage[26] = static_cast<uint8_t> ( iNumSegments );
+
+    std::copy ( &vecbySegTable[0],
+                &vecbySegTable[0] + iNumSegments,
+                &vecbyPage[27] );
+
+    std::copy ( &vecbyBody[0],
+                &vecbyBody[0] + iBodySize,
+                &vecbyPage[27 + iNumSegments] );
+
+    const quint32 iCRC = CalcCRC ( &vecbyPage[0], vecbyPage.Size() );
+
+    for ( i = 0; i < 4; i++ )
+    {
+        vecbyPage[22 + i] = static_cast<uint8_t> ( ( iCRC >> ( 8 * i ) ) & 0xFF );
+    }
+
+    // start a new page
+    iPageSeqNum++;
+    iNumPackets  = 0;
+    iNumSegments = 0;
+    iBodySize    = 0;
+
+    return Device.write ( reinterpret_cast<const char*> ( &vecbyPage[0] ),
+                          vecbyPage.Size() ) == vecbyPage.Size();
+}
+
+quint32 COggPageWriter::CalcCRC ( const uint8_t* pbyData,
+                                  const int      iNumBytes )
+{
+    // CRC-32 with the polynomial 0x04C11DB7, zero initial value and no final
+    // XOR (the bits are processed MSB first)
+    static quint32 iTable[256];
+    static bool    bTableIsInitialized = false;
+
+    if ( !bTableIsInitialized )
+    {
+        for ( quint32 i = 0; i < 256; i++ )
+        {
+            quint32 iReg = i << 24;
+
+            for ( int j = 0; j < 8; j++ )
+            {
+                iReg = ( iReg & 0x80000000 ) ? ( ( iReg << 1 ) ^ 0x04C11DB7 ) :
+                                               ( iReg << 1 );
+            }
+
+            iTable[i] = iReg;
+        }
+
+        bTableIsInitialized = true;
+    }
+
+    quint32 iCRC = 0;
+
+    for ( int i = 0; i < iNumBytes; i++ )
+    {
+        iCRC = ( iCRC << 8 ) ^ iTable[( ( iCRC >> 24 ) ^ pbyData[i] ) & 0xFF];
+    }
+
+    return iCRC;
+}
+
+
+// CMixStreamWriter implementation *********************************************
+CMixStreamWriter::CMixStreamWriter() :
+    bRun         ( false ),
+    iOutFd       ( -1 ),
+    pOpusEncoder ( NULL ),
+    iPreSkip     ( 0 )
+{
+    int iOpusError;
+
+    pOpusEncoder = opus_encoder_create ( SYSTEM_SAMPLE_RATE_HZ,
+                                         2,
+                                         OPUS_APPLICATION_AUDIO,
+                                         &iOpusError );
+
+    opus_encoder_ctl ( pOpusEncoder,
+                       OPUS_SET_BITRATE ( MIX_STREAM_BIT_RATE_BPS ) );
+
+    // the decoder has to skip the samples of the encoder delay
+    opus_int32 iLookahead = 0;
+    opus_encoder_ctl ( pOpusEncoder, OPUS_GET_LOOKAHEAD ( &iLookahead ) );
+    iPreSkip = static_cast<int> ( iLookahead );
+
+    Ring.Init ( MIX_STREAM_RING_SIZE_SAMPLES );
+}
+
+CMixStreamWriter::~CMixStreamWriter()
+{
+    Stop();
+
+    opus_encoder_destroy ( pOpusEncoder );
+}
+
+void CMixStreamWriter::Start ( const QString& strNFileName )
+{
+#ifndef _WIN32
+    // if the reader of a pipe went away, the write call shall return an
+    // error instead of terminating the application
+    signal ( SIGPIPE, SIG_IGN );
+#endif
+
+    strFileName = strNFileName;
+    bRun        = true;
+
+    // the encoding is not time critical but must keep up with the mixer
+    start ( QThread::HighPriority );
+}
+
+void CMixStreamWriter::Stop()
+{
+    if ( isRunning() )
+    {
+        bRun = false;
+        wait();
+    }
+}
+
+void CMixStreamWriter::Put ( const CVector<int16_t>& vecsStereoData,
+                             const int               iNumSamples )
+{
+    if ( !Ring.Put ( &vecsStereoData.front(), 2 * iNumSamples ) )
+    {
+        iNumDroppedBlocks.fetchAndAddRelaxed ( 1 );
+        iNumDroppedSamples.fetchAndAddRelaxed ( iNumSamples );
+    }
+}
+
+void CMixStreamWriter::run()
+{
+    CVector<int16_t> vecsFrame    ( 2 * MIX_STREAM_FRAME_SIZE_SAMPLES );
+    CVector<uint8_t> vecbyPacket  ( MIX_STREAM_MAX_PACKET_BYTES );
+    qint64           iGranulePos  = 0;
+    bool             bFileIsValid = false;
+    QFile            File;
+
+    // the audio dropped by the mixer is replaced by silence so that the
+    // stream time (granule position) keeps up with the real time
+    int iLastNumDroppedSamples = 0;
+    int iNumSilenceSamples     = 0;
+
+    while ( bRun )
+    {
+        // (re)open the output and start a new Ogg stream
+        if ( !bFileIsValid )
+        {
+            if ( !OpenOutput ( File ) || !WriteHeaders ( File ) )
+            {
+                CloseOutput ( File );
+                WaitWhileRunning ( MIX_STREAM_REOPEN_INTERV_MS );
+                continue;
+            }
+
+            // audio which was queued while the output was not available is
+            // outdated
+            while ( Ring.Get ( &vecsFrame[0], vecsFrame.Size() ) ) {}
+
+            opus_encoder_ctl ( pOpusEncoder, OPUS_RESET_STATE );
+            iGranulePos            = 0;
+            iLastNumDroppedSamples = iNumDroppedSamples.fetchAndAddRelaxed ( 0 );
+            iNumSilenceSamples     = 0;
+            bFileIsValid           = true;
+        }
+
+        // the difference is also correct if the counter wraps around
+        const int iCurNumDroppedSamples = iNumDroppedSamples.fetchAndAddRelaxed ( 0 );
+
+        iNumSilenceSamples += static_cast<int> (
+            static_cast<unsigned int> ( iCurNumDroppedSamples ) -
+            static_cast<unsigned int> ( iLastNumDroppedSamples ) );
+
+        iLastNumDroppedSamples = iCurNumDroppedSamples;
+
+        // the silence is inserted when the drop is noticed, i.e., before the
+        // audio which is still queued in the ring buffer (at most one second)
+        if ( iNumSilenceSamples >= MIX_STREAM_FRAME_SIZE_SAMPLES )
+        {
+            vecsFrame.Reset ( 0 );
+            iNumSilenceSamples -= MIX_STREAM_FRAME_SIZE_SAMPLES;
+        }
+        else if ( !Ring.Get ( &vecsFrame[0], vecsFrame.Size() ) )
+        {
+            msleep ( MIX_STREAM_POLL_INTERV_MS );
+            continue;
+        }
+
+        const int iNumBytes = opus_encode ( pOpusEncoder,
+                                            &vecsFrame[0],
+                                            MIX_STREAM_FRAME_SIZE_SAMPLES,
+                                            &vecbyPacket[0],
+                                            vecbyPacket.Size() );
+
+        if ( iNumBytes < 0 )
+        {
+            continue; // encoder error, drop the frame
+        }
+
+        OggWriter.AddPacket ( &vecbyPacket[0], iNumBytes );
+        iGranulePos += MIX_STREAM_FRAME_SIZE_SAMPLES;
+
+        if ( OggWriter.GetNumPackets() >= MIX_STREAM_PACKETS_PER_PAGE )
+        {
+            if ( !OggWriter.WritePage ( File, iGranulePos, false, false ) ||
+                 !File.flush() )
+            {
+                // e.g. the reader of the pipe went away
+                CloseOutput ( File );
+                bFileIsValid = false;
+            }
+        }
+    }
+
+    // terminate the Ogg stream properly
+    if ( bFileIsValid )
+    {
+        OggWriter.WritePage ( File, iGranulePos, false, true );
+        CloseOutput ( File );
+    }
+}
+
+void CMixStreamWriter::ReserveStdOut()
+{
+#ifndef _WIN32
+    // the stream gets a copy of the standard output, the standard output
+    // itself is redirected to the standard error so that the console output
+    // of the server (and of the libraries) does not corrupt the stream
+    if ( iStdOutFd < 0 )
+    {
+        fflush ( stdout );
+
+        iStdOutFd = dup ( fileno ( stdout ) );
+        dup2 ( fileno ( stderr ), fileno ( stdout ) );
+    }
+#endif
+}
+
+bool CMixStreamWriter::OpenStdOut ( QFile& File )
+{
+    if ( iStdOutFd >= 0 )
+    {
+        return File.open ( iStdOutFd, QIODevice::WriteOnly );
+    }
+
+    return File.open ( stdout, QIODevice::WriteOnly );
+}
+
+bool CMixStreamWriter::OpenOutput ( QFile& File )
+{
+    if ( strFileName == "-" )
+    {
+        return OpenStdOut ( File );
+    }
+
+#ifndef _WIN32
+    // a blocking open call would wait for the reader of a named pipe (and the
+    // thread could not be stopped), with the non-blocking open call the
+    // opening fails with ENXIO if there is no reader yet and is retried later
+    iOutFd = ::open ( strFileName.toLocal8Bit().constData(),
+                      O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK,
+                      0644 );
+
+    if ( iOutFd < 0 )
+    {
+        return false; // e.g. no reader of the named pipe (ENXIO)
+    }
+
+    // the writes shall block (a partially written page would corrupt the
+    // stream)
+    const int iFlags = fcntl ( iOutFd, F_GETFL );
+
+    if ( ( iFlags < 0 ) ||
+         ( fcntl ( iOutFd, F_SETFL, iFlags & ~O_NONBLOCK ) < 0 ) )
+    {
+        return false;
+    }
+
+    return File.open ( iOutFd, QIODevice::WriteOnly );
+#else
+    File.setFileName ( strFileName );
+    return File.open ( QIODevice::WriteOnly | QIODevice::Truncate );
+#endif
+}
+
+void CMixStreamWriter::CloseOutput ( QFile& File )
+{
+    File.close();
+
+#ifndef _WIN32
+    // a file which was opened with a file descriptor does not close it
+    if ( iOutFd >= 0 )
+    {
+        ::close ( iOutFd );
+        iOutFd = -1;
+    }
+#endif
+}
+
+bool CMixStreamWriter::WriteHeaders ( QFile& File )
+{
+    // each stream gets a new random serial number
+    OggWriter.Init ( static_cast<quint32> ( qrand() ) ^
+        static_cast<quint32> ( QDateTime::currentMSecsSinceEpoch() ) );
+
+    // identification header (RFC 7845): magic signature, version, number of
+    // channels, pre-skip, input sample rate, output gain, mapping family
+    uint8_t byHead[19] = { 'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 1, 2,
+        static_cast<uint8_t> ( iPreSkip & 0xFF ),
+        static_cast<uint8_t> ( ( iPreSkip >> 8 ) & 0xFF ),
+        static_cast<uint8_t> ( SYSTEM_SAMPLE_RATE_HZ & 0xFF ),
+        static_cast<uint8_t> ( ( SYSTEM_SAMPLE_RATE_HZ >> 8 ) & 0xFF ),
+        static_cast<uint8_t> ( ( SYSTEM_SAMPLE_RATE_HZ >> 16 ) & 0xFF ),
+        static_cast<uint8_t> ( ( SYSTEM_SAMPLE_RATE_HZ >> 24 ) & 0xFF ),
+        0, 0, 0 };
+
+    OggWriter.AddPacket ( byHead, sizeof ( byHead ) );
+
+    if ( !OggWriter.WritePage ( File, 0, true, false ) )
+    {
+        return false;
+    }
+
+    // comment header: magic signature, vendor string and no user comments
+    const QByteArray strVendor = QString ( APP_NAME ).toUtf8();
+    QByteArray       vecbyTags ( "OpusTags" );
+
+    for ( int i = 0; i < 4; i++ )
+    {
+        vecbyTags.append ( static_cast<char> ( ( strVendor.size() >> ( 8 * i ) ) & 0xFF ) );
+    }
+
+    vecbyTags.append ( strVendor );
+    vecbyTags.append ( QByteArray ( 4, 0 ) );
+
+    OggWriter.AddPacket ( reinterpret_cast<const uint8_t*> ( vecbyTags.constData() ),
+                          vecbyTags.size() );
+
+    return OggWriter.WritePage ( File, 0, false, false ) && File.flush();
+}
+
+void CMixStreamWriter::WaitWhileRunning ( const int iTimeMs )
+{
+    // wait in small steps so that a stop request is not delayed
+    for ( int i = 0; bRun && ( i < iTimeMs ); i += MIX_STREAM_POLL_INTERV_MS )
+    {
+        msleep ( MIX_STREAM_POLL_INTERV_MS );
+    }
+}
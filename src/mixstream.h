@@ -0,0 +1,145 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2014
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#if !defined ( MIXSTREAM_HOIHGE7LKJH83JH8_3_4344OIUZ7856IUHF1912__INCLUDED_ )
+#define MIXSTREAM_HOIHGE7LKJH83JH8_3_4344OIUZ7856IUHF1912__INCLUDED_
+
+#include <QThread>
+#include <QFile>
+#include <QAtomicInt>
+#include <QDateTime>
+#include "opus.h"
+#include "global.h"
+#include "buffer.h"
+#include "util.h"
+
+
+/* Definitions ****************************************************************/
+// the stream uses the regular OPUS codec (not the custom mode of the audio
+// transport) with 20 ms frames so that any Ogg Opus player can decode it
+#define MIX_STREAM_FRAME_SIZE_SAMPLES       960
+#define MIX_STREAM_BIT_RATE_BPS             128000
+#define MIX_STREAM_MAX_PACKET_BYTES         1500
+
+// number of OPUS packets which are combined in one Ogg page
+#define MIX_STREAM_PACKETS_PER_PAGE         5
+
+// the ring buffer between the mixer and the writer thread holds one second
+// of stereo audio, if the writer falls behind the audio is dropped
+#define MIX_STREAM_RING_SIZE_SAMPLES        ( 2 * SYSTEM_SAMPLE_RATE_HZ )
+
+// the writer thread polls the ring buffer with this interval
+#define MIX_STREAM_POLL_INTERV_MS           10
+
+// time to wait before the output is opened again after a write error (e.g. if
+// the reader of a named pipe went away) or if a named pipe has no reader yet
+#define MIX_STREAM_REOPEN_INTERV_MS         1000
+
+
+/* Classes ********************************************************************/
+// Ogg page writer -------------------------------------------------------------
+// Minimal Ogg encapsulation (RFC 3533) of a single logical stream: the packets
+// are collected and written as one page per call to WritePage.
+class COggPageWriter
+{
+public:
+    COggPageWriter();
+
+    void Init ( const quint32 iNSerialNumber );
+
+    bool AddPacket ( const uint8_t* pbyData, const int iNumBytes );
+    int GetNumPackets() const { return iNumPackets; }
+
+    bool WritePage ( QIODevice&   Device,
+                     const qint64 iGranulePos,
+                     const bool   bIsFirstPage,
+                     const bool   bIsLastPage );
+
+protected:
+    static quint32 CalcCRC ( const uint8_t* pbyData, const int iNumBytes );
+
+    quint32          iSerialNumber;
+    quint32          iPageSeqNum;
+    int              iNumPackets;
+    CVector<uint8_t> vecbySegTable;
+    CVector<uint8_t> vecbyBody;
+    int              iNumSegments;
+    int              iBodySize;
+};
+
+
+// Room mix stream writer ------------------------------------------------------
+// The mixer of the server puts the room mix in a lock-free ring buffer, the
+// encoding and the output (which may block, e.g. for a named pipe) is done in
+// a separate thread so that the mixer is never stalled.
+class CMixStreamWriter : public QThread
+{
+public:
+    CMixStreamWriter();
+    virtual ~CMixStreamWriter();
+
+    // the file name "-" writes the stream to the standard output
+    void Start ( const QString& strNFileName );
+    void Stop();
+
+    // called by the mixer with the stereo room mix, never blocks
+    void Put ( const CVector<int16_t>& vecsStereoData,
+               const int               iNumSamples );
+
+    int GetNumDroppedBlocks() { return iNumDroppedBlocks.fetchAndAddRelaxed ( 0 ); }
+
+    // reserves the standard output for the stream, all other output of the
+    // process to the standard output then goes to the standard error (must
+    // be called before anything is written to the standard output)
+    static void ReserveStdOut();
+
+    // opens the (reserved) standard output for writing binary data
+    static bool OpenStdOut ( QFile& File );
+
+protected:
+    virtual void run();
+
+    bool OpenOutput ( QFile& File );
+    void CloseOutput ( QFile& File );
+    bool WriteHeaders ( QFile& File );
+    void WaitWhileRunning ( const int iTimeMs );
+
+    CSpscRingBuffer<int16_t> Ring;
+    QString                  strFileName;
+    volatile bool            bRun;
+    QAtomicInt               iNumDroppedBlocks;
+    QAtomicInt               iNumDroppedSamples;
+
+    // file descriptor of the output file (if not the standard output)
+    int                      iOutFd;
+
+    OpusEncoder*             pOpusEncoder;
+    int                      iPreSkip;
+    COggPageWriter           OggWriter;
+
+    // file descriptor of the original standard output (if reserved)
+    static int               iStdOutFd;
+};
+
+#endif /* !defined ( MIXSTREAM_HOIHGE7LKJH83JH8_3_4344OIUZ7856IUHF1912__INCLUDED_ ) */
@@ -0,0 +1,290 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2014
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#include "mixtap.h"
+#include <string.h>
+#if !defined ( _WIN32 ) && !defined ( ANDROID )
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <signal.h>
+# include <errno.h>
+# define MIX_TAP_SUPPORTED
+#endif
+
+
+/* Implementation *************************************************************/
+CMixTap::CMixTap ( const int iNFrameSizeSamples,
+                   const int iNMaxNumChannels ) :
+    iFrameSizeSamples ( iNFrameSizeSamples ),
+    iNumStreams       ( iNMaxNumChannels + 1 ), // room mix and all channels
+    iMapSize          ( 0 ),
+    pHeader           ( NULL ),
+    pbySlots          ( NULL )
+{
+    // each stream has space for stereo audio
+    iStreamSize = sizeof ( MIX_TAP_STREAM_HEADER ) +
+        2 * iFrameSizeSamples * sizeof ( int16_t );
+
+    iSlotSize = sizeof ( MIX_TAP_SLOT_HEADER ) + iNumStreams * iStreamSize;
+
+    vecbStreamUsed.Init ( iNumStreams, false );
+}
+
+CMixTap::~CMixTap()
+{
+    Close();
+}
+
+bool CMixTap::Open ( const QString& strNName,
+                     const bool     bGroupRead )
+{
+#ifdef MIX_TAP_SUPPORTED
+    Close();
+
+    strName  = strNName;
+    iMapSize = sizeof ( MIX_TAP_HEADER ) +
+        static_cast<size_t> ( MIX_TAP_NUM_SLOTS ) * iSlotSize;
+
+    const QByteArray strLocalName = strName.toLocal8Bit();
+
+    // the audio of the clients is private, only the user of the server (and
+    // optionally its group) may read it and only the server can write it
+    const mode_t iMode = bGroupRead ? ( S_IRUSR | S_IWUSR | S_IRGRP ) :
+                                      ( S_IRUSR | S_IWUSR );
+
+    int iFd = shm_open ( strLocalName.constData(),
+                         O_CREAT | O_EXCL | O_RDWR,
+                         iMode );
+
+    // an object of a previous server instance which was not shut down
+    // properly is removed (readers which still have it mapped do not get any
+    // new audio), the object of a running server is never taken over
+    if ( ( iFd < 0 ) && ( errno == EEXIST ) && !IsInUse ( strLocalName ) )
+    {
+        shm_unlink ( strLocalName.constData() );
+
+        iFd = shm_open ( strLocalName.constData(),
+                         O_CREAT | O_EXCL | O_RDWR,
+                         iMode );
+    }
+
+    if ( iFd < 0 )
+    {
+        return false;
+    }
+
+    // the mode of shm_open is restricted by the umask, the requested mode is
+    // set explicitly
+    fchmod ( iFd, iMode );
+
+    void* pMap = MAP_FAILED;
+
+    if ( ftruncate ( iFd, static_cast<off_t> ( iMapSize ) ) == 0 )
+    {
+        pMap = mmap ( NULL, iMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, iFd, 0 );
+    }
+
+    close ( iFd );
+
+    if ( pMap == MAP_FAILED )
+    {
+        shm_unlink ( strLocalName.constData() );
+        return false;
+    }
+
+    // touch all pages now so that the mixer does not get page faults on the
+    // first write access
+    memset ( pMap, 0, iMapSize );
+
+    pHeader  = static_cast<MIX_TAP_HEADER*> ( pMap );
+    pbySlots = static_cast<uint8_t*> ( pMap ) + sizeof ( MIX_TAP_HEADER );
+
+    pHeader->iVersion          = MIX_TAP_VERSION;
+    pHeader->iHeaderSize       = sizeof ( MIX_TAP_HEADER );
+    pHeader->iSampleRate       = SYSTEM_SAMPLE_RATE_HZ;
+    pHeader->iFrameSizeSamples = iFrameSizeSamples;
+    pHeader->iNumStreams       = iNumStreams;
+    pHeader->iNumSlots         = MIX_TAP_NUM_SLOTS;
+    pHeader->iSlotSize         = iSlotSize;
+    pHeader->iStreamSize       = iStreamSize;
+    pHeader->iWriteSeq         = 0;
+    pHeader->iWriterPid        = static_cast<uint32_t> ( getpid() );
+
+    // a reader only accepts the header if the magic number is set
+    __sync_synchronize();
+    pHeader->iMagic = MIX_TAP_MAGIC;
+
+    return true;
+#else
+    // POSIX shared memory is not available on this platform
+    strName = strNName;
+    return false;
+#endif
+}
+
+bool CMixTap::IsInUse ( const QByteArray& strLocalName )
+{
+#ifdef MIX_TAP_SUPPORTED
+    const int iFd = shm_open ( strLocalName.constData(), O_RDONLY, 0 );
+
+    if ( iFd < 0 )
+    {
+        // the object may belong to another user, it must not be removed
+        return errno != ENOENT;
+    }
+
+    struct stat FileStat;
+    bool        bInUse = false;
+
+    if ( ( fstat ( iFd, &FileStat ) == 0 ) &&
+         ( FileStat.st_size >= static_cast<off_t> ( sizeof ( MIX_TAP_HEADER ) ) ) )
+    {
+        void* pMap = mmap ( NULL, sizeof ( MIX_TAP_HEADER ), PROT_READ, MAP_SHARED, iFd, 0 );
+
+        if ( pMap != MAP_FAILED )
+        {
+            const MIX_TAP_HEADER* pCurHeader = static_cast<const MIX_TAP_HEADER*> ( pMap );
+
+            // the object is in use if the server which wrote it still runs
+            // (EPERM: the process exists but belongs to another user)
+            if ( ( pCurHeader->iMagic == MIX_TAP_MAGIC ) &&
+                 ( pCurHeader->iWriterPid != 0 ) )
+            {
+                const pid_t iPid = static_cast<pid_t> ( pCurHeader->iWriterPid );
+
+                bInUse = ( kill ( iPid, 0 ) == 0 ) || ( errno == EPERM );
+            }
+
+            munmap ( pMap, sizeof ( MIX_TAP_HEADER ) );
+        }
+    }
+
+    close ( iFd );
+
+    return bInUse;
+#else
+    return false;
+#endif
+}
+
+void CMixTap::Close()
+{
+#ifdef MIX_TAP_SUPPORTED
+    if ( pHeader != NULL )
+    {
+        munmap ( pHeader, iMapSize );
+        shm_unlink ( strName.toLocal8Bit().constData() );
+
+        pHeader  = NULL;
+        pbySlots = NULL;
+    }
+#endif
+}
+
+void CMixTap::Put ( const CVector<int>&               vecChanIDs,
+                    const CVector<CVector<int16_t> >& vecvecsData,
+                    const CVector<int>&               vecNumAudioChannels,
+                    const int                         iNumClients,
+                    const CVector<int16_t>&           vecsRoomMix )
+{
+#ifdef MIX_TAP_SUPPORTED
+    if ( pHeader == NULL )
+    {
+        return;
+    }
+
+    // the server is the only writer, therefore the sequence number can be
+    // read without synchronization
+    const uint32_t iSeq  = pHeader->iWriteSeq;
+    uint8_t*       pSlot = pbySlots +
+        static_cast<size_t> ( iSeq % MIX_TAP_NUM_SLOTS ) * iSlotSize;
+
+    MIX_TAP_SLOT_HEADER* pSlotHeader =
+        reinterpret_cast<MIX_TAP_SLOT_HEADER*> ( pSlot );
+
+    // mark the slot as being written
+    pSlotHeader->iSeq = 2 * iSeq + 1;
+    __sync_synchronize();
+
+    PutStream ( pSlot, MIX_TAP_ROOM_MIX_STREAM, &vecsRoomMix.front(), 2 );
+
+    vecbStreamUsed.Reset ( false );
+
+    for ( int i = 0; i < iNumClients; i++ )
+    {
+        const int iStream = vecChanIDs[i] + 1;
+
+        // the audio is taken through an iterator since the const operator[]
+        // of the vector returns a copy
+        PutStream ( pSlot,
+                    iStream,
+                    &( vecvecsData.begin() + i )->front(),
+                    vecNumAudioChannels[i] );
+
+        vecbStreamUsed[iStream] = true;
+    }
+
+    // channels without a client have no audio
+    for ( int i = 1; i < iNumStreams; i++ )
+    {
+        if ( !vecbStreamUsed[i] )
+        {
+            PutStream ( pSlot, i, NULL, 0 );
+        }
+    }
+
+    // the slot is complete, publish it
+    __sync_synchronize();
+    pSlotHeader->iSeq = 2 * iSeq + 2;
+    __sync_synchronize();
+    pHeader->iWriteSeq = iSeq + 1;
+#else
+    Q_UNUSED ( vecChanIDs )
+    Q_UNUSED ( vecvecsData )
+    Q_UNUSED ( vecNumAudioChannels )
+    Q_UNUSED ( iNumClients )
+    Q_UNUSED ( vecsRoomMix )
+#endif
+}
+
+void CMixTap::PutStream ( uint8_t*       pbySlot,
+                          const int      iStream,
+                          const int16_t* psData,
+                          const int      iNumAudioChannels )
+{
+    uint8_t* pStream = pbySlot + sizeof ( MIX_TAP_SLOT_HEADER ) +
+        static_cast<size_t> ( iStream ) * iStreamSize;
+
+    reinterpret_cast<MIX_TAP_STREAM_HEADER*> ( pStream )->iNumAudioChannels =
+        iNumAudioChannels;
+
+    if ( iNumAudioChannels > 0 )
+    {
+        memcpy ( pStream + sizeof ( MIX_TAP_STREAM_HEADER ),
+                 psData,
+                 iNumAudioChannels * iFrameSizeSamples * sizeof ( int16_t ) );
+    }
+}
@@ -0,0 +1,89 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2014
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#if !defined ( MIXTAP_HOIHGE7LKJH83JH8_3_4344HGT65ZT98UHF1912__INCLUDED_ )
+#define MIXTAP_HOIHGE7LKJH83JH8_3_4344HGT65ZT98UHF1912__INCLUDED_
+
+#include <QString>
+#include <QByteArray>
+#include "mixtaplayout.h"
+#include "global.h"
+#include "util.h"
+
+
+/* Definitions ****************************************************************/
+// number of timer ticks in the ring of the shared memory (about 340 ms with
+// the default frame size)
+#define MIX_TAP_NUM_SLOTS                   128
+
+
+/* Classes ********************************************************************/
+// Shared memory mix tap -------------------------------------------------------
+// Publishes the room mix and the decoded audio of all channels of each timer
+// tick in a POSIX shared memory object so that processes on the same machine
+// can use the audio without any load on the server (the layout is described
+// in mixtaplayout.h, readers can use the library in libs/mixtap). The mixer
+// only writes to the shared memory and never waits for a reader.
+class CMixTap
+{
+public:
+    CMixTap ( const int iNFrameSizeSamples,
+              const int iNMaxNumChannels );
+
+    virtual ~CMixTap();
+
+    // creates the shared memory object with the given name (e.g. "/jamulus"),
+    // fails if the object is still used by another server
+    bool Open ( const QString& strNName,
+                const bool     bGroupRead = false );
+    void Close();
+
+    // called by the mixer for each timer tick
+    void Put ( const CVector<int>&               vecChanIDs,
+               const CVector<CVector<int16_t> >& vecvecsData,
+               const CVector<int>&               vecNumAudioChannels,
+               const int                         iNumClients,
+               const CVector<int16_t>&           vecsRoomMix );
+
+protected:
+    static bool IsInUse ( const QByteArray& strLocalName );
+
+    void PutStream ( uint8_t*       pbySlot,
+                     const int      iStream,
+                     const int16_t* psData,
+                     const int      iNumAudioChannels );
+
+    int             iFrameSizeSamples;
+    int             iNumStreams;
+    int             iStreamSize;
+    int             iSlotSize;
+    size_t          iMapSize;
+
+    QString         strName;
+    MIX_TAP_HEADER* pHeader;
+    uint8_t*        pbySlots;
+    CVector<bool>   vecbStreamUsed;
+};
+
+#endif /* !defined ( MIXTAP_HOIHGE7LKJH83JH8_3_4344HGT65ZT98UHF1912__INCLUDED_ ) */
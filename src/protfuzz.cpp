@@ -0,0 +1,668 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2014
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+/*
+  Protocol fuzzing and throughput benchmark harness.
+
+  The harness feeds the protocol parser functions ParseMessageFrame(),
+  ParseMessageBody() and ParseConnectionLessMessageBody() with the messages of
+  a corpus and with random mutations of these messages. The corpus is either
+  generated with the random message generator of the test bench or loaded
+  from files (one frame per file).
+
+  Build (separate target, not part of the normal build):
+    qmake "CONFIG+=protfuzz" Jamulus.pro
+
+  Usage:
+    jamulusprotfuzz [-i iterations] [-b] [corpus file or directory] ...
+      -i  number of fuzzing iterations (default 100000)
+      -b  run the throughput benchmark instead of the fuzzing
+
+  The benchmark reports the number of parsed messages per second and the
+  number of memory allocations per message for each message ID and the
+  throughput of the CRC calculation.
+
+  Before the fuzzing, the table driven CRC calculations (CCRC::AddByte() and
+  the slice-by-4 CCRC::AddBytes()) are checked against the original bit-wise
+  calculation with random buffers. The harness returns an error if the
+  results differ.
+
+  For libFuzzer, build with "CONFIG+=protfuzz libfuzzer" which defines
+  PROTOCOL_FUZZER_LIBFUZZER. Then only the LLVMFuzzerTestOneInput() entry
+  point is compiled and libFuzzer provides the main function (the allocation
+  counter is not used in this case since the sanitizers replace the memory
+  allocation functions).
+*/
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QStringList>
+#include <QMap>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <new>
+#include <cstdlib>
+#include "testbench.h"
+
+
+/* Definitions ****************************************************************/
+// number of messages which are generated if no corpus is given
+#define FUZZ_NUM_GENERATED_MESSAGES     2000
+
+// default number of fuzzing iterations
+#define FUZZ_DEFAULT_NUM_ITERATIONS     100000
+
+// maximum number of bytes which are appended by a mutation
+#define FUZZ_MAX_NUM_APPENDED_BYTES     64
+
+// number of random buffers for the CRC comparison
+#define FUZZ_NUM_CRC_CHECK_BUFFERS      10000
+
+// size of the buffer for the CRC throughput benchmark
+#define FUZZ_CRC_BENCHMARK_BUF_SIZE     ( 64 * 1024 )
+
+
+/* Memory allocation counter **************************************************/
+#if !defined ( PROTOCOL_FUZZER_LIBFUZZER )
+// note that the harness is single threaded, therefore no atomic operation is
+// required for the counter
+static long lNumAllocations = 0;
+
+void* operator new ( std::size_t iSize )
+{
+    lNumAllocations++;
+
+    void* pMem = malloc ( iSize > 0 ? iSize : 1 );
+
+    if ( pMem == NULL )
+    {
+        throw std::bad_alloc();
+    }
+
+    return pMem;
+}
+
+void* operator new[] ( std::size_t iSize )
+{
+    return operator new ( iSize );
+}
+
+void operator delete ( void* pMem ) throw()
+{
+    free ( pMem );
+}
+
+void operator delete[] ( void* pMem ) throw()
+{
+    free ( pMem );
+}
+#endif
+
+
+/* Reference CRC **************************************************************/
+// the original bit-wise implementation of the protocol CRC (generator
+// polynomial x^16 + x^12 + x^5 + 1) as the reference for the table driven
+// implementation in CCRC
+static uint32_t CalcCRCBitwise ( const uint8_t* pbyData,
+                                 const int      iNumBytes )
+{
+    const uint32_t iPoly          = ( 1 << 5 ) | ( 1 << 12 );
+    const uint32_t iBitOutMask    = 1 << 16;
+    uint32_t       iStateShiftReg = 0xFFFF;
+
+    for ( int j = 0; j < iNumBytes; j++ )
+    {
+        for ( int i = 0; i < 8; i++ )
+        {
+            iStateShiftReg <<= 1;
+
+            if ( ( iStateShiftReg & iBitOutMask ) > 0 )
+            {
+                iStateShiftReg |= 1;
+            }
+
+            if ( ( pbyData[j] & ( 1 << ( 8 - i - 1 ) ) ) > 0 )
+            {
+                iStateShiftReg ^= 1;
+            }
+
+            if ( iStateShiftReg & 1 )
+            {
+                iStateShiftReg ^= iPoly;
+            }
+        }
+    }
+
+    return ( ~iStateShiftReg ) & 0xFFFF;
+}
+
+
+/* Classes ********************************************************************/
+class CProtocolFuzzer : public CTestbench
+{
+public:
+    CProtocolFuzzer() :
+        CTestbench ( "127.0.0.1", LLCON_DEFAULT_PORT_NUMBER, false ),
+        InetAddr ( QHostAddress ( QHostAddress::LocalHost ),
+                   LLCON_DEFAULT_PORT_NUMBER ),
+        vecbyMesBodyData ( 0 ),
+        vecbyContainedMesBody ( 0 ),
+        vecbyMutatedData ( 0 ) {}
+
+    void GenerateCorpus ( const int iNumMessages )
+    {
+        for ( int i = 0; i < iNumMessages; i++ )
+        {
+            // the generated message is stored by ProcessMessage()
+            GenRandomMessage();
+        }
+    }
+
+    bool LoadCorpus ( const QString& strPath )
+    {
+        const QFileInfo FileInfo ( strPath );
+
+        if ( FileInfo.isDir() )
+        {
+            const QFileInfoList FileList =
+                QDir ( strPath ).entryInfoList ( QDir::Files );
+
+            for ( int i = 0; i < FileList.size(); i++ )
+            {
+                if ( LoadCorpus ( FileList[i].filePath() ) )
+                {
+                    return true; // return error code
+                }
+            }
+
+            return false; // no error
+        }
+
+        QFile File ( strPath );
+
+        if ( !File.open ( QIODevice::ReadOnly ) )
+        {
+            return true; // return error code
+        }
+
+        const QByteArray vecbyFileData = File.readAll();
+
+        CVector<uint8_t> vecbyFrame ( vecbyFileData.size() );
+
+        for ( int i = 0; i < vecbyFileData.size(); i++ )
+        {
+            vecbyFrame[i] = static_cast<uint8_t> ( vecbyFileData[i] );
+        }
+
+        ProcessMessage ( vecbyFrame );
+
+        return false; // no error
+    }
+
+    int GetCorpusSize() const { return vecvecbyCorpus.Size(); }
+
+    // returns the ID of the message or PROTMESSID_ILLEGAL if the frame was
+    // not accepted by the parser
+    int ProcessFrame ( const CVector<uint8_t>& vecbyData,
+                       const int               iNumBytes )
+    {
+        int iRecCounter, iRecID;
+
+        if ( CProtocol::ParseMessageFrame ( vecbyData,
+                                            iNumBytes,
+                                            vecbyMesBodyData,
+                                            iRecCounter,
+                                            iRecID ) )
+        {
+            return PROTMESSID_ILLEGAL;
+        }
+
+        if ( CProtocol::IsConnectionLessMessageID ( iRecID ) )
+        {
+            Receiver.ParseConnectionLessMessageBody ( vecbyMesBodyData,
+                                                      iRecID,
+                                                      InetAddr );
+        }
+        else if ( iRecID == PROTMESSID_MESS_CONTAINER )
+        {
+            int iPos = 0;
+            int iContRecCounter, iContRecID;
+
+            while ( !CProtocol::GetContainedMessage ( vecbyMesBodyData,
+                                                      iPos,
+                                                      vecbyContainedMesBody,
+                                                      iContRecCounter,
+                                                      iContRecID ) )
+            {
+                ParseConnectedMessage ( vecbyContainedMesBody,
+                                        iContRecCounter,
+                                        iContRecID );
+            }
+        }
+        else
+        {
+            ParseConnectedMessage ( vecbyMesBodyData, iRecCounter, iRecID );
+        }
+
+        return iRecID;
+    }
+
+    void RunFuzzing ( const int iNumIterations )
+    {
+        QTextStream tsConsole ( stdout );
+
+        int iNumAccepted = 0;
+
+        for ( int i = 0; i < iNumIterations; i++ )
+        {
+            Mutate ( vecvecbyCorpus[GenRandomIntInRange ( 0,
+                vecvecbyCorpus.Size() - 1 )] );
+
+            if ( ProcessFrame ( vecbyMutatedData,
+                                vecbyMutatedData.Size() ) != PROTMESSID_ILLEGAL )
+            {
+                iNumAccepted++;
+            }
+        }
+
+        tsConsole << "fuzzing: " << iNumIterations << " mutated frames, " <<
+            iNumAccepted << " accepted by the frame parser" << endl;
+    }
+
+    // returns true if the table driven CRC differs from the bit-wise CRC
+    bool CheckCRC ( const int iNumBuffers )
+    {
+        QTextStream      tsConsole ( stdout );
+        CVector<uint8_t> vecbyData ( MAX_SIZE_BYTES_NETW_BUF );
+
+        for ( int i = 0; i < iNumBuffers; i++ )
+        {
+            const int iSize = GenRandomIntInRange ( 0, vecbyData.Size() );
+
+            for ( int j = 0; j < iSize; j++ )
+            {
+                vecbyData[j] = static_cast<uint8_t> ( GenRandomIntInRange ( 0, 255 ) );
+            }
+
+            CCRC CRCByte;
+            CCRC CRCTable;
+            CCRC CRCSplit;
+
+            for ( int j = 0; j < iSize; j++ )
+            {
+                CRCByte.AddByte ( vecbyData[j] );
+            }
+
+            CRCTable.AddBytes ( &vecbyData[0], iSize );
+
+            // the table driven CRC must also be correct if the buffer is
+            // added in two parts with an arbitrary (unaligned) split position
+            const int iSplit = GenRandomIntInRange ( 0, iSize );
+
+            CRCSplit.AddBytes ( &vecbyData[0], iSplit );
+            CRCSplit.AddBytes ( &vecbyData[0] + iSplit, iSize - iSplit );
+
+            const uint32_t iCRCRef = CalcCRCBitwise ( &vecbyData[0], iSize );
+
+            if ( ( CRCByte.GetCRC() != iCRCRef ) ||
+                 ( CRCTable.GetCRC() != iCRCRef ) ||
+                 ( CRCSplit.GetCRC() != iCRCRef ) )
+            {
+                tsConsole << "CRC mismatch for a buffer of " << iSize <<
+                    " bytes" << endl;
+
+                return true; // return error code
+            }
+        }
+
+        tsConsole << "CRC: " << iNumBuffers << " random buffers, table driven "
+            "and bit-wise calculation are identical" << endl;
+
+        return false; // no error
+    }
+
+    void RunCRCBenchmark ( const int iNumIterations )
+    {
+        QTextStream      tsConsole ( stdout );
+        CVector<uint8_t> vecbyData ( FUZZ_CRC_BENCHMARK_BUF_SIZE );
+        uint32_t         iCRCSum = 0;
+
+        for ( int i = 0; i < vecbyData.Size(); i++ )
+        {
+            vecbyData[i] = static_cast<uint8_t> ( GenRandomIntInRange ( 0, 255 ) );
+        }
+
+        // the number of passes is scaled so that the benchmark takes about
+        // as long as the message benchmark
+        const int    iNumPasses = max ( 1, iNumIterations / 100 );
+        const double dNumMBytes =
+            static_cast<double> ( iNumPasses ) * vecbyData.Size() / 1e6;
+
+        QElapsedTimer ElapsedTimer;
+        ElapsedTimer.start();
+
+        for ( int i = 0; i < iNumPasses; i++ )
+        {
+            iCRCSum += CalcCRCBitwise ( &vecbyData[0], vecbyData.Size() );
+        }
+
+        const qint64 iBitNs = max ( ElapsedTimer.nsecsElapsed(),
+                                    static_cast<qint64> ( 1 ) );
+
+        ElapsedTimer.restart();
+
+        for ( int i = 0; i < iNumPasses; i++ )
+        {
+            CCRC CRCObj;
+
+            for ( int j = 0; j < vecbyData.Size(); j++ )
+            {
+                CRCObj.AddByte ( vecbyData[j] );
+            }
+
+            iCRCSum -= CRCObj.GetCRC();
+        }
+
+        const qint64 iByteNs = max ( ElapsedTimer.nsecsElapsed(),
+                                     static_cast<qint64> ( 1 ) );
+
+        ElapsedTimer.restart();
+
+        for ( int i = 0; i < iNumPasses; i++ )
+        {
+            CCRC CRCObj;
+            CRCObj.AddBytes ( &vecbyData[0], vecbyData.Size() );
+
+            iCRCSum += CRCObj.GetCRC();
+        }
+
+        const qint64 iTableNs = max ( ElapsedTimer.nsecsElapsed(),
+                                      static_cast<qint64> ( 1 ) );
+
+        // the results are used so that the compiler cannot remove the loops,
+        // if all calculations are identical, the sum is the number of passes
+        // times the CRC
+        tsConsole << "CRC MB/s: bit-wise " <<
+            static_cast<qint64> ( 1e9 * dNumMBytes / iBitNs ) <<
+            ", table byte-wise " <<
+            static_cast<qint64> ( 1e9 * dNumMBytes / iByteNs ) <<
+            ", table (slice-by-4) " <<
+            static_cast<qint64> ( 1e9 * dNumMBytes / iTableNs ) <<
+            ( iCRCSum == static_cast<uint32_t> ( iNumPasses ) *
+              CalcCRCBitwise ( &vecbyData[0], vecbyData.Size() ) ?
+              "" : " (results differ)" ) << endl;
+    }
+
+    void RunBenchmark ( const int iNumIterations )
+    {
+        QTextStream tsConsole ( stdout );
+
+        // sort the corpus by message IDs
+        QMap<int, CVector<int> > mapCorpusIdx;
+
+        for ( int i = 0; i < vecvecbyCorpus.Size(); i++ )
+        {
+            const int iID = ProcessFrame ( vecvecbyCorpus[i],
+                                           vecvecbyCorpus[i].Size() );
+
+            mapCorpusIdx[iID].Add ( i );
+        }
+
+        tsConsole << "ID\tmessages/s\tallocations/message" << endl;
+
+        QMapIterator<int, CVector<int> > MapIter ( mapCorpusIdx );
+
+        while ( MapIter.hasNext() )
+        {
+            MapIter.next();
+
+            const CVector<int>& veciIdx  = MapIter.value();
+            const long          lNumMess =
+                static_cast<long> ( iNumIterations ) * veciIdx.Size();
+
+            QElapsedTimer ElapsedTimer;
+
+#if !defined ( PROTOCOL_FUZZER_LIBFUZZER )
+            const long lNumAllocStart = lNumAllocations;
+#endif
+            ElapsedTimer.start();
+
+            for ( int i = 0; i < iNumIterations; i++ )
+            {
+                for ( int j = 0; j < veciIdx.Size(); j++ )
+                {
+                    const CVector<uint8_t>& vecbyFrame =
+                        vecvecbyCorpus[veciIdx[j]];
+
+                    ProcessFrame ( vecbyFrame, vecbyFrame.Size() );
+                }
+            }
+
+            const qint64 iElapsedNs = max ( ElapsedTimer.nsecsElapsed(),
+                                            static_cast<qint64> ( 1 ) );
+
+            tsConsole << MapIter.key() << "\t" <<
+                static_cast<qint64> ( 1e9 * lNumMess / iElapsedNs ) << "\t";
+
+#if !defined ( PROTOCOL_FUZZER_LIBFUZZER )
+            tsConsole << static_cast<double> ( lNumAllocations - lNumAllocStart ) /
+                lNumMess << endl;
+#else
+            tsConsole << "-" << endl;
+#endif
+        }
+    }
+
+protected:
+    virtual void ProcessMessage ( const CVector<uint8_t>& vecMessage )
+    {
+        // store the generated message in the corpus
+        vecvecbyCorpus.Enlarge ( 1 );
+        vecvecbyCorpus.back().Init ( vecMessage.Size() );
+        vecvecbyCorpus.back() = vecMessage;
+    }
+
+    void ParseConnectedMessage ( const CVector<uint8_t>& vecbyBody,
+                                 const int               iRecCounter,
+                                 const int               iRecID )
+    {
+        // the receive state is reset so that each message is evaluated as if
+        // it was the first message (otherwise most of the messages would only
+        // be stored as out of order messages)
+        Receiver.Reset();
+        Receiver.ParseMessageBody ( vecbyBody, iRecCounter, iRecID );
+    }
+
+    void Mutate ( const CVector<uint8_t>& vecbyFrame )
+    {
+        vecbyMutatedData.Init ( vecbyFrame.Size() );
+        vecbyMutatedData = vecbyFrame;
+
+        int iSize = vecbyMutatedData.Size();
+
+        switch ( GenRandomIntInRange ( 0, 4 ) )
+        {
+        case 0:
+            // flip some random bits
+            for ( int i = GenRandomIntInRange ( 1, 4 ); i > 0 && iSize > 0; i-- )
+            {
+                vecbyMutatedData[GenRandomIntInRange ( 0, iSize - 1 )] ^=
+                    static_cast<uint8_t> ( 1 << GenRandomIntInRange ( 0, 7 ) );
+            }
+            break;
+
+        case 1:
+            // set some random bytes to random values
+            for ( int i = GenRandomIntInRange ( 1, 4 ); i > 0 && iSize > 0; i-- )
+            {
+                vecbyMutatedData[GenRandomIntInRange ( 0, iSize - 1 )] =
+                    static_cast<uint8_t> ( GenRandomIntInRange ( 0, 255 ) );
+            }
+            break;
+
+        case 2:
+            // truncate the frame
+            iSize = GenRandomIntInRange ( 0, iSize );
+            vecbyMutatedData.resize ( iSize );
+            break;
+
+        case 3:
+            // append random bytes
+            for ( int i = GenRandomIntInRange ( 1, FUZZ_MAX_NUM_APPENDED_BYTES ); i > 0; i-- )
+            {
+                vecbyMutatedData.Add ( static_cast<uint8_t> (
+                    GenRandomIntInRange ( 0, 255 ) ) );
+            }
+
+            iSize = vecbyMutatedData.Size();
+            break;
+
+        case 4:
+            // replace the message ID (2 bytes after the TAG)
+            if ( iSize >= 4 )
+            {
+                vecbyMutatedData[2] = static_cast<uint8_t> ( GenRandomIntInRange ( 0, 255 ) );
+                vecbyMutatedData[3] = static_cast<uint8_t> ( GenRandomIntInRange ( 0, 7 ) );
+            }
+            break;
+        }
+
+        // in most of the cases, correct the length field and the CRC so that
+        // the mutated frame passes the frame check and the message body
+        // parser is reached
+        if ( ( iSize >= MESS_LEN_WITHOUT_DATA_BYTE ) &&
+             ( GenRandomIntInRange ( 0, 3 ) > 0 ) )
+        {
+            const int iDataLen = iSize - MESS_LEN_WITHOUT_DATA_BYTE;
+
+            vecbyMutatedData[5] = static_cast<uint8_t> ( iDataLen & 255 );
+            vecbyMutatedData[6] = static_cast<uint8_t> ( ( iDataLen >> 8 ) & 255 );
+
+            CCRC CRCObj;
+            CRCObj.AddBytes ( &vecbyMutatedData[0], iSize - 2 );
+
+            const uint32_t iCRC = CRCObj.GetCRC();
+
+            vecbyMutatedData[iSize - 2] = static_cast<uint8_t> ( iCRC & 255 );
+            vecbyMutatedData[iSize - 1] = static_cast<uint8_t> ( ( iCRC >> 8 ) & 255 );
+        }
+    }
+
+    CProtocol                  Receiver;
+    CHostAddress               InetAddr;
+    CVector<CVector<uint8_t> > vecvecbyCorpus;
+    CVector<uint8_t>           vecbyMesBodyData;
+    CVector<uint8_t>           vecbyContainedMesBody;
+    CVector<uint8_t>           vecbyMutatedData;
+};
+
+
+/* Implementation *************************************************************/
+#if defined ( PROTOCOL_FUZZER_LIBFUZZER )
+static CProtocolFuzzer* pFuzzer = NULL;
+
+extern "C" int LLVMFuzzerInitialize ( int* argc, char*** argv )
+{
+    // the protocol uses timers which require an application object
+    new QCoreApplication ( *argc, *argv );
+
+    pFuzzer = new CProtocolFuzzer();
+
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput ( const uint8_t* pData, size_t iSize )
+{
+    CVector<uint8_t> vecbyFrame ( static_cast<int> ( iSize ) );
+
+    for ( size_t i = 0; i < iSize; i++ )
+    {
+        vecbyFrame[static_cast<int> ( i )] = pData[i];
+    }
+
+    pFuzzer->ProcessFrame ( vecbyFrame, vecbyFrame.Size() );
+
+    return 0;
+}
+#else
+int main ( int argc, char** argv )
+{
+    QCoreApplication app ( argc, argv );
+    QTextStream      tsConsole ( stdout );
+    CProtocolFuzzer  Fuzzer;
+    int              iNumIterations = FUZZ_DEFAULT_NUM_ITERATIONS;
+    bool             bBenchmark     = false;
+
+    // the random mutations shall be reproducible
+    srand ( 0 );
+
+    const QStringList strArgs = app.arguments();
+
+    for ( int i = 1; i < strArgs.size(); i++ )
+    {
+        if ( ( strArgs[i] == "-i" ) && ( i + 1 < strArgs.size() ) )
+        {
+            iNumIterations = max ( 1, strArgs[++i].toInt() );
+        }
+        else if ( strArgs[i] == "-b" )
+        {
+            bBenchmark = true;
+        }
+        else if ( Fuzzer.LoadCorpus ( strArgs[i] ) )
+        {
+            tsConsole << "cannot read corpus: " << strArgs[i] << endl;
+            return 1;
+        }
+    }
+
+    // if no corpus is given, we use the message generator of the test bench
+    if ( Fuzzer.GetCorpusSize() == 0 )
+    {
+        Fuzzer.GenerateCorpus ( FUZZ_NUM_GENERATED_MESSAGES );
+    }
+
+    tsConsole << "corpus: " << Fuzzer.GetCorpusSize() << " frames" << endl;
+
+    // the protocol relies on the table driven CRC being identical to the
+    // byte-wise calculation
+    if ( Fuzzer.CheckCRC ( FUZZ_NUM_CRC_CHECK_BUFFERS ) )
+    {
+        return 1;
+    }
+
+    if ( bBenchmark )
+    {
+        Fuzzer.RunBenchmark ( iNumIterations );
+        Fuzzer.RunCRCBenchmark ( iNumIterations );
+    }
+    else
+    {
+        Fuzzer.RunFuzzing ( iNumIterations );
+    }
+
+    return 0;
+}
+#endif
@@ -38,12 +38,22 @@ MESSAGES (with connection)
 
 - PROTMESSID_ACKN: Acknowledgement message
 
-    +-----------------------------------+
-    | 2 bytes ID of message to be ackn. |
-    +-----------------------------------+
+    +-----------------------------------+--------------------------------+
+    | 2 bytes ID of message to be ackn. | 4 bytes selective ackn. field  |
+    +-----------------------------------+--------------------------------+
+
+    - selective acknowledgement field: bit i (i = 0, ..., 31) is set if the
+      message with the counter value cnt - 1 - i (modulo 256) was received
 
     note: the cnt value is the same as of the message to be acknowledged
 
+    note: the selective acknowledgement field is optional, old versions only
+          send the ID. As long as the peer does not send the selective
+          acknowledgement field, only one message is transmitted at a time and
+          the next message is sent after the acknowledgement is received. If
+          the peer sends the field, up to PROT_SEND_WINDOW_SIZE messages may be
+          in flight and the receiver delivers them in the order of the counter.
+
 
 - PROTMESSID_JITT_BUF_SIZE: Jitter buffer size
 
@@ -142,9 +152,12 @@ MESSAGES (with connection)
         ... ------------------+-----------------------+ ...
         ...  4 bytes sam rate | 2 bytes audiocod type | ...
         ... ------------------+-----------------------+ ...
-        ... -----------------+----------------------+
-        ...  2 bytes version | 4 bytes audiocod arg | 
-        ... -----------------+----------------------+
+        ... -----------------+----------------------+ ...
+        ...  2 bytes version | 4 bytes audiocod arg | ...
+        ... -----------------+----------------------+ ...
+        ... ------------------------------------+
+        ...  1 byte redundancy (optional field) |
+        ... ------------------------------------+
 
     - "base netw size":  length of the base network packet (frame) in bytes
     - "block size fact": block size factor
@@ -155,10 +168,33 @@ MESSAGES (with connection)
                           - 0: none, no audio coding applied
                           - 1: CELT
                           - 2: OPUS
+                          - 3: PCM, uncompressed 16 bit samples (little
+                               endian, interleaved for stereo), the "base netw
+                               size" must be 2 * frame size * "num chan" bytes,
+                               may only be used if the receiver supports the
+                               feature PROT_FEATURE_AUDIO_PCM
     - "version":         version of the audio coder, if not used this value
                          shall be set to 0
     - "audiocod arg":    argument for the audio coder, if not used this value
-                         shall be set to 0
+                         shall be set to 0; for OPUS and PCM the value 64
+                         selects the small frame size of 64 samples (may only
+                         be used if the receiver supports the feature
+                         PROT_FEATURE_SMALL_FRAME_SIZE), all other values
+                         select the default frame size of 128 samples
+    - "redundancy":      number of previous audio packets which are repeated in
+                         each audio packet (see below), this field is only
+                         present if the redundancy is not zero and may only be
+                         used if the receiver supports the feature
+                         PROT_FEATURE_AUDIO_REDUNDANCY
+
+    Audio packets with redundancy: each audio packet contains the current coded
+    audio data followed by the coded audio data of the previous audio packets
+    (newest first) and a 1 byte packet counter which is incremented for each
+    audio packet and wraps around at 255:
+
+    +--------------+----------------------+-----+-------------------+
+    | current data | data previous packet | ... | 1 byte packet cnt |
+    +--------------+----------------------+-----+-------------------+
 
 
 - PROTMESSID_REQ_NETW_TRANSPORT_PROPS: Request properties for network transport
@@ -172,6 +208,68 @@ MESSAGES (with connection)
     note: does not have any data -> n = 0
 
 
+- PROTMESSID_SUPPORTED_FEATURES: Features supported by the sender
+
+    +----------------------+
+    | 4 bytes feature bits |
+    +----------------------+
+
+    - "feature bits": combination of the PROT_FEATURE_x flags, unknown flags
+                      shall be ignored by the receiver
+
+
+- PROTMESSID_RECEIVER_REPORT: Audio receive statistics (only sent if the
+                              receiver supports PROT_FEATURE_RECEIVER_REPORT)
+
+    +----------------------+---------------------------+
+    | 2 bytes number fra.  | 2 bytes number lost fra.  |
+    +----------------------+---------------------------+
+
+    - "number fra.":      number of audio frames which were read from the
+                          jitter buffer since the last report
+    - "number lost fra.": number of these frames which were not available
+                          (lost or late audio packets)
+
+
+- PROTMESSID_MESS_CONTAINER: Container for multiple messages (only sent if the
+                             receiver supports PROT_FEATURE_MESS_CONTAINER)
+
+    for each contained message append following data:
+
+    +-------------+------------+------------------+-----------------+
+    | 2 bytes ID  | 1 byte cnt | 2 bytes length n | n bytes data    |
+    +-------------+------------+------------------+-----------------+
+
+    - the contained messages are the complete messages without the TAG and
+      without the CRC (the CRC of the container covers all messages)
+    - the cnt value of the container itself is always zero, the container is
+      not acknowledged (the contained messages are acknowledged as usual)
+    - the messages are collected during one event loop iteration and are sent
+      in one datagram of at most PROT_CONTAINER_MAX_SIZE_BYTES bytes
+
+
+- PROTMESSID_CONN_CLIENTS_LIST_DELTA: Changes of the connected clients list
+                                      (only sent if the receiver supports
+                                      PROT_FEATURE_CLIENT_LIST_DELTA)
+
+    +----------------------+-----------------+-------------------------+ ...
+    | 4 bytes base version | 4 bytes version | 1 byte num removed IDs  | ...
+    +----------------------+-----------------+-------------------------+ ...
+        ... ---------------------------------+-------------------------+
+        ...  n bytes removed channel IDs     | changed/added clients   |
+        ... ---------------------------------+-------------------------+
+
+    - "base version":    version of the list the changes apply to, zero means
+                         that the message contains the complete list
+    - "version":         version of the list after applying the changes
+    - "changed/added clients": for each changed or added client the same data
+                         as in PROTMESSID_CONN_CLIENTS_LIST
+
+    note: if the base version does not match the version of the list of the
+          receiver, it requests the complete list with
+          PROTMESSID_REQ_CONN_CLIENTS_LIST
+
+
 CONNECTION LESS MESSAGES
 ------------------------
 
@@ -248,7 +346,31 @@ CONNECTION LESS MESSAGES
 
 - PROTMESSID_CLM_REQ_SERVER_LIST: Request server list
 
-    note: does not have any data -> n = 0
+    +-------------------------------+
+    | 1 byte fragments supported    |
+    +-------------------------------+
+
+    - the byte is optional (old clients send the message without any data),
+      if it is present and not zero, the server list is sent with the
+      PROTMESSID_CLM_SERVER_LIST_FRAGMENT message, otherwise the server list
+      is sent with the PROTMESSID_CLM_SERVER_LIST message
+
+
+- PROTMESSID_CLM_SERVER_LIST_FRAGMENT: Fragment of the server list
+
+    +----------------------+------------------------+ ...
+    | 2 bytes list version | 2 bytes fragment index | ...
+    +----------------------+------------------------+ ...
+        ... ----------------------------+----------------------------------+
+        ...  2 bytes number of fragments | PROTMESSID_CLM_SERVER_LIST entries |
+        ... ----------------------------+----------------------------------+
+
+    - the server list is split in fragments so that each message fits in one
+      datagram without IP fragmentation, each fragment contains complete
+      server list entries in the format of the PROTMESSID_CLM_SERVER_LIST
+      message
+    - the list version is changed by the central server on each change of the
+      server list, the receiver only combines fragments of the same version
 
 
 - PROTMESSID_CLM_SEND_EMPTY_MESSAGE: Send "empty message" message
@@ -274,6 +396,92 @@ CONNECTION LESS MESSAGES
 
     note: does not have any data -> n = 0
 
+
+- PROTMESSID_CLM_CONN_CHALLENGE: Connection challenge
+
+    +----------------+
+    | 4 bytes cookie |
+    +----------------+
+
+    - the server sends this message to an unknown sender of audio packets,
+      a channel is only allocated after the cookie was echoed with the
+      PROTMESSID_CLM_CONN_CHALLENGE_RESP message (old clients which do not
+      answer are admitted after they sent audio packets for a while)
+    - the cookie is only valid for a limited time and for the address of the
+      receiver of the challenge
+
+
+- PROTMESSID_CLM_CONN_CHALLENGE_RESP: Response to the connection challenge
+
+    +---------------------------------+
+    | 4 bytes cookie of the challenge |
+    +---------------------------------+
+
+
+- PROTMESSID_CLM_SERVER_LOAD: Load of a registered server
+
+    +-------------------+------------------------+ ...
+    | 1 byte number of  | 1 byte tick headroom   | ...
+    | connected clients | in percent             | ...
+    +-------------------+------------------------+ ...
+        ... -----------------+----------------------+
+        ...  2 bytes number n | n bytes UTF-8 string |
+        ...  of group name    | group name           |
+        ... -----------------+----------------------+
+
+    - sent by a registered server together with the registration and the
+      regular ping of the central server
+    - the tick headroom is the part of the server timer tick which is not used
+      for processing the audio data
+    - servers with the same group name can host the same sessions, an empty
+      group name means that the server is not part of a group
+
+
+- PROTMESSID_CLM_REQ_GROUP_SERVER: Request the server of a group
+
+    +------------------+----------------------+------------------------+
+    | 2 bytes number n | n bytes UTF-8 string | 1 byte number of       |
+    | of group name    | group name           | clients which shall    |
+    |                  |                      | join                   |
+    +------------------+----------------------+------------------------+
+
+    - the central server answers with a PROTMESSID_CLM_GROUP_SERVER message
+
+
+- PROTMESSID_CLM_GROUP_SERVER: Least loaded server of a group
+
+    +--------------------+--------------+
+    | 4 bytes IP address | 2 bytes port |
+    +--------------------+--------------+
+
+    - the IP address and port are zero if no server of the group can host the
+      requested number of clients
+
+
+- PROTMESSID_CLM_REQ_LISTEN: Request to receive the room mix as a listener
+
+    +----------------+------------------------+--------------------+ ...
+    | 4 bytes cookie | 2 bytes audio coding   | 1 byte number of   | ...
+    |                | type                   | audio channels     | ...
+    +----------------+------------------------+--------------------+ ...
+        ... ------------------------+-------------------------+
+        ...  2 bytes network frame  | 2 bytes audio frame     |
+        ...  size (coded bytes)     | size in samples         |
+        ... ------------------------+-------------------------+
+
+    - a listener does not send audio and does not occupy a channel, it gets
+      the mix of all clients of the server (the same mix for all listeners)
+    - each audio packet to the listener contains one coded audio frame
+    - the server answers a request with an invalid cookie with a
+      PROTMESSID_CLM_CONN_CHALLENGE message, the next request must contain
+      the cookie of the challenge
+    - the request must be repeated regularly, otherwise the listener is
+      removed after a time-out (a PROTMESSID_CLM_DISCONNECTION message removes
+      the listener immediately)
+    - note that the client of this software does not send this request yet,
+      a listener must be implemented by a separate tool (the test bench sends
+      the request for testing)
+
  ******************************************************************************
  *
  * This program is free software; you can redistribute it and/or modify it under
@@ -298,6 +506,49 @@ CONNECTION LESS MESSAGES
 /* Implementation *************************************************************/
 CProtocol::CProtocol()
 {
+    // allocate memory for the receive state
+    veciRecID.Init ( PROT_NUM_COUNTER_VALUES );
+    veciRecTimeMs.Init ( PROT_NUM_COUNTER_VALUES );
+    vecvecbyRecMesBody.Init ( PROT_NUM_COUNTER_VALUES );
+
+    // preallocate the send message ring buffer, the message frames are
+    // generated directly in the slots of the ring buffer
+    vecSendMessRing.Init ( PROT_SEND_RING_INIT_SIZE );
+
+    for ( int i = 0; i < PROT_SEND_RING_INIT_SIZE; i++ )
+    {
+        vecSendMessRing[i].vecMessage.reserve ( PROT_FRAME_BUF_INIT_SIZE_BYTES );
+    }
+
+    // preallocate the buffers which are used for sending the messages
+    vecvecbySendBuf.Init ( PROT_SEND_WINDOW_SIZE );
+
+    for ( int i = 0; i < PROT_SEND_WINDOW_SIZE; i++ )
+    {
+        vecvecbySendBuf[i].reserve ( PROT_FRAME_BUF_INIT_SIZE_BYTES );
+    }
+
+    vecbyAcknData.Init ( 6 ); // 6 bytes of data
+    vecbyAcknMessage.Init ( MESS_LEN_WITHOUT_DATA_BYTE + 6 );
+    vecbyCLMessage.reserve ( PROT_FRAME_BUF_INIT_SIZE_BYTES );
+
+    // the time base for the retransmission time outs
+    SendTime.start();
+
+    // the timer is restarted with the time to the next message time out
+    TimerSendMess.setSingleShot ( true );
+
+    // preallocate the message container
+    vecbyContainerData.Init ( PROT_CONTAINER_MAX_SIZE_BYTES - MESS_LEN_WITHOUT_DATA_BYTE );
+    vecbyContainerFirstMes.reserve ( PROT_FRAME_BUF_INIT_SIZE_BYTES );
+    vecbyContainerFrame.reserve ( PROT_CONTAINER_MAX_SIZE_BYTES );
+    vecbyContainerFrameData.reserve ( PROT_CONTAINER_MAX_SIZE_BYTES );
+    bContainerFlushPending = false;
+
+    // no server list fragments are collected yet
+    iServerListFragVersion     = PROT_INVALID_VALUE;
+    iServerListFragNumReceived = 0;
+
     Reset();
 
 
@@ -311,129 +562,408 @@ void CProtocol::Reset()
     QMutexLocker locker ( &Mutex );
 
     // prepare internal variables for initial protocol transfer
-    iCounter   = 0;
-    iOldRecID  = PROTMESSID_ILLEGAL;
-    iOldRecCnt = 0;
+    iCounter = 0;
+    ResetRecState();
 
     // delete complete "send message queue"
-    SendMessQueue.clear();
+    iSendRingStart   = 0;
+    iSendRingNumUsed = 0;
+
+    // until the peer has shown that it supports the selective acknowledgement,
+    // we send only one message at a time
+    bPeerSupportsSelAckn = false;
+
+    // the round trip time is not yet known
+    iSmoothedRttMs    = PROT_INVALID_VALUE;
+    iRttVarianceMs    = 0;
+    iRetransTimeOutMs = SEND_MESS_TIMEOUT_MS;
+
+    // the message container must be negotiated again and all collected
+    // messages are deleted
+    bMessContainerEnabled = false;
+    iContainerNumMess     = 0;
+    iContainerNumBytes    = 0;
+}
+
+void CProtocol::ResetRecState()
+{
+    iNextRecCnt        = PROT_INVALID_VALUE; // next expected counter is not yet known
+    iRecGapStartTimeMs = PROT_INVALID_VALUE;
+    veciRecID.Reset ( PROTMESSID_ILLEGAL );
+}
+
+void CProtocol::SetMessContainerEnabled ( const bool bEnable )
+{
+    QMutexLocker locker ( &Mutex );
+
+    bMessContainerEnabled = bEnable;
 }
 
-void CProtocol::EnqueueMessage ( CVector<uint8_t>& vecMessage,
-                                 const int         iCnt,
-                                 const int         iID )
+void CProtocol::PutMessageForSending ( const CVector<uint8_t>& vecMessage )
 {
-    bool bListWasEmpty;
+    // note that this function must be called with a locked send mutex since
+    // the container frame buffer is used
+    bool bSendFullContainer = false;
+    bool bSendDirectly      = true;
+    bool bRequestFlush      = false;
 
     Mutex.lock();
     {
-        // check if list is empty so that we have to initiate a send process
-        bListWasEmpty = SendMessQueue.empty();
+        if ( bMessContainerEnabled )
+        {
+            // the message is stored without TAG and CRC
+            const int iContMesLen = vecMessage.Size() - 4;
+
+            // if the new message does not fit in the container anymore, the
+            // collected messages are sent right now
+            if ( iContainerNumBytes + iContMesLen > vecbyContainerData.Size() )
+            {
+                bSendFullContainer = TakeContainerMessage ( vecbyContainerFrame );
+            }
 
-        // create send message object for the queue
-        CSendMessage SendMessageObj ( vecMessage, iCnt, iID );
+            // messages which are too large for a container are sent directly
+            if ( iContMesLen <= vecbyContainerData.Size() )
+            {
+                if ( iContainerNumMess == 0 )
+                {
+                    // if only one message is collected, it is sent as it is
+                    vecbyContainerFirstMes.Init ( vecMessage.Size() );
+                    vecbyContainerFirstMes = vecMessage;
+                }
 
-        // we want to have a FIFO: we add at the end and take from the beginning
-        SendMessQueue.push_back ( SendMessageObj );
+                // copy message without the 2 bytes TAG and the 2 bytes CRC
+                for ( int i = 0; i < iContMesLen; i++ )
+                {
+                    vecbyContainerData[iContainerNumBytes + i] = vecMessage[i + 2];
+                }
+
+                iContainerNumBytes += iContMesLen;
+                iContainerNumMess++;
+
+                bSendDirectly = false;
+
+                // the collected messages are sent when the event loop
+                // processes the next events
+                if ( !bContainerFlushPending )
+                {
+                    bContainerFlushPending = true;
+                    bRequestFlush          = true;
+                }
+            }
+        }
     }
     Mutex.unlock();
 
-    // if list was empty, initiate send process
-    if ( bListWasEmpty )
+    if ( bSendFullContainer )
+    {
+        emit MessReadyForSending ( vecbyContainerFrame );
+    }
+
+    if ( bSendDirectly )
+    {
+        emit MessReadyForSending ( vecMessage );
+    }
+
+    if ( bRequestFlush )
     {
-        SendMessage();
+        // a queued invocation works from any thread and is executed after
+        // all currently pending events are processed
+        QMetaObject::invokeMethod ( this, "OnFlushMessContainer",
+            Qt::QueuedConnection );
     }
 }
 
-void CProtocol::SendMessage()
+bool CProtocol::TakeContainerMessage ( CVector<uint8_t>& vecMessage )
+{
+    // note that this function must be called with a locked mutex, the
+    // return value indicates if a message was written in the output vector
+    bool bMessageTaken = false;
+
+    if ( iContainerNumMess == 1 )
+    {
+        // the initialization reuses the memory of the vector if possible
+        vecMessage.Init ( vecbyContainerFirstMes.Size() );
+        vecMessage    = vecbyContainerFirstMes;
+        bMessageTaken = true;
+    }
+    else if ( iContainerNumMess > 1 )
+    {
+        vecbyContainerFrameData.Init ( iContainerNumBytes );
+
+        for ( int i = 0; i < iContainerNumBytes; i++ )
+        {
+            vecbyContainerFrameData[i] = vecbyContainerData[i];
+        }
+
+        // the container is not acknowledged, therefore the counter is not used
+        GenMessageFrame ( vecMessage, 0, PROTMESSID_MESS_CONTAINER,
+            vecbyContainerFrameData );
+
+        bMessageTaken = true;
+    }
+
+    iContainerNumMess  = 0;
+    iContainerNumBytes = 0;
+
+    return bMessageTaken;
+}
+
+void CProtocol::OnFlushMessContainer()
+{
+    QMutexLocker locker ( &MutexSend );
+
+    bool bSendContainer;
+
+    Mutex.lock();
+    {
+        bContainerFlushPending = false;
+
+        bSendContainer = TakeContainerMessage ( vecbyContainerFrame );
+    }
+    Mutex.unlock();
+
+    if ( bSendContainer )
+    {
+        emit MessReadyForSending ( vecbyContainerFrame );
+    }
+}
+
+int CProtocol::GetTimeMs()
 {
-    CVector<uint8_t> vecMessage;
-    bool             bSendMess = false;
+    // note that the QTime wraps around after 24 hours (this case is handled
+    // by treating the message as timed out which only results in one
+    // additional retransmission)
+    return SendTime.elapsed();
+}
 
+void CProtocol::EnqueueMessage ( const int               iID,
+                                 const CVector<uint8_t>& vecData )
+{
     Mutex.lock();
     {
-        // we have to check that list is not empty, since in another thread the
-        // last element of the list might have been erased
-        if ( !SendMessQueue.empty() )
+        const int iRingSize = vecSendMessRing.Size();
+
+        // if the ring buffer is full, enlarge it (this should only happen
+        // very rarely since the initial size is large enough for the usual
+        // number of queued messages)
+        if ( iSendRingNumUsed == iRingSize )
         {
-            vecMessage.Init ( SendMessQueue.front().vecMessage.Size() );
-            vecMessage = SendMessQueue.front().vecMessage;
+            CVector<CSendMessage> vecNewRing ( 2 * iRingSize );
+
+            // the message buffers are swapped and not copied
+            for ( int i = 0; i < iSendRingNumUsed; i++ )
+            {
+                vecNewRing[i].MoveFrom (
+                    vecSendMessRing[( iSendRingStart + i ) % iRingSize] );
+            }
 
-            bSendMess = true;
+            vecSendMessRing.swap ( vecNewRing );
+            iSendRingStart = 0;
         }
+
+        // we want to have a FIFO: we add at the end and take from the beginning
+        CSendMessage& NewMess = vecSendMessRing[( iSendRingStart +
+            iSendRingNumUsed ) % vecSendMessRing.Size()];
+
+        // build complete message directly in the slot of the ring buffer
+        GenMessageFrame ( NewMess.vecMessage, iCounter, iID, vecData );
+        NewMess.Init ( iCounter, iID );
+
+        // increase counter (wraps around automatically)
+        iCounter++;
+
+        iSendRingNumUsed++;
     }
     Mutex.unlock();
 
-    if ( bSendMess )
+    // send the new message if it is in the send window
+    SendMessage();
+}
+
+void CProtocol::SendMessage()
+{
+    // the send buffers are reused, therefore only one thread at a time may
+    // send messages
+    QMutexLocker locker ( &MutexSend );
+
+    int iNumSendMess   = 0;
+    int iNextTimeOutMs = PROT_INVALID_VALUE;
+
+    Mutex.lock();
     {
-        // send message
-        emit MessReadyForSending ( vecMessage );
+        const int iRingSize = vecSendMessRing.Size();
+        const int iCurTime  = GetTimeMs();
 
-        // start time-out timer if not active
-        if ( !TimerSendMess.isActive() )
+        // as long as the peer does not support the selective acknowledgement,
+        // only the first message in the queue is transmitted
+        int iNumMessInWindow = 1;
+
+        if ( bPeerSupportsSelAckn )
+        {
+            iNumMessInWindow = PROT_SEND_WINDOW_SIZE;
+        }
+
+        iNumMessInWindow = min ( iNumMessInWindow, iSendRingNumUsed );
+
+        for ( int i = 0; i < iNumMessInWindow; i++ )
         {
-            TimerSendMess.start ( SEND_MESS_TIMEOUT_MS );
+            CSendMessage& CurMess =
+                vecSendMessRing[( iSendRingStart + i ) % iRingSize];
+
+            if ( CurMess.bAckn )
+            {
+                // this message was already acknowledged
+                continue;
+            }
+
+            bool bSendMess = false;
+
+            if ( !CurMess.bSent )
+            {
+                // first transmission of this message
+                bSendMess = true;
+
+                CurMess.bSent       = true;
+                CurMess.iSendTimeMs = iCurTime;
+                CurMess.iTimeOutMs  = iRetransTimeOutMs;
+            }
+            else
+            {
+                const int iElapsedMs = iCurTime - CurMess.iSendTimeMs;
+
+                if ( ( iElapsedMs >= CurMess.iTimeOutMs ) || ( iElapsedMs < 0 ) )
+                {
+                    // the message was not acknowledged in time, resend it
+                    // with doubled time out (exponential back off)
+                    bSendMess = true;
+
+                    CurMess.bRetransmitted = true;
+                    CurMess.iSendTimeMs    = iCurTime;
+                    CurMess.iTimeOutMs     = min ( 2 * CurMess.iTimeOutMs,
+                                                   SEND_MESS_MAX_TIMEOUT_MS );
+                }
+            }
+
+            if ( bSendMess )
+            {
+                // copy the message since it is sent after the mutex is
+                // unlocked (the initialization reuses the memory of the
+                // send buffer)
+                CVector<uint8_t>& vecSendBuf = vecvecbySendBuf[iNumSendMess];
+
+                vecSendBuf.Init ( CurMess.vecMessage.Size() );
+                vecSendBuf = CurMess.vecMessage;
+
+                iNumSendMess++;
+            }
+
+            // find the next time out of all messages in flight
+            const int iRemainingMs =
+                CurMess.iSendTimeMs + CurMess.iTimeOutMs - iCurTime;
+
+            if ( ( iNextTimeOutMs == PROT_INVALID_VALUE ) ||
+                 ( iRemainingMs < iNextTimeOutMs ) )
+            {
+                iNextTimeOutMs = iRemainingMs;
+            }
         }
     }
+    Mutex.unlock();
+
+    // send messages
+    for ( int i = 0; i < iNumSendMess; i++ )
+    {
+        PutMessageForSending ( vecvecbySendBuf[i] );
+    }
+
+    if ( iNextTimeOutMs != PROT_INVALID_VALUE )
+    {
+        // restart the time-out timer with the time to the next time out
+        TimerSendMess.start ( max ( 1, iNextTimeOutMs ) );
+    }
     else
     {
-        // no message to send, stop timer
+        // no message in flight, stop timer
         TimerSendMess.stop();
     }
 }
 
-void CProtocol::CreateAndSendMessage ( const int               iID,
-                                       const CVector<uint8_t>& vecData )
+void CProtocol::UpdateRetransTimeOut ( const int iRoundTripTimeMs )
 {
-    CVector<uint8_t> vecNewMessage;
-    int              iCurCounter;
-
-    Mutex.lock();
+    // estimation of the retransmission time out based on the smoothed round
+    // trip time and its variance (see RFC 6298), note that this function
+    // must be called with a locked mutex
+    if ( iSmoothedRttMs == PROT_INVALID_VALUE )
+    {
+        // first measurement
+        iSmoothedRttMs = iRoundTripTimeMs;
+        iRttVarianceMs = iRoundTripTimeMs / 2;
+    }
+    else
     {
-        // store current counter value
-        iCurCounter = iCounter;
+        iRttVarianceMs = ( 3 * iRttVarianceMs +
+            abs ( iSmoothedRttMs - iRoundTripTimeMs ) ) / 4;
 
-        // increase counter (wraps around automatically)
-        iCounter++;
+        iSmoothedRttMs = ( 7 * iSmoothedRttMs + iRoundTripTimeMs ) / 8;
     }
-    Mutex.unlock();
 
-    // build complete message
-    GenMessageFrame ( vecNewMessage, iCurCounter, iID, vecData );
+    iRetransTimeOutMs = min ( max ( iSmoothedRttMs + 4 * iRttVarianceMs,
+                                    SEND_MESS_MIN_TIMEOUT_MS ),
+                              SEND_MESS_MAX_TIMEOUT_MS );
+}
 
-    // enqueue message
-    EnqueueMessage ( vecNewMessage, iCurCounter, iID );
+void CProtocol::CreateAndSendMessage ( const int               iID,
+                                       const CVector<uint8_t>& vecData )
+{
+    // build complete message and enqueue it
+    EnqueueMessage ( iID, vecData );
 }
 
 void CProtocol::CreateAndImmSendAcknMess ( const int& iID,
                                            const int& iCnt )
 {
-    CVector<uint8_t> vecAcknMessage;
-    CVector<uint8_t> vecData ( 2 ); // 2 bytes of data
-    int              iPos = 0; // init position pointer
+    // the acknowledge buffers are reused
+    QMutexLocker locker ( &MutexSend );
+
+    int      iPos     = 0; // init position pointer
+    uint32_t iSelAckn = 0;
+
+    // the selective acknowledgement field contains the receive state of the
+    // preceding messages so that a lost acknowledgement does not require
+    // a retransmission of the message
+    for ( int i = 0; i < PROT_NUM_SEL_ACKN_BITS; i++ )
+    {
+        if ( veciRecID[( iCnt - 1 - i ) & ( PROT_NUM_COUNTER_VALUES - 1 )] !=
+             PROTMESSID_ILLEGAL )
+        {
+            iSelAckn |= ( 1u << i );
+        }
+    }
 
     // build data vector
-    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( iID ), 2 );
+    PutValOnStream ( vecbyAcknData, iPos, static_cast<uint32_t> ( iID ), 2 );
+    PutValOnStream ( vecbyAcknData, iPos, iSelAckn, 4 );
 
     // build complete message
-    GenMessageFrame ( vecAcknMessage, iCnt, PROTMESSID_ACKN, vecData );
+    GenMessageFrame ( vecbyAcknMessage, iCnt, PROTMESSID_ACKN, vecbyAcknData );
 
     // immediately send acknowledge message
-    emit MessReadyForSending ( vecAcknMessage );
+    PutMessageForSending ( vecbyAcknMessage );
 }
 
 void CProtocol::CreateAndImmSendConLessMessage ( const int               iID,
                                                  const CVector<uint8_t>& vecData,
                                                  const CHostAddress&     InetAddr )
 {
-    CVector<uint8_t> vecNewMessage;
+    // the message buffer is reused
+    QMutexLocker locker ( &MutexSend );
 
     // build complete message (counter per definition=0 for connection less
     // messages)
-    GenMessageFrame ( vecNewMessage, 0, iID, vecData );
+    GenMessageFrame ( vecbyCLMessage, 0, iID, vecData );
 
     // immediately send message
-    emit CLMessReadyForSending ( InetAddr, vecNewMessage );
+    emit CLMessReadyForSending ( InetAddr, vecbyCLMessage );
 }
 
 bool CProtocol::ParseMessageBody ( const CVector<uint8_t>& vecbyMesBodyData,
@@ -451,122 +981,280 @@ bool CProtocol::ParseMessageBody ( const CVector<uint8_t>& vecbyMesBodyData,
 if ( rand() < ( RAND_MAX / 2 ) ) return false;
 */
 
-    // In case we received a message and returned an answer but our answer
-    // did not make it to the receiver, he will resend his message. We check
-    // here if the message is the same as the old one, and if this is the
-    // case, just resend our old answer again
-    if ( ( iOldRecID == iRecID ) && ( iOldRecCnt == iRecCounter ) )
-    {
-        // acknowledgments are not acknowledged
-        if ( iRecID != PROTMESSID_ACKN )
-        {
-            // resend acknowledgement
-            CreateAndImmSendAcknMess ( iRecID, iRecCounter );
-        }
-    }
-    else
+    // special treatment for acknowledge messages
+    if ( iRecID == PROTMESSID_ACKN )
     {
-        // special treatment for acknowledge messages
-        if ( iRecID == PROTMESSID_ACKN )
+        // extract data from stream
+        int       iPos = 0;
+        const int iData =
+            static_cast<int> ( GetValFromStream ( vecbyMesBodyData, iPos, 2 ) );
+
+        // the selective acknowledgement field is only sent by new versions
+        uint32_t iSelAckn = 0;
+
+        Mutex.lock();
         {
-            // extract data from stream and emit signal for received value
-            int       iPos = 0;
-            const int iData =
-                static_cast<int> ( GetValFromStream ( vecbyMesBodyData, iPos, 2 ) );
+            if ( vecbyMesBodyData.Size() >= 6 )
+            {
+                iSelAckn = GetValFromStream ( vecbyMesBodyData, iPos, 4 );
+
+                // from now on we can have multiple messages in flight
+                bPeerSupportsSelAckn = true;
+            }
+
+            // check all messages in flight if they are acknowledged by this
+            // acknowledgement message
+            const int iRingSize = vecSendMessRing.Size();
+            const int iCurTime  = GetTimeMs();
 
-            Mutex.lock();
+            bSendNextMess = false;
+
+            for ( int i = 0; i < iSendRingNumUsed; i++ )
             {
-                // check if this is the correct acknowledgment
-                bSendNextMess = false;
-                if ( !SendMessQueue.empty() )
+                CSendMessage& CurMess =
+                    vecSendMessRing[( iSendRingStart + i ) % iRingSize];
+
+                if ( !CurMess.bSent )
                 {
-                    if ( ( SendMessQueue.front().iCnt == iRecCounter ) &&
-                         ( SendMessQueue.front().iID == iData ) )
-                    {
-                        // message acknowledged, remove from queue
-                        SendMessQueue.pop_front();
+                    // all following messages are not yet sent
+                    break;
+                }
+
+                if ( CurMess.bAckn )
+                {
+                    continue;
+                }
+
+                // distance of the message counter to the acknowledged counter
+                const int iCntDist = ( iRecCounter - CurMess.iCnt ) &
+                    ( PROT_NUM_COUNTER_VALUES - 1 );
 
-                        // send next message in queue
-                        bSendNextMess = true;
+                if ( ( ( iCntDist == 0 ) && ( CurMess.iID == iData ) ) ||
+                     ( ( iCntDist > 0 ) && ( iCntDist <= PROT_NUM_SEL_ACKN_BITS ) &&
+                       ( ( iSelAckn >> ( iCntDist - 1 ) ) & 1 ) ) )
+                {
+                    // message acknowledged, only use the round trip time of
+                    // messages which were not retransmitted since we do not
+                    // know to which transmission the acknowledgement belongs
+                    if ( !CurMess.bRetransmitted )
+                    {
+                        UpdateRetransTimeOut ( max ( 0, iCurTime - CurMess.iSendTimeMs ) );
                     }
+
+                    CurMess.bAckn = true;
+                    bSendNextMess = true;
                 }
             }
-            Mutex.unlock();
 
-            if ( bSendNextMess )
+            // remove all acknowledged messages at the beginning of the queue
+            while ( ( iSendRingNumUsed > 0 ) &&
+                    vecSendMessRing[iSendRingStart].bAckn )
             {
-                SendMessage();
+                iSendRingStart = ( iSendRingStart + 1 ) % iRingSize;
+                iSendRingNumUsed--;
             }
         }
+        Mutex.unlock();
+
+        if ( bSendNextMess )
+        {
+            // send next messages in queue
+            SendMessage();
+        }
+    }
+    else
+    {
+        if ( iNextRecCnt == PROT_INVALID_VALUE )
+        {
+            // this is the very first message we receive
+            EvaluateInOrderMes ( vecbyMesBodyData, iRecCounter, iRecID, bRet );
+        }
         else
         {
-            // check which type of message we received and do action
-            switch ( iRecID )
+            // distance of the received counter to the expected counter
+            const int iCntDist = ( iRecCounter - iNextRecCnt ) &
+                ( PROT_NUM_COUNTER_VALUES - 1 );
+
+            if ( iCntDist == 0 )
+            {
+                // this is the expected message
+                EvaluateInOrderMes ( vecbyMesBodyData, iRecCounter, iRecID, bRet );
+            }
+            else if ( iCntDist < PROT_SEND_WINDOW_SIZE )
             {
-            case PROTMESSID_JITT_BUF_SIZE:
-                bRet = EvaluateJitBufMes ( vecbyMesBodyData );
-                break;
+                // A message was received before a preceding message which is
+                // still missing. Store it until all preceding messages are
+                // received (if it was already stored, it was resent).
+                if ( veciRecID[iRecCounter] == PROTMESSID_ILLEGAL )
+                {
+                    veciRecID[iRecCounter] = iRecID;
 
-            case PROTMESSID_REQ_JITT_BUF_SIZE:
-                bRet = EvaluateReqJitBufMes();
-                break;
+                    vecvecbyRecMesBody[iRecCounter].Init ( vecbyMesBodyData.Size() );
+                    vecvecbyRecMesBody[iRecCounter] = vecbyMesBodyData;
+                }
 
-            case PROTMESSID_CHANNEL_GAIN:
-                bRet = EvaluateChanGainMes ( vecbyMesBodyData );
-                break;
+                const int iCurTime = GetTimeMs();
 
-// #### COMPATIBILITY OLD VERSION, TO BE REMOVED ####
-case PROTMESSID_CONN_CLIENTS_LIST_NAME:
-    bRet = EvaluateConClientListNameMes ( vecbyMesBodyData );
-    break;
+                if ( iRecGapStartTimeMs == PROT_INVALID_VALUE )
+                {
+                    iRecGapStartTimeMs = iCurTime;
+                }
+                else if ( iCurTime - iRecGapStartTimeMs > PROT_REC_RESTART_TIMEOUT_MS )
+                {
+                    // The missing message was not resent in time, i.e. the
+                    // protocol of the peer was reset and its counter restarted
+                    // just in front of our expected counter. The stored
+                    // messages are evaluated starting with the first one.
+                    while ( veciRecID[iNextRecCnt] == PROTMESSID_ILLEGAL )
+                    {
+                        iNextRecCnt = ( iNextRecCnt + 1 ) & ( PROT_NUM_COUNTER_VALUES - 1 );
+                    }
 
-            case PROTMESSID_CONN_CLIENTS_LIST:
-                bRet = EvaluateConClientListMes ( vecbyMesBodyData );
-                break;
+                    EvaluateStoredMes ( bRet );
+                }
+            }
+            else if ( ( iCntDist >= PROT_NUM_COUNTER_VALUES / 2 ) &&
+                      ( veciRecID[iRecCounter] == iRecID ) &&
+                      ( GetTimeMs() - veciRecTimeMs[iRecCounter] <= PROT_REC_RESTART_TIMEOUT_MS ) )
+            {
+                // In case we received a message and returned an answer but
+                // our answer did not make it to the receiver, he will resend
+                // his message. In this case we just resend our acknowledgement.
+            }
+            else
+            {
+                // the counter is out of the expected range or the message
+                // matches only a message which was received long ago (e.g. the
+                // protocol of the peer was reset), start over with this message
+                ResetRecState();
 
-            case PROTMESSID_REQ_CONN_CLIENTS_LIST:
-                bRet = EvaluateReqConnClientsList();
-                break;
+                EvaluateInOrderMes ( vecbyMesBodyData, iRecCounter, iRecID, bRet );
+            }
+        }
+
+        // immediately send acknowledge message (also for resent messages)
+        CreateAndImmSendAcknMess ( iRecID, iRecCounter );
+    }
+
+    return bRet;
+}
+
+void CProtocol::EvaluateInOrderMes ( const CVector<uint8_t>& vecbyMesBodyData,
+                                     const int               iRecCounter,
+                                     const int               iRecID,
+                                     bool&                   bRet )
+{
+    // evaluate the received message
+    bRet = EvaluateMessage ( vecbyMesBodyData, iRecID );
+
+    // store the ID and the receive time to find out if the message was resent
+    // and advance the expected counter
+    veciRecID[iRecCounter]     = iRecID;
+    veciRecTimeMs[iRecCounter] = GetTimeMs();
+    iNextRecCnt                = ( iRecCounter + 1 ) & ( PROT_NUM_COUNTER_VALUES - 1 );
+
+    // The receive state of counters which are far in the past is cleared so
+    // that the entries can be used again after the counter wrapped around.
+    veciRecID[( iRecCounter + PROT_NUM_COUNTER_VALUES / 2 ) &
+        ( PROT_NUM_COUNTER_VALUES - 1 )] = PROTMESSID_ILLEGAL;
+
+    EvaluateStoredMes ( bRet );
+}
+
+void CProtocol::EvaluateStoredMes ( bool& bRet )
+{
+    // the expected counter has advanced, a new gap starts a new time out
+    iRecGapStartTimeMs = PROT_INVALID_VALUE;
+
+    // evaluate all stored messages which are now in order
+    while ( veciRecID[iNextRecCnt] != PROTMESSID_ILLEGAL )
+    {
+        const int iCurCnt = iNextRecCnt;
+
+        bRet |= EvaluateMessage ( vecvecbyRecMesBody[iCurCnt], veciRecID[iCurCnt] );
+
+        veciRecTimeMs[iCurCnt] = GetTimeMs();
+        iNextRecCnt            = ( iCurCnt + 1 ) & ( PROT_NUM_COUNTER_VALUES - 1 );
+
+        veciRecID[( iCurCnt + PROT_NUM_COUNTER_VALUES / 2 ) &
+            ( PROT_NUM_COUNTER_VALUES - 1 )] = PROTMESSID_ILLEGAL;
+    }
+}
+
+bool CProtocol::EvaluateMessage ( const CVector<uint8_t>& vecbyMesBodyData,
+                                  const int               iRecID )
+{
+    bool bRet = false;
+
+    // check which type of message we received and do action
+    switch ( iRecID )
+    {
+    case PROTMESSID_JITT_BUF_SIZE:
+        bRet = EvaluateJitBufMes ( vecbyMesBodyData );
+        break;
+
+    case PROTMESSID_REQ_JITT_BUF_SIZE:
+        bRet = EvaluateReqJitBufMes();
+        break;
+
+    case PROTMESSID_CHANNEL_GAIN:
+        bRet = EvaluateChanGainMes ( vecbyMesBodyData );
+        break;
+
+// #### COMPATIBILITY OLD VERSION, TO BE REMOVED ####
+case PROTMESSID_CONN_CLIENTS_LIST_NAME:
+    bRet = EvaluateConClientListNameMes ( vecbyMesBodyData );
+    break;
+
+    case PROTMESSID_CONN_CLIENTS_LIST:
+        bRet = EvaluateConClientListMes ( vecbyMesBodyData );
+        break;
+
+    case PROTMESSID_CONN_CLIENTS_LIST_DELTA:
+        bRet = EvaluateConClientListDeltaMes ( vecbyMesBodyData );
+        break;
+
+    case PROTMESSID_REQ_CONN_CLIENTS_LIST:
+        bRet = EvaluateReqConnClientsList();
+        break;
 
 // #### COMPATIBILITY OLD VERSION, TO BE REMOVED ####
 case PROTMESSID_CHANNEL_NAME:
     bRet = EvaluateChanNameMes ( vecbyMesBodyData );
     break;
 
-            case PROTMESSID_CHANNEL_INFOS:
-                bRet = EvaluateChanInfoMes ( vecbyMesBodyData );
-                break;
+    case PROTMESSID_CHANNEL_INFOS:
+        bRet = EvaluateChanInfoMes ( vecbyMesBodyData );
+        break;
 
-            case PROTMESSID_REQ_CHANNEL_INFOS:
-                bRet = EvaluateReqChanInfoMes();
-                break;
+    case PROTMESSID_REQ_CHANNEL_INFOS:
+        bRet = EvaluateReqChanInfoMes();
+        break;
 
-            case PROTMESSID_CHAT_TEXT:
-                bRet = EvaluateChatTextMes ( vecbyMesBodyData );
-                break;
+    case PROTMESSID_CHAT_TEXT:
+        bRet = EvaluateChatTextMes ( vecbyMesBodyData );
+        break;
 
-            case PROTMESSID_NETW_TRANSPORT_PROPS:
-                bRet = EvaluateNetwTranspPropsMes ( vecbyMesBodyData );
-                break;
+    case PROTMESSID_NETW_TRANSPORT_PROPS:
+        bRet = EvaluateNetwTranspPropsMes ( vecbyMesBodyData );
+        break;
 
-            case PROTMESSID_REQ_NETW_TRANSPORT_PROPS:
-                bRet = EvaluateReqNetwTranspPropsMes();
-                break;
+    case PROTMESSID_REQ_NETW_TRANSPORT_PROPS:
+        bRet = EvaluateReqNetwTranspPropsMes();
+        break;
 
 // #### COMPATIBILITY OLD VERSION, TO BE REMOVED ####
 case PROTMESSID_OPUS_SUPPORTED:
     bRet = EvaluateOpusSupportedMes();
     break;
-            }
 
-            // immediately send acknowledge message
-            CreateAndImmSendAcknMess ( iRecID, iRecCounter );
+    case PROTMESSID_SUPPORTED_FEATURES:
+        bRet = EvaluateSupportedFeaturesMes ( vecbyMesBodyData );
+        break;
 
-            // save current message ID and counter to find out if message
-            // was resent
-            iOldRecID  = iRecID;
-            iOldRecCnt = iRecCounter;
-        }
+    case PROTMESSID_RECEIVER_REPORT:
+        bRet = EvaluateReceiverReportMes ( vecbyMesBodyData );
+        break;
     }
 
     return bRet;
@@ -608,7 +1296,11 @@ if ( rand() < ( RAND_MAX / 2 ) ) return false;
             break;
 
         case PROTMESSID_CLM_REQ_SERVER_LIST:
-            bRet = EvaluateCLReqServerListMes ( InetAddr );
+            bRet = EvaluateCLReqServerListMes ( InetAddr, vecbyMesBodyData );
+            break;
+
+        case PROTMESSID_CLM_SERVER_LIST_FRAGMENT:
+            bRet = EvaluateCLServerListFragmentMes ( InetAddr, vecbyMesBodyData );
             break;
 
         case PROTMESSID_CLM_SEND_EMPTY_MESSAGE:
@@ -634,6 +1326,30 @@ if ( rand() < ( RAND_MAX / 2 ) ) return false;
         case PROTMESSID_CLM_REQ_VERSION_AND_OS:
             bRet = EvaluateCLReqVersionAndOSMes ( InetAddr );
             break;
+
+        case PROTMESSID_CLM_CONN_CHALLENGE:
+            bRet = EvaluateCLConnChallengeMes ( InetAddr, vecbyMesBodyData );
+            break;
+
+        case PROTMESSID_CLM_CONN_CHALLENGE_RESP:
+            bRet = EvaluateCLConnChallengeRespMes ( InetAddr, vecbyMesBodyData );
+            break;
+
+        case PROTMESSID_CLM_SERVER_LOAD:
+            bRet = EvaluateCLServerLoadMes ( InetAddr, vecbyMesBodyData );
+            break;
+
+        case PROTMESSID_CLM_REQ_GROUP_SERVER:
+            bRet = EvaluateCLReqGroupServerMes ( InetAddr, vecbyMesBodyData );
+            break;
+
+        case PROTMESSID_CLM_GROUP_SERVER:
+            bRet = EvaluateCLGroupServerMes ( InetAddr, vecbyMesBodyData );
+            break;
+
+        case PROTMESSID_CLM_REQ_LISTEN:
+            bRet = EvaluateCLReqListenMes ( InetAddr, vecbyMesBodyData );
+            break;
         }
     }
     else
@@ -650,28 +1366,27 @@ if ( rand() < ( RAND_MAX / 2 ) ) return false;
 \******************************************************************************/
 void CProtocol::CreateJitBufMes ( const int iJitBufSize )
 {
-    CVector<uint8_t> vecData ( 2 ); // 2 bytes of data
-    int              iPos = 0;      // init position pointer
+    CVector<uint8_t>                       vecData;
+    CProtMessWriter<CProtSchemaJitBufSize> Mes ( vecData );
 
     // build data vector
-    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( iJitBufSize ), 2 );
+    Mes.Set<0> ( static_cast<uint32_t> ( iJitBufSize ) );
 
     CreateAndSendMessage ( PROTMESSID_JITT_BUF_SIZE, vecData );
 }
 
 bool CProtocol::EvaluateJitBufMes ( const CVector<uint8_t>& vecData )
 {
-    int iPos = 0; // init position pointer
+    CProtMessView<CProtSchemaJitBufSize> Mes;
 
     // check size
-    if ( vecData.Size() != 2 )
+    if ( Mes.Parse ( vecData ) )
     {
         return true; // return error code
     }
 
     // extract jitter buffer size
-    const int iData =
-        static_cast<int> ( GetValFromStream ( vecData, iPos, 2 ) );
+    const int iData = static_cast<int> ( Mes.Get<0>() );
 
     if ( ( ( iData < MIN_NET_BUF_SIZE_NUM_BL ) ||
            ( iData > MAX_NET_BUF_SIZE_NUM_BL ) ) &&
@@ -702,38 +1417,36 @@ bool CProtocol::EvaluateReqJitBufMes()
 
 void CProtocol::CreateChanGainMes ( const int iChanID, const double dGain )
 {
-    CVector<uint8_t> vecData ( 3 ); // 3 bytes of data
-    int              iPos = 0;      // init position pointer
+    CVector<uint8_t>                     vecData;
+    CProtMessWriter<CProtSchemaChanGain> Mes ( vecData );
 
     // build data vector
     // channel ID
-    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( iChanID ), 1 );
+    Mes.Set<0> ( static_cast<uint32_t> ( iChanID ) );
 
     // actual gain, we convert from double with range 0..1 to integer
     const int iCurGain = static_cast<int> ( dGain * ( 1 << 15 ) );
 
-    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( iCurGain ), 2 );
+    Mes.Set<1> ( static_cast<uint32_t> ( iCurGain ) );
 
     CreateAndSendMessage ( PROTMESSID_CHANNEL_GAIN, vecData );
 }
 
 bool CProtocol::EvaluateChanGainMes ( const CVector<uint8_t>& vecData )
 {
-    int iPos = 0; // init position pointer
+    CProtMessView<CProtSchemaChanGain> Mes;
 
     // check size
-    if ( vecData.Size() != 3 )
+    if ( Mes.Parse ( vecData ) )
     {
         return true; // return error code
     }
 
     // channel ID
-    const int iCurID =
-        static_cast<int> ( GetValFromStream ( vecData, iPos, 1 ) );
+    const int iCurID = static_cast<int> ( Mes.Get<0>() );
 
     // gain (read integer value)
-    const int iData =
-        static_cast<int> ( GetValFromStream ( vecData, iPos, 2 ) );
+    const int iData = static_cast<int> ( Mes.Get<1>() );
 
     // we convert the gain from integer to double with range 0..1
     const double dNewGain = static_cast<double> ( iData ) / ( 1 << 15 );
@@ -745,12 +1458,22 @@ bool CProtocol::EvaluateChanGainMes ( const CVector<uint8_t>& vecData )
 }
 
 void CProtocol::CreateConClientListNameMes ( const CVector<CChannelInfo>& vecChanInfo )
+{
+    CVector<uint8_t> vecData;
+
+    PrepareConClientListNameMes ( vecChanInfo, vecData );
+
+    CreatePreparedConClientListNameMes ( vecData );
+}
+
+void CProtocol::PrepareConClientListNameMes ( const CVector<CChannelInfo>& vecChanInfo,
+                                              CVector<uint8_t>&            vecData )
 {
     const int iNumClients = vecChanInfo.Size();
 
     // build data vector
-    CVector<uint8_t> vecData ( 0 );
-    int              iPos = 0; // init position pointer
+    vecData.Init ( 0 );
+    int iPos = 0; // init position pointer
 
     for ( int i = 0; i < iNumClients; i++ )
     {
@@ -776,8 +1499,6 @@ void CProtocol::CreateConClientListNameMes ( const CVector<CChannelInfo>& vecCha
         // name string
         PutStringUTF8OnStream ( vecData, iPos, strUTF8Name );
     }
-
-    CreateAndSendMessage ( PROTMESSID_CONN_CLIENTS_LIST_NAME, vecData );
 }
 
 bool CProtocol::EvaluateConClientListNameMes ( const CVector<uint8_t>& vecData )
@@ -829,122 +1550,149 @@ bool CProtocol::EvaluateConClientListNameMes ( const CVector<uint8_t>& vecData )
 }
 
 void CProtocol::CreateConClientListMes ( const CVector<CChannelInfo>& vecChanInfo )
+{
+    CVector<uint8_t> vecData;
+
+    PrepareConClientListMes ( vecChanInfo, vecData );
+
+    CreatePreparedConClientListMes ( vecData );
+}
+
+void CProtocol::PrepareConClientListMes ( const CVector<CChannelInfo>& vecChanInfo,
+                                          CVector<uint8_t>&            vecData )
 {
     const int iNumClients = vecChanInfo.Size();
 
     // build data vector
-    CVector<uint8_t> vecData ( 0 );
-    int              iPos = 0; // init position pointer
+    vecData.Init ( 0 );
+    int iPos = 0; // init position pointer
 
     for ( int i = 0; i < iNumClients; i++ )
     {
-        // convert strings to utf-8
-        const QByteArray strUTF8Name = vecChanInfo[i].strName.toUtf8();
-        const QByteArray strUTF8City = vecChanInfo[i].strCity.toUtf8();
+        PutChanInfoOnStream ( vecData, iPos, vecChanInfo[i] );
+    }
+}
 
-        // size of current list entry
-        const int iCurListEntrLen =
-            1 /* chan ID */ + 2 /* country */ +
-            4 /* instrument */ + 1 /* skill level */ +
-            4 /* IP address */ +
-            2 /* utf-8 str. size */ + strUTF8Name.size() +
-            2 /* utf-8 str. size */ + strUTF8City.size();
+bool CProtocol::EvaluateConClientListMes ( const CVector<uint8_t>& vecData )
+{
+    int                   iPos     = 0; // init position pointer
+    const int             iDataLen = vecData.Size();
+    CVector<CChannelInfo> vecChanInfo ( 0 );
 
-        // make space for new data
-        vecData.Enlarge ( iCurListEntrLen );
+    while ( iPos < iDataLen )
+    {
+        CChannelInfo CurChanInfo;
 
-        // channel ID (1 byte)
-        PutValOnStream ( vecData, iPos,
-            static_cast<uint32_t> ( vecChanInfo[i].iChanID ), 1 );
+        if ( GetChanInfoFromStream ( vecData, iPos, CurChanInfo ) )
+        {
+            return true; // return error code
+        }
 
-        // country (2 bytes)
-        PutValOnStream ( vecData, iPos,
-            static_cast<uint32_t> ( vecChanInfo[i].eCountry ), 2 );
+        // add channel information to vector
+        vecChanInfo.Add ( CurChanInfo );
+    }
 
-        // instrument (4 bytes)
-        PutValOnStream ( vecData, iPos,
-            static_cast<uint32_t> ( vecChanInfo[i].iInstrument ), 4 );
+    // check size: all data is read, the position must now be at the end
+    if ( iPos != iDataLen )
+    {
+        return true; // return error code
+    }
 
-        // skill level (1 byte)
-        PutValOnStream ( vecData, iPos,
-            static_cast<uint32_t> ( vecChanInfo[i].eSkillLevel ), 1 );
+    // invoke message action
+    emit ConClientListMesReceived ( vecChanInfo );
 
-        // IP address (4 bytes)
-        PutValOnStream ( vecData, iPos,
-            static_cast<uint32_t> ( vecChanInfo[i].iIpAddr ), 4 );
+    return false; // no error
+}
 
-        // name
-        PutStringUTF8OnStream ( vecData, iPos, strUTF8Name );
+void CProtocol::PrepareConClientListDeltaMes ( const int                    iBaseVersion,
+                                               const int                    iVersion,
+                                               const CVector<int>&          veciRemovedChanIDs,
+                                               const CVector<CChannelInfo>& vecChanInfo,
+                                               CVector<uint8_t>&            vecData )
+{
+    const int iNumRemoved = veciRemovedChanIDs.Size();
+    const int iNumClients = vecChanInfo.Size();
 
-        // city
-        PutStringUTF8OnStream ( vecData, iPos, strUTF8City );
+    // build data vector
+    vecData.Init ( 4 /* base version */ + 4 /* version */ +
+                   1 /* num removed */ + iNumRemoved );
+
+    int iPos = 0; // init position pointer
+
+    // base version (4 bytes)
+    PutValOnStream ( vecData, iPos,
+        static_cast<uint32_t> ( iBaseVersion ), 4 );
+
+    // version (4 bytes)
+    PutValOnStream ( vecData, iPos,
+        static_cast<uint32_t> ( iVersion ), 4 );
+
+    // number of removed channels (1 byte)
+    PutValOnStream ( vecData, iPos,
+        static_cast<uint32_t> ( iNumRemoved ), 1 );
+
+    // removed channel IDs (1 byte each)
+    for ( int i = 0; i < iNumRemoved; i++ )
+    {
+        PutValOnStream ( vecData, iPos,
+            static_cast<uint32_t> ( veciRemovedChanIDs[i] ), 1 );
     }
 
-    CreateAndSendMessage ( PROTMESSID_CONN_CLIENTS_LIST, vecData );
+    // changed or added channels
+    for ( int i = 0; i < iNumClients; i++ )
+    {
+        PutChanInfoOnStream ( vecData, iPos, vecChanInfo[i] );
+    }
 }
 
-bool CProtocol::EvaluateConClientListMes ( const CVector<uint8_t>& vecData )
+bool CProtocol::EvaluateConClientListDeltaMes ( const CVector<uint8_t>& vecData )
 {
     int                   iPos     = 0; // init position pointer
     const int             iDataLen = vecData.Size();
+    CVector<int>          veciRemovedChanIDs ( 0 );
     CVector<CChannelInfo> vecChanInfo ( 0 );
 
-    while ( iPos < iDataLen )
+    // check size (the first 9 bytes)
+    if ( iDataLen < 9 )
     {
-        // check size (the next 12 bytes)
-        if ( ( iDataLen - iPos ) < 12 )
-        {
-            return true; // return error code
-        }
+        return true; // return error code
+    }
 
-        // channel ID (1 byte)
-        const int iChanID =
-            static_cast<int> ( GetValFromStream ( vecData, iPos, 1 ) );
+    // base version (4 bytes)
+    const int iBaseVersion =
+        static_cast<int> ( GetValFromStream ( vecData, iPos, 4 ) );
 
-        // country (2 bytes)
-        const QLocale::Country eCountry =
-            static_cast<QLocale::Country> ( GetValFromStream ( vecData, iPos, 2 ) );
+    // version (4 bytes)
+    const int iVersion =
+        static_cast<int> ( GetValFromStream ( vecData, iPos, 4 ) );
 
-        // instrument (4 bytes)
-        const int iInstrument =
-            static_cast<int> ( GetValFromStream ( vecData, iPos, 4 ) );
+    // number of removed channels (1 byte)
+    const int iNumRemoved =
+        static_cast<int> ( GetValFromStream ( vecData, iPos, 1 ) );
 
-        // skill level (1 byte)
-        const ESkillLevel eSkillLevel =
-            static_cast<ESkillLevel> ( GetValFromStream ( vecData, iPos, 1 ) );
+    // check size (the removed channel IDs)
+    if ( ( iDataLen - iPos ) < iNumRemoved )
+    {
+        return true; // return error code
+    }
 
-        // IP address (4 bytes)
-        const int iIpAddr =
-            static_cast<int> ( GetValFromStream ( vecData, iPos, 4 ) );
+    for ( int i = 0; i < iNumRemoved; i++ )
+    {
+        veciRemovedChanIDs.Add (
+            static_cast<int> ( GetValFromStream ( vecData, iPos, 1 ) ) );
+    }
 
-        // name
-        QString strCurName;
-        if ( GetStringFromStream ( vecData,
-                                   iPos,
-                                   MAX_LEN_FADER_TAG,
-                                   strCurName ) )
-        {
-            return true; // return error code
-        }
+    while ( iPos < iDataLen )
+    {
+        CChannelInfo CurChanInfo;
 
-        // city
-        QString strCurCity;
-        if ( GetStringFromStream ( vecData,
-                                   iPos,
-                                   MAX_LEN_SERVER_CITY,
-                                   strCurCity ) )
+        if ( GetChanInfoFromStream ( vecData, iPos, CurChanInfo ) )
         {
             return true; // return error code
         }
 
         // add channel information to vector
-        vecChanInfo.Add ( CChannelInfo ( iChanID,
-                                         iIpAddr,
-                                         strCurName,
-                                         eCountry,
-                                         strCurCity,
-                                         iInstrument,
-                                         eSkillLevel ) );
+        vecChanInfo.Add ( CurChanInfo );
     }
 
     // check size: all data is read, the position must now be at the end
@@ -954,7 +1702,10 @@ bool CProtocol::EvaluateConClientListMes ( const CVector<uint8_t>& vecData )
     }
 
     // invoke message action
-    emit ConClientListMesReceived ( vecChanInfo );
+    emit ConClientListDeltaMesReceived ( iBaseVersion,
+                                         iVersion,
+                                         veciRemovedChanIDs,
+                                         vecChanInfo );
 
     return false; // no error
 }
@@ -1174,76 +1925,64 @@ bool CProtocol::EvaluateChatTextMes ( const CVector<uint8_t>& vecData )
 
 void CProtocol::CreateNetwTranspPropsMes ( const CNetworkTransportProps& NetTrProps )
 {
-    int iPos = 0; // init position pointer
+    CVector<uint8_t> vecData;
 
-    // size of current message body
-    const int iEntrLen =
-        4 /* netw size */ +
-        2 /* block size fact */ +
-        1 /* num chan */ +
-        4 /* sam rate */ +
-        2 /* audiocod type */ +
-        2 /* version */ +
-        4 /* audiocod arg */;
+    // the optional redundancy field is only appended if redundancy is used
+    // (old versions do not know this field)
+    int iNumFields = CProtSchemaNetwTranspProps::iNumFields - 1;
 
-    // build data vector
-    CVector<uint8_t> vecData ( iEntrLen );
+    if ( NetTrProps.iNumRedundantPackets > 0 )
+    {
+        iNumFields = CProtSchemaNetwTranspProps::iNumFields;
+    }
 
+    CProtMessWriter<CProtSchemaNetwTranspProps> Mes ( vecData, iNumFields );
+
+    // build data vector
     // length of the base network packet (frame) in bytes (4 bytes)
-    PutValOnStream ( vecData, iPos,
-        static_cast<uint32_t> ( NetTrProps.iBaseNetworkPacketSize ), 4 );
+    Mes.Set<0> ( static_cast<uint32_t> ( NetTrProps.iBaseNetworkPacketSize ) );
 
     // block size factor (2 bytes)
-    PutValOnStream ( vecData, iPos,
-        static_cast<uint32_t> ( NetTrProps.iBlockSizeFact ), 2 );
+    Mes.Set<1> ( static_cast<uint32_t> ( NetTrProps.iBlockSizeFact ) );
 
     // number of channels of the audio signal, e.g. "2" is stereo (1 byte)
-    PutValOnStream ( vecData, iPos,
-        static_cast<uint32_t> ( NetTrProps.iNumAudioChannels ), 1 );
+    Mes.Set<2> ( static_cast<uint32_t> ( NetTrProps.iNumAudioChannels ) );
 
     // sample rate of the audio stream (4 bytes)
-    PutValOnStream ( vecData, iPos,
-        static_cast<uint32_t> ( NetTrProps.iSampleRate ), 4 );
+    Mes.Set<3> ( static_cast<uint32_t> ( NetTrProps.iSampleRate ) );
 
     // audio coding type (2 bytes)
-    PutValOnStream ( vecData, iPos,
-        static_cast<uint32_t> ( NetTrProps.eAudioCodingType ), 2 );
+    Mes.Set<4> ( static_cast<uint32_t> ( NetTrProps.eAudioCodingType ) );
 
     // version (2 bytes)
-    PutValOnStream ( vecData, iPos,
-        static_cast<uint32_t> ( NetTrProps.iVersion ), 2 );
+    Mes.Set<5> ( static_cast<uint32_t> ( NetTrProps.iVersion ) );
 
     // argument for the audio coder (4 bytes)
-    PutValOnStream ( vecData, iPos,
-        static_cast<uint32_t> ( NetTrProps.iAudioCodingArg ), 4 );
+    Mes.Set<6> ( static_cast<uint32_t> ( NetTrProps.iAudioCodingArg ) );
+
+    // number of redundant audio packets (1 byte, optional)
+    if ( iNumFields == CProtSchemaNetwTranspProps::iNumFields )
+    {
+        Mes.Set<7> ( static_cast<uint32_t> ( NetTrProps.iNumRedundantPackets ) );
+    }
 
     CreateAndSendMessage ( PROTMESSID_NETW_TRANSPORT_PROPS, vecData );
 }
 
 bool CProtocol::EvaluateNetwTranspPropsMes ( const CVector<uint8_t>& vecData )
 {
-    int                    iPos = 0; // init position pointer
-    CNetworkTransportProps ReceivedNetwTranspProps;
+    CProtMessView<CProtSchemaNetwTranspProps> Mes;
+    CNetworkTransportProps                    ReceivedNetwTranspProps;
 
-    // size of current message body
-    const int iEntrLen =
-        4 /* netw size */ +
-        2 /* block size fact */ +
-        1 /* num chan */ +
-        4 /* sam rate */ +
-        2 /* audiocod type */ +
-        2 /* version */ +
-        4 /* audiocod arg */;
-
-    // check size
-    if ( vecData.Size() != iEntrLen )
+    // check size (the redundancy field is optional)
+    if ( Mes.Parse ( vecData, CProtSchemaNetwTranspProps::iNumFields - 1 ) )
     {
         return true; // return error code
     }
 
     // length of the base network packet (frame) in bytes (4 bytes)
     ReceivedNetwTranspProps.iBaseNetworkPacketSize =
-        static_cast<uint32_t> ( GetValFromStream ( vecData, iPos, 4 ) );
+        static_cast<uint32_t> ( Mes.Get<0>() );
 
     // at least CELT_MINIMUM_NUM_BYTES bytes are required for the CELC codec
     if ( ( ReceivedNetwTranspProps.iBaseNetworkPacketSize < CELT_MINIMUM_NUM_BYTES ) ||
@@ -1254,7 +1993,7 @@ bool CProtocol::EvaluateNetwTranspPropsMes ( const CVector<uint8_t>& vecData )
 
     // block size factor (2 bytes)
     ReceivedNetwTranspProps.iBlockSizeFact =
-        static_cast<uint16_t> ( GetValFromStream ( vecData, iPos, 2 ) );
+        static_cast<uint16_t> ( Mes.Get<1>() );
 
     if ( ( ReceivedNetwTranspProps.iBlockSizeFact != FRAME_SIZE_FACTOR_PREFERRED ) &&
          ( ReceivedNetwTranspProps.iBlockSizeFact != FRAME_SIZE_FACTOR_DEFAULT ) &&
@@ -1266,7 +2005,7 @@ bool CProtocol::EvaluateNetwTranspPropsMes ( const CVector<uint8_t>& vecData )
     // number of channels of the audio signal, only mono (1 channel) or
     // stereo (2 channels) allowed (1 byte)
     ReceivedNetwTranspProps.iNumAudioChannels =
-        static_cast<uint32_t> ( GetValFromStream ( vecData, iPos, 1 ) );
+        static_cast<uint32_t> ( Mes.Get<2>() );
 
     if ( ( ReceivedNetwTranspProps.iNumAudioChannels != 1 ) &&
          ( ReceivedNetwTranspProps.iNumAudioChannels != 2 ) )
@@ -1276,15 +2015,15 @@ bool CProtocol::EvaluateNetwTranspPropsMes ( const CVector<uint8_t>& vecData )
 
     // sample rate of the audio stream (4 bytes)
     ReceivedNetwTranspProps.iSampleRate =
-        static_cast<uint32_t> ( GetValFromStream ( vecData, iPos, 4 ) );
+        static_cast<uint32_t> ( Mes.Get<3>() );
 
     // audio coding type (2 bytes) with error check
-    const int iRecCodingType =
-        static_cast<int> ( GetValFromStream ( vecData, iPos, 2 ) );
+    const int iRecCodingType = static_cast<int> ( Mes.Get<4>() );
 
     if ( ( iRecCodingType != CT_NONE ) &&
          ( iRecCodingType != CT_CELT ) &&
-         ( iRecCodingType != CT_OPUS ) )
+         ( iRecCodingType != CT_OPUS ) &&
+         ( iRecCodingType != CT_PCM ) )
     {
         return true;
     }
@@ -1294,11 +2033,33 @@ bool CProtocol::EvaluateNetwTranspPropsMes ( const CVector<uint8_t>& vecData )
 
     // version (2 bytes)
     ReceivedNetwTranspProps.iVersion =
-        static_cast<uint32_t> ( GetValFromStream ( vecData, iPos, 2 ) );
+        static_cast<uint32_t> ( Mes.Get<5>() );
 
     // argument for the audio coder (4 bytes)
     ReceivedNetwTranspProps.iAudioCodingArg =
-        static_cast<int32_t> ( GetValFromStream ( vecData, iPos, 4 ) );
+        static_cast<int32_t> ( Mes.Get<6>() );
+
+    // for uncompressed audio the network frame size is fixed
+    if ( ( ReceivedNetwTranspProps.eAudioCodingType == CT_PCM ) &&
+         ( ReceivedNetwTranspProps.iBaseNetworkPacketSize !=
+           static_cast<uint32_t> ( PCM_NUM_BYTES_PER_SAMPLE *
+           ReceivedNetwTranspProps.GetFrameSizeSamples() ) *
+           ReceivedNetwTranspProps.iNumAudioChannels ) )
+    {
+        return true; // return error code
+    }
+
+    // number of redundant audio packets (1 byte, optional)
+    if ( Mes.GetNumFields() == CProtSchemaNetwTranspProps::iNumFields )
+    {
+        ReceivedNetwTranspProps.iNumRedundantPackets =
+            static_cast<uint32_t> ( Mes.Get<7>() );
+
+        if ( ReceivedNetwTranspProps.iNumRedundantPackets > MAX_NUM_REDUNDANT_PACKETS )
+        {
+            return true; // return error code
+        }
+    }
 
     // invoke message action
     emit NetTranspPropsReceived ( ReceivedNetwTranspProps );
@@ -1334,17 +2095,89 @@ bool CProtocol::EvaluateOpusSupportedMes()
     return false; // no error
 }
 
+void CProtocol::CreateSupportedFeaturesMes ( const int iFeatures )
+{
+    CVector<uint8_t>                              vecData;
+    CProtMessWriter<CProtSchemaSupportedFeatures> Mes ( vecData );
+
+    // build data vector
+    Mes.Set<0> ( static_cast<uint32_t> ( iFeatures ) );
+
+    CreateAndSendMessage ( PROTMESSID_SUPPORTED_FEATURES, vecData );
+}
+
+bool CProtocol::EvaluateSupportedFeaturesMes ( const CVector<uint8_t>& vecData )
+{
+    CProtMessView<CProtSchemaSupportedFeatures> Mes;
+
+    // check size
+    if ( Mes.Parse ( vecData ) )
+    {
+        return true; // return error code
+    }
+
+    // extract feature bits
+    const int iFeatures = static_cast<int> ( Mes.Get<0>() );
+
+    // invoke message action
+    emit SupportedFeaturesReceived ( iFeatures );
+
+    return false; // no error
+}
+
+void CProtocol::CreateReceiverReportMes ( const int iNumFrames,
+                                          const int iNumLostFrames )
+{
+    CVector<uint8_t>                           vecData;
+    CProtMessWriter<CProtSchemaReceiverReport> Mes ( vecData );
+
+    // build data vector
+    // number of frames (2 bytes)
+    Mes.Set<0> ( static_cast<uint32_t> ( iNumFrames ) );
+
+    // number of lost frames (2 bytes)
+    Mes.Set<1> ( static_cast<uint32_t> ( iNumLostFrames ) );
+
+    CreateAndSendMessage ( PROTMESSID_RECEIVER_REPORT, vecData );
+}
+
+bool CProtocol::EvaluateReceiverReportMes ( const CVector<uint8_t>& vecData )
+{
+    CProtMessView<CProtSchemaReceiverReport> Mes;
+
+    // check size
+    if ( Mes.Parse ( vecData ) )
+    {
+        return true; // return error code
+    }
+
+    // number of frames
+    const int iNumFrames = static_cast<int> ( Mes.Get<0>() );
+
+    // number of lost frames
+    const int iNumLostFrames = static_cast<int> ( Mes.Get<1>() );
+
+    // the number of lost frames cannot be larger than the number of frames
+    if ( iNumLostFrames > iNumFrames )
+    {
+        return true; // return error code
+    }
+
+    // invoke message action
+    emit ReceiverReportReceived ( iNumFrames, iNumLostFrames );
+
+    return false; // no error
+}
+
 
 // Connection less messages ----------------------------------------------------
 void CProtocol::CreateCLPingMes ( const CHostAddress& InetAddr, const int iMs )
 {
-    int iPos = 0; // init position pointer
-
-    // build data vector (4 bytes long)
-    CVector<uint8_t> vecData ( 4 );
+    CVector<uint8_t>                   vecData;
+    CProtMessWriter<CProtSchemaCLPing> Mes ( vecData );
 
     // transmit time (4 bytes)
-    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( iMs ), 4 );
+    Mes.Set<0> ( static_cast<uint32_t> ( iMs ) );
 
     CreateAndImmSendConLessMessage ( PROTMESSID_CLM_PING_MS,
                                      vecData,
@@ -1354,17 +2187,16 @@ void CProtocol::CreateCLPingMes ( const CHostAddress& InetAddr, const int iMs )
 bool CProtocol::EvaluateCLPingMes ( const CHostAddress& InetAddr,
                                     const CVector<uint8_t>& vecData )
 {
-    int iPos = 0; // init position pointer
+    CProtMessView<CProtSchemaCLPing> Mes;
 
     // check size
-    if ( vecData.Size() != 4 )
+    if ( Mes.Parse ( vecData ) )
     {
         return true; // return error code
     }
 
     // invoke message action
-    emit CLPingReceived ( InetAddr,
-                          static_cast<int> ( GetValFromStream ( vecData, iPos, 4 ) ) );
+    emit CLPingReceived ( InetAddr, static_cast<int> ( Mes.Get<0>() ) );
 
     return false; // no error
 }
@@ -1373,16 +2205,14 @@ void CProtocol::CreateCLPingWithNumClientsMes ( const CHostAddress& InetAddr,
                                                 const int           iMs,
                                                 const int           iNumClients )
 {
-    int iPos = 0; // init position pointer
-
-    // build data vector (5 bytes long)
-    CVector<uint8_t> vecData ( 5 );
+    CVector<uint8_t>                                 vecData;
+    CProtMessWriter<CProtSchemaCLPingWithNumClients> Mes ( vecData );
 
     // transmit time (4 bytes)
-    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( iMs ), 4 );
+    Mes.Set<0> ( static_cast<uint32_t> ( iMs ) );
 
     // current number of connected clients (1 byte)
-    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( iNumClients ), 1 );
+    Mes.Set<1> ( static_cast<uint32_t> ( iNumClients ) );
 
     CreateAndImmSendConLessMessage ( PROTMESSID_CLM_PING_MS_WITHNUMCLIENTS,
                                      vecData,
@@ -1392,21 +2222,19 @@ void CProtocol::CreateCLPingWithNumClientsMes ( const CHostAddress& InetAddr,
 bool CProtocol::EvaluateCLPingWithNumClientsMes ( const CHostAddress&     InetAddr,
                                                   const CVector<uint8_t>& vecData )
 {
-    int iPos = 0; // init position pointer
+    CProtMessView<CProtSchemaCLPingWithNumClients> Mes;
 
     // check size
-    if ( vecData.Size() != 5 )
+    if ( Mes.Parse ( vecData ) )
     {
         return true; // return error code
     }
 
     // transmit time
-    const int iCurMs =
-        static_cast<int> ( GetValFromStream ( vecData, iPos, 4 ) );
+    const int iCurMs = static_cast<int> ( Mes.Get<0>() );
 
     // current number of connected clients
-    const int iCurNumClients =
-        static_cast<int> ( GetValFromStream ( vecData, iPos, 1 ) );
+    const int iCurNumClients = static_cast<int> ( Mes.Get<1>() );
 
     // invoke message action
     emit CLPingWithNumClientsReceived ( InetAddr, iCurMs, iCurNumClients );
@@ -1567,144 +2395,216 @@ bool CProtocol::EvaluateCLUnregisterServerMes ( const CHostAddress& InetAddr )
 
 void CProtocol::CreateCLServerListMes ( const CHostAddress&        InetAddr,
                                         const CVector<CServerInfo> vecServerInfo )
+{
+    CVector<uint8_t> vecData;
+    CVector<int>     veciEntryPos;
+
+    PrepareCLServerListMes ( vecServerInfo, vecData, veciEntryPos );
+
+    CreatePreparedCLServerListMes ( InetAddr, vecData );
+}
+
+void CProtocol::PrepareCLServerListMes ( const CVector<CServerInfo>& vecServerInfo,
+                                         CVector<uint8_t>&           vecData,
+                                         CVector<int>&               veciEntryPos )
 {
     const int iNumServers = vecServerInfo.Size();
 
     // build data vector
-    CVector<uint8_t> vecData ( 0 );
-    int              iPos = 0; // init position pointer
+    vecData.Init ( 0 );
+    veciEntryPos.Init ( iNumServers );
+    int iPos = 0; // init position pointer
 
     for ( int i = 0; i < iNumServers; i++ )
     {
-        // convert server list strings to utf-8
-        const QByteArray strUTF8Name  = vecServerInfo[i].strName.toUtf8();
-        const QByteArray strUTF8Topic = vecServerInfo[i].strTopic.toUtf8();
-        const QByteArray strUTF8City  = vecServerInfo[i].strCity.toUtf8();
+        veciEntryPos[i] = iPos;
+        PutServerInfoOnStream ( vecData, iPos, vecServerInfo[i] );
+    }
+}
 
-        // size of current list entry
-        const int iCurListEntrLen =
-            4 /* IP address */ +
-            2 /* port number */ +
-            2 /* country */ +
-            1 /* maximum number of connected clients */ +
-            1 /* is permanent flag */ +
-            2 /* name utf-8 string size */ + strUTF8Name.size() +
-            2 /* topic utf-8 string size */ + strUTF8Topic.size() +
-            2 /* city utf-8 string size */ + strUTF8City.size();
+void CProtocol::PatchCLServerListEntryAddress ( CVector<uint8_t>&   vecData,
+                                                const int           iEntryPos,
+                                                const CHostAddress& HostAddr )
+{
+    // the address is at the beginning of each entry and has a fixed size
+    int iPos = iEntryPos;
 
-        // make space for new data
-        vecData.Enlarge ( iCurListEntrLen );
+    // IP address (4 bytes)
+    PutValOnStream ( vecData, iPos, static_cast<uint32_t> (
+        HostAddr.InetAddr.toIPv4Address() ), 4 );
 
-        // IP address (4 bytes)
-        PutValOnStream ( vecData, iPos, static_cast<uint32_t> (
-            vecServerInfo[i].HostAddr.InetAddr.toIPv4Address() ), 4 );
+    // port number (2 bytes)
+    PutValOnStream ( vecData, iPos,
+        static_cast<uint32_t> ( HostAddr.iPort ), 2 );
+}
 
-        // port number (2 bytes)
-        PutValOnStream ( vecData, iPos,
-            static_cast<uint32_t> ( vecServerInfo[i].HostAddr.iPort ), 2 );
+bool CProtocol::EvaluateCLServerListMes ( const CHostAddress&     InetAddr,
+                                          const CVector<uint8_t>& vecData )
+{
+    int                  iPos     = 0; // init position pointer
+    const int            iDataLen = vecData.Size();
+    CVector<CServerInfo> vecServerInfo ( 0 );
 
-        // country (2 bytes)
-        PutValOnStream ( vecData, iPos,
-            static_cast<uint32_t> ( vecServerInfo[i].eCountry ), 2 );
+    while ( iPos < iDataLen )
+    {
+        CServerInfo CurServerInfo;
 
-        // maximum number of connected clients (1 byte)
-        PutValOnStream ( vecData, iPos,
-            static_cast<uint32_t> ( vecServerInfo[i].iMaxNumClients ), 1 );
+        if ( GetServerInfoFromStream ( vecData, iPos, CurServerInfo ) )
+        {
+            return true; // return error code
+        }
 
-        // "is permanent" flag (1 byte)
-        PutValOnStream ( vecData, iPos,
-            static_cast<uint32_t> ( vecServerInfo[i].bPermanentOnline ), 1 );
+        // add server information to vector
+        vecServerInfo.Add ( CurServerInfo );
+    }
 
-        // name
-        PutStringUTF8OnStream ( vecData, iPos, strUTF8Name );
+    // check size: all data is read, the position must now be at the end
+    if ( iPos != iDataLen )
+    {
+        return true; // return error code
+    }
 
-        // topic
-        PutStringUTF8OnStream ( vecData, iPos, strUTF8Topic );
+    // invoke message action
+    emit CLServerListReceived ( InetAddr, vecServerInfo );
 
-        // city
-        PutStringUTF8OnStream ( vecData, iPos, strUTF8City );
-    }
+    return false; // no error
+}
 
-    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_SERVER_LIST,
-                                     vecData,
-                                     InetAddr );
+void CProtocol::CreateCLServerListFragmentMes ( const CHostAddress&         InetAddr,
+                                                const int                   iListVersion,
+                                                const CVector<CServerInfo>& vecServerInfo )
+{
+    CVector<CVector<uint8_t> > vecvecData;
+    CVector<int>               veciEntryFrag;
+    CVector<int>               veciEntryPos;
+
+    PrepareCLServerListFragmentMes ( iListVersion,
+                                     vecServerInfo,
+                                     vecvecData,
+                                     veciEntryFrag,
+                                     veciEntryPos );
+
+    for ( int iFrag = 0; iFrag < vecvecData.Size(); iFrag++ )
+    {
+        CreatePreparedCLServerListFragmentMes ( InetAddr, vecvecData[iFrag] );
+    }
 }
 
-bool CProtocol::EvaluateCLServerListMes ( const CHostAddress&     InetAddr,
-                                          const CVector<uint8_t>& vecData )
+void CProtocol::PrepareCLServerListFragmentMes ( const int                   iListVersion,
+                                                 const CVector<CServerInfo>& vecServerInfo,
+                                                 CVector<CVector<uint8_t> >& vecvecData,
+                                                 CVector<int>&               veciEntryFrag,
+                                                 CVector<int>&               veciEntryPos )
 {
-    int                  iPos     = 0; // init position pointer
-    const int            iDataLen = vecData.Size();
-    CVector<CServerInfo> vecServerInfo ( 0 );
+    const int iNumServers = vecServerInfo.Size();
 
-    while ( iPos < iDataLen )
+    // serialize all entries and store the start position of each entry
+    CVector<uint8_t> vecEntries;
+    CVector<int>     veciEntryStart;
+
+    PrepareCLServerListMes ( vecServerInfo, vecEntries, veciEntryStart );
+    veciEntryStart.Add ( vecEntries.Size() );
+
+    // split the entries in fragments (an entry is never split, an empty list
+    // is sent as one empty fragment)
+    CVector<int> veciFragFirstEntry ( 1, 0 );
+
+    for ( int i = 1; i < iNumServers; i++ )
     {
-        // check size (the next 10 bytes)
-        if ( ( iDataLen - iPos ) < 10 )
+        if ( veciEntryStart[i + 1] - veciEntryStart[veciFragFirstEntry.back()] >
+             PROT_SERVER_LIST_FRAG_MAX_SIZE_BYTES )
         {
-            return true; // return error code
+            veciFragFirstEntry.Add ( i );
         }
+    }
 
-        // IP address (4 bytes)
-        const quint32 iIpAddr =
-            static_cast<int> ( GetValFromStream ( vecData, iPos, 4 ) );
+    const int iNumFrags = veciFragFirstEntry.Size();
 
-        // port number (2 bytes)
-        const quint16 iPort =
-            static_cast<int> ( GetValFromStream ( vecData, iPos, 2 ) );
+    veciFragFirstEntry.Add ( iNumServers );
 
-        // country (2 bytes)
-        const QLocale::Country eCountry =
-            static_cast<QLocale::Country> ( GetValFromStream ( vecData, iPos, 2 ) );
+    // build the fragments
+    vecvecData.Init ( iNumFrags );
+    veciEntryFrag.Init ( iNumServers );
+    veciEntryPos.Init ( iNumServers );
 
-        // maximum number of connected clients (1 byte)
-        const int iMaxNumClients =
-            static_cast<int> ( GetValFromStream ( vecData, iPos, 1 ) );
+    for ( int iFrag = 0; iFrag < iNumFrags; iFrag++ )
+    {
+        const int iStart = veciEntryStart[veciFragFirstEntry[iFrag]];
+        const int iEnd   = veciEntryStart[veciFragFirstEntry[iFrag + 1]];
+        int       iPos   = 0; // init position pointer
 
-        // "is permanent" flag (1 byte)
-        const bool bPermanentOnline =
-            static_cast<bool> ( GetValFromStream ( vecData, iPos, 1 ) );
+        vecvecData[iFrag].Init ( 6 /* header */ + iEnd - iStart );
 
-        // server name
-        QString strName;
-        if ( GetStringFromStream ( vecData,
-                                   iPos,
-                                   MAX_LEN_SERVER_NAME,
-                                   strName ) )
+        // list version (2 bytes)
+        PutValOnStream ( vecvecData[iFrag], iPos,
+            static_cast<uint32_t> ( iListVersion ), 2 );
+
+        // fragment index (2 bytes)
+        PutValOnStream ( vecvecData[iFrag], iPos,
+            static_cast<uint32_t> ( iFrag ), 2 );
+
+        // number of fragments (2 bytes)
+        PutValOnStream ( vecvecData[iFrag], iPos,
+            static_cast<uint32_t> ( iNumFrags ), 2 );
+
+        // server list entries
+        if ( iEnd > iStart )
         {
-            return true; // return error code
+            memcpy ( &vecvecData[iFrag][iPos], &vecEntries[iStart], iEnd - iStart );
         }
 
-        // server topic
-        QString strTopic;
-        if ( GetStringFromStream ( vecData,
-                                   iPos,
-                                   MAX_LEN_SERVER_TOPIC,
-                                   strTopic ) )
+        // store the position of each entry in the fragment
+        for ( int i = veciFragFirstEntry[iFrag]; i < veciFragFirstEntry[iFrag + 1]; i++ )
         {
-            return true; // return error code
+            veciEntryFrag[i] = iFrag;
+            veciEntryPos[i]  = iPos + veciEntryStart[i] - iStart;
         }
+    }
+}
 
-        // server city
-        QString strCity;
-        if ( GetStringFromStream ( vecData,
-                                   iPos,
-                                   MAX_LEN_SERVER_CITY,
-                                   strCity ) )
+bool CProtocol::EvaluateCLServerListFragmentMes ( const CHostAddress&     InetAddr,
+                                                  const CVector<uint8_t>& vecData )
+{
+    int                  iPos     = 0; // init position pointer
+    const int            iDataLen = vecData.Size();
+    CVector<CServerInfo> vecServerInfo ( 0 );
+
+    // check size (the header with 6 bytes)
+    if ( iDataLen < 6 )
+    {
+        return true; // return error code
+    }
+
+    // list version (2 bytes)
+    const int iListVersion =
+        static_cast<int> ( GetValFromStream ( vecData, iPos, 2 ) );
+
+    // fragment index (2 bytes)
+    const int iFrag =
+        static_cast<int> ( GetValFromStream ( vecData, iPos, 2 ) );
+
+    // number of fragments (2 bytes)
+    const int iNumFrags =
+        static_cast<int> ( GetValFromStream ( vecData, iPos, 2 ) );
+
+    if ( ( iNumFrags < 1 ) ||
+         ( iNumFrags > PROT_SERVER_LIST_MAX_NUM_FRAGS ) ||
+         ( iFrag >= iNumFrags ) )
+    {
+        return true; // return error code
+    }
+
+    while ( iPos < iDataLen )
+    {
+        CServerInfo CurServerInfo;
+
+        if ( GetServerInfoFromStream ( vecData, iPos, CurServerInfo ) )
         {
             return true; // return error code
         }
 
         // add server information to vector
-        vecServerInfo.Add (
-            CServerInfo ( CHostAddress ( QHostAddress ( iIpAddr ), iPort ),
-                          iPort,
-                          strName,
-                          strTopic,
-                          eCountry,
-                          strCity,
-                          iMaxNumClients,
-                          bPermanentOnline ) );
+        vecServerInfo.Add ( CurServerInfo );
     }
 
     // check size: all data is read, the position must now be at the end
@@ -1713,23 +2613,82 @@ bool CProtocol::EvaluateCLServerListMes ( const CHostAddress&     InetAddr,
         return true; // return error code
     }
 
-    // invoke message action
-    emit CLServerListReceived ( InetAddr, vecServerInfo );
+    // a fragment of a new list (or of a new version of the list) resets the
+    // collected fragments
+    if ( !( ServerListFragHostAddr == InetAddr ) ||
+         ( iServerListFragVersion != iListVersion ) ||
+         ( vecvecServerListFrag.Size() != iNumFrags ) )
+    {
+        ServerListFragHostAddr     = InetAddr;
+        iServerListFragVersion     = iListVersion;
+        iServerListFragNumReceived = 0;
+        vecvecServerListFrag.Init ( iNumFrags );
+        veciServerListFragReceived.Init ( iNumFrags, 0 );
+    }
+
+    // store the fragment (a fragment which was received twice is ignored)
+    if ( !veciServerListFragReceived[iFrag] )
+    {
+        vecvecServerListFrag[iFrag].swap ( vecServerInfo );
+        veciServerListFragReceived[iFrag] = 1;
+        iServerListFragNumReceived++;
+    }
+
+    if ( iServerListFragNumReceived == iNumFrags )
+    {
+        // all fragments are received, combine them to the complete list
+        CVector<CServerInfo> vecCompleteServerInfo ( 0 );
+
+        for ( int i = 0; i < iNumFrags; i++ )
+        {
+            vecCompleteServerInfo.insert ( vecCompleteServerInfo.end(),
+                                           vecvecServerListFrag[i].begin(),
+                                           vecvecServerListFrag[i].end() );
+        }
+
+        // reset the collected fragments
+        vecvecServerListFrag.Init ( 0 );
+        veciServerListFragReceived.Init ( 0 );
+        iServerListFragNumReceived = 0;
+
+        // invoke message action
+        emit CLServerListReceived ( InetAddr, vecCompleteServerInfo );
+    }
 
     return false; // no error
 }
 
 void CProtocol::CreateCLReqServerListMes ( const CHostAddress& InetAddr )
 {
+    int iPos = 0; // init position pointer
+
+    // build data vector (old servers ignore the data of this message)
+    CVector<uint8_t> vecData ( 1 );
+
+    // fragments supported (1 byte)
+    PutValOnStream ( vecData, iPos, static_cast<uint32_t> ( 1 ), 1 );
+
     CreateAndImmSendConLessMessage ( PROTMESSID_CLM_REQ_SERVER_LIST,
-                                     CVector<uint8_t> ( 0 ),
+                                     vecData,
                                      InetAddr );
 }
 
-bool CProtocol::EvaluateCLReqServerListMes ( const CHostAddress& InetAddr )
+bool CProtocol::EvaluateCLReqServerListMes ( const CHostAddress&     InetAddr,
+                                             const CVector<uint8_t>& vecData )
 {
+    int  iPos                = 0; // init position pointer
+    bool bFragmentsSupported = false;
+
+    // the fragments supported flag is optional (old clients do not send any
+    // data with this message)
+    if ( vecData.Size() >= 1 )
+    {
+        bFragmentsSupported =
+            static_cast<bool> ( GetValFromStream ( vecData, iPos, 1 ) );
+    }
+
     // invoke message action
-    emit CLReqServerList ( InetAddr );
+    emit CLReqServerList ( InetAddr, bFragmentsSupported );
 
     return false; // no error
 }
@@ -1737,18 +2696,15 @@ bool CProtocol::EvaluateCLReqServerListMes ( const CHostAddress& InetAddr )
 void CProtocol::CreateCLSendEmptyMesMes ( const CHostAddress& InetAddr,
                                           const CHostAddress& TargetInetAddr )
 {
-    int iPos = 0; // init position pointer
-
-    // build data vector (6 bytes long)
-    CVector<uint8_t> vecData ( 6 );
+    CVector<uint8_t>                           vecData;
+    CProtMessWriter<CProtSchemaCLSendEmptyMes> Mes ( vecData );
 
     // IP address (4 bytes)
-    PutValOnStream ( vecData, iPos, static_cast<uint32_t> (
-        TargetInetAddr.InetAddr.toIPv4Address() ), 4 );
+    Mes.Set<0> ( static_cast<uint32_t> (
+        TargetInetAddr.InetAddr.toIPv4Address() ) );
 
     // port number (2 bytes)
-    PutValOnStream ( vecData, iPos,
-        static_cast<uint32_t> ( TargetInetAddr.iPort ), 2 );
+    Mes.Set<1> ( static_cast<uint32_t> ( TargetInetAddr.iPort ) );
 
     CreateAndImmSendConLessMessage ( PROTMESSID_CLM_SEND_EMPTY_MESSAGE,
                                      vecData,
@@ -1757,21 +2713,19 @@ void CProtocol::CreateCLSendEmptyMesMes ( const CHostAddress& InetAddr,
 
 bool CProtocol::EvaluateCLSendEmptyMesMes ( const CVector<uint8_t>& vecData )
 {
-    int iPos = 0; // init position pointer
+    CProtMessView<CProtSchemaCLSendEmptyMes> Mes;
 
     // check size
-    if ( vecData.Size() != 6 )
+    if ( Mes.Parse ( vecData ) )
     {
         return true; // return error code
     }
 
     // IP address (4 bytes)
-    const quint32 iIpAddr =
-        static_cast<int> ( GetValFromStream ( vecData, iPos, 4 ) );
+    const quint32 iIpAddr = static_cast<quint32> ( Mes.Get<0>() );
 
     // port number (2 bytes)
-    const quint16 iPort =
-        static_cast<int> ( GetValFromStream ( vecData, iPos, 2 ) );
+    const quint16 iPort = static_cast<quint16> ( Mes.Get<1>() );
 
     // invoke message action
     emit CLSendEmptyMes ( CHostAddress ( QHostAddress ( iIpAddr ), iPort ) );
@@ -1810,78 +2764,405 @@ void CProtocol::CreateCLVersionAndOSMes ( const CHostAddress& InetAddr )
     // get the version number string
     const QString strVerion = VERSION;
 
-    // convert version string to utf-8
-    const QByteArray strUTF8Version = strVerion.toUtf8();
+    // convert version string to utf-8
+    const QByteArray strUTF8Version = strVerion.toUtf8();
+
+    // size of current message body
+    const int iEntrLen =
+        1 /* operating system */ +
+        2 /* version utf-8 string size */ + strUTF8Version.size();
+
+    // build data vector
+    CVector<uint8_t> vecData ( iEntrLen );
+
+    // operating system (1 byte)
+    PutValOnStream ( vecData, iPos,
+        static_cast<uint32_t> ( COSUtil::GetOperatingSystem() ), 1 );
+
+    // version
+    PutStringUTF8OnStream ( vecData, iPos, strUTF8Version );
+
+    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_VERSION_AND_OS,
+                                     vecData,
+                                     InetAddr );
+}
+
+bool CProtocol::EvaluateCLVersionAndOSMes ( const CHostAddress&     InetAddr,
+                                            const CVector<uint8_t>& vecData )
+{
+    int       iPos = 0; // init position pointer
+    const int iDataLen = vecData.Size();
+
+    // check size (the first 1 byte)
+    if ( iDataLen < 1 )
+    {
+        return true; // return error code
+    }
+
+    // operating system (1 byte)
+    const COSUtil::EOpSystemType eOSType =
+        static_cast<COSUtil::EOpSystemType> ( GetValFromStream ( vecData, iPos, 1 ) );
+
+    // version text
+    QString strVersion;
+    if ( GetStringFromStream ( vecData,
+                               iPos,
+                               MAX_LEN_VERSION_TEXT,
+                               strVersion ) )
+    {
+        return true; // return error code
+    }
+
+    // check size: all data is read, the position must now be at the end
+    if ( iPos != iDataLen )
+    {
+        return true; // return error code
+    }
+
+    // invoke message action
+    emit CLVersionAndOSReceived ( InetAddr, eOSType, strVersion );
+
+    return false; // no error
+}
+
+void CProtocol::CreateCLReqVersionAndOSMes ( const CHostAddress& InetAddr )
+{
+    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_REQ_VERSION_AND_OS,
+                                     CVector<uint8_t> ( 0 ),
+                                     InetAddr );
+}
+
+bool CProtocol::EvaluateCLReqVersionAndOSMes ( const CHostAddress& InetAddr )
+{
+    // invoke message action
+    emit CLReqVersionAndOS ( InetAddr );
+
+    return false; // no error
+}
+
+void CProtocol::CreateCLConnChallengeMes ( const CHostAddress& InetAddr,
+                                           const uint32_t      iCookie )
+{
+    CVector<uint8_t>                            vecData;
+    CProtMessWriter<CProtSchemaCLConnChallenge> Mes ( vecData );
+
+    // cookie (4 bytes)
+    Mes.Set<0> ( iCookie );
+
+    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_CONN_CHALLENGE,
+                                     vecData,
+                                     InetAddr );
+}
+
+bool CProtocol::EvaluateCLConnChallengeMes ( const CHostAddress&     InetAddr,
+                                             const CVector<uint8_t>& vecData )
+{
+    CProtMessView<CProtSchemaCLConnChallenge> Mes;
+
+    // check size
+    if ( Mes.Parse ( vecData ) )
+    {
+        return true; // return error code
+    }
+
+    // invoke message action
+    emit CLConnChallengeReceived ( InetAddr, Mes.Get<0>() );
+
+    return false; // no error
+}
+
+void CProtocol::CreateCLConnChallengeRespMes ( const CHostAddress& InetAddr,
+                                               const uint32_t      iCookie )
+{
+    CVector<uint8_t>                            vecData;
+    CProtMessWriter<CProtSchemaCLConnChallenge> Mes ( vecData );
+
+    // cookie of the challenge (4 bytes)
+    Mes.Set<0> ( iCookie );
+
+    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_CONN_CHALLENGE_RESP,
+                                     vecData,
+                                     InetAddr );
+}
+
+bool CProtocol::EvaluateCLConnChallengeRespMes ( const CHostAddress&     InetAddr,
+                                                 const CVector<uint8_t>& vecData )
+{
+    CProtMessView<CProtSchemaCLConnChallenge> Mes;
+
+    // check size
+    if ( Mes.Parse ( vecData ) )
+    {
+        return true; // return error code
+    }
+
+    // invoke message action
+    emit CLConnChallengeRespReceived ( InetAddr, Mes.Get<0>() );
+
+    return false; // no error
+}
+
+void CProtocol::CreateCLServerLoadMes ( const CHostAddress& InetAddr,
+                                        const int           iNumClients,
+                                        const int           iTickHeadroom,
+                                        const QString&      strGroup )
+{
+    int iPos = 0; // init position pointer
+
+    // convert group name string to utf-8
+    const QByteArray strUTF8Group = strGroup.toUtf8();
+
+    // size of current message body
+    const int iEntrLen =
+        1 /* number of connected clients */ +
+        1 /* tick headroom */ +
+        2 /* group name utf-8 string size */ + strUTF8Group.size();
+
+    // build data vector
+    CVector<uint8_t> vecData ( iEntrLen );
+
+    // number of connected clients (1 byte)
+    PutValOnStream ( vecData, iPos,
+        static_cast<uint32_t> ( iNumClients ), 1 );
+
+    // tick headroom in percent (1 byte)
+    PutValOnStream ( vecData, iPos,
+        static_cast<uint32_t> ( iTickHeadroom ), 1 );
+
+    // group name
+    PutStringUTF8OnStream ( vecData, iPos, strUTF8Group );
+
+    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_SERVER_LOAD,
+                                     vecData,
+                                     InetAddr );
+}
+
+bool CProtocol::EvaluateCLServerLoadMes ( const CHostAddress&     InetAddr,
+                                          const CVector<uint8_t>& vecData )
+{
+    int       iPos     = 0; // init position pointer
+    const int iDataLen = vecData.Size();
+    QString   strGroup;
+
+    // check size (the first 2 bytes)
+    if ( iDataLen < 2 )
+    {
+        return true; // return error code
+    }
+
+    // number of connected clients (1 byte)
+    const int iNumClients =
+        static_cast<int> ( GetValFromStream ( vecData, iPos, 1 ) );
+
+    // tick headroom in percent (1 byte)
+    const int iTickHeadroom =
+        static_cast<int> ( GetValFromStream ( vecData, iPos, 1 ) );
+
+    if ( iTickHeadroom > 100 )
+    {
+        return true; // return error code
+    }
+
+    // group name
+    if ( GetStringFromStream ( vecData,
+                               iPos,
+                               MAX_LEN_SERVER_GROUP,
+                               strGroup ) )
+    {
+        return true; // return error code
+    }
+
+    // check size: all data is read, the position must now be at the end
+    if ( iPos != iDataLen )
+    {
+        return true; // return error code
+    }
+
+    // invoke message action
+    emit CLServerLoadReceived ( InetAddr, iNumClients, iTickHeadroom, strGroup );
+
+    return false; // no error
+}
+
+void CProtocol::CreateCLReqGroupServerMes ( const CHostAddress& InetAddr,
+                                            const QString&      strGroup,
+                                            const int           iNumClients )
+{
+    int iPos = 0; // init position pointer
+
+    // convert group name string to utf-8
+    const QByteArray strUTF8Group = strGroup.toUtf8();
+
+    // size of current message body
+    const int iEntrLen =
+        2 /* group name utf-8 string size */ + strUTF8Group.size() +
+        1 /* number of clients */;
+
+    // build data vector
+    CVector<uint8_t> vecData ( iEntrLen );
+
+    // group name
+    PutStringUTF8OnStream ( vecData, iPos, strUTF8Group );
+
+    // number of clients which shall join (1 byte)
+    PutValOnStream ( vecData, iPos,
+        static_cast<uint32_t> ( iNumClients ), 1 );
+
+    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_REQ_GROUP_SERVER,
+                                     vecData,
+                                     InetAddr );
+}
+
+bool CProtocol::EvaluateCLReqGroupServerMes ( const CHostAddress&     InetAddr,
+                                              const CVector<uint8_t>& vecData )
+{
+    int       iPos     = 0; // init position pointer
+    const int iDataLen = vecData.Size();
+    QString   strGroup;
+
+    // group name
+    if ( GetStringFromStream ( vecData,
+                               iPos,
+                               MAX_LEN_SERVER_GROUP,
+                               strGroup ) )
+    {
+        return true; // return error code
+    }
+
+    // check size: exactly one byte must be left
+    if ( iPos + 1 != iDataLen )
+    {
+        return true; // return error code
+    }
+
+    // number of clients which shall join (1 byte)
+    const int iNumClients =
+        static_cast<int> ( GetValFromStream ( vecData, iPos, 1 ) );
+
+    // invoke message action
+    emit CLReqGroupServer ( InetAddr, strGroup, iNumClients );
+
+    return false; // no error
+}
+
+void CProtocol::CreateCLGroupServerMes ( const CHostAddress& InetAddr,
+                                         const CHostAddress& ServerInetAddr )
+{
+    CVector<uint8_t>                          vecData;
+    CProtMessWriter<CProtSchemaCLGroupServer> Mes ( vecData );
+
+    // IP address (4 bytes)
+    Mes.Set<0> ( static_cast<uint32_t> (
+        ServerInetAddr.InetAddr.toIPv4Address() ) );
+
+    // port number (2 bytes)
+    Mes.Set<1> ( static_cast<uint32_t> ( ServerInetAddr.iPort ) );
+
+    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_GROUP_SERVER,
+                                     vecData,
+                                     InetAddr );
+}
+
+bool CProtocol::EvaluateCLGroupServerMes ( const CHostAddress&     InetAddr,
+                                           const CVector<uint8_t>& vecData )
+{
+    CProtMessView<CProtSchemaCLGroupServer> Mes;
+
+    // check size
+    if ( Mes.Parse ( vecData ) )
+    {
+        return true; // return error code
+    }
+
+    // IP address (4 bytes)
+    const quint32 iIpAddr = static_cast<quint32> ( Mes.Get<0>() );
+
+    // port number (2 bytes)
+    const quint16 iPort = static_cast<quint16> ( Mes.Get<1>() );
+
+    // invoke message action
+    emit CLGroupServerReceived ( InetAddr,
+                                 CHostAddress ( QHostAddress ( iIpAddr ), iPort ) );
+
+    return false; // no error
+}
+
+void CProtocol::CreateCLReqListenMes ( const CHostAddress& InetAddr,
+                                       const uint32_t      iCookie,
+                                       const EAudComprType eAudComprType,
+                                       const int           iNumAudioChannels,
+                                       const int           iNetwFrameSize,
+                                       const int           iFrameSizeSamples )
+{
+    CVector<uint8_t>                        vecData;
+    CProtMessWriter<CProtSchemaCLReqListen> Mes ( vecData );
 
-    // size of current message body
-    const int iEntrLen =
-        1 /* operating system */ +
-        2 /* version utf-8 string size */ + strUTF8Version.size();
+    // cookie of the last challenge (4 bytes)
+    Mes.Set<0> ( iCookie );
 
-    // build data vector
-    CVector<uint8_t> vecData ( iEntrLen );
+    // audio coding type (2 bytes)
+    Mes.Set<1> ( static_cast<uint32_t> ( eAudComprType ) );
 
-    // operating system (1 byte)
-    PutValOnStream ( vecData, iPos,
-        static_cast<uint32_t> ( COSUtil::GetOperatingSystem() ), 1 );
+    // number of audio channels (1 byte)
+    Mes.Set<2> ( static_cast<uint32_t> ( iNumAudioChannels ) );
 
-    // version
-    PutStringUTF8OnStream ( vecData, iPos, strUTF8Version );
+    // network frame size (2 bytes)
+    Mes.Set<3> ( static_cast<uint32_t> ( iNetwFrameSize ) );
 
-    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_VERSION_AND_OS,
+    // audio frame size in samples (2 bytes)
+    Mes.Set<4> ( static_cast<uint32_t> ( iFrameSizeSamples ) );
+
+    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_REQ_LISTEN,
                                      vecData,
                                      InetAddr );
 }
 
-bool CProtocol::EvaluateCLVersionAndOSMes ( const CHostAddress&     InetAddr,
-                                            const CVector<uint8_t>& vecData )
+bool CProtocol::EvaluateCLReqListenMes ( const CHostAddress&     InetAddr,
+                                         const CVector<uint8_t>& vecData )
 {
-    int       iPos = 0; // init position pointer
-    const int iDataLen = vecData.Size();
+    CProtMessView<CProtSchemaCLReqListen> Mes;
 
-    // check size (the first 1 byte)
-    if ( iDataLen < 1 )
+    // check size
+    if ( Mes.Parse ( vecData ) )
     {
         return true; // return error code
     }
 
-    // operating system (1 byte)
-    const COSUtil::EOpSystemType eOSType =
-        static_cast<COSUtil::EOpSystemType> ( GetValFromStream ( vecData, iPos, 1 ) );
+    // cookie of the last challenge (4 bytes)
+    const quint32 iCookie = static_cast<quint32> ( Mes.Get<0>() );
 
-    // version text
-    QString strVersion;
-    if ( GetStringFromStream ( vecData,
-                               iPos,
-                               MAX_LEN_VERSION_TEXT,
-                               strVersion ) )
+    // audio coding type (2 bytes), the listener gets OPUS or uncompressed
+    // audio
+    const int iAudComprType = static_cast<int> ( Mes.Get<1>() );
+
+    if ( ( iAudComprType != CT_OPUS ) &&
+         ( iAudComprType != CT_PCM ) )
     {
         return true; // return error code
     }
 
-    // check size: all data is read, the position must now be at the end
-    if ( iPos != iDataLen )
+    // number of audio channels (1 byte)
+    const int iNumAudioChannels = static_cast<int> ( Mes.Get<2>() );
+
+    if ( ( iNumAudioChannels != 1 ) &&
+         ( iNumAudioChannels != 2 ) )
     {
         return true; // return error code
     }
 
-    // invoke message action
-    emit CLVersionAndOSReceived ( InetAddr, eOSType, strVersion );
-
-    return false; // no error
-}
+    // network frame size (2 bytes)
+    const int iNetwFrameSize = static_cast<int> ( Mes.Get<3>() );
 
-void CProtocol::CreateCLReqVersionAndOSMes ( const CHostAddress& InetAddr )
-{
-    CreateAndImmSendConLessMessage ( PROTMESSID_CLM_REQ_VERSION_AND_OS,
-                                     CVector<uint8_t> ( 0 ),
-                                     InetAddr );
-}
+    // audio frame size in samples (2 bytes)
+    const int iFrameSizeSamples = static_cast<int> ( Mes.Get<4>() );
 
-bool CProtocol::EvaluateCLReqVersionAndOSMes ( const CHostAddress& InetAddr )
-{
     // invoke message action
-    emit CLReqVersionAndOS ( InetAddr );
+    emit CLReqListen ( InetAddr,
+                       iCookie,
+                       iAudComprType,
+                       iNumAudioChannels,
+                       iNetwFrameSize,
+                       iFrameSizeSamples );
 
     return false; // no error
 }
@@ -1890,13 +3171,16 @@ bool CProtocol::EvaluateCLReqVersionAndOSMes ( const CHostAddress& InetAddr )
 /******************************************************************************\
 * Message generation and parsing                                               *
 \******************************************************************************/
-bool CProtocol::ParseMessageFrame ( const CVector<uint8_t>& vecbyData,
+bool CProtocol::CheckMessageFrame ( const CVector<uint8_t>& vecbyData,
                                     const int               iNumBytesIn,
-                                    CVector<uint8_t>&       vecbyMesBodyData,
                                     int&                    iCnt,
-                                    int&                    iID )
+                                    int&                    iID,
+                                    int&                    iLenBy )
 {
-    int i;
+/*
+    note: this function does not allocate any memory since it is called in the
+    real-time network receive thread to classify the incoming packets
+*/
     int iCurPos;
 
     // vector must be at least "MESS_LEN_WITHOUT_DATA_BYTE" bytes long
@@ -1925,7 +3209,7 @@ bool CProtocol::ParseMessageFrame ( const CVector<uint8_t>& vecbyData,
     iCnt = static_cast<int> ( GetValFromStream ( vecbyData, iCurPos, 1 ) );
 
     // 2 bytes length
-    const int iLenBy = static_cast<int> ( GetValFromStream ( vecbyData, iCurPos, 2 ) );
+    iLenBy = static_cast<int> ( GetValFromStream ( vecbyData, iCurPos, 2 ) );
 
     // make sure the length is correct
     if ( iLenBy != iNumBytesIn - MESS_LEN_WITHOUT_DATA_BYTE )
@@ -1939,28 +3223,49 @@ bool CProtocol::ParseMessageFrame ( const CVector<uint8_t>& vecbyData,
 
     const int iLenCRCCalc = MESS_HEADER_LENGTH_BYTE + iLenBy;
 
-    iCurPos = 0; // start from the beginning
+    // the CRC is calculated over the header and the data
+    CRCObj.AddBytes ( &vecbyData.front(), iLenCRCCalc );
 
-    for ( i = 0; i < iLenCRCCalc; i++ )
-    {
-        CRCObj.AddByte ( static_cast<uint8_t> ( 
-            GetValFromStream ( vecbyData, iCurPos, 1 ) ) );
-    }
+    iCurPos = iLenCRCCalc; // the CRC follows the data
 
     if ( CRCObj.GetCRC () != GetValFromStream ( vecbyData, iCurPos, 2 ) )
     {
         return true; // return error code
     }
 
+    return false; // no error
+}
+
+bool CProtocol::IsProtocolMessage ( const CVector<uint8_t>& vecbyData,
+                                    const int               iNumBytesIn )
+{
+    int iCnt;
+    int iID;
+    int iLenBy;
 
-    // Extract actual data -----------------------------------------------------
+    return !CheckMessageFrame ( vecbyData, iNumBytesIn, iCnt, iID, iLenBy );
+}
+
+bool CProtocol::ParseMessageFrame ( const CVector<uint8_t>& vecbyData,
+                                    const int               iNumBytesIn,
+                                    CVector<uint8_t>&       vecbyMesBodyData,
+                                    int&                    iCnt,
+                                    int&                    iID )
+{
+    int i;
+    int iLenBy;
+
+    // check the header and the CRC of the message frame
+    if ( CheckMessageFrame ( vecbyData, iNumBytesIn, iCnt, iID, iLenBy ) )
+    {
+        return true; // return error code
+    }
 
-// TODO this memory allocation is done in the real time thread but should be
-//      done in the low prioirity protocol management thread
 
+    // Extract actual data -----------------------------------------------------
     vecbyMesBodyData.Init ( iLenBy );
 
-    iCurPos = MESS_HEADER_LENGTH_BYTE; // start from beginning of data
+    int iCurPos = MESS_HEADER_LENGTH_BYTE; // start from beginning of data
 
     for ( i = 0; i < iLenBy; i++ )
     {
@@ -1971,6 +3276,48 @@ bool CProtocol::ParseMessageFrame ( const CVector<uint8_t>& vecbyData,
     return false; // no error
 }
 
+bool CProtocol::GetContainedMessage ( const CVector<uint8_t>& vecbyContainerData,
+                                      int&                    iPos,
+                                      CVector<uint8_t>&       vecbyMesBodyData,
+                                      int&                    iRecCounter,
+                                      int&                    iRecID )
+{
+/*
+    note: iPos is automatically incremented in this function, the return value
+    is true if no further message is available in the container
+*/
+    const int iContainerLen = vecbyContainerData.Size();
+
+    // check that the header of the contained message is available
+    if ( iPos + PROT_CONTAINER_MESS_OVERHEAD > iContainerLen )
+    {
+        return true; // return error code
+    }
+
+    iRecID      = static_cast<int> ( GetValFromStream ( vecbyContainerData, iPos, 2 ) );
+    iRecCounter = static_cast<int> ( GetValFromStream ( vecbyContainerData, iPos, 1 ) );
+
+    const int iLenBy = static_cast<int> ( GetValFromStream ( vecbyContainerData, iPos, 2 ) );
+
+    // a container must not contain connection less messages or containers
+    if ( ( iPos + iLenBy > iContainerLen ) ||
+         IsConnectionLessMessageID ( iRecID ) ||
+         ( iRecID == PROTMESSID_MESS_CONTAINER ) )
+    {
+        return true; // return error code
+    }
+
+    vecbyMesBodyData.Init ( iLenBy );
+
+    for ( int i = 0; i < iLenBy; i++ )
+    {
+        vecbyMesBodyData[i] = static_cast<uint8_t> (
+            GetValFromStream ( vecbyContainerData, iPos, 1 ) );
+    }
+
+    return false; // no error
+}
+
 uint32_t CProtocol::GetValFromStream ( const CVector<uint8_t>& vecIn,
                                        int&                    iPos,
                                        const int               iNumOfBytes )
@@ -2087,15 +3434,12 @@ void CProtocol::GenMessageFrame ( CVector<uint8_t>&       vecOut,
     // Encode CRC --------------------------------------------------------------
     CCRC CRCObj;
 
-    iCurPos = 0; // start from beginning
-
     const int iLenCRCCalc = MESS_HEADER_LENGTH_BYTE + iDataLenByte;
 
-    for ( i = 0; i < iLenCRCCalc; i++ )
-    {
-        CRCObj.AddByte ( static_cast<uint8_t> ( 
-            GetValFromStream ( vecOut, iCurPos, 1 ) ) );
-    }
+    // the CRC is calculated over the header and the data
+    CRCObj.AddBytes ( &vecOut[0], iLenCRCCalc );
+
+    iCurPos = iLenCRCCalc; // the CRC follows the data
 
     PutValOnStream ( vecOut, iCurPos,
         static_cast<uint32_t> ( CRCObj.GetCRC() ), 2 );
@@ -2141,3 +3485,235 @@ void CProtocol::PutStringUTF8OnStream ( CVector<uint8_t>& vecIn,
             static_cast<uint32_t> ( sStringUTF8[j] ), 1 );
     }
 }
+
+void CProtocol::PutChanInfoOnStream ( CVector<uint8_t>&   vecIn,
+                                      int&                iPos,
+                                      const CChannelInfo& ChanInfo )
+{
+    // convert strings to utf-8
+    const QByteArray strUTF8Name = ChanInfo.strName.toUtf8();
+    const QByteArray strUTF8City = ChanInfo.strCity.toUtf8();
+
+    // size of current list entry
+    const int iCurListEntrLen =
+        1 /* chan ID */ + 2 /* country */ +
+        4 /* instrument */ + 1 /* skill level */ +
+        4 /* IP address */ +
+        2 /* utf-8 str. size */ + strUTF8Name.size() +
+        2 /* utf-8 str. size */ + strUTF8City.size();
+
+    // make space for new data
+    vecIn.Enlarge ( iCurListEntrLen );
+
+    // channel ID (1 byte)
+    PutValOnStream ( vecIn, iPos,
+        static_cast<uint32_t> ( ChanInfo.iChanID ), 1 );
+
+    // country (2 bytes)
+    PutValOnStream ( vecIn, iPos,
+        static_cast<uint32_t> ( ChanInfo.eCountry ), 2 );
+
+    // instrument (4 bytes)
+    PutValOnStream ( vecIn, iPos,
+        static_cast<uint32_t> ( ChanInfo.iInstrument ), 4 );
+
+    // skill level (1 byte)
+    PutValOnStream ( vecIn, iPos,
+        static_cast<uint32_t> ( ChanInfo.eSkillLevel ), 1 );
+
+    // IP address (4 bytes)
+    PutValOnStream ( vecIn, iPos,
+        static_cast<uint32_t> ( ChanInfo.iIpAddr ), 4 );
+
+    // name
+    PutStringUTF8OnStream ( vecIn, iPos, strUTF8Name );
+
+    // city
+    PutStringUTF8OnStream ( vecIn, iPos, strUTF8City );
+}
+
+bool CProtocol::GetChanInfoFromStream ( const CVector<uint8_t>& vecIn,
+                                        int&                    iPos,
+                                        CChannelInfo&           ChanInfo )
+{
+    // check size (the next 12 bytes)
+    if ( ( vecIn.Size() - iPos ) < 12 )
+    {
+        return true; // return error code
+    }
+
+    // channel ID (1 byte)
+    const int iChanID =
+        static_cast<int> ( GetValFromStream ( vecIn, iPos, 1 ) );
+
+    // country (2 bytes)
+    const QLocale::Country eCountry =
+        static_cast<QLocale::Country> ( GetValFromStream ( vecIn, iPos, 2 ) );
+
+    // instrument (4 bytes)
+    const int iInstrument =
+        static_cast<int> ( GetValFromStream ( vecIn, iPos, 4 ) );
+
+    // skill level (1 byte)
+    const ESkillLevel eSkillLevel =
+        static_cast<ESkillLevel> ( GetValFromStream ( vecIn, iPos, 1 ) );
+
+    // IP address (4 bytes)
+    const int iIpAddr =
+        static_cast<int> ( GetValFromStream ( vecIn, iPos, 4 ) );
+
+    // name
+    QString strCurName;
+    if ( GetStringFromStream ( vecIn,
+                               iPos,
+                               MAX_LEN_FADER_TAG,
+                               strCurName ) )
+    {
+        return true; // return error code
+    }
+
+    // city
+    QString strCurCity;
+    if ( GetStringFromStream ( vecIn,
+                               iPos,
+                               MAX_LEN_SERVER_CITY,
+                               strCurCity ) )
+    {
+        return true; // return error code
+    }
+
+    ChanInfo = CChannelInfo ( iChanID,
+                              iIpAddr,
+                              strCurName,
+                              eCountry,
+                              strCurCity,
+                              iInstrument,
+                              eSkillLevel );
+
+    return false; // no error
+}
+
+void CProtocol::PutServerInfoOnStream ( CVector<uint8_t>&  vecIn,
+                                        int&               iPos,
+                                        const CServerInfo& ServerInfo )
+{
+    // convert server list strings to utf-8
+    const QByteArray strUTF8Name  = ServerInfo.strName.toUtf8();
+    const QByteArray strUTF8Topic = ServerInfo.strTopic.toUtf8();
+    const QByteArray strUTF8City  = ServerInfo.strCity.toUtf8();
+
+    // size of current list entry
+    const int iCurListEntrLen =
+        4 /* IP address */ +
+        2 /* port number */ +
+        2 /* country */ +
+        1 /* maximum number of connected clients */ +
+        1 /* is permanent flag */ +
+        2 /* name utf-8 string size */ + strUTF8Name.size() +
+        2 /* topic utf-8 string size */ + strUTF8Topic.size() +
+        2 /* city utf-8 string size */ + strUTF8City.size();
+
+    // make space for new data
+    vecIn.Enlarge ( iCurListEntrLen );
+
+    // IP address (4 bytes)
+    PutValOnStream ( vecIn, iPos, static_cast<uint32_t> (
+        ServerInfo.HostAddr.InetAddr.toIPv4Address() ), 4 );
+
+    // port number (2 bytes)
+    PutValOnStream ( vecIn, iPos,
+        static_cast<uint32_t> ( ServerInfo.HostAddr.iPort ), 2 );
+
+    // country (2 bytes)
+    PutValOnStream ( vecIn, iPos,
+        static_cast<uint32_t> ( ServerInfo.eCountry ), 2 );
+
+    // maximum number of connected clients (1 byte)
+    PutValOnStream ( vecIn, iPos,
+        static_cast<uint32_t> ( ServerInfo.iMaxNumClients ), 1 );
+
+    // "is permanent" flag (1 byte)
+    PutValOnStream ( vecIn, iPos,
+        static_cast<uint32_t> ( ServerInfo.bPermanentOnline ), 1 );
+
+    // name
+    PutStringUTF8OnStream ( vecIn, iPos, strUTF8Name );
+
+    // topic
+    PutStringUTF8OnStream ( vecIn, iPos, strUTF8Topic );
+
+    // city
+    PutStringUTF8OnStream ( vecIn, iPos, strUTF8City );
+}
+
+bool CProtocol::GetServerInfoFromStream ( const CVector<uint8_t>& vecIn,
+                                          int&                    iPos,
+                                          CServerInfo&            ServerInfo )
+{
+    // check size (the next 10 bytes)
+    if ( ( vecIn.Size() - iPos ) < 10 )
+    {
+        return true; // return error code
+    }
+
+    // IP address (4 bytes)
+    const quint32 iIpAddr =
+        static_cast<int> ( GetValFromStream ( vecIn, iPos, 4 ) );
+
+    // port number (2 bytes)
+    const quint16 iPort =
+        static_cast<int> ( GetValFromStream ( vecIn, iPos, 2 ) );
+
+    // country (2 bytes)
+    const QLocale::Country eCountry =
+        static_cast<QLocale::Country> ( GetValFromStream ( vecIn, iPos, 2 ) );
+
+    // maximum number of connected clients (1 byte)
+    const int iMaxNumClients =
+        static_cast<int> ( GetValFromStream ( vecIn, iPos, 1 ) );
+
+    // "is permanent" flag (1 byte)
+    const bool bPermanentOnline =
+        static_cast<bool> ( GetValFromStream ( vecIn, iPos, 1 ) );
+
+    // server name
+    QString strName;
+    if ( GetStringFromStream ( vecIn,
+                               iPos,
+                               MAX_LEN_SERVER_NAME,
+                               strName ) )
+    {
+        return true; // return error code
+    }
+
+    // server topic
+    QString strTopic;
+    if ( GetStringFromStream ( vecIn,
+                               iPos,
+                               MAX_LEN_SERVER_TOPIC,
+                               strTopic ) )
+    {
+        return true; // return error code
+    }
+
+    // server city
+    QString strCity;
+    if ( GetStringFromStream ( vecIn,
+                               iPos,
+                               MAX_LEN_SERVER_CITY,
+                               strCity ) )
+    {
+        return true; // return error code
+    }
+
+    ServerInfo = CServerInfo ( CHostAddress ( QHostAddress ( iIpAddr ), iPort ),
+                               iPort,
+                               strName,
+                               strTopic,
+                               eCountry,
+                               strCity,
+                               iMaxNumClients,
+                               bPermanentOnline );
+
+    return false; // no error
+}
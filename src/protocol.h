@@ -28,9 +28,9 @@
 #include <QMutex>
 #include <QTimer>
 #include <QDateTime>
-#include <list>
 #include "global.h"
 #include "util.h"
+#include "protschema.h"
 
 
 /* Definitions ****************************************************************/
@@ -54,6 +54,10 @@
 #define PROTMESSID_CONN_CLIENTS_LIST          24 // channel infos for connected clients
 #define PROTMESSID_CHANNEL_INFOS              25 // set channel infos
 #define PROTMESSID_OPUS_SUPPORTED             26 // tells that OPUS codec is supported
+#define PROTMESSID_SUPPORTED_FEATURES         27 // features supported by the sender
+#define PROTMESSID_RECEIVER_REPORT            28 // audio receive statistics
+#define PROTMESSID_MESS_CONTAINER             29 // container for multiple messages
+#define PROTMESSID_CONN_CLIENTS_LIST_DELTA    30 // changes of the connected clients list
 
 // message IDs of connection less messages (CLM)
 // DEFINITION -> start at 1000, end at 1999, see IsConnectionLessMessageID
@@ -69,13 +73,82 @@
 #define PROTMESSID_CLM_DISCONNECTION          1010 // disconnection
 #define PROTMESSID_CLM_VERSION_AND_OS         1011 // version number and operating system
 #define PROTMESSID_CLM_REQ_VERSION_AND_OS     1012 // request version number and operating system
+#define PROTMESSID_CLM_CONN_CHALLENGE         1013 // connection challenge (cookie)
+#define PROTMESSID_CLM_CONN_CHALLENGE_RESP    1014 // response to connection challenge
+#define PROTMESSID_CLM_SERVER_LIST_FRAGMENT   1015 // fragment of the server list
+#define PROTMESSID_CLM_SERVER_LOAD            1016 // load of a registered server
+#define PROTMESSID_CLM_REQ_GROUP_SERVER       1017 // request server of a group
+#define PROTMESSID_CLM_GROUP_SERVER           1018 // server of a group
+#define PROTMESSID_CLM_REQ_LISTEN             1019 // request to receive the room mix
+
+// feature flags for the supported features message
+#define PROT_FEATURE_AUDIO_REDUNDANCY         0x00000001 // redundant audio packets
+#define PROT_FEATURE_RECEIVER_REPORT          0x00000002 // receiver report message
+#define PROT_FEATURE_AUDIO_PCM                0x00000004 // uncompressed audio
+#define PROT_FEATURE_SMALL_FRAME_SIZE         0x00000008 // 64 samples frame size
+#define PROT_FEATURE_MESS_CONTAINER           0x00000010 // message container
+#define PROT_FEATURE_CLIENT_LIST_DELTA        0x00000020 // incremental client list
+
+// features which are supported by this software version (the small frame
+// size is a server setting and therefore is not included here)
+#define PROT_SUPPORTED_FEATURES               ( PROT_FEATURE_AUDIO_REDUNDANCY | \
+                                                PROT_FEATURE_RECEIVER_REPORT | \
+                                                PROT_FEATURE_AUDIO_PCM | \
+                                                PROT_FEATURE_MESS_CONTAINER | \
+                                                PROT_FEATURE_CLIENT_LIST_DELTA )
 
 // lengths of message as defined in protocol.cpp file
 #define MESS_HEADER_LENGTH_BYTE         7 // TAG (2), ID (2), cnt (1), length (2)
 #define MESS_LEN_WITHOUT_DATA_BYTE      ( MESS_HEADER_LENGTH_BYTE + 2 /* CRC (2) */ )
 
-// time out for message re-send if no acknowledgement was received
-#define SEND_MESS_TIMEOUT_MS            400 // ms
+// time out for message re-send if no acknowledgement was received (this is
+// the initial value, as soon as the round trip time was measured, the time out
+// is derived from it and limited to the given range)
+#define SEND_MESS_TIMEOUT_MS            400  // ms
+#define SEND_MESS_MIN_TIMEOUT_MS        50   // ms
+#define SEND_MESS_MAX_TIMEOUT_MS        3000 // ms
+
+// if a gap in the received message counters is not filled by a resent
+// message within this time, or if a message seems to be resent much later
+// than it was received, we assume that the protocol of the peer was reset
+// (the peer resends a message at least once per maximum time out)
+#define PROT_REC_RESTART_TIMEOUT_MS     ( 2 * SEND_MESS_MAX_TIMEOUT_MS )
+
+// maximum number of not acknowledged messages which may be in flight at the
+// same time (must be smaller than the number of selective acknowledgement
+// bits and much smaller than the counter range)
+#define PROT_SEND_WINDOW_SIZE           16
+
+// number of preceding message counters covered by the selective
+// acknowledgement bit field of the acknowledgement message
+#define PROT_NUM_SEL_ACKN_BITS          32
+
+// initial number of slots of the send message ring buffer (the ring buffer is
+// enlarged if more messages are queued)
+#define PROT_SEND_RING_INIT_SIZE        64
+
+// the message counter is a one byte value
+#define PROT_NUM_COUNTER_VALUES         256
+
+// maximum size of a datagram with a message container (a message which does
+// not fit in the container is sent in its own datagram)
+#define PROT_CONTAINER_MAX_SIZE_BYTES   1200
+
+// each message in the container has the header without the TAG and no CRC
+#define PROT_CONTAINER_MESS_OVERHEAD    5 // ID (2), cnt (1), length (2)
+
+// initial size of the reused message frame buffers (the buffers grow if a
+// larger message is generated and keep their size afterwards)
+#define PROT_FRAME_BUF_INIT_SIZE_BYTES  256
+
+// maximum size of the server list entries in one server list fragment so that
+// the datagram does not exceed the typical MTU (an entry is never split), the
+// maximum number of fragments limits the memory used by the receiver
+#define PROT_SERVER_LIST_FRAG_MAX_SIZE_BYTES 1100
+#define PROT_SERVER_LIST_MAX_NUM_FRAGS       1024
+
+// marks a counter or time value which is not yet known
+#define PROT_INVALID_VALUE              -1
 
 
 /* Classes ********************************************************************/
@@ -93,6 +166,24 @@ public:
     void CreateChanGainMes ( const int iChanID, const double dGain );
     void CreateConClientListNameMes ( const CVector<CChannelInfo>& vecChanInfo );
     void CreateConClientListMes ( const CVector<CChannelInfo>& vecChanInfo );
+
+    // the list messages are usually sent to all connected clients, therefore
+    // the message data can be prepared once and then be sent to each client
+    static void PrepareConClientListNameMes ( const CVector<CChannelInfo>& vecChanInfo,
+                                              CVector<uint8_t>&            vecData );
+    static void PrepareConClientListMes ( const CVector<CChannelInfo>& vecChanInfo,
+                                          CVector<uint8_t>&            vecData );
+    static void PrepareConClientListDeltaMes ( const int                    iBaseVersion,
+                                               const int                    iVersion,
+                                               const CVector<int>&          veciRemovedChanIDs,
+                                               const CVector<CChannelInfo>& vecChanInfo,
+                                               CVector<uint8_t>&            vecData );
+    void CreatePreparedConClientListNameMes ( const CVector<uint8_t>& vecData )
+        { CreateAndSendMessage ( PROTMESSID_CONN_CLIENTS_LIST_NAME, vecData ); }
+    void CreatePreparedConClientListMes ( const CVector<uint8_t>& vecData )
+        { CreateAndSendMessage ( PROTMESSID_CONN_CLIENTS_LIST, vecData ); }
+    void CreatePreparedConClientListDeltaMes ( const CVector<uint8_t>& vecData )
+        { CreateAndSendMessage ( PROTMESSID_CONN_CLIENTS_LIST_DELTA, vecData ); }
     void CreateReqConnClientsList();
     void CreateChanNameMes ( const QString strName );
     void CreateChanInfoMes ( const CChannelCoreInfo ChanInfo );
@@ -101,6 +192,9 @@ public:
     void CreateNetwTranspPropsMes ( const CNetworkTransportProps& NetTrProps );
     void CreateReqNetwTranspPropsMes();
     void CreateOpusSupportedMes();
+    void CreateSupportedFeaturesMes ( const int iFeatures );
+    void CreateReceiverReportMes ( const int iNumFrames,
+                                   const int iNumLostFrames );
 
     void CreateCLPingMes               ( const CHostAddress& InetAddr, const int iMs );
     void CreateCLPingWithNumClientsMes ( const CHostAddress& InetAddr,
@@ -112,6 +206,30 @@ public:
     void CreateCLUnregisterServerMes   ( const CHostAddress& InetAddr );
     void CreateCLServerListMes         ( const CHostAddress&        InetAddr,
                                          const CVector<CServerInfo> vecServerInfo );
+    void CreateCLServerListFragmentMes ( const CHostAddress&         InetAddr,
+                                         const int                   iListVersion,
+                                         const CVector<CServerInfo>& vecServerInfo );
+
+    // the server list is sent to many clients, therefore the central server
+    // can prepare the message data once, the positions of the entries are
+    // stored so that the address of an entry can be changed for a client
+    static void PrepareCLServerListMes ( const CVector<CServerInfo>& vecServerInfo,
+                                         CVector<uint8_t>&           vecData,
+                                         CVector<int>&               veciEntryPos );
+    static void PrepareCLServerListFragmentMes ( const int                   iListVersion,
+                                                 const CVector<CServerInfo>& vecServerInfo,
+                                                 CVector<CVector<uint8_t> >& vecvecData,
+                                                 CVector<int>&               veciEntryFrag,
+                                                 CVector<int>&               veciEntryPos );
+    static void PatchCLServerListEntryAddress ( CVector<uint8_t>&   vecData,
+                                                const int           iEntryPos,
+                                                const CHostAddress& HostAddr );
+    void CreatePreparedCLServerListMes ( const CHostAddress&     InetAddr,
+                                         const CVector<uint8_t>& vecData )
+        { CreateAndImmSendConLessMessage ( PROTMESSID_CLM_SERVER_LIST, vecData, InetAddr ); }
+    void CreatePreparedCLServerListFragmentMes ( const CHostAddress&     InetAddr,
+                                                 const CVector<uint8_t>& vecData )
+        { CreateAndImmSendConLessMessage ( PROTMESSID_CLM_SERVER_LIST_FRAGMENT, vecData, InetAddr ); }
     void CreateCLReqServerListMes      ( const CHostAddress& InetAddr );
     void CreateCLSendEmptyMesMes       ( const CHostAddress& InetAddr,
                                          const CHostAddress& TargetInetAddr );
@@ -119,6 +237,28 @@ public:
     void CreateCLDisconnection         ( const CHostAddress& InetAddr );
     void CreateCLVersionAndOSMes       ( const CHostAddress& InetAddr );
     void CreateCLReqVersionAndOSMes    ( const CHostAddress& InetAddr );
+    void CreateCLConnChallengeMes      ( const CHostAddress& InetAddr,
+                                         const uint32_t      iCookie );
+    void CreateCLConnChallengeRespMes  ( const CHostAddress& InetAddr,
+                                         const uint32_t      iCookie );
+    void CreateCLServerLoadMes         ( const CHostAddress& InetAddr,
+                                         const int           iNumClients,
+                                         const int           iTickHeadroom,
+                                         const QString&      strGroup );
+    void CreateCLReqGroupServerMes     ( const CHostAddress& InetAddr,
+                                         const QString&      strGroup,
+                                         const int           iNumClients );
+    void CreateCLGroupServerMes        ( const CHostAddress& InetAddr,
+                                         const CHostAddress& ServerInetAddr );
+    void CreateCLReqListenMes          ( const CHostAddress& InetAddr,
+                                         const uint32_t      iCookie,
+                                         const EAudComprType eAudComprType,
+                                         const int           iNumAudioChannels,
+                                         const int           iNetwFrameSize,
+                                         const int           iFrameSizeSamples );
+
+    static bool IsProtocolMessage ( const CVector<uint8_t>& vecbyData,
+                                    const int               iNumBytesIn );
 
     static bool ParseMessageFrame ( const CVector<uint8_t>& vecbyData,
                                     const int               iNumBytesIn,
@@ -134,6 +274,14 @@ public:
                                           const int               iRecID,
                                           const CHostAddress&     InetAddr );
 
+    static bool GetContainedMessage ( const CVector<uint8_t>& vecbyContainerData,
+                                      int&                    iPos,
+                                      CVector<uint8_t>&       vecbyMesBodyData,
+                                      int&                    iRecCounter,
+                                      int&                    iRecID );
+
+    void SetMessContainerEnabled ( const bool bEnable );
+
     static bool IsConnectionLessMessageID ( const int iID )
         { return ( iID >= 1000 ) && ( iID < 2000 ); }
 
@@ -142,46 +290,84 @@ public:
                                     const int& iCnt );
 
 protected:
+    // Slot of the send message ring buffer. The message frame is generated
+    // directly in the slot and the memory of the slot is reused for the
+    // following messages, i.e., after the buffers have reached their maximum
+    // size, no memory is allocated anymore.
     class CSendMessage
     {
     public:
         CSendMessage() : vecMessage ( 0 ), iID ( PROTMESSID_ILLEGAL ),
-            iCnt ( 0 ) {}
-        CSendMessage ( const CVector<uint8_t>& nMess, const int iNCnt,
-            const int iNID ) : vecMessage ( nMess ), iID ( iNID ),
-            iCnt ( iNCnt ) {}
+            iCnt ( 0 ), bSent ( false ), bAckn ( false ),
+            bRetransmitted ( false ), iSendTimeMs ( 0 ), iTimeOutMs ( 0 ) {}
 
-        CSendMessage& operator= ( const CSendMessage& NewSendMess )
+        void Init ( const int iNCnt, const int iNID )
         {
-            vecMessage.Init ( NewSendMess.vecMessage.Size() );
-            vecMessage = NewSendMess.vecMessage;
+            iID            = iNID;
+            iCnt           = iNCnt;
+            bSent          = false;
+            bAckn          = false;
+            bRetransmitted = false;
+        }
 
-            iID  = NewSendMess.iID;
-            iCnt = NewSendMess.iCnt;
-            return *this; 
+        // moves the message to this slot by swapping the buffers (no copy)
+        void MoveFrom ( CSendMessage& OldSendMess )
+        {
+            vecMessage.swap ( OldSendMess.vecMessage );
+
+            iID            = OldSendMess.iID;
+            iCnt           = OldSendMess.iCnt;
+            bSent          = OldSendMess.bSent;
+            bAckn          = OldSendMess.bAckn;
+            bRetransmitted = OldSendMess.bRetransmitted;
+            iSendTimeMs    = OldSendMess.iSendTimeMs;
+            iTimeOutMs     = OldSendMess.iTimeOutMs;
         }
 
         CVector<uint8_t> vecMessage;
         int              iID, iCnt;
+        bool             bSent, bAckn, bRetransmitted;
+        int              iSendTimeMs, iTimeOutMs;
     };
 
-    void EnqueueMessage ( CVector<uint8_t>& vecMessage,
-                          const int         iCnt,
-                          const int         iID );
-
-    void GenMessageFrame ( CVector<uint8_t>&       vecOut,
-                           const int               iCnt,
-                           const int               iID,
-                           const CVector<uint8_t>& vecData );
+    void EnqueueMessage ( const int               iID,
+                          const CVector<uint8_t>& vecData );
 
-    void PutValOnStream ( CVector<uint8_t>& vecIn,
-                          int&              iPos,
-                          const uint32_t    iVal,
-                          const int         iNumOfBytes );
+    static void GenMessageFrame ( CVector<uint8_t>&       vecOut,
+                                  const int               iCnt,
+                                  const int               iID,
+                                  const CVector<uint8_t>& vecData );
 
-    void PutStringUTF8OnStream ( CVector<uint8_t>& vecIn,
+    static void PutValOnStream ( CVector<uint8_t>& vecIn,
                                  int&              iPos,
-                                 const QByteArray& sStringUTF8 );
+                                 const uint32_t    iVal,
+                                 const int         iNumOfBytes );
+
+    static void PutStringUTF8OnStream ( CVector<uint8_t>& vecIn,
+                                        int&              iPos,
+                                        const QByteArray& sStringUTF8 );
+
+    static void PutChanInfoOnStream ( CVector<uint8_t>&   vecIn,
+                                      int&                iPos,
+                                      const CChannelInfo& ChanInfo );
+
+    bool GetChanInfoFromStream ( const CVector<uint8_t>& vecIn,
+                                 int&                    iPos,
+                                 CChannelInfo&           ChanInfo );
+
+    static void PutServerInfoOnStream ( CVector<uint8_t>&  vecIn,
+                                        int&               iPos,
+                                        const CServerInfo& ServerInfo );
+
+    bool GetServerInfoFromStream ( const CVector<uint8_t>& vecIn,
+                                   int&                    iPos,
+                                   CServerInfo&            ServerInfo );
+
+    static bool CheckMessageFrame ( const CVector<uint8_t>& vecbyData,
+                                    const int               iNumBytesIn,
+                                    int&                    iCnt,
+                                    int&                    iID,
+                                    int&                    iLenBy );
 
     static uint32_t GetValFromStream ( const CVector<uint8_t>& vecIn,
                                        int&                    iPos,
@@ -193,6 +379,20 @@ protected:
                                QString&                strOut );
 
     void SendMessage();
+    void PutMessageForSending ( const CVector<uint8_t>& vecMessage );
+    bool TakeContainerMessage ( CVector<uint8_t>& vecMessage );
+    void UpdateRetransTimeOut ( const int iRoundTripTimeMs );
+    int  GetTimeMs();
+
+    void ResetRecState();
+    void EvaluateStoredMes ( bool& bRet );
+    void EvaluateInOrderMes ( const CVector<uint8_t>& vecbyMesBodyData,
+                              const int               iRecCounter,
+                              const int               iRecID,
+                              bool&                   bRet );
+
+    bool EvaluateMessage ( const CVector<uint8_t>& vecbyMesBodyData,
+                           const int               iRecID );
 
     void CreateAndSendMessage ( const int               iID,
                                 const CVector<uint8_t>& vecData );
@@ -206,6 +406,7 @@ protected:
     bool EvaluateChanGainMes          ( const CVector<uint8_t>& vecData );
     bool EvaluateConClientListNameMes ( const CVector<uint8_t>& vecData );
     bool EvaluateConClientListMes     ( const CVector<uint8_t>& vecData );
+    bool EvaluateConClientListDeltaMes ( const CVector<uint8_t>& vecData );
     bool EvaluateReqConnClientsList();
     bool EvaluateChanNameMes          ( const CVector<uint8_t>& vecData );
     bool EvaluateChanInfoMes          ( const CVector<uint8_t>& vecData );
@@ -214,6 +415,8 @@ protected:
     bool EvaluateNetwTranspPropsMes   ( const CVector<uint8_t>& vecData );
     bool EvaluateReqNetwTranspPropsMes();
     bool EvaluateOpusSupportedMes();
+    bool EvaluateSupportedFeaturesMes ( const CVector<uint8_t>& vecData );
+    bool EvaluateReceiverReportMes    ( const CVector<uint8_t>& vecData );
 
     bool EvaluateCLPingMes               ( const CHostAddress&     InetAddr,
                                            const CVector<uint8_t>& vecData );
@@ -225,31 +428,87 @@ protected:
     bool EvaluateCLUnregisterServerMes   ( const CHostAddress&     InetAddr );
     bool EvaluateCLServerListMes         ( const CHostAddress&     InetAddr,
                                            const CVector<uint8_t>& vecData );
-    bool EvaluateCLReqServerListMes      ( const CHostAddress& InetAddr );
+    bool EvaluateCLServerListFragmentMes ( const CHostAddress&     InetAddr,
+                                           const CVector<uint8_t>& vecData );
+    bool EvaluateCLReqServerListMes      ( const CHostAddress&     InetAddr,
+                                           const CVector<uint8_t>& vecData );
     bool EvaluateCLSendEmptyMesMes       ( const CVector<uint8_t>& vecData );
     bool EvaluateCLDisconnectionMes      ( const CHostAddress& InetAddr );
     bool EvaluateCLVersionAndOSMes       ( const CHostAddress&     InetAddr,
                                            const CVector<uint8_t>& vecData );
     bool EvaluateCLReqVersionAndOSMes    ( const CHostAddress& InetAddr );
+    bool EvaluateCLConnChallengeMes      ( const CHostAddress&     InetAddr,
+                                           const CVector<uint8_t>& vecData );
+    bool EvaluateCLConnChallengeRespMes  ( const CHostAddress&     InetAddr,
+                                           const CVector<uint8_t>& vecData );
+    bool EvaluateCLServerLoadMes         ( const CHostAddress&     InetAddr,
+                                           const CVector<uint8_t>& vecData );
+    bool EvaluateCLReqGroupServerMes     ( const CHostAddress&     InetAddr,
+                                           const CVector<uint8_t>& vecData );
+    bool EvaluateCLGroupServerMes        ( const CHostAddress&     InetAddr,
+                                           const CVector<uint8_t>& vecData );
+    bool EvaluateCLReqListenMes          ( const CHostAddress&     InetAddr,
+                                           const CVector<uint8_t>& vecData );
 
-    int                     iOldRecID;
-    int                     iOldRecCnt;
-
-    // these two objects must be sequred by a mutex
-    uint8_t                 iCounter;
-    std::list<CSendMessage> SendMessQueue;
-
-    QTimer                  TimerSendMess;
-    QMutex                  Mutex;
+    // receive state: for each counter value the ID of the received message is
+    // stored (or PROTMESSID_ILLEGAL if no message was received) which is used
+    // for detecting resent messages, for the selective acknowledgement and
+    // for the reordering of messages received out of order
+    int                        iNextRecCnt;
+    CVector<int>               veciRecID;
+    CVector<int>               veciRecTimeMs;
+    CVector<CVector<uint8_t> > vecvecbyRecMesBody;
+    int                        iRecGapStartTimeMs;
+
+    // these objects must be sequred by a mutex
+    uint8_t                    iCounter;
+    CVector<CSendMessage>      vecSendMessRing;
+    int                        iSendRingStart;
+    int                        iSendRingNumUsed;
+    bool                       bPeerSupportsSelAckn;
+    int                        iSmoothedRttMs;
+    int                        iRttVarianceMs;
+    int                        iRetransTimeOutMs;
+
+    // messages which are collected for the next message container
+    bool                       bMessContainerEnabled;
+    bool                       bContainerFlushPending;
+    int                        iContainerNumMess;
+    int                        iContainerNumBytes;
+    CVector<uint8_t>           vecbyContainerData;
+    CVector<uint8_t>           vecbyContainerFirstMes;
+
+    // reused buffers for the messages which are sent, these buffers must be
+    // secured by the send mutex
+    CVector<CVector<uint8_t> > vecvecbySendBuf;
+    CVector<uint8_t>           vecbyAcknData;
+    CVector<uint8_t>           vecbyAcknMessage;
+    CVector<uint8_t>           vecbyCLMessage;
+    CVector<uint8_t>           vecbyContainerFrame;
+    CVector<uint8_t>           vecbyContainerFrameData;
+    QMutex                     MutexSend;
+
+    // collected fragments of the server list (only used in the thread which
+    // parses the connection less messages)
+    CHostAddress                   ServerListFragHostAddr;
+    int                            iServerListFragVersion;
+    int                            iServerListFragNumReceived;
+    CVector<CVector<CServerInfo> > vecvecServerListFrag;
+    CVector<int>                   veciServerListFragReceived;
+
+    QTime                      SendTime;
+    QTimer                     TimerSendMess;
+    QMutex                     Mutex;
 
 public slots:
     void OnTimerSendMess() { SendMessage(); }
+    void OnFlushMessContainer();
 
 signals:
     // transmitting
-    void MessReadyForSending   ( CVector<uint8_t> vecMessage );
-    void CLMessReadyForSending ( CHostAddress     InetAddr,
-                                 CVector<uint8_t> vecMessage );
+    void MessReadyForSending   ( const CVector<uint8_t>& vecMessage );
+    void CLMessReadyForSending ( CHostAddress            InetAddr,
+                                 const CVector<uint8_t>& vecMessage );
 
     // receiving
     void ChangeJittBufSize ( int iNewJitBufSize );
@@ -258,12 +517,18 @@ signals:
     void ChangeChanGain ( int iChanID, double dNewGain );
     void ConClientListNameMesReceived ( CVector<CChannelInfo> vecChanInfo );
     void ConClientListMesReceived ( CVector<CChannelInfo> vecChanInfo );
+    void ConClientListDeltaMesReceived ( int                   iBaseVersion,
+                                         int                   iVersion,
+                                         CVector<int>          veciRemovedChanIDs,
+                                         CVector<CChannelInfo> vecChanInfo );
     void ServerFullMesReceived();
     void ReqConnClientsList();
     void ChangeChanName ( QString strName );
     void ChangeChanInfo ( CChannelCoreInfo ChanInfo );
     void ReqChanInfo();
     void OpusSupported();
+    void SupportedFeaturesReceived ( int iFeatures );
+    void ReceiverReportReceived ( int iNumFrames, int iNumLostFrames );
     void ChatTextReceived ( QString strChatText );
     void NetTranspPropsReceived ( CNetworkTransportProps NetworkTransportProps );
     void ReqNetTranspProps();
@@ -278,13 +543,33 @@ signals:
     void CLUnregisterServerReceived   ( CHostAddress           InetAddr );
     void CLServerListReceived         ( CHostAddress           InetAddr,
                                         CVector<CServerInfo>   vecServerInfo );
-    void CLReqServerList              ( CHostAddress           InetAddr );
+    void CLReqServerList              ( CHostAddress           InetAddr,
+                                        bool                   bFragmentsSupported );
     void CLSendEmptyMes               ( CHostAddress           TargetInetAddr );
     void CLDisconnection              ( CHostAddress           InetAddr );
     void CLVersionAndOSReceived       ( CHostAddress           InetAddr,
                                         COSUtil::EOpSystemType eOSType,
                                         QString                strVersion );
     void CLReqVersionAndOS            ( CHostAddress           InetAddr );
+    void CLConnChallengeReceived      ( CHostAddress           InetAddr,
+                                        quint32                iCookie );
+    void CLConnChallengeRespReceived  ( CHostAddress           InetAddr,
+                                        quint32                iCookie );
+    void CLServerLoadReceived         ( CHostAddress           InetAddr,
+                                        int                    iNumClients,
+                                        int                    iTickHeadroom,
+                                        QString                strGroup );
+    void CLReqGroupServer             ( CHostAddress           InetAddr,
+                                        QString                strGroup,
+                                        int                    iNumClients );
+    void CLGroupServerReceived        ( CHostAddress           InetAddr,
+                                        CHostAddress           ServerInetAddr );
+    void CLReqListen                  ( CHostAddress           InetAddr,
+                                        quint32                iCookie,
+                                        int                    iAudComprType,
+                                        int                    iNumAudioChannels,
+                                        int                    iNetwFrameSize,
+                                        int                    iFrameSizeSamples );
 };
 
 #endif /* !defined ( PROTOCOL_H__3B123453_4344_BB2392354455IUHF1912__INCLUDED_ ) */
@@ -0,0 +1,294 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2014
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#if !defined ( PROTSCHEMA_H__3B123453_4344_BB2392354455IUHF1913__INCLUDED_ )
+#define PROTSCHEMA_H__3B123453_4344_BB2392354455IUHF1913__INCLUDED_
+
+#include "util.h"
+
+
+/* Classes ********************************************************************/
+/*
+  Declarative description of the fixed layout protocol message bodies.
+
+  A message schema is the list of the field lengths in bytes of the message
+  body, e.g., "CProtSchema<1, 2>" is a message with a 1 byte field followed
+  by a 2 byte field. All fields are unsigned integers of 1 to 4 bytes which
+  are stored in little endian byte order (same as PutValOnStream and
+  GetValFromStream). The total size and the offset of each field are compile
+  time constants so that the encoding and decoding is done with straight-line
+  code and the bounds check of a received message is a single size
+  comparison.
+
+  Optional fields are only allowed at the end of the message (old versions
+  do not know these fields). The number of fields which are present is then
+  defined by the size of the message body.
+
+  Messages with a variable length (strings, lists) still use the stream
+  functions of the protocol class.
+*/
+
+// Value encoding --------------------------------------------------------------
+template<int iNumBytes>
+class CProtValue
+{
+public:
+    static void Put ( uint8_t* pData, const uint32_t iVal )
+    {
+        pData[0] = static_cast<uint8_t> ( iVal & 255 /* 11111111 */ );
+        CProtValue<iNumBytes - 1>::Put ( pData + 1, iVal >> 8 );
+    }
+
+    static uint32_t Get ( const uint8_t* pData )
+    {
+        return static_cast<uint32_t> ( pData[0] ) |
+            ( CProtValue<iNumBytes - 1>::Get ( pData + 1 ) << 8 );
+    }
+};
+
+template<>
+class CProtValue<0>
+{
+public:
+    static void Put ( uint8_t*, const uint32_t ) {}
+    static uint32_t Get ( const uint8_t* ) { return 0; }
+};
+
+
+// Field list ------------------------------------------------------------------
+class CProtFieldEnd
+{
+public:
+    enum { iSize = 0, iNumFields = 0 };
+
+    static int GetSize ( const int ) { return 0; }
+};
+
+template<int iNumBytes, class TNext>
+class CProtField
+{
+public:
+    // 4 bytes maximum since the values are of type uint32 (a wrong field
+    // length results in a compile error)
+    typedef char CLenCheck[( ( iNumBytes > 0 ) && ( iNumBytes <= 4 ) ) ? 1 : -1];
+
+    typedef TNext CNext;
+
+    enum
+    {
+        iLen       = iNumBytes,
+        iSize      = iNumBytes + TNext::iSize,
+        iNumFields = 1 + TNext::iNumFields
+    };
+
+    // size of the first iNumUsedFields fields
+    static int GetSize ( const int iNumUsedFields )
+    {
+        if ( iNumUsedFields <= 0 )
+        {
+            return 0;
+        }
+
+        return iNumBytes + TNext::GetSize ( iNumUsedFields - 1 );
+    }
+};
+
+// offset and length of the field with index iIdx (an index which is out of
+// range results in a compile error)
+template<class TList, int iIdx>
+class CProtFieldAt
+{
+public:
+    typedef CProtFieldAt<typename TList::CNext, iIdx - 1> CRest;
+
+    enum
+    {
+        iOffset = TList::iLen + CRest::iOffset,
+        iLen    = CRest::iLen
+    };
+};
+
+template<class TList>
+class CProtFieldAt<TList, 0>
+{
+public:
+    enum
+    {
+        iOffset = 0,
+        iLen    = TList::iLen
+    };
+};
+
+
+// Schema ----------------------------------------------------------------------
+// a field length of zero marks the end of the field list
+template<int iLen0,     int iLen1 = 0, int iLen2 = 0, int iLen3 = 0,
+         int iLen4 = 0, int iLen5 = 0, int iLen6 = 0, int iLen7 = 0>
+class CProtSchema
+{
+public:
+    typedef CProtField<iLen0, typename CProtSchema<iLen1, iLen2, iLen3, iLen4,
+        iLen5, iLen6, iLen7, 0>::CList> CList;
+
+    enum
+    {
+        iSize      = CList::iSize,
+        iNumFields = CList::iNumFields
+    };
+};
+
+template<>
+class CProtSchema<0, 0, 0, 0, 0, 0, 0, 0>
+{
+public:
+    typedef CProtFieldEnd CList;
+
+    enum
+    {
+        iSize      = 0,
+        iNumFields = 0
+    };
+};
+
+
+// Message writer --------------------------------------------------------------
+// initializes the output vector with the size of the message body (the
+// memory of the vector is reused if possible) and writes the fields directly
+// in the vector, optional fields at the end can be omitted
+template<class TSchema>
+class CProtMessWriter
+{
+public:
+    CProtMessWriter ( CVector<uint8_t>& vecOut,
+                      const int         iNNumFields = TSchema::iNumFields ) :
+        iNumFields ( iNNumFields )
+    {
+        vecOut.Init ( TSchema::CList::GetSize ( iNumFields ) );
+        pData = &vecOut[0];
+    }
+
+    template<int iIdx>
+    void Set ( const uint32_t iVal )
+    {
+        typedef CProtFieldAt<typename TSchema::CList, iIdx> CCurField;
+
+        Q_ASSERT ( iIdx < iNumFields );
+
+        CProtValue<CCurField::iLen>::Put ( pData + CCurField::iOffset, iVal );
+    }
+
+protected:
+    uint8_t* pData;
+    int      iNumFields;
+};
+
+
+// Message view ----------------------------------------------------------------
+// read access to the fields of a received message body without copying the
+// data, note that the view is only valid as long as the vector exists and is
+// not modified
+template<class TSchema>
+class CProtMessView
+{
+public:
+    CProtMessView() : pData ( NULL ), iNumFields ( 0 ) {}
+
+    bool Parse ( const CVector<uint8_t>& vecData,
+                 const int               iMinNumFields = TSchema::iNumFields )
+    {
+        // the size of the message body must exactly match the schema where
+        // the fields after the first iMinNumFields fields are optional
+        for ( int i = TSchema::iNumFields; i >= iMinNumFields; i-- )
+        {
+            if ( vecData.Size() == TSchema::CList::GetSize ( i ) )
+            {
+                pData      = &vecData.front();
+                iNumFields = i;
+
+                return false; // no error
+            }
+        }
+
+        return true; // return error code
+    }
+
+    int GetNumFields() const { return iNumFields; }
+
+    template<int iIdx>
+    uint32_t Get() const
+    {
+        typedef CProtFieldAt<typename TSchema::CList, iIdx> CCurField;
+
+        Q_ASSERT ( iIdx < iNumFields );
+
+        return CProtValue<CCurField::iLen>::Get ( pData + CCurField::iOffset );
+    }
+
+protected:
+    const uint8_t* pData;
+    int            iNumFields;
+};
+
+
+/* Message schemas ************************************************************/
+// PROTMESSID_JITT_BUF_SIZE: jitter buffer size (2)
+typedef CProtSchema<2> CProtSchemaJitBufSize;
+
+// PROTMESSID_CHANNEL_GAIN: channel ID (1), gain (2)
+typedef CProtSchema<1, 2> CProtSchemaChanGain;
+
+// PROTMESSID_NETW_TRANSPORT_PROPS: network frame size (4), block size
+// factor (2), number of channels (1), sample rate (4), audio coding type (2),
+// version (2), audio coding argument (4) and the optional number of redundant
+// audio packets (1)
+typedef CProtSchema<4, 2, 1, 4, 2, 2, 4, 1> CProtSchemaNetwTranspProps;
+
+// PROTMESSID_SUPPORTED_FEATURES: feature bits (4)
+typedef CProtSchema<4> CProtSchemaSupportedFeatures;
+
+// PROTMESSID_RECEIVER_REPORT: number of frames (2), number of lost frames (2)
+typedef CProtSchema<2, 2> CProtSchemaReceiverReport;
+
+// PROTMESSID_CLM_PING_MS: transmit time (4)
+typedef CProtSchema<4> CProtSchemaCLPing;
+
+// PROTMESSID_CLM_PING_MS_WITHNUMCLIENTS: transmit time (4), number of
+// connected clients (1)
+typedef CProtSchema<4, 1> CProtSchemaCLPingWithNumClients;
+
+// PROTMESSID_CLM_SEND_EMPTY_MESSAGE: IP address (4), port number (2)
+typedef CProtSchema<4, 2> CProtSchemaCLSendEmptyMes;
+
+// PROTMESSID_CLM_CONN_CHALLENGE and PROTMESSID_CLM_CONN_CHALLENGE_RESP:
+// cookie (4)
+typedef CProtSchema<4> CProtSchemaCLConnChallenge;
+
+// PROTMESSID_CLM_GROUP_SERVER: IP address (4), port number (2)
+typedef CProtSchema<4, 2> CProtSchemaCLGroupServer;
+
+// PROTMESSID_CLM_REQ_LISTEN: cookie (4), audio coding type (2), number of
+// channels (1), network frame size (2), audio frame size (2)
+typedef CProtSchema<4, 2, 1, 2, 2> CProtSchemaCLReqListen;
+
+#endif /* !defined ( PROTSCHEMA_H__3B123453_4344_BB2392354455IUHF1913__INCLUDED_ ) */
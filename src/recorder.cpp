@@ -0,0 +1,385 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2014
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#include "recorder.h"
+#ifdef _WIN32
+# include <io.h>
+#else
+# include <unistd.h>
+#endif
+
+
+/* Implementation *************************************************************/
+CSessionRecorder::CSessionRecorder ( const int  iNFrameSizeSamples,
+                                     const int  iNMaxNumChannels,
+                                     const bool bNSyncToDisk ) :
+    iFrameSizeSamples ( iNFrameSizeSamples ),
+    bSyncToDisk       ( bNSyncToDisk ),
+    iSessionSample    ( 0 ),
+    bRun              ( false )
+{
+    // all memory is allocated here, the memory usage does not depend on the
+    // speed of the disk
+    vecTracks.Init      ( iNMaxNumChannels );
+    vecbConnected.Init  ( iNMaxNumChannels, false );
+    vecsStereoData.Init ( 2 * iFrameSizeSamples );
+    vecsWriteData.Init  ( RECORDER_RING_SIZE_SAMPLES );
+
+    for ( int i = 0; i < iNMaxNumChannels; i++ )
+    {
+        vecTracks[i].Ring.Init ( RECORDER_RING_SIZE_SAMPLES );
+    }
+}
+
+CSessionRecorder::~CSessionRecorder()
+{
+    bRun = false;
+    wait();
+}
+
+void CSessionRecorder::Start ( const QString& strNBaseDirName )
+{
+    // the writer thread of the previous session may still close its files
+    wait();
+
+    // each session gets its own directory
+    strSessionDirName = strNBaseDirName + "/Jamulus-" +
+        QDateTime::currentDateTime().toString ( "yyyyMMdd-hhmmss" );
+
+    QDir().mkpath ( strSessionDirName );
+
+    // the mixer is not running at this time
+    for ( int i = 0; i < vecTracks.Size(); i++ )
+    {
+        vecTracks[i].bMixerActive = false;
+        vecTracks[i].iState.fetchAndStoreRelease ( RECORDER_TRACK_IDLE );
+        vecTracks[i].Ring.Init ( RECORDER_RING_SIZE_SAMPLES );
+    }
+
+    iSessionSample = 0;
+    iNumDroppedSamples.fetchAndStoreRelaxed ( 0 );
+
+    bRun = true;
+    start();
+}
+
+void CSessionRecorder::Process ( const CVector<int>&               vecChanIDs,
+                                 const CVector<CVector<int16_t> >& vecvecsData,
+                                 const CVector<int>&               vecNumAudioChannels,
+                                 const int                         iNumClients )
+{
+    int i, j;
+
+    vecbConnected.Reset ( false );
+
+    for ( i = 0; i < iNumClients; i++ )
+    {
+        const int iCurChanID = vecChanIDs[i];
+        CTrack&   CurTrack   = vecTracks[iCurChanID];
+
+        vecbConnected[iCurChanID] = true;
+
+        if ( !CurTrack.bMixerActive )
+        {
+            // a new client on this channel: the new track can only be started
+            // if the writer thread has finished the previous track
+            if ( CurTrack.iState.fetchAndAddAcquire ( 0 ) != RECORDER_TRACK_IDLE )
+            {
+                iNumDroppedSamples.fetchAndAddRelaxed ( iFrameSizeSamples );
+                continue;
+            }
+
+            CurTrack.iStartSample = iSessionSample;
+            CurTrack.iNumDroppedSamples.fetchAndStoreRelaxed ( 0 );
+            CurTrack.iNumPendingSilence.fetchAndStoreRelaxed ( 0 );
+            CurTrack.iState.fetchAndStoreRelease ( RECORDER_TRACK_ACTIVE );
+            CurTrack.bMixerActive = true;
+        }
+
+        // all tracks are stored in stereo since the number of audio channels
+        // of a client may change during the session (note that the const
+        // operator[] of the vector returns a copy)
+        const int16_t* psCurData = &( vecvecsData.begin() + i )->front();
+
+        if ( vecNumAudioChannels[i] == 1 )
+        {
+            for ( j = 0; j < iFrameSizeSamples; j++ )
+            {
+                vecsStereoData[2 * j]     = psCurData[j];
+                vecsStereoData[2 * j + 1] = psCurData[j];
+            }
+        }
+        else
+        {
+            std::copy ( psCurData,
+                        psCurData + 2 * iFrameSizeSamples,
+                        vecsStereoData.begin() );
+        }
+
+        // the audio which was dropped before is replaced by silence at its
+        // position in the track so that the track stays aligned to the
+        // session timeline
+        int iNumPendingSilence = CurTrack.iNumPendingSilence.fetchAndAddRelaxed ( 0 );
+
+        if ( iNumPendingSilence > 0 )
+        {
+            const int iNumSilence =
+                min ( iNumPendingSilence, CurTrack.Ring.GetAvailSpace() / 2 );
+
+            if ( ( iNumSilence > 0 ) &&
+                 CurTrack.Ring.PutValue ( 0, 2 * iNumSilence ) )
+            {
+                iNumPendingSilence -= iNumSilence;
+            }
+        }
+
+        if ( ( iNumPendingSilence > 0 ) ||
+             !CurTrack.Ring.Put ( &vecsStereoData[0], 2 * iFrameSizeSamples ) )
+        {
+            iNumPendingSilence += iFrameSizeSamples;
+
+            CurTrack.iNumDroppedSamples.fetchAndAddRelaxed ( iFrameSizeSamples );
+            iNumDroppedSamples.fetchAndAddRelaxed ( iFrameSizeSamples );
+        }
+
+        CurTrack.iNumPendingSilence.fetchAndStoreRelaxed ( iNumPendingSilence );
+    }
+
+    // the tracks of disconnected clients are finished by the writer thread
+    for ( i = 0; i < vecTracks.Size(); i++ )
+    {
+        if ( vecTracks[i].bMixerActive && !vecbConnected[i] )
+        {
+            vecTracks[i].iState.fetchAndStoreRelease ( RECORDER_TRACK_CLOSING );
+            vecTracks[i].bMixerActive = false;
+        }
+    }
+
+    iSessionSample += iFrameSizeSamples;
+}
+
+void CSessionRecorder::run()
+{
+    TimelineFile.setFileName ( strSessionDirName + "/" +
+                               RECORDER_TIMELINE_FILE_NAME );
+
+    TimelineFile.open ( QIODevice::WriteOnly | QIODevice::Text );
+
+    while ( bRun )
+    {
+        WriteTracks ( false );
+        WaitWhileRunning ( RECORDER_WRITE_INTERV_MS );
+    }
+
+    // at the end of the session all tracks are finished
+    WriteTracks ( true );
+
+    TimelineFile.close();
+}
+
+void CSessionRecorder::WriteTracks ( const bool bIsFinal )
+{
+    for ( int i = 0; i < vecTracks.Size(); i++ )
+    {
+        CTrack&   CurTrack = vecTracks[i];
+        const int iState   = CurTrack.iState.fetchAndAddAcquire ( 0 );
+
+        if ( iState == RECORDER_TRACK_IDLE )
+        {
+            continue;
+        }
+
+        if ( CurTrack.pFile == NULL )
+        {
+            OpenTrack ( CurTrack, i );
+        }
+
+        // if the file could not be opened, the audio of the track is
+        // discarded
+        const bool bFileIsOpen = CurTrack.pFile->isOpen();
+
+        // write all available audio in one large block (the data is always
+        // put in the ring buffer in complete stereo frames)
+        const int iNumAvail = CurTrack.Ring.GetAvailData();
+
+        if ( ( iNumAvail > 0 ) &&
+             CurTrack.Ring.Get ( &vecsWriteData[0], iNumAvail ) &&
+             bFileIsOpen )
+        {
+            CurTrack.pFile->write ( reinterpret_cast<const char*> ( &vecsWriteData[0] ),
+                                    iNumAvail * sizeof ( int16_t ) );
+
+            CurTrack.iNumWrittenSamples += iNumAvail / 2;
+        }
+
+        if ( bSyncToDisk && bFileIsOpen )
+        {
+            SyncToDisk ( *CurTrack.pFile );
+        }
+
+        if ( ( iState == RECORDER_TRACK_CLOSING ) || bIsFinal )
+        {
+            // the audio which was dropped at the end of the track could not
+            // be replaced by the mixer anymore
+            WriteSilence ( CurTrack,
+                           CurTrack.iNumPendingSilence.fetchAndAddAcquire ( 0 ) );
+
+            CloseTrack ( CurTrack, i );
+
+            // the channel can be used for a new track by the mixer now
+            CurTrack.iState.fetchAndStoreRelease ( RECORDER_TRACK_IDLE );
+        }
+    }
+
+    TimelineFile.flush();
+}
+
+void CSessionRecorder::WriteSilence ( CTrack&   Track,
+                                      const int iNumSamples )
+{
+    int iNumRemaining = iNumSamples;
+
+    while ( iNumRemaining > 0 )
+    {
+        const int iNumCurSamples = min ( iNumRemaining, vecsWriteData.Size() / 2 );
+
+        std::fill ( vecsWriteData.begin(),
+                    vecsWriteData.begin() + 2 * iNumCurSamples,
+                    0 );
+
+        if ( Track.pFile->isOpen() )
+        {
+            Track.pFile->write ( reinterpret_cast<const char*> ( &vecsWriteData[0] ),
+                                 2 * iNumCurSamples * sizeof ( int16_t ) );
+        }
+
+        Track.iNumWrittenSamples += iNumCurSamples;
+        iNumRemaining            -= iNumCurSamples;
+    }
+}
+
+void CSessionRecorder::OpenTrack ( CTrack&   Track,
+                                   const int iChanID )
+{
+    const qint64 iStartMs = Track.iStartSample * 1000 / SYSTEM_SAMPLE_RATE_HZ;
+
+    const QString strFileName = QString ( "chan%1-%2.wav" )
+        .arg ( iChanID + 1, 2, 10, QLatin1Char ( '0' ) )
+        .arg ( iStartMs, 9, 10, QLatin1Char ( '0' ) );
+
+    // the audio is written in large blocks, an additional buffer is not needed
+    Track.pFile = new QFile ( strSessionDirName + "/" + strFileName );
+    Track.pFile->open ( QIODevice::WriteOnly | QIODevice::Truncate |
+                        QIODevice::Unbuffered );
+
+    // the sizes in the header are set when the track is closed
+    WriteWavHeader ( *Track.pFile, 0 );
+
+    Track.iNumWrittenSamples = 0;
+
+    QTextStream ( &TimelineFile ) << "file \"" << strFileName << "\" offset " <<
+        QString::number ( static_cast<double> ( Track.iStartSample ) /
+                          SYSTEM_SAMPLE_RATE_HZ, 'f', 3 ) << endl;
+}
+
+void CSessionRecorder::CloseTrack ( CTrack&   Track,
+                                    const int iChanID )
+{
+    WriteWavHeader ( *Track.pFile, Track.iNumWrittenSamples );
+
+    Track.pFile->close();
+    delete Track.pFile;
+    Track.pFile = NULL;
+
+    // the leave event is stored as a comment in the timeline
+    QTextStream ( &TimelineFile ) << "# channel " << iChanID + 1 <<
+        " left at " << QString::number ( static_cast<double> (
+        Track.iStartSample + Track.iNumWrittenSamples ) /
+        SYSTEM_SAMPLE_RATE_HZ, 'f', 3 ) << ", dropped samples: " <<
+        Track.iNumDroppedSamples.fetchAndAddRelaxed ( 0 ) << endl;
+}
+
+void CSessionRecorder::WriteWavHeader ( QFile&       File,
+                                        const qint64 iNumSamples )
+{
+    if ( !File.isOpen() )
+    {
+        return;
+    }
+
+    // RIFF WAVE header for 16 bit stereo PCM (all values in little endian)
+    const qint64  iNumBytes    = iNumSamples * static_cast<qint64> ( 2 * sizeof ( int16_t ) );
+    const quint32 iDataSize    = static_cast<quint32> (
+        min ( iNumBytes, static_cast<qint64> ( RECORDER_MAX_WAV_DATA_SIZE ) ) );
+    const quint32 iSampleRate  = SYSTEM_SAMPLE_RATE_HZ;
+    const quint32 iByteRate    = iSampleRate * 2 * sizeof ( int16_t );
+    const quint32 iHeaderVal[] = { 36 + iDataSize, 16, iSampleRate, iByteRate, iDataSize };
+
+    uint8_t byHeader[44] = { 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E',
+                             'f', 'm', 't', ' ', 0, 0, 0, 0, 1, 0, 2, 0,
+                             0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 16, 0,
+                             'd', 'a', 't', 'a', 0, 0, 0, 0 };
+
+    // positions of the 32 bit values in the header
+    const int iHeaderPos[] = { 4, 16, 24, 28, 40 };
+
+    for ( int i = 0; i < 5; i++ )
+    {
+        for ( int j = 0; j < 4; j++ )
+        {
+            byHeader[iHeaderPos[i] + j] =
+                static_cast<uint8_t> ( ( iHeaderVal[i] >> ( 8 * j ) ) & 0xFF );
+        }
+    }
+
+    const qint64 iCurPos = File.pos();
+
+    File.seek  ( 0 );
+    File.write ( reinterpret_cast<const char*> ( byHeader ), sizeof ( byHeader ) );
+
+    if ( iCurPos > 0 )
+    {
+        File.seek ( iCurPos );
+    }
+}
+
+void CSessionRecorder::SyncToDisk ( QFile& File )
+{
+#if defined ( _WIN32 )
+    _commit ( File.handle() );
+#elif defined ( __linux__ )
+    fdatasync ( File.handle() );
+#else
+    fsync ( File.handle() );
+#endif
+}
+
+void CSessionRecorder::WaitWhileRunning ( const int iTimeMs )
+{
+    // wait in small steps so that the end of the session is not delayed
+    for ( int i = 0; bRun && ( i < iTimeMs ); i += 10 )
+    {
+        msleep ( 10 );
+    }
+}
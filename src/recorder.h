@@ -0,0 +1,148 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2014
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#if !defined ( RECORDER_HOIHGE7LKJH83JH8_3_4344LKJH6ZTEIUHF1912__INCLUDED_ )
+#define RECORDER_HOIHGE7LKJH83JH8_3_4344LKJH6ZTEIUHF1912__INCLUDED_
+
+#include <QThread>
+#include <QFile>
+#include <QDir>
+#include <QDateTime>
+#include <QTextStream>
+#include <QAtomicInt>
+#include "global.h"
+#include "buffer.h"
+#include "util.h"
+
+
+/* Definitions ****************************************************************/
+// each track has a ring buffer for four seconds of stereo audio, if the disk
+// falls behind the audio is dropped
+#define RECORDER_RING_SIZE_SAMPLES          ( 4 * 2 * SYSTEM_SAMPLE_RATE_HZ )
+
+// the writer thread writes the audio of all tracks with this interval
+#define RECORDER_WRITE_INTERV_MS            250
+
+// name of the session timeline file (Audacity list of files format)
+#define RECORDER_TIMELINE_FILE_NAME         "session.lof"
+
+// the size in the header of a WAV file is limited to 32 bits, the audio after
+// this size is still written (most tools can read it if they ignore the size)
+#define RECORDER_MAX_WAV_DATA_SIZE          0xFFFFFFD8u
+
+// states of a track, set by the mixer (active, closing) and by the writer
+// thread (idle)
+#define RECORDER_TRACK_IDLE                 0
+#define RECORDER_TRACK_ACTIVE               1
+#define RECORDER_TRACK_CLOSING              2
+
+
+/* Classes ********************************************************************/
+// Multitrack session recorder -------------------------------------------------
+// The decoded audio of each connected client is recorded in a separate stereo
+// WAV file. A session lasts from the start to the stop of the server and is
+// stored in its own directory. A track starts when a client connects to a
+// channel and ends when it disconnects, the file name contains the channel
+// number and the start time in the session in ms. All tracks are listed with
+// their offset in the session timeline file so that they can be imported
+// aligned.
+// The mixer only copies the audio in a lock-free ring buffer per channel and
+// never blocks. All file operations are done by the writer thread.
+class CSessionRecorder : public QThread
+{
+public:
+    CSessionRecorder ( const int  iNFrameSizeSamples,
+                       const int  iNMaxNumChannels,
+                       const bool bNSyncToDisk );
+
+    virtual ~CSessionRecorder();
+
+    // starts a new session in a new sub directory of the given directory
+    void Start ( const QString& strNBaseDirName );
+
+    // does not wait for the writer thread, can be called by the mixer
+    void Stop() { bRun = false; }
+
+    // called by the mixer for each timer tick, never blocks
+    void Process ( const CVector<int>&               vecChanIDs,
+                   const CVector<CVector<int16_t> >& vecvecsData,
+                   const CVector<int>&               vecNumAudioChannels,
+                   const int                         iNumClients );
+
+    int GetNumDroppedSamples() { return iNumDroppedSamples.fetchAndAddRelaxed ( 0 ); }
+
+protected:
+    class CTrack
+    {
+    public:
+        CTrack() : bMixerActive ( false ), iStartSample ( 0 ),
+            iState ( RECORDER_TRACK_IDLE ), iNumDroppedSamples ( 0 ),
+            iNumPendingSilence ( 0 ), pFile ( NULL ),
+            iNumWrittenSamples ( 0 ) {}
+
+        // mixer thread only
+        bool                     bMixerActive;
+
+        // written by the mixer before the state is changed
+        qint64                   iStartSample;
+
+        QAtomicInt               iState;
+        QAtomicInt               iNumDroppedSamples;
+        CSpscRingBuffer<int16_t> Ring;
+
+        // the audio which was dropped by the mixer is replaced by silence in
+        // the ring buffer as soon as there is space again, the silence which
+        // is still pending when the track is closed is added by the writer
+        QAtomicInt               iNumPendingSilence;
+
+        // writer thread only
+        QFile*                   pFile;
+        qint64                   iNumWrittenSamples;
+    };
+
+    virtual void run();
+
+    void WriteTracks ( const bool bIsFinal );
+    void WriteSilence ( CTrack& Track, const int iNumSamples );
+    void OpenTrack ( CTrack& Track, const int iChanID );
+    void CloseTrack ( CTrack& Track, const int iChanID );
+    void WriteWavHeader ( QFile& File, const qint64 iNumSamples );
+    void SyncToDisk ( QFile& File );
+    void WaitWhileRunning ( const int iTimeMs );
+
+    int                iFrameSizeSamples;
+    bool               bSyncToDisk;
+    CVector<CTrack>    vecTracks;
+    CVector<bool>      vecbConnected;
+    CVector<int16_t>   vecsStereoData;
+    qint64             iSessionSample;
+    QAtomicInt         iNumDroppedSamples;
+
+    QString            strSessionDirName;
+    volatile bool      bRun;
+    CVector<int16_t>   vecsWriteData;
+    QFile              TimelineFile;
+};
+
+#endif /* !defined ( RECORDER_HOIHGE7LKJH83JH8_3_4344LKJH6ZTEIUHF1912__INCLUDED_ ) */
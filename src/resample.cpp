@@ -0,0 +1,340 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2014
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#include "resample.h"
+
+
+/* Fractional resampler implementation ****************************************/
+CFracResample::CFracResample() :
+    iNumChannels  ( 0 ),
+    iBlockSize    ( 0 ),
+    iMaxNumFrames ( 0 ),
+    iFillFrames   ( 0 ),
+    dPos          ( 0 )
+{
+    // Calculate the polyphase filter bank: windowed sinc function (Kaiser
+    // window) with a cut-off frequency slightly below the Nyquist frequency.
+    // One additional phase is stored for the linear interpolation between the
+    // last phase and the next input sample.
+    const int    iHalfNumTaps = RESAMPLE_NUM_TAPS / 2;
+    const double dCutOff      = 0.95; // normalized to the Nyquist frequency
+    const double dBeta        = 8.0;  // Kaiser window parameter
+    const double dNormWindow  = BesselI0 ( dBeta );
+    const double dPi          = 3.14159265358979323846;
+
+    vecdFilterTable.Init ( ( RESAMPLE_NUM_PHASES + 1 ) * RESAMPLE_NUM_TAPS );
+
+    for ( int iPhase = 0; iPhase <= RESAMPLE_NUM_PHASES; iPhase++ )
+    {
+        const double dFrac =
+            static_cast<double> ( iPhase ) / RESAMPLE_NUM_PHASES;
+
+        double dSum = 0;
+
+        for ( int k = 0; k < RESAMPLE_NUM_TAPS; k++ )
+        {
+            // distance of the current tap to the interpolation position (the
+            // interpolation position is between tap "iHalfNumTaps - 1" and tap
+            // "iHalfNumTaps")
+            const double dX =
+                static_cast<double> ( k - ( iHalfNumTaps - 1 ) ) - dFrac;
+
+            // Kaiser window
+            const double dXNorm = dX / iHalfNumTaps;
+            double       dWindow = 0;
+
+            if ( fabs ( dXNorm ) < 1.0 )
+            {
+                dWindow = BesselI0 ( dBeta * sqrt ( 1.0 - dXNorm * dXNorm ) ) /
+                    dNormWindow;
+            }
+
+            // sinc function
+            double dSinc = dCutOff;
+
+            if ( dX != 0.0 )
+            {
+                dSinc = sin ( dPi * dCutOff * dX ) / ( dPi * dX );
+            }
+
+            vecdFilterTable[iPhase * RESAMPLE_NUM_TAPS + k] = dSinc * dWindow;
+            dSum += dSinc * dWindow;
+        }
+
+        // normalize the filter of the current phase to a DC gain of one
+        for ( int k = 0; k < RESAMPLE_NUM_TAPS; k++ )
+        {
+            vecdFilterTable[iPhase * RESAMPLE_NUM_TAPS + k] /= dSum;
+        }
+    }
+}
+
+double CFracResample::BesselI0 ( const double dX )
+{
+    // zeroth order modified Bessel function of the first kind (power series)
+    double dSum  = 1.0;
+    double dTerm = 1.0;
+
+    for ( int k = 1; k < 50; k++ )
+    {
+        dTerm *= ( dX / ( 2 * k ) ) * ( dX / ( 2 * k ) );
+        dSum  += dTerm;
+
+        if ( dTerm < dSum * 1e-12 )
+        {
+            break;
+        }
+    }
+
+    return dSum;
+}
+
+void CFracResample::Init ( const int iNewNumChannels,
+                           const int iNewBlockSize )
+{
+    iNumChannels = iNewNumChannels;
+    iBlockSize   = iNewBlockSize;
+
+    // we never need more than the filter history and two blocks in the
+    // buffer, use some more space for safety reasons
+    iMaxNumFrames = RESAMPLE_NUM_TAPS + 4 * iBlockSize;
+
+    vecdBuffer.Init ( iMaxNumFrames * iNumChannels );
+
+    Reset();
+}
+
+void CFracResample::Reset()
+{
+    // The buffer is pre-filled with the filter history (zeros). With this
+    // initialization the resampler does only introduce half the number of
+    // filter taps as delay if the ratio is one.
+    vecdBuffer.Reset ( 0 );
+    iFillFrames = RESAMPLE_NUM_TAPS - 1;
+    dPos        = 0;
+}
+
+int CFracResample::GetNumRequiredInputBlocks ( const double dRatio ) const
+{
+    // the last output sample of the next block requires the input frames up
+    // to the last filter tap
+    const int iRequiredFrames = static_cast<int> (
+        floor ( dPos + ( iBlockSize - 1 ) * dRatio ) ) + RESAMPLE_NUM_TAPS;
+
+    if ( iRequiredFrames <= iFillFrames )
+    {
+        return 0;
+    }
+
+    return ( iRequiredFrames - iFillFrames + iBlockSize - 1 ) / iBlockSize;
+}
+
+double CFracResample::GetFillLevelBlocks() const
+{
+    // number of input frames which are not yet consumed (without the filter
+    // history), given in blocks
+    if ( iBlockSize == 0 )
+    {
+        return 0;
+    }
+
+    return ( iFillFrames - ( RESAMPLE_NUM_TAPS - 1 ) - dPos ) / iBlockSize;
+}
+
+bool CFracResample::Put ( const int16_t* psData )
+{
+    // check if there is not enough space available
+    if ( iFillFrames + iBlockSize > iMaxNumFrames )
+    {
+        return false;
+    }
+
+    const int iNumSamples = iBlockSize * iNumChannels;
+    const int iOffset     = iFillFrames * iNumChannels;
+
+    for ( int i = 0; i < iNumSamples; i++ )
+    {
+        vecdBuffer[iOffset + i] = psData[i];
+    }
+
+    iFillFrames += iBlockSize;
+
+    return true;
+}
+
+void CFracResample::Get ( int16_t*     psData,
+                          const double dRatio )
+{
+    int i, j, k;
+
+    for ( i = 0; i < iBlockSize; i++ )
+    {
+        const int iStart = static_cast<int> ( dPos );
+
+        if ( iStart + RESAMPLE_NUM_TAPS <= iFillFrames )
+        {
+            // get the two neighbouring phases of the filter bank and the
+            // linear interpolation factor in between them
+            const double dPhase =
+                ( dPos - iStart ) * RESAMPLE_NUM_PHASES;
+
+            const int    iPhase       = static_cast<int> ( dPhase );
+            const double dFracPhase   = dPhase - iPhase;
+            const int    iCoeffOffset = iPhase * RESAMPLE_NUM_TAPS;
+
+            for ( j = 0; j < iNumChannels; j++ )
+            {
+                double dOut = 0;
+
+                for ( k = 0; k < RESAMPLE_NUM_TAPS; k++ )
+                {
+                    const double dCoeffA =
+                        vecdFilterTable[iCoeffOffset + k];
+
+                    const double dCoeffB =
+                        vecdFilterTable[iCoeffOffset + RESAMPLE_NUM_TAPS + k];
+
+                    dOut += ( dCoeffA + dFracPhase * ( dCoeffB - dCoeffA ) ) *
+                        vecdBuffer[( iStart + k ) * iNumChannels + j];
+                }
+
+                psData[i * iNumChannels + j] = Double2Short ( dOut );
+            }
+        }
+        else
+        {
+            // not enough input data available (should not happen if the
+            // required number of input blocks was put), output silence
+            for ( j = 0; j < iNumChannels; j++ )
+            {
+                psData[i * iNumChannels + j] = 0;
+            }
+        }
+
+        dPos += dRatio;
+    }
+
+    // remove the consumed input frames from the buffer
+    int iNumConsumedFrames = static_cast<int> ( dPos );
+
+    if ( iNumConsumedFrames > iFillFrames )
+    {
+        iNumConsumedFrames = iFillFrames;
+        dPos               = iFillFrames;
+    }
+
+    std::copy ( vecdBuffer.begin() + iNumConsumedFrames * iNumChannels,
+                vecdBuffer.begin() + iFillFrames * iNumChannels,
+                vecdBuffer.begin() );
+
+    iFillFrames -= iNumConsumedFrames;
+    dPos        -= iNumConsumedFrames;
+}
+
+
+/* Clock drift compensation implementation ************************************/
+void CClockDriftComp::Init ( const int iNewNumChannels,
+                             const int iNewBlockSize )
+{
+    Resample.Init ( iNewNumChannels, iNewBlockSize );
+
+    Reset();
+}
+
+void CClockDriftComp::Reset()
+{
+    Resample.Reset();
+
+    dFilteredFillLevel = 0;
+    dDriftEst          = 0;
+    dRatio             = 1.0;
+    iInitCounter       = CLOCK_DRIFT_INIT_NUM_BLOCKS;
+}
+
+int CClockDriftComp::Update ( const double dJitBufFillLevel,
+                              const double dJitBufTargetFillLevel )
+{
+/*
+    The fill level is given in blocks. If the resampling ratio differs from one
+    by "d", the fill level changes by "d" blocks per block. The controller
+    parameters are chosen for a critically damped loop with a time constant of
+    approx. 5 s. The fill level itself is smoothed by an IIR filter with a time
+    constant of approx. 0.5 s to get rid of the network jitter.
+*/
+    const double dMaxDrift  = CLOCK_DRIFT_MAX_PPM * 1e-6;
+    const double dPropGain  = 1.0 / 1875;
+    const double dIntegGain = dPropGain * dPropGain / 4;
+    double       dWeight    = 0.995;
+
+    // the input frames which are still stored in the resampler are part of
+    // the total buffer fill level
+    const double dFillLevel =
+        dJitBufFillLevel + Resample.GetFillLevelBlocks();
+
+    if ( iInitCounter > 0 )
+    {
+        // initialization phase: the jitter buffer is just filled, only track
+        // the fill level (with a faster IIR filter) but do not control yet
+        iInitCounter--;
+        dWeight = 0.95;
+    }
+
+    dFilteredFillLevel =
+        dFilteredFillLevel * dWeight + ( 1.0 - dWeight ) * dFillLevel;
+
+    if ( iInitCounter == 0 )
+    {
+        const double dError = dFilteredFillLevel - dJitBufTargetFillLevel;
+
+        // integral part (drift estimate)
+        dDriftEst += dIntegGain * dError;
+
+        if ( dDriftEst > dMaxDrift )
+        {
+            dDriftEst = dMaxDrift;
+        }
+        else if ( dDriftEst < -dMaxDrift )
+        {
+            dDriftEst = -dMaxDrift;
+        }
+
+        // proportional part
+        double dCurDeviation = dDriftEst + dPropGain * dError;
+
+        if ( dCurDeviation > dMaxDrift )
+        {
+            dCurDeviation = dMaxDrift;
+        }
+        else if ( dCurDeviation < -dMaxDrift )
+        {
+            dCurDeviation = -dMaxDrift;
+        }
+
+        // a fill level above the target requires to consume more input frames
+        // than output frames are generated
+        dRatio = 1.0 + dCurDeviation;
+    }
+
+    return Resample.GetNumRequiredInputBlocks ( dRatio );
+}
@@ -0,0 +1,122 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2014
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#if !defined ( RESAMPLE_HOIH9345KJH98_3_4344_BB23945IUHF1912__INCLUDED_ )
+#define RESAMPLE_HOIH9345KJH98_3_4344_BB23945IUHF1912__INCLUDED_
+
+#include "util.h"
+#include "global.h"
+
+
+/* Definitions ****************************************************************/
+// number of filter taps of the fractional resampler (must be even), the
+// algorithmic delay of the resampler is half the number of taps
+#define RESAMPLE_NUM_TAPS                   16
+
+// number of phases of the polyphase filter bank (the filter coefficients for
+// positions in between two phases are linearly interpolated)
+#define RESAMPLE_NUM_PHASES                 128
+
+// maximum clock drift which is compensated (given in parts per million, the
+// sound card clocks are usually much more accurate than this value)
+#define CLOCK_DRIFT_MAX_PPM                 1000
+
+// number of blocks after a reset in which the drift compensation is not yet
+// active since the jitter buffer is just filled (approx. 1 s)
+#define CLOCK_DRIFT_INIT_NUM_BLOCKS         375
+
+
+/* Classes ********************************************************************/
+// Fractional resampler --------------------------------------------------------
+// Resamples interleaved audio blocks of a fixed size with a ratio close to
+// one. The ratio may be changed from block to block without introducing any
+// discontinuities in the output signal.
+class CFracResample
+{
+public:
+    CFracResample();
+
+    void Init ( const int iNewNumChannels,
+                const int iNewBlockSize );
+
+    void Reset();
+
+    int GetNumChannels() const { return iNumChannels; }
+    int GetBlockSize() const { return iBlockSize; }
+
+    int GetNumRequiredInputBlocks ( const double dRatio ) const;
+    double GetFillLevelBlocks() const;
+
+    bool Put ( const int16_t* psData );
+    void Get ( int16_t* psData, const double dRatio );
+
+protected:
+    double BesselI0 ( const double dX );
+
+    CVector<double> vecdFilterTable;
+    CVector<double> vecdBuffer;
+    int             iNumChannels;
+    int             iBlockSize;
+    int             iMaxNumFrames;
+    int             iFillFrames;
+    double          dPos;
+};
+
+
+// Clock drift compensation ----------------------------------------------------
+// The sound card clock of the sender is not synchronized with the clock of the
+// receiver. The mismatch slowly fills or drains the jitter buffer. We estimate
+// the drift from the jitter buffer fill level with a PI controller (the
+// integral part converges to the actual clock drift) and apply a fractional
+// resampler to the decoded audio which keeps the jitter buffer at its target
+// fill level.
+class CClockDriftComp
+{
+public:
+    CClockDriftComp() { Reset(); }
+
+    void Init ( const int iNewNumChannels,
+                const int iNewBlockSize = SYSTEM_FRAME_SIZE_SAMPLES );
+    void Reset();
+
+    int GetNumChannels() const { return Resample.GetNumChannels(); }
+    int GetBlockSize() const { return Resample.GetBlockSize(); }
+    double GetDriftPPM() const { return dDriftEst * 1e6; }
+
+    int Update ( const double dJitBufFillLevel,
+                 const double dJitBufTargetFillLevel );
+
+    bool Put ( const int16_t* psData ) { return Resample.Put ( psData ); }
+    void Get ( int16_t* psData ) { Resample.Get ( psData, dRatio ); }
+
+protected:
+    CFracResample Resample;
+
+    double        dFilteredFillLevel;
+    double        dDriftEst;
+    double        dRatio;
+    int           iInitCounter;
+};
+
+#endif /* !defined ( RESAMPLE_HOIH9345KJH98_3_4344_BB23945IUHF1912__INCLUDED_ ) */
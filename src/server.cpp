@@ -25,14 +25,415 @@
 #include "server.h"
 
 
+// CConnAdmission implementation ***********************************************
+CConnAdmission::CConnAdmission() :
+    vecEntries      ( CONN_ADM_TABLE_SIZE ),
+    iAdmittedKeyIdx ( 0 )
+{
+    // the secret for the cookie generation is random and only known by this
+    // server instance
+    vecbySecret = QUuid::createUuid().toRfc4122() +
+                  QUuid::createUuid().toRfc4122();
+}
+
+void CConnAdmission::Reset()
+{
+    QMutexLocker locker ( &Mutex );
+
+    for ( int i = 0; i < CONN_ADM_TABLE_SIZE; i++ )
+    {
+        vecEntries[i] = CEntry();
+    }
+}
+
+uint32_t CConnAdmission::CalcCookie ( const CHostAddress& HostAddr,
+                                      const qint64        iTimeSlot ) const
+{
+    // hash the secret together with the address of the client and the time
+    // slot, the first four bytes of the hash are the cookie
+    QByteArray vecbyHashInput ( vecbySecret );
+    const quint32 iIPAddr = HostAddr.InetAddr.toIPv4Address();
+
+    for ( int i = 0; i < 4; i++ )
+    {
+        vecbyHashInput.append ( static_cast<char> ( ( iIPAddr >> ( 8 * i ) ) & 0xFF ) );
+    }
+
+    vecbyHashInput.append ( static_cast<char> ( HostAddr.iPort & 0xFF ) );
+    vecbyHashInput.append ( static_cast<char> ( ( HostAddr.iPort >> 8 ) & 0xFF ) );
+
+    for ( int i = 0; i < 8; i++ )
+    {
+        vecbyHashInput.append ( static_cast<char> ( ( iTimeSlot >> ( 8 * i ) ) & 0xFF ) );
+    }
+
+    const QByteArray vecbyHash =
+        QCryptographicHash::hash ( vecbyHashInput, QCryptographicHash::Sha1 );
+
+    uint32_t iCookie = 0;
+
+    for ( int i = 0; i < 4; i++ )
+    {
+        iCookie |= static_cast<uint32_t> ( static_cast<uint8_t> ( vecbyHash[i] ) ) << ( 8 * i );
+    }
+
+    return iCookie;
+}
+
+bool CConnAdmission::CheckCookie ( const CHostAddress& HostAddr,
+                                   const uint32_t      iCookie ) const
+{
+    // the cookie of the previous time slot is still accepted so that a
+    // challenge sent right before the end of a time slot is not lost
+    const qint64 iCurTimeSlot = GetCurTimeSlot();
+
+    return ( iCookie == CalcCookie ( HostAddr, iCurTimeSlot ) ) ||
+           ( iCookie == CalcCookie ( HostAddr, iCurTimeSlot - 1 ) );
+}
+
+int CConnAdmission::GetEntry ( const CHostAddress& HostAddr,
+                               const qint64        iCurTimeMs )
+{
+    // note that the mutex must be locked by the caller
+    int iFreeIdx   = INVALID_CONN_ADM_ENTRY;
+    int iOldestIdx = INVALID_CONN_ADM_ENTRY;
+
+    for ( int i = 0; i < CONN_ADM_TABLE_SIZE; i++ )
+    {
+        if ( vecEntries[i].bUsed )
+        {
+            if ( vecEntries[i].HostAddr == HostAddr )
+            {
+                return i;
+            }
+
+            // entries which are not used anymore can be replaced, entries of
+            // senders which are not admitted yet are replaced first
+            if ( iCurTimeMs - vecEntries[i].iLastTimeMs > CONN_ADM_ENTRY_TIMEOUT_MS )
+            {
+                iFreeIdx = i;
+            }
+            else if ( !vecEntries[i].bAdmitted &&
+                      ( ( iOldestIdx == INVALID_CONN_ADM_ENTRY ) ||
+                        ( vecEntries[i].iLastTimeMs < vecEntries[iOldestIdx].iLastTimeMs ) ) )
+            {
+                iOldestIdx = i;
+            }
+        }
+        else
+        {
+            iFreeIdx = i;
+        }
+    }
+
+    if ( iFreeIdx == INVALID_CONN_ADM_ENTRY )
+    {
+        iFreeIdx = iOldestIdx;
+    }
+
+    if ( iFreeIdx != INVALID_CONN_ADM_ENTRY )
+    {
+        // initialize the new entry
+        vecEntries[iFreeIdx]              = CEntry();
+        vecEntries[iFreeIdx].bUsed        = true;
+        vecEntries[iFreeIdx].HostAddr     = HostAddr;
+        vecEntries[iFreeIdx].iFirstTimeMs = iCurTimeMs;
+        vecEntries[iFreeIdx].iLastTimeMs  = iCurTimeMs;
+    }
+
+    return iFreeIdx;
+}
+
+void CConnAdmission::Admit ( const CHostAddress& HostAddr )
+{
+    QMutexLocker locker ( &Mutex );
+
+    const int iIdx = GetEntry ( HostAddr, QDateTime::currentMSecsSinceEpoch() );
+
+    if ( iIdx != INVALID_CONN_ADM_ENTRY )
+    {
+        vecEntries[iIdx].bAdmitted   = true;
+        vecEntries[iIdx].iLastTimeMs = QDateTime::currentMSecsSinceEpoch();
+    }
+
+    // the audio packets of the admitted sender must pass the pre-check even
+    // if the server is flooded with packets of unknown senders
+    iAdmittedKeys[iAdmittedKeyIdx].fetchAndStoreRelease ( GetAddrKey ( HostAddr ) );
+    iAdmittedKeyIdx = ( iAdmittedKeyIdx + 1 ) % CONN_ADM_NUM_ADMITTED_KEYS;
+}
+
+bool CConnAdmission::PreCheckAudioSender ( const CHostAddress& HostAddr )
+{
+    const int iKey = GetAddrKey ( HostAddr );
+
+    for ( int i = 0; i < CONN_ADM_NUM_ADMITTED_KEYS; i++ )
+    {
+        if ( iAdmittedKeys[i].fetchAndAddAcquire ( 0 ) == iKey )
+        {
+            return true;
+        }
+    }
+
+    // limit the number of packets per time window (the reset of the counter
+    // is not exact if two threads start a new window at the same time which
+    // is not a problem for a rate limit)
+    const int iCurWindow = static_cast<int> (
+        QDateTime::currentMSecsSinceEpoch() / CONN_ADM_PRE_CHECK_WINDOW_MS );
+
+    if ( iPreCheckWindow.fetchAndAddRelaxed ( 0 ) != iCurWindow )
+    {
+        iPreCheckWindow.fetchAndStoreRelaxed ( iCurWindow );
+        iNumPreChecks.fetchAndStoreRelaxed ( 0 );
+    }
+
+    return iNumPreChecks.fetchAndAddRelaxed ( 1 ) < CONN_ADM_PRE_CHECK_MAX_NUM_PACKETS;
+}
+
+int CConnAdmission::GetAddrKey ( const CHostAddress& HostAddr )
+{
+    const uint32_t iKey =
+        ( HostAddr.InetAddr.toIPv4Address() * 2654435761u ) ^
+        ( static_cast<uint32_t> ( HostAddr.iPort ) * 40503u );
+
+    // zero is the key of an unused channel
+    return static_cast<int> ( iKey | 1 );
+}
+
+bool CConnAdmission::CheckAudioSender ( const CHostAddress& HostAddr,
+                                        bool&               bSendChallenge )
+{
+    QMutexLocker locker ( &Mutex );
+
+    const qint64 iCurTimeMs = QDateTime::currentMSecsSinceEpoch();
+    bool         bAdmitted  = false;
+
+    bSendChallenge = false;
+
+    const int iIdx = GetEntry ( HostAddr, iCurTimeMs );
+
+    if ( iIdx == INVALID_CONN_ADM_ENTRY )
+    {
+        // the table is full with admitted senders, the sender has to try
+        // again later
+        return false;
+    }
+
+    CEntry& Entry = vecEntries[iIdx];
+
+    Entry.iNumPackets++;
+    Entry.iLastTimeMs = iCurTimeMs;
+
+    // old clients do not know the challenge message, these are admitted if
+    // they continuously send audio packets for a while
+    if ( Entry.bAdmitted ||
+         ( ( Entry.iNumPackets >= CONN_ADM_LEGACY_MIN_NUM_PACKETS ) &&
+           ( iCurTimeMs - Entry.iFirstTimeMs >= CONN_ADM_LEGACY_MIN_TIME_MS ) ) )
+    {
+        // the entry is not needed anymore since a channel will be allocated
+        bAdmitted = true;
+        Entry     = CEntry();
+    }
+    else if ( ( Entry.iLastChallengeMs == 0 ) ||
+              ( iCurTimeMs - Entry.iLastChallengeMs >= CONN_ADM_CHALLENGE_INTERVAL_MS ) )
+    {
+        // rate limit the challenges to the same sender
+        bSendChallenge         = true;
+        Entry.iLastChallengeMs = iCurTimeMs;
+    }
+
+    return bAdmitted;
+}
+
+
+// CCLRateLimiter implementation ***********************************************
+CCLRateLimiter::CCLRateLimiter() :
+    vecEntries      ( CL_RATE_LIMIT_TABLE_SIZE ),
+    iExemptInetAddr ( 0 )
+{
+    EntryIdx.reserve ( CL_RATE_LIMIT_TABLE_SIZE );
+
+    Reset();
+}
+
+void CCLRateLimiter::Reset()
+{
+    const qint64 iCurTimeMs = QDateTime::currentMSecsSinceEpoch();
+
+    // all entries are put in the usage list so that a free entry is always
+    // taken from the tail of the list
+    for ( int i = 0; i < CL_RATE_LIMIT_TABLE_SIZE; i++ )
+    {
+        vecEntries[i]       = CEntry();
+        vecEntries[i].iPrev = i - 1;
+        vecEntries[i].iNext = ( i + 1 < CL_RATE_LIMIT_TABLE_SIZE ) ?
+            i + 1 : INVALID_CL_RATE_LIMIT_ENTRY;
+    }
+
+    iHead = 0;
+    iTail = CL_RATE_LIMIT_TABLE_SIZE - 1;
+    EntryIdx.clear();
+
+    GlobalBucket.Init ( CL_RATE_LIMIT_GLOBAL_BURST, iCurTimeMs );
+
+    iNumDroppedSource.fetchAndStoreRelaxed ( 0 );
+    iNumDroppedGlobal.fetchAndStoreRelaxed ( 0 );
+}
+
+void CCLRateLimiter::CTokenBucket::Update ( const double dRate,
+                                            const double dBurst,
+                                            const qint64 iCurTimeMs )
+{
+    // refill the bucket according to the elapsed time (the time may jump
+    // backwards if the system time is changed, in this case we do not refill)
+    const qint64 iElapsedMs = iCurTimeMs - iLastUpdateMs;
+
+    if ( iElapsedMs > 0 )
+    {
+        dTokens = min ( dBurst, dTokens + dRate * iElapsedMs / 1000 );
+    }
+
+    iLastUpdateMs = iCurTimeMs;
+}
+
+void CCLRateLimiter::Unlink ( const int iIdx )
+{
+    if ( vecEntries[iIdx].iPrev != INVALID_CL_RATE_LIMIT_ENTRY )
+    {
+        vecEntries[vecEntries[iIdx].iPrev].iNext = vecEntries[iIdx].iNext;
+    }
+    else
+    {
+        iHead = vecEntries[iIdx].iNext;
+    }
+
+    if ( vecEntries[iIdx].iNext != INVALID_CL_RATE_LIMIT_ENTRY )
+    {
+        vecEntries[vecEntries[iIdx].iNext].iPrev = vecEntries[iIdx].iPrev;
+    }
+    else
+    {
+        iTail = vecEntries[iIdx].iPrev;
+    }
+}
+
+void CCLRateLimiter::PushFront ( const int iIdx )
+{
+    vecEntries[iIdx].iPrev = INVALID_CL_RATE_LIMIT_ENTRY;
+    vecEntries[iIdx].iNext = iHead;
+
+    if ( iHead != INVALID_CL_RATE_LIMIT_ENTRY )
+    {
+        vecEntries[iHead].iPrev = iIdx;
+    }
+
+    iHead = iIdx;
+
+    if ( iTail == INVALID_CL_RATE_LIMIT_ENTRY )
+    {
+        iTail = iIdx;
+    }
+}
+
+int CCLRateLimiter::GetEntry ( const quint32 iInetAddr,
+                               const qint64  iCurTimeMs )
+{
+    int iIdx = EntryIdx.value ( iInetAddr, INVALID_CL_RATE_LIMIT_ENTRY );
+
+    if ( iIdx == INVALID_CL_RATE_LIMIT_ENTRY )
+    {
+        // replace the least recently used entry
+        iIdx = iTail;
+
+        if ( vecEntries[iIdx].bUsed )
+        {
+            EntryIdx.remove ( vecEntries[iIdx].iInetAddr );
+        }
+
+        vecEntries[iIdx].iInetAddr = iInetAddr;
+        vecEntries[iIdx].bUsed     = true;
+        vecEntries[iIdx].Bucket.Init ( CL_RATE_LIMIT_SOURCE_BURST, iCurTimeMs );
+
+        EntryIdx.insert ( iInetAddr, iIdx );
+    }
+
+    // move the entry to the front of the usage list
+    if ( iIdx != iHead )
+    {
+        Unlink ( iIdx );
+        PushFront ( iIdx );
+    }
+
+    return iIdx;
+}
+
+int CCLRateLimiter::GetMessageCost ( const int iRecID,
+                                     const int iNumServerListFrags )
+{
+    // the server list reply is much larger than all other replies, each
+    // fragment is a datagram of almost the maximum size
+    if ( iRecID == PROTMESSID_CLM_REQ_SERVER_LIST )
+    {
+        return min ( max ( iNumServerListFrags, 1 ) * CL_RATE_LIMIT_COST_SERVER_LIST_FRAG,
+                     CL_RATE_LIMIT_SOURCE_BURST );
+    }
+
+    return 1;
+}
+
+bool CCLRateLimiter::Allow ( const CHostAddress& HostAddr,
+                             const int           iCost )
+{
+    // the central server does not take any tokens
+    if ( ( iExemptInetAddr != 0 ) &&
+         ( HostAddr.InetAddr.toIPv4Address() == iExemptInetAddr ) )
+    {
+        return true;
+    }
+
+    const qint64 iCurTimeMs = QDateTime::currentMSecsSinceEpoch();
+
+    // per source address bucket (the port is not used since a misbehaving
+    // client may use arbitrary ports)
+    CTokenBucket& SourceBucket =
+        vecEntries[GetEntry ( HostAddr.InetAddr.toIPv4Address(), iCurTimeMs )].Bucket;
+
+    SourceBucket.Update ( CL_RATE_LIMIT_SOURCE_RATE,
+                          CL_RATE_LIMIT_SOURCE_BURST,
+                          iCurTimeMs );
+
+    if ( SourceBucket.dTokens < iCost )
+    {
+        iNumDroppedSource.fetchAndAddRelaxed ( 1 );
+        return false;
+    }
+
+    // global bucket
+    GlobalBucket.Update ( CL_RATE_LIMIT_GLOBAL_RATE,
+                          CL_RATE_LIMIT_GLOBAL_BURST,
+                          iCurTimeMs );
+
+    if ( GlobalBucket.dTokens < iCost )
+    {
+        iNumDroppedGlobal.fetchAndAddRelaxed ( 1 );
+        return false;
+    }
+
+    // the tokens are only taken if both buckets allow the message
+    SourceBucket.dTokens -= iCost;
+    GlobalBucket.dTokens -= iCost;
+
+    return true;
+}
+
+
 // CHighPrecisionTimer implementation ******************************************
 #ifdef _WIN32
-CHighPrecisionTimer::CHighPrecisionTimer()
+CHighPrecisionTimer::CHighPrecisionTimer ( const int iFrameSizeSamples )
 {
     // add some error checking, the high precision timer implementation only
-    // supports 128 samples frame size at 48 kHz sampling rate
-#if ( SYSTEM_FRAME_SIZE_SAMPLES != 128 )
-# error "Only system frame size of 128 samples is supported by this module"
+    // supports 128 (and 64) samples frame size at 48 kHz sampling rate
+#if ( SYSTEM_FRAME_SIZE_SAMPLES != 128 ) || ( SYSTEM_FRAME_SIZE_SAMPLES_SMALL != 64 )
+# error "Only system frame size of 128 (64) samples is supported by this module"
 #endif
 #if ( SYSTEM_SAMPLE_RATE_HZ != 48000 )
 # error "Only a system sample rate of 48 kHz is supported by this module"
@@ -53,6 +454,17 @@ CHighPrecisionTimer::CHighPrecisionTimer()
     veciTimeOutIntervals[1] = 1;
     veciTimeOutIntervals[2] = 0;
 
+    // for 64 sample frame size the intervals are exactly half of the above
+    // intervals, we use the same pattern with 1 ms resolution
+    if ( iFrameSizeSamples == SYSTEM_FRAME_SIZE_SAMPLES_SMALL )
+    {
+        iTimerResolutionMs = 1;
+    }
+    else
+    {
+        iTimerResolutionMs = 2;
+    }
+
     // connect timer timeout signal
     QObject::connect ( &Timer, SIGNAL ( timeout() ),
         this, SLOT ( OnTimer() ) );
@@ -64,8 +476,8 @@ void CHighPrecisionTimer::Start()
     iCurPosInVector  = 0;
     iIntervalCounter = 0;
 
-    // start internal timer with 2 ms resolution
-    Timer.start ( 2 );
+    // start internal timer with 2 ms (1 ms) resolution
+    Timer.start ( iTimerResolutionMs );
 }
 
 void CHighPrecisionTimer::Stop()
@@ -101,12 +513,12 @@ void CHighPrecisionTimer::OnTimer()
     }
 }
 #else // Mac and Linux
-CHighPrecisionTimer::CHighPrecisionTimer() :
+CHighPrecisionTimer::CHighPrecisionTimer ( const int iFrameSizeSamples ) :
     bRun ( false )
 {
     // calculate delay in ns
     const uint64_t iNsDelay =
-        ( (uint64_t) SYSTEM_FRAME_SIZE_SAMPLES * 1000000000 ) /
+        ( (uint64_t) iFrameSizeSamples * 1000000000 ) /
         (uint64_t) SYSTEM_SAMPLE_RATE_HZ; // in ns
 
 #if defined ( __APPLE__ ) || defined ( __MACOSX )
@@ -196,8 +608,39 @@ void CHighPrecisionTimer::run()
 #endif
 
 
+// CServerCodecModes implementation ********************************************
+CServerCodecModes::CServerCodecModes()
+{
+    int iOpusError;
+
+    CeltModeMono = cc6_celt_mode_create (
+        SYSTEM_SAMPLE_RATE_HZ, 1, SYSTEM_FRAME_SIZE_SAMPLES, NULL );
+
+    CeltModeStereo = cc6_celt_mode_create (
+        SYSTEM_SAMPLE_RATE_HZ, 2, SYSTEM_FRAME_SIZE_SAMPLES, NULL );
+
+    OpusMode = opus_custom_mode_create ( SYSTEM_SAMPLE_RATE_HZ,
+                                         SYSTEM_FRAME_SIZE_SAMPLES,
+                                         &iOpusError );
+
+    // only CELT does not support the small frame size
+    OpusModeSmall = opus_custom_mode_create ( SYSTEM_SAMPLE_RATE_HZ,
+                                              SYSTEM_FRAME_SIZE_SAMPLES_SMALL,
+                                              &iOpusError );
+}
+
+CServerCodecModes::~CServerCodecModes()
+{
+    opus_custom_mode_destroy ( OpusModeSmall );
+    opus_custom_mode_destroy ( OpusMode );
+    cc6_celt_mode_destroy ( CeltModeStereo );
+    cc6_celt_mode_destroy ( CeltModeMono );
+}
+
+
 // CServer implementation ******************************************************
 CServer::CServer ( const int      iNewMaxNumChan,
+                   const int      iNewMaxNumListeners,
                    const QString& strLoggingFileName,
                    const quint16  iPortNumber,
                    const QString& strHTMLStatusFileName,
@@ -205,34 +648,71 @@ CServer::CServer ( const int      iNewMaxNumChan,
                    const QString& strServerNameForHTMLStatusFile,
                    const QString& strCentralServer,
                    const QString& strServerInfo,
+                   const QString& strServerListFileName,
+                   const QString& strServerGroup,
+                   const QString& strUpstreamServer,
+                   const QString& strMixStreamFileName,
+                   const QString& strNRecordingDirName,
+                   const QString& strMixTapName,
                    const QString& strNewWelcomeMessage,
-                   const bool     bNCentServPingServerInList ) :
-    iMaxNumChannels      ( iNewMaxNumChan ),
-    Socket               ( this, iPortNumber ),
-    bWriteStatusHTMLFile ( false ),
-    ServerListManager    ( iPortNumber,
-                           strCentralServer,
-                           strServerInfo,
-                           iNewMaxNumChan,
-                           bNCentServPingServerInList,
-                           &ConnLessProtocol ),
-    bAutoRunMinimized    ( false ),
-    strWelcomeMessage    ( strNewWelcomeMessage )
+                   const bool     bNCentServPingServerInList,
+                   const bool     bNUseSmallFrameSize,
+                   const bool     bNRecordingSyncToDisk,
+                   const bool     bNMixTapGroupRead,
+                   CServerCodecModes* pNCodecModes ) :
+    iMaxNumChannels         ( iNewMaxNumChan ),
+    iServerFrameSizeSamples ( bNUseSmallFrameSize ?
+                              SYSTEM_FRAME_SIZE_SAMPLES_SMALL :
+                              SYSTEM_FRAME_SIZE_SAMPLES ),
+    pUplink                 ( NULL ),
+    Listeners               ( iServerFrameSizeSamples, iNewMaxNumListeners ),
+    pMixStream              ( NULL ),
+    pRecorder               ( NULL ),
+    strRecordingDirName     ( strNRecordingDirName ),
+    pMixTap                 ( NULL ),
+    iServerTickCnt          ( 0 ),
+    iLoadBusyNs             ( 0 ),
+    Socket                  ( this, iPortNumber ),
+    bWriteStatusHTMLFile    ( false ),
+    HighPrecisionTimer      ( iServerFrameSizeSamples ),
+    pRoomMixerPool          ( NULL ),
+    iRoomRunning            ( 0 ),
+    bRoomIdlePending        ( false ),
+    ServerListManager       ( iPortNumber,
+                              strCentralServer,
+                              strServerInfo,
+                              strServerListFileName,
+                              strServerGroup,
+                              iNewMaxNumChan,
+                              bNCentServPingServerInList,
+                              &ConnLessProtocol ),
+    bAutoRunMinimized       ( false ),
+    strWelcomeMessage       ( strNewWelcomeMessage )
 {
     int iOpusError;
     int i;
 
+    // the codec modes are shared by all channels, if no shared codec modes
+    // are given (single room), this server creates its own
+    if ( pNCodecModes == NULL )
+    {
+        pOwnCodecModes = new CServerCodecModes();
+        pCodecModes    = pOwnCodecModes;
+    }
+    else
+    {
+        pOwnCodecModes = NULL;
+        pCodecModes    = pNCodecModes;
+    }
+
     // create CELT encoder/decoder for each channel (must be done before
     // enabling the channels), create a mono and stereo encoder/decoder
     // for each channel
     for ( i = 0; i < iMaxNumChannels; i++ )
     {
         // init audio endocder/decoder (mono)
-        CeltModeMono[i] = cc6_celt_mode_create (
-            SYSTEM_SAMPLE_RATE_HZ, 1, SYSTEM_FRAME_SIZE_SAMPLES, NULL );
-
-        CeltEncoderMono[i] = cc6_celt_encoder_create ( CeltModeMono[i] );
-        CeltDecoderMono[i] = cc6_celt_decoder_create ( CeltModeMono[i] );
+        CeltEncoderMono[i] = cc6_celt_encoder_create ( pCodecModes->CeltModeMono );
+        CeltDecoderMono[i] = cc6_celt_decoder_create ( pCodecModes->CeltModeMono );
 
 #ifdef USE_LOW_COMPLEXITY_CELT_ENC
         // set encoder low complexity
@@ -240,15 +720,11 @@ CServer::CServer ( const int      iNewMaxNumChan,
                                cc6_CELT_SET_COMPLEXITY ( 1 ) );
 #endif
 
-        OpusMode[i] = opus_custom_mode_create ( SYSTEM_SAMPLE_RATE_HZ,
-                                                SYSTEM_FRAME_SIZE_SAMPLES,
-                                                &iOpusError );
-
-        OpusEncoderMono[i] = opus_custom_encoder_create ( OpusMode[i],
+        OpusEncoderMono[i] = opus_custom_encoder_create ( pCodecModes->OpusMode,
                                                           1,
                                                           &iOpusError );
 
-        OpusDecoderMono[i] = opus_custom_decoder_create ( OpusMode[i],
+        OpusDecoderMono[i] = opus_custom_decoder_create ( pCodecModes->OpusMode,
                                                           1,
                                                           &iOpusError );
 
@@ -267,11 +743,8 @@ CServer::CServer ( const int      iNewMaxNumChan,
 #endif
 
         // init audio endocder/decoder (stereo)
-        CeltModeStereo[i] = cc6_celt_mode_create (
-            SYSTEM_SAMPLE_RATE_HZ, 2, SYSTEM_FRAME_SIZE_SAMPLES, NULL );
-
-        CeltEncoderStereo[i] = cc6_celt_encoder_create ( CeltModeStereo[i] );
-        CeltDecoderStereo[i] = cc6_celt_decoder_create ( CeltModeStereo[i] );
+        CeltEncoderStereo[i] = cc6_celt_encoder_create ( pCodecModes->CeltModeStereo );
+        CeltDecoderStereo[i] = cc6_celt_decoder_create ( pCodecModes->CeltModeStereo );
 
 #ifdef USE_LOW_COMPLEXITY_CELT_ENC
         // set encoder low complexity
@@ -279,11 +752,11 @@ CServer::CServer ( const int      iNewMaxNumChan,
                                cc6_CELT_SET_COMPLEXITY ( 1 ) );
 #endif
 
-        OpusEncoderStereo[i] = opus_custom_encoder_create ( OpusMode[i],
+        OpusEncoderStereo[i] = opus_custom_encoder_create ( pCodecModes->OpusMode,
                                                             2,
                                                             &iOpusError );
 
-        OpusDecoderStereo[i] = opus_custom_decoder_create ( OpusMode[i],
+        OpusDecoderStereo[i] = opus_custom_decoder_create ( pCodecModes->OpusMode,
                                                             2,
                                                             &iOpusError );
 
@@ -300,6 +773,53 @@ CServer::CServer ( const int      iNewMaxNumChan,
         opus_custom_encoder_ctl ( OpusEncoderStereo[i],
                                   OPUS_SET_COMPLEXITY ( 1 ) );
 #endif
+
+        // init OPUS encoder/decoder for the small frame size (mono and
+        // stereo, only CELT does not support the small frame size)
+        OpusEncoderMonoSmall[i] = opus_custom_encoder_create ( pCodecModes->OpusModeSmall,
+                                                               1,
+                                                               &iOpusError );
+
+        OpusDecoderMonoSmall[i] = opus_custom_decoder_create ( pCodecModes->OpusModeSmall,
+                                                               1,
+                                                               &iOpusError );
+
+        OpusEncoderStereoSmall[i] = opus_custom_encoder_create ( pCodecModes->OpusModeSmall,
+                                                                 2,
+                                                                 &iOpusError );
+
+        OpusDecoderStereoSmall[i] = opus_custom_decoder_create ( pCodecModes->OpusModeSmall,
+                                                                 2,
+                                                                 &iOpusError );
+
+        // same settings as for the encoders with the default frame size
+        opus_custom_encoder_ctl ( OpusEncoderMonoSmall[i],
+                                  OPUS_SET_VBR ( 0 ) );
+
+        opus_custom_encoder_ctl ( OpusEncoderMonoSmall[i],
+                                  OPUS_SET_APPLICATION ( OPUS_APPLICATION_RESTRICTED_LOWDELAY ) );
+
+        opus_custom_encoder_ctl ( OpusEncoderStereoSmall[i],
+                                  OPUS_SET_VBR ( 0 ) );
+
+        opus_custom_encoder_ctl ( OpusEncoderStereoSmall[i],
+                                  OPUS_SET_APPLICATION ( OPUS_APPLICATION_RESTRICTED_LOWDELAY ) );
+
+#ifdef USE_LOW_COMPLEXITY_CELT_ENC
+        // set encoder low complexity
+        opus_custom_encoder_ctl ( OpusEncoderMonoSmall[i],
+                                  OPUS_SET_COMPLEXITY ( 1 ) );
+
+        opus_custom_encoder_ctl ( OpusEncoderStereoSmall[i],
+                                  OPUS_SET_COMPLEXITY ( 1 ) );
+#endif
+
+        // the encoder bit rates are set as soon as we know the number of
+        // coded bytes of the connected client
+        iOpusEncMonoNumCodedBytes[i]        = 0;
+        iOpusEncStereoNumCodedBytes[i]      = 0;
+        iOpusEncMonoSmallNumCodedBytes[i]   = 0;
+        iOpusEncStereoSmallNumCodedBytes[i] = 0;
     }
 
     // define colors for chat window identifiers
@@ -320,24 +840,42 @@ CServer::CServer ( const int      iNewMaxNumChan,
     // we always use stereo audio buffers (which is the worst case)
     vecsSendData.Init ( 2 * SYSTEM_FRAME_SIZE_SAMPLES );
 
-    // allocate worst case memory for the temporary vectors
+    // allocate worst case memory for the temporary vectors (the mix of the
+    // upstream server is an additional source after the connected channels)
     vecChanIDsCurConChan.Init ( iMaxNumChannels );
     vecvecdGains.Init         ( iMaxNumChannels );
-    vecvecsData.Init          ( iMaxNumChannels );
-    vecNumAudioChannels.Init  ( iMaxNumChannels );
+    vecvecsData.Init          ( iMaxNumChannels + 1 );
+    vecNumAudioChannels.Init  ( iMaxNumChannels + 1 );
+    vecvecsChanDecFrame.Init  ( iMaxNumChannels );
+    vecvecsChanEncFrame.Init  ( iMaxNumChannels );
 
     for ( i = 0; i < iMaxNumChannels; i++ )
     {
         // init vectors storing information of all channels
-        vecvecdGains[i].Init ( iMaxNumChannels );
+        vecvecdGains[i].Init ( iMaxNumChannels + 1 );
 
         // we always use stereo audio buffers (see "vecsSendData")
-        vecvecsData[i].Init  ( 2 * SYSTEM_FRAME_SIZE_SAMPLES );
+        vecvecsData[i].Init         ( 2 * SYSTEM_FRAME_SIZE_SAMPLES );
+        vecvecsChanDecFrame[i].Init ( 2 * SYSTEM_FRAME_SIZE_SAMPLES );
+        vecvecsChanEncFrame[i].Init ( 2 * SYSTEM_FRAME_SIZE_SAMPLES );
     }
 
     // allocate worst case memory for the coded data
     vecbyCodedData.Init ( MAX_SIZE_BYTES_NETW_BUF );
 
+    // the submix for the upstream server and the room mix for the listeners
+    // contain all sources with unity gain
+    vecvecsData[iMaxNumChannels].Init ( 2 * SYSTEM_FRAME_SIZE_SAMPLES );
+    vecdUnityGains.Init               ( iMaxNumChannels + 1, 1.0 );
+    vecsUplinkData.Init               ( 2 * SYSTEM_FRAME_SIZE_SAMPLES );
+    vecsRoomMix.Init                  ( 2 * SYSTEM_FRAME_SIZE_SAMPLES );
+
+    // no connected clients list was sent yet (the version zero is reserved
+    // for the complete list in the list delta message)
+    vecChanListLast.Init     ( 0 );
+    iChanListVersion = 1;
+    veciChanListVersion.Init ( iMaxNumChannels, PROT_INVALID_VALUE );
+
 
     // enable history graph (if requested)
     if ( !strHistoryFileName.isEmpty() )
@@ -377,19 +915,83 @@ CServer::CServer ( const int      iNewMaxNumChan,
             QString().number( static_cast<int> ( iPortNumber ) ) );
     }
 
+    // cascading into an upstream server (if requested), the fader of this
+    // server in the upstream server shows the server name (the uplink adds a
+    // random suffix to make the fader tag unique)
+    if ( !strUpstreamServer.isEmpty() )
+    {
+        QString strUplinkName = ServerListManager.GetServerName();
+
+        if ( strUplinkName.isEmpty() )
+        {
+            strUplinkName = "Uplink";
+        }
+
+        pUplink = new CServerUplink ( iServerFrameSizeSamples,
+                                      strUplinkName );
+
+        if ( !pUplink->SetUpstreamAddr ( strUpstreamServer ) )
+        {
+            delete pUplink;
+            pUplink = NULL;
+        }
+    }
+
+    // encoded stream of the room mix (if requested), the output is opened
+    // by the writer thread since opening a named pipe blocks until a reader
+    // is available
+    if ( !strMixStreamFileName.isEmpty() )
+    {
+        pMixStream = new CMixStreamWriter();
+        pMixStream->Start ( strMixStreamFileName );
+    }
+
+    // multitrack recording (if requested), a new session is started each time
+    // the server is started
+    if ( !strRecordingDirName.isEmpty() )
+    {
+        pRecorder = new CSessionRecorder ( iServerFrameSizeSamples,
+                                           iMaxNumChannels,
+                                           bNRecordingSyncToDisk );
+    }
+
+    // shared memory mix tap (if requested)
+    if ( !strMixTapName.isEmpty() )
+    {
+        pMixTap = new CMixTap ( iServerFrameSizeSamples, iMaxNumChannels );
+
+        if ( !pMixTap->Open ( strMixTapName, bNMixTapGroupRead ) )
+        {
+            delete pMixTap;
+            pMixTap = NULL;
+        }
+    }
+
     // enable all channels (for the server all channel must be enabled the
     // entire life time of the software)
     for ( i = 0; i < iMaxNumChannels; i++ )
     {
         vecChannels[i].SetEnable ( true );
+
+        // the clients may only use the small frame size if the server runs
+        // with the small frame size
+        vecChannels[i].SetSmallFrameSizeSupported ( bNUseSmallFrameSize );
     }
 
 
+    // the dropped connection less messages are logged periodically
+    iLastLogNumDroppedSource = 0;
+    iLastLogNumDroppedGlobal = 0;
+
+
     // Connections -------------------------------------------------------------
     // connect timer timeout signal
     QObject::connect ( &HighPrecisionTimer, SIGNAL ( timeout() ),
         this, SLOT ( OnTimer() ) );
 
+    QObject::connect ( &TimerLogDropped, SIGNAL ( timeout() ),
+        this, SLOT ( OnTimerLogDropped() ) );
+
     QObject::connect ( &ConnLessProtocol,
         SIGNAL ( CLMessReadyForSending ( CHostAddress, CVector<uint8_t> ) ),
         this, SLOT ( OnSendCLProtMessage ( CHostAddress, CVector<uint8_t> ) ) );
@@ -411,8 +1013,16 @@ CServer::CServer ( const int      iNewMaxNumChan,
         this, SLOT ( OnCLUnregisterServerReceived ( CHostAddress ) ) );
 
     QObject::connect ( &ConnLessProtocol,
-        SIGNAL ( CLReqServerList ( CHostAddress ) ),
-        this, SLOT ( OnCLReqServerList ( CHostAddress ) ) );
+        SIGNAL ( CLServerLoadReceived ( CHostAddress, int, int, QString ) ),
+        this, SLOT ( OnCLServerLoadReceived ( CHostAddress, int, int, QString ) ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLReqGroupServer ( CHostAddress, QString, int ) ),
+        this, SLOT ( OnCLReqGroupServer ( CHostAddress, QString, int ) ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLReqServerList ( CHostAddress, bool ) ),
+        this, SLOT ( OnCLReqServerList ( CHostAddress, bool ) ) );
 
     QObject::connect ( &ConnLessProtocol,
         SIGNAL ( CLSendEmptyMes ( CHostAddress ) ),
@@ -426,6 +1036,14 @@ CServer::CServer ( const int      iNewMaxNumChan,
         SIGNAL ( CLReqVersionAndOS ( CHostAddress ) ),
         this, SLOT ( OnCLReqVersionAndOS ( CHostAddress ) ) );
 
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLConnChallengeRespReceived ( CHostAddress, quint32 ) ),
+        this, SLOT ( OnCLConnChallengeRespReceived ( CHostAddress, quint32 ) ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLReqListen ( CHostAddress, quint32, int, int, int, int ) ),
+        this, SLOT ( OnCLReqListen ( CHostAddress, quint32, int, int, int, int ) ) );
+
     // CODE TAG: MAX_NUM_CHANNELS_TAG
     // make sure we have MAX_NUM_CHANNELS connections!!!
     // send message
@@ -542,9 +1160,38 @@ CServer::CServer ( const int      iNewMaxNumChan,
     // start the socket (it is important to start the socket after all
     // initializations and connections)
     Socket.Start();
+
+    // the messages are also dropped while the server is idle, therefore the
+    // timer runs the entire life time of the server
+    TimerLogDropped.start ( SERVER_DROP_LOG_INTERV_MS );
+}
+
+CServer::~CServer()
+{
+    delete pUplink;
+    delete pMixStream;
+    delete pRecorder;
+    delete pMixTap;
+    delete pOwnCodecModes;
+}
+
+void CServer::OnTimerLogDropped()
+{
+    const int iNumDroppedSource = CLRateLimiter.GetNumDroppedSource();
+    const int iNumDroppedGlobal = CLRateLimiter.GetNumDroppedGlobal();
+
+    // only log the counters if messages were dropped since the last entry
+    if ( ( iNumDroppedSource != iLastLogNumDroppedSource ) ||
+         ( iNumDroppedGlobal != iLastLogNumDroppedGlobal ) )
+    {
+        Logging.AddCLMessagesDropped ( iNumDroppedSource, iNumDroppedGlobal );
+
+        iLastLogNumDroppedSource = iNumDroppedSource;
+        iLastLogNumDroppedGlobal = iNumDroppedGlobal;
+    }
 }
 
-void CServer::OnSendProtMessage ( int iChID, CVector<uint8_t> vecMessage )
+void CServer::OnSendProtMessage ( int iChID, const CVector<uint8_t>& vecMessage )
 {
     // the protocol queries me to call the function to send the message
     // send it through the network
@@ -554,6 +1201,13 @@ void CServer::OnSendProtMessage ( int iChID, CVector<uint8_t> vecMessage )
 void CServer::OnNewConnection ( int          iChID,
                                 CHostAddress RecHostAddr )
 {
+    // the new client does not have any connected clients list yet
+    MutexChanList.lock();
+    {
+        veciChanListVersion[iChID] = PROT_INVALID_VALUE;
+    }
+    MutexChanList.unlock();
+
     // on a new connection we query the network transport properties for the
     // audio packets (to use the correct network block size and audio
     // compression properties, etc.)
@@ -566,6 +1220,19 @@ void CServer::OnNewConnection ( int          iChID,
     // client or server thinks that the connection was still active, etc.)
     vecChannels[iChID].CreateReqJitBufMes();
 
+    // tell the client which features this server supports (old clients
+    // simply ignore this message)
+    if ( iServerFrameSizeSamples == SYSTEM_FRAME_SIZE_SAMPLES_SMALL )
+    {
+        vecChannels[iChID].CreateSupportedFeaturesMes (
+            PROT_SUPPORTED_FEATURES | PROT_FEATURE_SMALL_FRAME_SIZE );
+    }
+    else
+    {
+        vecChannels[iChID].CreateSupportedFeaturesMes (
+            PROT_SUPPORTED_FEATURES );
+    }
+
     // logging of new connected channel
     Logging.AddNewConnection ( RecHostAddr.InetAddr );
 
@@ -608,12 +1275,38 @@ CreateAndSendChanListForAllConChannels();
 
 void CServer::OnServerFull ( CHostAddress RecHostAddr )
 {
-    // inform the calling client that no channel is free
-    ConnLessProtocol.CreateCLServerFullMes ( RecHostAddr );
+    // inform the calling client that no channel is free (this is fired for
+    // each audio packet of the client, therefore it is rate limited)
+    if ( CLRateLimiter.Allow ( RecHostAddr ) )
+    {
+        ConnLessProtocol.CreateCLServerFullMes ( RecHostAddr );
+    }
+}
+
+void CServer::OnConnChallengeRequired ( CHostAddress RecHostAddr )
+{
+    // send a connection challenge to the unknown sender
+    if ( CLRateLimiter.Allow ( RecHostAddr ) )
+    {
+        ConnLessProtocol.CreateCLConnChallengeMes ( RecHostAddr,
+            ConnAdmission.GetCookie ( RecHostAddr ) );
+    }
+}
+
+void CServer::OnCLConnChallengeRespReceived ( CHostAddress InetAddr,
+                                              quint32      iCookie )
+{
+    // the client echoed the cookie of our challenge, now the next audio
+    // packet of this client is allowed to allocate a channel
+    if ( ConnAdmission.CheckCookie ( InetAddr, iCookie ) &&
+         ( FindChannel ( InetAddr ) == INVALID_CHANNEL_ID ) )
+    {
+        ConnAdmission.Admit ( InetAddr );
+    }
 }
 
-void CServer::OnSendCLProtMessage ( CHostAddress     InetAddr,
-                                    CVector<uint8_t> vecMessage )
+void CServer::OnSendCLProtMessage ( CHostAddress            InetAddr,
+                                    const CVector<uint8_t>& vecMessage )
 {
     // the protocol queries me to call the function to send the message
     // send it through the network
@@ -624,10 +1317,24 @@ void CServer::OnProtcolCLMessageReceived ( int              iRecID,
                                            CVector<uint8_t> vecbyMesBodyData,
                                            CHostAddress     RecHostAddr )
 {
-    // connection less messages are always processed
-    ConnLessProtocol.ParseConnectionLessMessageBody ( vecbyMesBodyData,
-                                                      iRecID,
-                                                      RecHostAddr );
+    // connection less messages are processed if the rate limits of the
+    // sender and of the server are not exceeded (this check is done before
+    // the message is parsed and before any reply is generated), the address
+    // of the central server may change if it is given by a host name
+    CLRateLimiter.SetExemptAddress (
+        ServerListManager.GetCentralServerHostAddress() );
+
+    const int iNumServerListFrags = ( iRecID == PROTMESSID_CLM_REQ_SERVER_LIST ) ?
+        ServerListManager.GetNumServerListFragments() : 0;
+
+    if ( CLRateLimiter.Allow ( RecHostAddr,
+                               CCLRateLimiter::GetMessageCost ( iRecID,
+                                                                iNumServerListFrags ) ) )
+    {
+        ConnLessProtocol.ParseConnectionLessMessageBody ( vecbyMesBodyData,
+                                                          iRecID,
+                                                          RecHostAddr );
+    }
 }
 
 void CServer::OnCLDisconnection ( CHostAddress InetAddr )
@@ -640,6 +1347,42 @@ void CServer::OnCLDisconnection ( CHostAddress InetAddr )
     {
         vecChannels[iCurChanID].Disconnect();
     }
+
+    // the sender may also be a listener
+    Listeners.Remove ( InetAddr );
+}
+
+void CServer::OnCLReqListen ( CHostAddress InetAddr,
+                              quint32      iCookie,
+                              int          iAudComprType,
+                              int          iNumAudioChannels,
+                              int          iNetwFrameSize,
+                              int          iFrameSizeSamples )
+{
+    // connected clients already get their own mix
+    if ( FindChannel ( InetAddr ) != INVALID_CHANNEL_ID )
+    {
+        return;
+    }
+
+    // a listener must prove that it receives the packets sent to its address
+    // since otherwise the audio stream could be directed to any address
+    if ( !ConnAdmission.CheckCookie ( InetAddr, iCookie ) )
+    {
+        ConnLessProtocol.CreateCLConnChallengeMes ( InetAddr,
+            ConnAdmission.GetCookie ( InetAddr ) );
+
+        return;
+    }
+
+    if ( !Listeners.Put ( InetAddr,
+                          static_cast<EAudComprType> ( iAudComprType ),
+                          iNumAudioChannels,
+                          iNetwFrameSize,
+                          iFrameSizeSamples ) )
+    {
+        ConnLessProtocol.CreateCLServerFullMes ( InetAddr );
+    }
 }
 
 void CServer::Start()
@@ -647,8 +1390,41 @@ void CServer::Start()
     // only start if not already running
     if ( !IsRunning() )
     {
-        // start timer
-        HighPrecisionTimer.Start();
+        // the mixer of this room might still be running on a worker thread
+        // if the room was just stopped
+        if ( pRoomMixerPool != NULL )
+        {
+            pRoomMixerPool->WaitForTick();
+        }
+
+        // the recording session must be prepared before the mixer runs
+        if ( pRecorder != NULL )
+        {
+            pRecorder->Start ( strRecordingDirName );
+        }
+
+        // start timer (in the multi-room mode the timer of the room mixer
+        // pool calls the mixer of this room, the room state is only changed
+        // above after the last tick of the mixer of this room is done)
+        if ( pRoomMixerPool != NULL )
+        {
+            iRoomRunning.fetchAndStoreRelease ( 1 );
+            pRoomMixerPool->Start();
+        }
+        else
+        {
+            HighPrecisionTimer.Start();
+        }
+
+        // start a new load measurement interval
+        LoadMeasTimer.start();
+        iLoadBusyNs = 0;
+
+        // connect to the upstream server
+        if ( pUplink != NULL )
+        {
+            pUplink->Start();
+        }
 
         // emit start signal
         emit Started();
@@ -664,9 +1440,36 @@ void CServer::Stop()
     if ( IsRunning() )
     {
         // stop timer
-        HighPrecisionTimer.Stop();
+        if ( pRoomMixerPool != NULL )
+        {
+            // the room is not processed anymore after the current tick
+            iRoomRunning.fetchAndStoreRelease ( 0 );
+            pRoomMixerPool->WaitForTick();
+        }
+        else
+        {
+            HighPrecisionTimer.Stop();
+        }
+
+        // without local clients there is no submix for the upstream server
+        if ( pUplink != NULL )
+        {
+            pUplink->Stop();
+        }
+
+        // the writer thread finishes the recording session on its own (this
+        // function may be called by the mixer)
+        if ( pRecorder != NULL )
+        {
+            pRecorder->Stop();
+
+            Logging.AddRecordingStopped ( pRecorder->GetNumDroppedSamples() );
+        }
 
         // logging (add "server stopped" logging entry)
+        Logging.AddCLMessagesDropped ( CLRateLimiter.GetNumDroppedSource(),
+                                       CLRateLimiter.GetNumDroppedGlobal() );
+
         Logging.AddServerStopped();
 
         // emit stopped signal
@@ -676,7 +1479,11 @@ void CServer::Stop()
 
 void CServer::OnTimer()
 {
-    int i, j;
+    int i, j, k;
+
+    // measure the processing time of this timer tick
+    QElapsedTimer TickTimer;
+    TickTimer.start();
 
 
     // Get data from all connected clients -------------------------------------
@@ -725,127 +1532,295 @@ void CServer::OnTimer()
                     vecChannels[iCurChanID].GetGain( vecChanIDsCurConChan[j] );
             }
 
-            // get current number of CELT coded bytes
-            const int iCeltNumCodedBytes =
-                vecChannels[iCurChanID].GetNetwFrameSize();
+            // If the server runs with the small frame size, the audio frame
+            // of a client using the default frame size spans multiple timer
+            // ticks. In this case the complete frame is decoded at the first
+            // tick and at each tick the corresponding part of it is mixed.
+            const int iCurFrameSize =
+                vecChannels[iCurChanID].GetAudioFrameSizeSamples();
 
-            // get data
-            const EGetDataStat eGetStat =
-                vecChannels[iCurChanID].GetData ( vecbyCodedData,
-                                                  iCeltNumCodedBytes );
+            const int iCurTickPhase =
+                iServerTickCnt % ( iCurFrameSize / iServerFrameSizeSamples );
 
-            // if channel was just disconnected, set flag that connected
-            // client list is sent to all other clients
-            if ( eGetStat == GS_CHAN_NOW_DISCONNECTED )
-            {
-                bChannelIsNowDisconnected = true;
-            }
+            CVector<int16_t>& vecsCurDecFrame = vecvecsChanDecFrame[iCurChanID];
 
-            // CELT decode received data stream
-            if ( eGetStat == GS_BUFFER_OK )
+            if ( iCurTickPhase == 0 )
             {
-                if ( iCurNumAudChan == 1 )
+                // get current number of CELT coded bytes (it is updated with
+                // the size of each received frame since the frame size of the
+                // buffered frames may differ while it is changed)
+                int iCeltNumCodedBytes =
+                    vecChannels[iCurChanID].GetNetwFrameSize();
+
+                // select the OPUS decoders for the frame size of the channel
+                OpusCustomDecoder* pCurOpusDecoderMono =
+                    ( iCurFrameSize == SYSTEM_FRAME_SIZE_SAMPLES_SMALL ) ?
+                    OpusDecoderMonoSmall[iCurChanID] : OpusDecoderMono[iCurChanID];
+
+                OpusCustomDecoder* pCurOpusDecoderStereo =
+                    ( iCurFrameSize == SYSTEM_FRAME_SIZE_SAMPLES_SMALL ) ?
+                    OpusDecoderStereoSmall[iCurChanID] : OpusDecoderStereo[iCurChanID];
+
+                // The sound card clock of the client is not synchronized with
+                // our timer. The clock drift compensation tells us how many
+                // coded blocks must be decoded to generate the current output
+                // block (this is usually one block but may sometimes be zero
+                // or two blocks). Make sure the resampler uses the current
+                // number of audio channels and frame size.
+                if ( ( DriftComp[iCurChanID].GetNumChannels() != iCurNumAudChan ) ||
+                     ( DriftComp[iCurChanID].GetBlockSize() != iCurFrameSize ) )
                 {
-                    // mono
-
-                    if ( vecChannels[iCurChanID].GetAudioCompressionType() == CT_CELT )
-                    {
-                        cc6_celt_decode ( CeltDecoderMono[iCurChanID],
-                                          &vecbyCodedData[0],
-                                          iCeltNumCodedBytes,
-                                          &vecvecsData[i][0] );
-                    }
-                    else
-                    {
-                        opus_custom_decode ( OpusDecoderMono[iCurChanID],
-                                             &vecbyCodedData[0],
-                                             iCeltNumCodedBytes,
-                                             &vecvecsData[i][0],
-                                             SYSTEM_FRAME_SIZE_SAMPLES );
-                    }
+                    DriftComp[iCurChanID].Init ( iCurNumAudChan, iCurFrameSize );
                 }
-                else
-                {
-                    // stereo
 
-                    if ( vecChannels[iCurChanID].GetAudioCompressionType() == CT_CELT )
-                    {
-                        cc6_celt_decode ( CeltDecoderStereo[iCurChanID],
-                                          &vecbyCodedData[0],
-                                          iCeltNumCodedBytes,
-                                          &vecvecsData[i][0] );
-                    }
-                    else
+                const int iNumBlocksToDecode = DriftComp[iCurChanID].Update (
+                    vecChannels[iCurChanID].GetSockBufFillLevel(),
+                    vecChannels[iCurChanID].GetSockBufTargetFillLevel() );
+
+                for ( k = 0; k < iNumBlocksToDecode; k++ )
+                {
+                    // get data
+                    const EGetDataStat eGetStat =
+                        vecChannels[iCurChanID].GetData ( vecbyCodedData,
+                                                          iCeltNumCodedBytes );
+
+                    // if channel was just disconnected, set flag that connected
+                    // client list is sent to all other clients, the address
+                    // key is cleared so that the packets of this address must
+                    // pass the connection admission again
+                    if ( eGetStat == GS_CHAN_NOW_DISCONNECTED )
                     {
-                        opus_custom_decode ( OpusDecoderStereo[iCurChanID],
-                                             &vecbyCodedData[0],
-                                             iCeltNumCodedBytes,
-                                             &vecvecsData[i][0],
-                                             SYSTEM_FRAME_SIZE_SAMPLES );
+                        bChannelIsNowDisconnected = true;
+                        iChanAddrKeys[iCurChanID].fetchAndStoreRelease ( 0 );
                     }
-                }
-            }
-            else
-            {
-                // lost packet
-                if ( iCurNumAudChan == 1 )
-                {
-                    // mono
 
-                    if ( vecChannels[iCurChanID].GetAudioCompressionType() == CT_CELT )
+                    // CELT decode received data stream
+                    if ( eGetStat == GS_BUFFER_OK )
                     {
-                        cc6_celt_decode ( CeltDecoderMono[iCurChanID],
-                                          NULL,
-                                          0,
-                                          &vecvecsData[i][0] );
+                        if ( vecChannels[iCurChanID].GetAudioCompressionType() == CT_PCM )
+                        {
+                            // uncompressed audio, no decoding required
+                            PcmDecode ( &vecbyCodedData[0],
+                                        &vecsCurDecFrame[0],
+                                        iCurNumAudChan * iCurFrameSize );
+                        }
+                        else if ( iCurNumAudChan == 1 )
+                        {
+                            // mono
+
+                            if ( vecChannels[iCurChanID].GetAudioCompressionType() == CT_CELT )
+                            {
+                                cc6_celt_decode ( CeltDecoderMono[iCurChanID],
+                                                  &vecbyCodedData[0],
+                                                  iCeltNumCodedBytes,
+                                                  &vecsCurDecFrame[0] );
+                            }
+                            else
+                            {
+                                opus_custom_decode ( pCurOpusDecoderMono,
+                                                     &vecbyCodedData[0],
+                                                     iCeltNumCodedBytes,
+                                                     &vecsCurDecFrame[0],
+                                                     iCurFrameSize );
+                            }
+                        }
+                        else
+                        {
+                            // stereo
+
+                            if ( vecChannels[iCurChanID].GetAudioCompressionType() == CT_CELT )
+                            {
+                                cc6_celt_decode ( CeltDecoderStereo[iCurChanID],
+                                                  &vecbyCodedData[0],
+                                                  iCeltNumCodedBytes,
+                                                  &vecsCurDecFrame[0] );
+                            }
+                            else
+                            {
+                                opus_custom_decode ( pCurOpusDecoderStereo,
+                                                     &vecbyCodedData[0],
+                                                     iCeltNumCodedBytes,
+                                                     &vecsCurDecFrame[0],
+                                                     iCurFrameSize );
+                            }
+                        }
                     }
                     else
                     {
-                        opus_custom_decode ( OpusDecoderMono[iCurChanID],
-                                             NULL,
-                                             iCeltNumCodedBytes,
-                                             &vecvecsData[i][0],
-                                             SYSTEM_FRAME_SIZE_SAMPLES );
+                        // lost packet
+                        if ( vecChannels[iCurChanID].GetAudioCompressionType() == CT_PCM )
+                        {
+                            // uncompressed audio has no packet loss concealment,
+                            // use silence instead
+                            std::fill ( vecsCurDecFrame.begin(),
+                                        vecsCurDecFrame.begin() + iCurNumAudChan * iCurFrameSize,
+                                        0 );
+                        }
+                        else if ( iCurNumAudChan == 1 )
+                        {
+                            // mono
+
+                            if ( vecChannels[iCurChanID].GetAudioCompressionType() == CT_CELT )
+                            {
+                                cc6_celt_decode ( CeltDecoderMono[iCurChanID],
+                                                  NULL,
+                                                  0,
+                                                  &vecsCurDecFrame[0] );
+                            }
+                            else
+                            {
+                                opus_custom_decode ( pCurOpusDecoderMono,
+                                                     NULL,
+                                                     iCeltNumCodedBytes,
+                                                     &vecsCurDecFrame[0],
+                                                     iCurFrameSize );
+                            }
+                        }
+                        else
+                        {
+                            // stereo
+
+                            if ( vecChannels[iCurChanID].GetAudioCompressionType() == CT_CELT )
+                            {
+                                cc6_celt_decode ( CeltDecoderStereo[iCurChanID],
+                                                  NULL,
+                                                  0,
+                                                  &vecsCurDecFrame[0] );
+                            }
+                            else
+                            {
+                                opus_custom_decode ( pCurOpusDecoderStereo,
+                                                     NULL,
+                                                     iCeltNumCodedBytes,
+                                                     &vecsCurDecFrame[0],
+                                                     iCurFrameSize );
+                            }
+                        }
                     }
+
+                    // store the decoded block in the clock drift compensation
+                    DriftComp[iCurChanID].Put ( &vecsCurDecFrame[0] );
                 }
-                else
-                {
-                    // stereo
 
-                    if ( vecChannels[iCurChanID].GetAudioCompressionType() == CT_CELT )
-                    {
-                        cc6_celt_decode ( CeltDecoderStereo[iCurChanID],
-                                          NULL,
-                                          0,
-                                          &vecvecsData[i][0] );
-                    }
-                    else
-                    {
-                        opus_custom_decode ( OpusDecoderStereo[iCurChanID],
-                                             NULL,
-                                             iCeltNumCodedBytes,
-                                             &vecvecsData[i][0],
-                                             SYSTEM_FRAME_SIZE_SAMPLES );
-                    }
+                // get the resampled block for mixing
+                DriftComp[iCurChanID].Get ( &vecsCurDecFrame[0] );
+
+                // the next client on this channel starts with a new clock drift
+                // estimation
+                if ( !vecChannels[iCurChanID].IsConnected() )
+                {
+                    DriftComp[iCurChanID].Reset();
                 }
             }
+
+            // copy the part of the decoded frame which belongs to the current
+            // timer tick
+            const int iCurTickNumSamples =
+                iCurNumAudChan * iServerFrameSizeSamples;
+
+            std::copy ( vecsCurDecFrame.begin() + iCurTickPhase * iCurTickNumSamples,
+                        vecsCurDecFrame.begin() + ( iCurTickPhase + 1 ) * iCurTickNumSamples,
+                        vecvecsData[i].begin() );
         }
 
         // a channel is now disconnected, take action on it
         if ( bChannelIsNowDisconnected )
         {
-            // update channel list for all currently connected clients
-            CreateAndSendChanListForAllConChannels();
+            // update channel list for all currently connected clients (the
+            // protocol must only be used in the main thread, in the multi-room
+            // mode the mixer is called by a worker thread)
+            if ( pRoomMixerPool != NULL )
+            {
+                // (note that Qt will delete the event object when done)
+                QCoreApplication::postEvent ( this,
+                    new CCustomEvent ( MS_CHAN_LIST_CHANGED, 0, 0 ) );
+            }
+            else
+            {
+                CreateAndSendChanListForAllConChannels();
+            }
         }
     }
     Mutex.unlock(); // release mutex
 
+    // the recorder also has to be called without connected clients to finish
+    // the tracks of the clients which have just left
+    if ( pRecorder != NULL )
+    {
+        pRecorder->Process ( vecChanIDsCurConChan,
+                             vecvecsData,
+                             vecNumAudioChannels,
+                             iNumClients );
+    }
+
 
     // Process data ------------------------------------------------------------
     // Check if at least one client is connected. If not, stop server until
     // one client is connected.
     if ( iNumClients > 0 )
     {
+        // the number of mixed sources includes the mix of the upstream server
+        int iNumSources = iNumClients;
+
+        if ( pUplink != NULL )
+        {
+            // send the submix of all local clients to the upstream server
+            ProcessData ( vecvecsData,
+                          vecdUnityGains,
+                          vecNumAudioChannels,
+                          vecsUplinkData,
+                          2,
+                          iNumClients );
+
+            pUplink->PutLocalSubmix ( vecsUplinkData, iServerTickCnt );
+
+            // the mix of the upstream server is mixed with unity gain for all
+            // local clients
+            pUplink->GetUpstreamMix ( vecvecsData[iNumClients], iServerTickCnt );
+            vecNumAudioChannels[iNumClients] = 2;
+
+            for ( int i = 0; i < iNumClients; i++ )
+            {
+                vecvecdGains[i][iNumClients] = 1.0;
+            }
+
+            iNumSources++;
+        }
+
+        // the room mix is only generated once for all listeners, the mix
+        // stream and the mix tap
+        if ( ( Listeners.GetNumListeners() > 0 ) || ( pMixStream != NULL ) ||
+             ( pMixTap != NULL ) )
+        {
+            ProcessData ( vecvecsData,
+                          vecdUnityGains,
+                          vecNumAudioChannels,
+                          vecsRoomMix,
+                          2,
+                          iNumSources );
+
+            if ( Listeners.GetNumListeners() > 0 )
+            {
+                Listeners.Process ( vecsRoomMix, iServerTickCnt, Socket );
+            }
+
+            if ( pMixStream != NULL )
+            {
+                // never blocks, the audio is dropped if the writer is too slow
+                pMixStream->Put ( vecsRoomMix, iServerFrameSizeSamples );
+            }
+
+            if ( pMixTap != NULL )
+            {
+                // never waits for the readers
+                pMixTap->Put ( vecChanIDsCurConChan,
+                               vecvecsData,
+                               vecNumAudioChannels,
+                               iNumClients,
+                               vecsRoomMix );
+            }
+        }
+
         for ( int i = 0; i < iNumClients; i++ )
         {
             // get actual ID of current channel
@@ -861,37 +1836,82 @@ void CServer::OnTimer()
                           vecNumAudioChannels,
                           vecsSendData,
                           iCurNumAudChan,
-                          iNumClients );
+                          iNumSources );
+
+            // collect the mixes of all timer ticks of the current audio frame
+            // of the channel (see the frame decoding above)
+            const int iCurFrameSize =
+                vecChannels[iCurChanID].GetAudioFrameSizeSamples();
+
+            const int iCurNumTicksPerFrame =
+                iCurFrameSize / iServerFrameSizeSamples;
+
+            const int iCurTickPhase      = iServerTickCnt % iCurNumTicksPerFrame;
+            const int iCurTickNumSamples = iCurNumAudChan * iServerFrameSizeSamples;
+
+            CVector<int16_t>& vecsCurEncFrame = vecvecsChanEncFrame[iCurChanID];
+
+            std::copy ( vecsSendData.begin(),
+                        vecsSendData.begin() + iCurTickNumSamples,
+                        vecsCurEncFrame.begin() + iCurTickPhase * iCurTickNumSamples );
+
+            // the audio frame is encoded and sent at its last timer tick
+            if ( iCurTickPhase != iCurNumTicksPerFrame - 1 )
+            {
+                continue;
+            }
 
             // get current number of CELT coded bytes
             const int iCeltNumCodedBytes =
                 vecChannels[iCurChanID].GetNetwFrameSize();
 
             // OPUS/CELT encoding
-            if ( vecChannels[iCurChanID].GetNumAudioChannels() == 1 )
+            if ( vecChannels[iCurChanID].GetAudioCompressionType() == CT_PCM )
+            {
+                // uncompressed audio, no encoding required
+                PcmEncode ( &vecsCurEncFrame[0],
+                            &vecbyCodedData[0],
+                            iCurNumAudChan * iCurFrameSize );
+            }
+            else if ( vecChannels[iCurChanID].GetNumAudioChannels() == 1 )
             {
                 // mono:
 
                 if ( vecChannels[iCurChanID].GetAudioCompressionType() == CT_CELT )
                 {
                     cc6_celt_encode ( CeltEncoderMono[iCurChanID],
-                                      &vecsSendData[0],
+                                      &vecsCurEncFrame[0],
                                       NULL,
                                       &vecbyCodedData[0],
                                       iCeltNumCodedBytes );
                 }
                 else
                 {
+                    // select the encoder for the frame size of the channel
+                    OpusCustomEncoder* pCurOpusEncoder    = OpusEncoderMono[iCurChanID];
+                    int*               piCurNumCodedBytes = &iOpusEncMonoNumCodedBytes[iCurChanID];
 
-// TODO find a better place than this: the setting does not change all the time
-//      so for speed optimization it would be better to set it only if the network
-//      frame size is changed
-opus_custom_encoder_ctl ( OpusEncoderMono[iCurChanID],
-                          OPUS_SET_BITRATE ( CalcBitRateBitsPerSecFromCodedBytes ( iCeltNumCodedBytes ) ) );
+                    if ( iCurFrameSize == SYSTEM_FRAME_SIZE_SAMPLES_SMALL )
+                    {
+                        pCurOpusEncoder    = OpusEncoderMonoSmall[iCurChanID];
+                        piCurNumCodedBytes = &iOpusEncMonoSmallNumCodedBytes[iCurChanID];
+                    }
 
-                    opus_custom_encode ( OpusEncoderMono[iCurChanID],
-                                         &vecsSendData[0],
-                                         SYSTEM_FRAME_SIZE_SAMPLES,
+                    // the bit rate only has to be set if the number of coded
+                    // bytes was changed by the client
+                    if ( *piCurNumCodedBytes != iCeltNumCodedBytes )
+                    {
+                        opus_custom_encoder_ctl ( pCurOpusEncoder,
+                                                  OPUS_SET_BITRATE (
+                                                      CalcBitRateBitsPerSecFromCodedBytes (
+                                                          iCeltNumCodedBytes, iCurFrameSize ) ) );
+
+                        *piCurNumCodedBytes = iCeltNumCodedBytes;
+                    }
+
+                    opus_custom_encode ( pCurOpusEncoder,
+                                         &vecsCurEncFrame[0],
+                                         iCurFrameSize,
                                          &vecbyCodedData[0],
                                          iCeltNumCodedBytes );
                 }
@@ -903,23 +1923,38 @@ opus_custom_encoder_ctl ( OpusEncoderMono[iCurChanID],
                 if ( vecChannels[iCurChanID].GetAudioCompressionType() == CT_CELT )
                 {
                     cc6_celt_encode ( CeltEncoderStereo[iCurChanID],
-                                      &vecsSendData[0],
+                                      &vecsCurEncFrame[0],
                                       NULL,
                                       &vecbyCodedData[0],
                                       iCeltNumCodedBytes );
                 }
                 else
                 {
+                    // select the encoder for the frame size of the channel
+                    OpusCustomEncoder* pCurOpusEncoder    = OpusEncoderStereo[iCurChanID];
+                    int*               piCurNumCodedBytes = &iOpusEncStereoNumCodedBytes[iCurChanID];
+
+                    if ( iCurFrameSize == SYSTEM_FRAME_SIZE_SAMPLES_SMALL )
+                    {
+                        pCurOpusEncoder    = OpusEncoderStereoSmall[iCurChanID];
+                        piCurNumCodedBytes = &iOpusEncStereoSmallNumCodedBytes[iCurChanID];
+                    }
+
+                    // the bit rate only has to be set if the number of coded
+                    // bytes was changed by the client
+                    if ( *piCurNumCodedBytes != iCeltNumCodedBytes )
+                    {
+                        opus_custom_encoder_ctl ( pCurOpusEncoder,
+                                                  OPUS_SET_BITRATE (
+                                                      CalcBitRateBitsPerSecFromCodedBytes (
+                                                          iCeltNumCodedBytes, iCurFrameSize ) ) );
 
-// TODO find a better place than this: the setting does not change all the time
-//      so for speed optimization it would be better to set it only if the network
-//      frame size is changed
-opus_custom_encoder_ctl ( OpusEncoderStereo[iCurChanID],
-                          OPUS_SET_BITRATE ( CalcBitRateBitsPerSecFromCodedBytes ( iCeltNumCodedBytes ) ) );
+                        *piCurNumCodedBytes = iCeltNumCodedBytes;
+                    }
 
-                    opus_custom_encode ( OpusEncoderStereo[iCurChanID],
-                                         &vecsSendData[0],
-                                         SYSTEM_FRAME_SIZE_SAMPLES,
+                    opus_custom_encode ( pCurOpusEncoder,
+                                         &vecsCurEncFrame[0],
+                                         iCurFrameSize,
                                          &vecbyCodedData[0],
                                          iCeltNumCodedBytes );
                 }
@@ -933,12 +1968,59 @@ opus_custom_encoder_ctl ( OpusEncoderStereo[iCurChanID],
             // update socket buffer size
             vecChannels[iCurChanID].UpdateSocketBufferSize();
         }
+
+        // next timer tick (the counter only has to cover the number of ticks
+        // of one audio frame with the default frame size)
+        iServerTickCnt++;
+
+        if ( iServerTickCnt >= SYSTEM_FRAME_SIZE_SAMPLES / iServerFrameSizeSamples )
+        {
+            iServerTickCnt = 0;
+        }
+
+        // update the load of the server which is reported to the central
+        // server, the tick headroom is the part of the measurement interval
+        // which was not used for processing the timer ticks
+        iLoadBusyNs += TickTimer.nsecsElapsed();
+
+        const qint64 iLoadMeasTimeMs = LoadMeasTimer.elapsed();
+
+        if ( iLoadMeasTimeMs >= SERVER_LOAD_MEAS_INTERV_MS )
+        {
+            const int iTickHeadroom = static_cast<int> (
+                100 - iLoadBusyNs / ( iLoadMeasTimeMs * 10000 ) );
+
+            ServerListManager.SetServerLoad ( iNumClients,
+                                              max ( 0, min ( 100, iTickHeadroom ) ) );
+
+            LoadMeasTimer.restart();
+            iLoadBusyNs = 0;
+        }
     }
     else
     {
+        // no client is connected, the server is idle
+        ServerListManager.SetServerLoad ( 0, 100 );
+
         // Disable server if no clients are connected. In this case the server
         // does not consume any significant CPU when no client is connected.
-        Stop();
+        if ( pRoomMixerPool != NULL )
+        {
+            // in the multi-room mode the mixer is called by a worker thread of
+            // the room mixer pool, the room is stopped in the main thread
+            if ( !bRoomIdlePending )
+            {
+                bRoomIdlePending = true;
+
+                // (note that Qt will delete the event object when done)
+                QCoreApplication::postEvent ( this,
+                    new CCustomEvent ( MS_SERVER_IDLE, 0, 0 ) );
+            }
+        }
+        else
+        {
+            Stop();
+        }
     }
 }
 
@@ -971,7 +2053,7 @@ void CServer::ProcessData ( const CVector<CVector<int16_t> >& vecvecsData,
                 if ( vecNumAudioChannels[j] == 1 )
                 {
                     // mono
-                    for ( i = 0; i < SYSTEM_FRAME_SIZE_SAMPLES; i++ )
+                    for ( i = 0; i < iServerFrameSizeSamples; i++ )
                     {
                         vecsOutData[i] = Double2Short (
                             static_cast<double> ( vecsOutData[i] ) + vecsData[i] );
@@ -980,7 +2062,7 @@ void CServer::ProcessData ( const CVector<CVector<int16_t> >& vecvecsData,
                 else
                 {
                     // stereo: apply stereo-to-mono attenuation
-                    for ( i = 0, k = 0; i < SYSTEM_FRAME_SIZE_SAMPLES; i++, k += 2 )
+                    for ( i = 0, k = 0; i < iServerFrameSizeSamples; i++, k += 2 )
                     {
                         vecsOutData[i] =
                             Double2Short ( vecsOutData[i] +
@@ -993,7 +2075,7 @@ void CServer::ProcessData ( const CVector<CVector<int16_t> >& vecvecsData,
                 if ( vecNumAudioChannels[j] == 1 )
                 {
                     // mono
-                    for ( i = 0; i < SYSTEM_FRAME_SIZE_SAMPLES; i++ )
+                    for ( i = 0; i < iServerFrameSizeSamples; i++ )
                     {
                         vecsOutData[i] = Double2Short (
                             vecsOutData[i] + vecsData[i] * dGain );
@@ -1002,7 +2084,7 @@ void CServer::ProcessData ( const CVector<CVector<int16_t> >& vecvecsData,
                 else
                 {
                     // stereo: apply stereo-to-mono attenuation
-                    for ( i = 0, k = 0; i < SYSTEM_FRAME_SIZE_SAMPLES; i++, k += 2 )
+                    for ( i = 0, k = 0; i < iServerFrameSizeSamples; i++, k += 2 )
                     {
                         vecsOutData[i] =
                             Double2Short ( vecsOutData[i] + dGain *
@@ -1027,7 +2109,7 @@ void CServer::ProcessData ( const CVector<CVector<int16_t> >& vecvecsData,
                 if ( vecNumAudioChannels[j] == 1 )
                 {
                     // mono: copy same mono data in both out stereo audio channels
-                    for ( i = 0, k = 0; i < SYSTEM_FRAME_SIZE_SAMPLES; i++, k += 2 )
+                    for ( i = 0, k = 0; i < iServerFrameSizeSamples; i++, k += 2 )
                     {
                         // left channel
                         vecsOutData[k] = Double2Short (
@@ -1041,7 +2123,7 @@ void CServer::ProcessData ( const CVector<CVector<int16_t> >& vecvecsData,
                 else
                 {
                     // stereo
-                    for ( i = 0; i < ( 2 * SYSTEM_FRAME_SIZE_SAMPLES ); i++ )
+                    for ( i = 0; i < ( 2 * iServerFrameSizeSamples ); i++ )
                     {
                         vecsOutData[i] = Double2Short (
                             static_cast<double> ( vecsOutData[i] ) + vecsData[i] );
@@ -1053,7 +2135,7 @@ void CServer::ProcessData ( const CVector<CVector<int16_t> >& vecvecsData,
                 if ( vecNumAudioChannels[j] == 1 )
                 {
                     // mono: copy same mono data in both out stereo audio channels
-                    for ( i = 0, k = 0; i < SYSTEM_FRAME_SIZE_SAMPLES; i++, k += 2 )
+                    for ( i = 0, k = 0; i < iServerFrameSizeSamples; i++, k += 2 )
                     {
                         // left channel
                         vecsOutData[k] = Double2Short (
@@ -1067,7 +2149,7 @@ void CServer::ProcessData ( const CVector<CVector<int16_t> >& vecvecsData,
                 else
                 {
                     // stereo
-                    for ( i = 0; i < ( 2 * SYSTEM_FRAME_SIZE_SAMPLES ); i++ )
+                    for ( i = 0; i < ( 2 * iServerFrameSizeSamples ); i++ )
                     {
                         vecsOutData[i] = Double2Short (
                             vecsOutData[i] + vecsData[i] * dGain );
@@ -1100,20 +2182,8 @@ CVector<CChannelInfo> CServer::CreateChannelList()
 
 void CServer::CreateAndSendChanListForAllConChannels()
 {
-    // create channel list
-    CVector<CChannelInfo> vecChanInfo ( CreateChannelList() );
-
-    // now send connected channels list to all connected clients
-    for ( int i = 0; i < iMaxNumChannels; i++ )
-    {
-        if ( vecChannels[i].IsConnected() )
-        {
-            // send message
-// #### COMPATIBILITY OLD VERSION, TO BE REMOVED ####
-vecChannels[i].CreateConClientListNameMes ( vecChanInfo );
-            vecChannels[i].CreateConClientListMes ( vecChanInfo );
-        }
-    }
+    // send the connected channels list to all connected clients
+    UpdateAndSendChanList ( INVALID_CHANNEL_ID );
 
     // create status HTML file if enabled
     if ( bWriteStatusHTMLFile )
@@ -1124,13 +2194,167 @@ vecChannels[i].CreateConClientListNameMes ( vecChanInfo );
 
 void CServer::CreateAndSendChanListForThisChan ( const int iCurChanID )
 {
+    // send the connected channels list to the channel with the ID "iCurChanID"
+    UpdateAndSendChanList ( iCurChanID );
+}
+
+void CServer::UpdateAndSendChanList ( const int iReqChanID )
+{
+/*
+    The list data is only serialized once and is then sent to all clients.
+    Clients which support the incremental list get the complete list only
+    once (or on request) and after that only the changes of the list.
+    Clients which do not support it get the complete list as before.
+    If iReqChanID is a valid channel ID, the complete list is sent to this
+    channel and the other channels only get the list if it has changed.
+*/
+    int i, j;
+
+    QMutexLocker locker ( &MutexChanList );
+
     // create channel list
     CVector<CChannelInfo> vecChanInfo ( CreateChannelList() );
 
-    // now send connected channels list to the channel with the ID "iCurChanID"
+    // find the changes compared to the last sent list
+    CVector<int>          veciRemovedChanIDs ( 0 );
+    CVector<CChannelInfo> vecChangedChanInfo ( 0 );
+
+    for ( i = 0; i < vecChanListLast.Size(); i++ )
+    {
+        bool bRemoved = true;
+
+        for ( j = 0; j < vecChanInfo.Size(); j++ )
+        {
+            if ( vecChanInfo[j].iChanID == vecChanListLast[i].iChanID )
+            {
+                bRemoved = false;
+            }
+        }
+
+        if ( bRemoved )
+        {
+            veciRemovedChanIDs.Add ( vecChanListLast[i].iChanID );
+        }
+    }
+
+    for ( i = 0; i < vecChanInfo.Size(); i++ )
+    {
+        bool bChanged = true;
+
+        for ( j = 0; j < vecChanListLast.Size(); j++ )
+        {
+            if ( ( vecChanListLast[j].iChanID == vecChanInfo[i].iChanID ) &&
+                 ( vecChanListLast[j].iIpAddr == vecChanInfo[i].iIpAddr ) &&
+                 !( vecChanListLast[j] != vecChanInfo[i] ) )
+            {
+                bChanged = false;
+            }
+        }
+
+        if ( bChanged )
+        {
+            vecChangedChanInfo.Add ( vecChanInfo[i] );
+        }
+    }
+
+    const bool bListChanged = ( veciRemovedChanIDs.Size() > 0 ) ||
+                              ( vecChangedChanInfo.Size() > 0 );
+
+    const int iBaseVersion = iChanListVersion;
+
+    if ( bListChanged )
+    {
+        // new list version (the version zero is not used)
+        iChanListVersion = ( iChanListVersion % 0x7FFFFFFF ) + 1;
+
+        vecChanListLast.Init ( vecChanInfo.Size() );
+        vecChanListLast = vecChanInfo;
+    }
+
+    // the list messages are only prepared if they are needed
+    CVector<uint8_t> vecbyListNameData;
+    CVector<uint8_t> vecbyListData;
+    CVector<uint8_t> vecbyDeltaData;
+    CVector<uint8_t> vecbyFullListData;
+    bool             bListPrepared     = false;
+    bool             bDeltaPrepared    = false;
+    bool             bFullListPrepared = false;
+
+    for ( i = 0; i < iMaxNumChannels; i++ )
+    {
+        if ( !vecChannels[i].IsConnected() ||
+             ( ( iReqChanID != INVALID_CHANNEL_ID ) && ( iReqChanID != i ) &&
+               !bListChanged ) )
+        {
+            continue;
+        }
+
+        if ( vecChannels[i].GetRemoteFeatures() & PROT_FEATURE_CLIENT_LIST_DELTA )
+        {
+            if ( i == iReqChanID )
+            {
+                // the client requested the complete list
+                veciChanListVersion[i] = PROT_INVALID_VALUE;
+            }
+
+            if ( veciChanListVersion[i] == iChanListVersion )
+            {
+                // this client already has the current list
+                continue;
+            }
+
+            if ( bListChanged && ( veciChanListVersion[i] == iBaseVersion ) )
+            {
+                // only send the changes
+                if ( !bDeltaPrepared )
+                {
+                    CProtocol::PrepareConClientListDeltaMes ( iBaseVersion,
+                                                              iChanListVersion,
+                                                              veciRemovedChanIDs,
+                                                              vecChangedChanInfo,
+                                                              vecbyDeltaData );
+                    bDeltaPrepared = true;
+                }
+
+                vecChannels[i].CreatePreparedConClientListDeltaMes ( vecbyDeltaData );
+            }
+            else
+            {
+                // send the complete list
+                if ( !bFullListPrepared )
+                {
+                    CProtocol::PrepareConClientListDeltaMes ( 0,
+                                                              iChanListVersion,
+                                                              CVector<int> ( 0 ),
+                                                              vecChanInfo,
+                                                              vecbyFullListData );
+                    bFullListPrepared = true;
+                }
+
+                vecChannels[i].CreatePreparedConClientListDeltaMes ( vecbyFullListData );
+            }
+
+            veciChanListVersion[i] = iChanListVersion;
+        }
+        else
+        {
+            if ( !bListPrepared )
+            {
 // #### COMPATIBILITY OLD VERSION, TO BE REMOVED ####
-vecChannels[iCurChanID].CreateConClientListNameMes ( vecChanInfo );
-    vecChannels[iCurChanID].CreateConClientListMes ( vecChanInfo );
+CProtocol::PrepareConClientListNameMes ( vecChanInfo, vecbyListNameData );
+                CProtocol::PrepareConClientListMes ( vecChanInfo, vecbyListData );
+                bListPrepared = true;
+            }
+
+            // send message
+// #### COMPATIBILITY OLD VERSION, TO BE REMOVED ####
+vecChannels[i].CreatePreparedConClientListNameMes ( vecbyListNameData );
+            vecChannels[i].CreatePreparedConClientListMes ( vecbyListData );
+
+            // the client does not have a version of the list
+            veciChanListVersion[i] = PROT_INVALID_VALUE;
+        }
+    }
 }
 
 void CServer::CreateAndSendChatTextForAllConChannels ( const int      iCurChanID,
@@ -1245,49 +2469,117 @@ void CServer::OnProtcolMessageReceived ( int              iRecCounter,
     Mutex.unlock();
 }
 
-bool CServer::PutAudioData ( const CVector<uint8_t>& vecbyRecBuf,
-                             const int               iNumBytesRead,
-                             const CHostAddress&     HostAdr,
-                             int&                    iCurChanID )
+EPutDataStat CServer::PutAudioData ( const CVector<uint8_t>& vecbyRecBuf,
+                                     const int               iNumBytesRead,
+                                     const CHostAddress&     HostAdr,
+                                     int&                    iCurChanID )
 {
-    bool bNewConnection = false; // init return value
-    bool bChanOK        = true; // init with ok, might be overwritten
+    EPutDataStat eRet = PS_GEN_ERROR; // init return value
+
+    // init channel ID with invalid value
+    iCurChanID = INVALID_CHANNEL_ID;
+
+    // packets which are too short to be a coded audio packet are dropped
+    // before taking any lock
+    if ( iNumBytesRead < CELT_MINIMUM_NUM_BYTES )
+    {
+        return eRet;
+    }
+
+    // The server mutex is shared with the mixer. Packets of senders which are
+    // not connected are therefore checked by the connection admission before
+    // the mutex is taken. If the server is flooded with such packets, most
+    // of them are dropped by the lock-free pre-check.
+    const int iAddrKey  = CConnAdmission::GetAddrKey ( HostAdr );
+    bool      bAdmitted = false;
+    bool      bIsKnown  = false;
+
+    for ( int i = 0; i < iMaxNumChannels; i++ )
+    {
+        if ( iChanAddrKeys[i].fetchAndAddAcquire ( 0 ) == iAddrKey )
+        {
+            bIsKnown = true;
+            break;
+        }
+    }
+
+    if ( !bIsKnown )
+    {
+        if ( !ConnAdmission.PreCheckAudioSender ( HostAdr ) )
+        {
+            return eRet;
+        }
+
+        // a new client is calling, a channel is only allocated if the client
+        // has answered our connection challenge (or if it is an old client
+        // which does not support the challenge)
+        bool bSendChallenge;
+
+        if ( !ConnAdmission.CheckAudioSender ( HostAdr, bSendChallenge ) )
+        {
+            return bSendChallenge ? PS_UNKNOWN_SENDER : eRet;
+        }
+
+        bAdmitted = true;
+    }
 
     Mutex.lock();
     {
+        bool bChanOK = true; // init with ok, might be overwritten
+
         // Get channel ID ------------------------------------------------------
         // check address
         iCurChanID = FindChannel ( HostAdr );
 
         if ( iCurChanID == INVALID_CHANNEL_ID )
         {
-            // a new client is calling, look for free channel
-            iCurChanID = GetFreeChan();
+            // the address key of another address matched (or the channel
+            // was disconnected in the meantime), the admission check is done
+            // here in this rare case
+            bool bSendChallenge = false;
 
-            if ( iCurChanID != INVALID_CHANNEL_ID )
+            if ( !bAdmitted &&
+                 !ConnAdmission.CheckAudioSender ( HostAdr, bSendChallenge ) )
             {
-                // initialize current channel by storing the calling host
-                // address
-                vecChannels[iCurChanID].SetAddress ( HostAdr );
-
-                // reset channel info
-                vecChannels[iCurChanID].ResetInfo();
+                bChanOK = false;
 
-                // reset the channel gains of current channel, at the same
-                // time reset gains of this channel ID for all other channels
-                for ( int i = 0; i < iMaxNumChannels; i++ )
+                if ( bSendChallenge )
                 {
-                    vecChannels[iCurChanID].SetGain ( i, (double) 1.0 );
-
-                    // other channels (we do not distinguish the case if
-                    // i == iCurChanID for simplicity)
-                    vecChannels[i].SetGain ( iCurChanID, (double) 1.0 );
+                    eRet = PS_UNKNOWN_SENDER;
                 }
             }
             else
             {
-                // no free channel available
-                bChanOK = false;
+                // look for free channel
+                iCurChanID = GetFreeChan();
+
+                if ( iCurChanID != INVALID_CHANNEL_ID )
+                {
+                    // initialize current channel by storing the calling host
+                    // address
+                    vecChannels[iCurChanID].SetAddress ( HostAdr );
+                    iChanAddrKeys[iCurChanID].fetchAndStoreRelease ( iAddrKey );
+
+                    // reset channel info
+                    vecChannels[iCurChanID].ResetInfo();
+
+                    // reset the channel gains of current channel, at the same
+                    // time reset gains of this channel ID for all other channels
+                    for ( int i = 0; i < iMaxNumChannels; i++ )
+                    {
+                        vecChannels[iCurChanID].SetGain ( i, (double) 1.0 );
+
+                        // other channels (we do not distinguish the case if
+                        // i == iCurChanID for simplicity)
+                        vecChannels[i].SetGain ( iCurChanID, (double) 1.0 );
+                    }
+                }
+                else
+                {
+                    // no free channel available
+                    bChanOK = false;
+                    eRet    = PS_SERVER_FULL;
+                }
             }
         }
 
@@ -1296,33 +2588,28 @@ bool CServer::PutAudioData ( const CVector<uint8_t>& vecbyRecBuf,
         if ( bChanOK )
         {
             // put packet in socket buffer
-            if ( vecChannels[iCurChanID].PutAudioData ( vecbyRecBuf,
-                                                        iNumBytesRead,
-                                                        HostAdr ) == PS_NEW_CONNECTION )
-            {
-                // in case we have a new connection return this information
-                bNewConnection = true;
-            }
+            eRet = vecChannels[iCurChanID].PutAudioData ( vecbyRecBuf,
+                                                          iNumBytesRead,
+                                                          HostAdr );
         }
     }
     Mutex.unlock();
 
-    // return the state if a new connection was happening
-    return bNewConnection;
+    return eRet;
 }
 
 void CServer::GetConCliParam ( CVector<CHostAddress>& vecHostAddresses,
                                CVector<QString>&      vecsName,
                                CVector<int>&          veciJitBufNumFrames,
-                               CVector<int>&          veciNetwFrameSizeFact )
+                               CVector<int>&          veciNetwBlockSizeSamples )
 {
     CHostAddress InetAddr;
 
     // init return values
-    vecHostAddresses.Init      ( iMaxNumChannels );
-    vecsName.Init              ( iMaxNumChannels );
-    veciJitBufNumFrames.Init   ( iMaxNumChannels );
-    veciNetwFrameSizeFact.Init ( iMaxNumChannels );
+    vecHostAddresses.Init         ( iMaxNumChannels );
+    vecsName.Init                 ( iMaxNumChannels );
+    veciJitBufNumFrames.Init      ( iMaxNumChannels );
+    veciNetwBlockSizeSamples.Init ( iMaxNumChannels );
 
     // check all possible channels
     for ( int i = 0; i < iMaxNumChannels; i++ )
@@ -1330,10 +2617,11 @@ void CServer::GetConCliParam ( CVector<CHostAddress>& vecHostAddresses,
         if ( vecChannels[i].GetAddress ( InetAddr ) )
         {
             // get requested data
-            vecHostAddresses[i]      = InetAddr;
-            vecsName[i]              = vecChannels[i].GetName();
-            veciJitBufNumFrames[i]   = vecChannels[i].GetSockBufNumFrames();
-            veciNetwFrameSizeFact[i] = vecChannels[i].GetNetwFrameSizeFact();
+            vecHostAddresses[i]         = InetAddr;
+            vecsName[i]                 = vecChannels[i].GetName();
+            veciJitBufNumFrames[i]      = vecChannels[i].GetSockBufNumFrames();
+            veciNetwBlockSizeSamples[i] = vecChannels[i].GetNetwFrameSizeFact() *
+                                          vecChannels[i].GetAudioFrameSizeSamples();
         }
     }
 }
@@ -1412,6 +2700,223 @@ void CServer::customEvent ( QEvent* pEvent )
             // no effect
             Start();
             break;
+
+        case MS_SERVER_IDLE:
+            // the room was idle on the last timer tick, a client might have
+            // connected in the meantime
+            bRoomIdlePending = false;
+
+            if ( GetNumberOfConnectedClients() == 0 )
+            {
+                Stop();
+            }
+            break;
+
+        case MS_CHAN_LIST_CHANGED:
+            // a channel was disconnected by the mixer of the room
+            CreateAndSendChanListForAllConChannels();
+            break;
+        }
+    }
+}
+
+
+// CRoomMixerPool implementation ***********************************************
+CRoomMixerPool::CRoomMixerPool ( const int iFrameSizeSamples,
+                                 const int iNumRooms ) :
+    HighPrecisionTimer ( iFrameSizeSamples ),
+    iTickCnt           ( 0 ),
+    iNextRoom          ( 0 ),
+    iNumRoomsDone      ( 0 ),
+    bRun               ( true ),
+    bIdlePending       ( false )
+{
+    // one thread per processor core, the timer thread processes rooms, too,
+    // and more threads than rooms are not useful
+    const int iNumWorkers =
+        max ( 0, min ( QThread::idealThreadCount(), iNumRooms ) - 1 );
+
+    for ( int i = 0; i < iNumWorkers; i++ )
+    {
+        vecpWorkers.Add ( new CWorker ( this ) );
+        vecpWorkers[i]->start ( QThread::TimeCriticalPriority );
+    }
+
+    // the mixers are called directly in the timer thread (and not via the
+    // event loop of the main thread) so that the rooms are processed in
+    // parallel
+    QObject::connect ( &HighPrecisionTimer, SIGNAL ( timeout() ),
+        this, SLOT ( OnTimer() ), Qt::DirectConnection );
+}
+
+CRoomMixerPool::~CRoomMixerPool()
+{
+    Stop();
+
+    // stop the worker threads
+    Mutex.lock();
+    {
+        bRun = false;
+        WaitCondTick.wakeAll();
+    }
+    Mutex.unlock();
+
+    for ( int i = 0; i < vecpWorkers.Size(); i++ )
+    {
+        vecpWorkers[i]->wait ( 5000 );
+        delete vecpWorkers[i];
+    }
+}
+
+void CRoomMixerPool::Stop()
+{
+    // note that after the timer is stopped, no mixer of a room is called
+    // anymore so that the rooms can be deleted
+    HighPrecisionTimer.Stop();
+}
+
+void CRoomMixerPool::OnTimer()
+{
+    const int iNumRooms = vecpRooms.Size();
+
+    // rooms which are started or stopped wait for the end of this tick
+    QMutexLocker TickLocker ( &TickMutex );
+
+    // start a new tick for all rooms
+    Mutex.lock();
+    {
+        iTickCnt++;
+        iNextRoom     = 0;
+        iNumRoomsDone = 0;
+        WaitCondTick.wakeAll();
+    }
+    Mutex.unlock();
+
+    // the timer thread processes rooms, too
+    ProcessRooms();
+
+    // wait until all rooms are done so that the next tick does not overlap
+    // with this one
+    Mutex.lock();
+    {
+        while ( iNumRoomsDone < iNumRooms )
+        {
+            WaitCondDone.wait ( &Mutex );
+        }
+    }
+    Mutex.unlock();
+
+    // if no room is running anymore, the timer is stopped in the main thread
+    bool bAnyRoomRunning = false;
+
+    for ( int i = 0; i < iNumRooms; i++ )
+    {
+        if ( vecpRooms[i]->IsRunning() )
+        {
+            bAnyRoomRunning = true;
+        }
+    }
+
+    if ( !bAnyRoomRunning && !bIdlePending )
+    {
+        bIdlePending = true;
+
+        // (note that Qt will delete the event object when done)
+        QCoreApplication::postEvent ( this,
+            new CCustomEvent ( MS_SERVER_IDLE, 0, 0 ) );
+    }
+}
+
+void CRoomMixerPool::ProcessRooms()
+{
+    const int iNumRooms = vecpRooms.Size();
+
+    for ( ;; )
+    {
+        int iCurRoom;
+
+        // take the next room which is not yet processed
+        Mutex.lock();
+        {
+            iCurRoom = iNextRoom;
+
+            if ( iNextRoom < iNumRooms )
+            {
+                iNextRoom++;
+            }
+        }
+        Mutex.unlock();
+
+        if ( iCurRoom >= iNumRooms )
+        {
+            return;
+        }
+
+        // call the mixer of the room (only if clients are connected)
+        if ( vecpRooms[iCurRoom]->IsRunning() )
+        {
+            vecpRooms[iCurRoom]->OnTimer();
+        }
+
+        Mutex.lock();
+        {
+            iNumRoomsDone++;
+
+            if ( iNumRoomsDone == iNumRooms )
+            {
+                WaitCondDone.wakeAll();
+            }
+        }
+        Mutex.unlock();
+    }
+}
+
+void CRoomMixerPool::WorkerLoop()
+{
+    int iLastTickCnt = 0;
+
+    Mutex.lock();
+
+    while ( bRun )
+    {
+        if ( iTickCnt == iLastTickCnt )
+        {
+            // wait for the next timer tick
+            WaitCondTick.wait ( &Mutex );
+            continue;
+        }
+
+        iLastTickCnt = iTickCnt;
+
+        Mutex.unlock();
+        {
+            ProcessRooms();
+        }
+        Mutex.lock();
+    }
+
+    Mutex.unlock();
+}
+
+void CRoomMixerPool::customEvent ( QEvent* pEvent )
+{
+    if ( pEvent->type() == QEvent::User + 11 )
+    {
+        if ( ( (CCustomEvent*) pEvent )->iMessType == MS_SERVER_IDLE )
+        {
+            bIdlePending = false;
+
+            // a room might have been started in the meantime (the rooms are
+            // started in the main thread, too)
+            for ( int i = 0; i < vecpRooms.Size(); i++ )
+            {
+                if ( vecpRooms[i]->IsRunning() )
+                {
+                    return;
+                }
+            }
+
+            HighPrecisionTimer.Stop();
         }
     }
 }
@@ -26,23 +26,97 @@
 #define SERVER_HOIHGE7LOKIH83JH8_3_43445KJIUHF1912__INCLUDED_
 
 #include <QObject>
+#include <QCoreApplication>
 #include <QTimer>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QHostAddress>
+#include <QCryptographicHash>
+#include <QUuid>
+#include <QHash>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
 #include "cc6_celt.h"
 #include "opus_custom.h"
 #include "global.h"
 #include "socket.h"
 #include "channel.h"
 #include "util.h"
+#include "resample.h"
 #include "serverlogging.h"
 #include "serverlist.h"
+#include "uplink.h"
+#include "listener.h"
+#include "mixstream.h"
+#include "recorder.h"
+#include "mixtap.h"
 
 
 /* Definitions ****************************************************************/
 // no valid channel number
 #define INVALID_CHANNEL_ID                  ( MAX_NUM_CHANNELS + 1 )
 
+// connection admission: number of table entries for the senders which are not
+// yet connected (a larger number of unknown senders replaces the oldest
+// entries which are not yet admitted)
+#define CONN_ADM_TABLE_SIZE                 64
+#define INVALID_CONN_ADM_ENTRY              ( -1 )
+
+// the cookie is valid for the current and the previous time slot
+#define CONN_ADM_COOKIE_TIME_SLOT_MS        10000
+
+// a new challenge is sent to the same sender after this time at the earliest
+#define CONN_ADM_CHALLENGE_INTERVAL_MS      250
+
+// an entry which was not used for this time is free again
+#define CONN_ADM_ENTRY_TIMEOUT_MS           5000
+
+// old clients which do not answer the challenge are admitted if they sent at
+// least this number of audio packets over at least the given time
+#define CONN_ADM_LEGACY_MIN_NUM_PACKETS     50
+#define CONN_ADM_LEGACY_MIN_TIME_MS         500
+
+// lock-free pre-check of the audio packets of senders which are not connected:
+// at most this number of packets per time window is checked by the connection
+// admission (which needs a mutex), all other packets are dropped
+#define CONN_ADM_PRE_CHECK_WINDOW_MS        100
+#define CONN_ADM_PRE_CHECK_MAX_NUM_PACKETS  200
+
+// number of recently admitted senders which pass the pre-check in any case
+#define CONN_ADM_NUM_ADMITTED_KEYS          16
+
+// rate limiting of connection less messages: number of source addresses for
+// which an individual token bucket is stored (least recently used entries are
+// replaced)
+#define CL_RATE_LIMIT_TABLE_SIZE            256
+#define INVALID_CL_RATE_LIMIT_ENTRY         ( -1 )
+
+// token bucket parameters per source address and for all messages (the
+// rates are given in tokens per second, the burst size in tokens)
+#define CL_RATE_LIMIT_SOURCE_RATE           25
+#define CL_RATE_LIMIT_SOURCE_BURST          50
+#define CL_RATE_LIMIT_GLOBAL_RATE           2000
+#define CL_RATE_LIMIT_GLOBAL_BURST          4000
+
+// number of tokens a server list request costs per fragment of the reply (the
+// cost is limited to the burst size so that a large list can still be
+// requested), all other messages cost one token
+#define CL_RATE_LIMIT_COST_SERVER_LIST_FRAG 2
+
+// interval in which the load of the server (used part of the timer tick) is
+// measured
+#define SERVER_LOAD_MEAS_INTERV_MS          1000
+
+// interval in which the counters of the dropped connection less messages are
+// logged (only if they have changed)
+#define SERVER_DROP_LOG_INTERV_MS           600000 // 10 minutes
+
+// maximum number of rooms which can be hosted by one server process (each
+// room uses its own port number)
+#define MAX_NUM_SERVER_ROOMS                64
+
 
 /* Classes ********************************************************************/
 #if ( defined ( WIN32 ) || defined ( _WIN32 ) )
@@ -52,7 +126,7 @@ class CHighPrecisionTimer : public QObject
     Q_OBJECT
 
 public:
-    CHighPrecisionTimer();
+    CHighPrecisionTimer ( const int iFrameSizeSamples );
 
     void Start();
     void Stop();
@@ -61,6 +135,7 @@ public:
 protected:
     QTimer       Timer;
     CVector<int> veciTimeOutIntervals;
+    int          iTimerResolutionMs;
     int          iCurPosInVector;
     int          iIntervalCounter;
 
@@ -85,7 +160,7 @@ class CHighPrecisionTimer : public QThread
     Q_OBJECT
 
 public:
-    CHighPrecisionTimer();
+    CHighPrecisionTimer ( const int iFrameSizeSamples );
 
     void Start();
     void Stop();
@@ -110,12 +185,180 @@ signals:
 #endif
 
 
+// Connection admission ----------------------------------------------------------
+/*
+  A new client must echo a cookie which the server sends in a connection less
+  challenge message before a channel is allocated for the client. The cookie
+  is derived from a secret, the address of the client and the current time
+  slot, i.e., the server does not store any state for the challenges. Only
+  the clients which echoed a valid cookie and the senders of audio packets
+  are stored in a small table of fixed size until a channel is allocated.
+  Old clients which do not know the challenge are admitted after they sent
+  audio packets for a while.
+*/
+class CConnAdmission
+{
+public:
+    CConnAdmission();
+
+    void Reset();
+
+    uint32_t GetCookie ( const CHostAddress& HostAddr ) const
+        { return CalcCookie ( HostAddr, GetCurTimeSlot() ); }
+
+    bool CheckCookie ( const CHostAddress& HostAddr,
+                       const uint32_t      iCookie ) const;
+
+    void Admit ( const CHostAddress& HostAddr );
+
+    bool CheckAudioSender ( const CHostAddress& HostAddr,
+                            bool&               bSendChallenge );
+
+    // lock-free, can be called for each received packet
+    bool PreCheckAudioSender ( const CHostAddress& HostAddr );
+
+    // 32 bit key of an address for lock-free look-ups (never zero, different
+    // addresses may have the same key)
+    static int GetAddrKey ( const CHostAddress& HostAddr );
+
+protected:
+    class CEntry
+    {
+    public:
+        CEntry() : bUsed ( false ), bAdmitted ( false ), iNumPackets ( 0 ),
+            iFirstTimeMs ( 0 ), iLastTimeMs ( 0 ), iLastChallengeMs ( 0 ) {}
+
+        CHostAddress HostAddr;
+        bool         bUsed;
+        bool         bAdmitted;
+        int          iNumPackets;
+        qint64       iFirstTimeMs;
+        qint64       iLastTimeMs;
+        qint64       iLastChallengeMs;
+    };
+
+    static qint64 GetCurTimeSlot()
+        { return QDateTime::currentMSecsSinceEpoch() / CONN_ADM_COOKIE_TIME_SLOT_MS; }
+
+    uint32_t CalcCookie ( const CHostAddress& HostAddr,
+                          const qint64        iTimeSlot ) const;
+
+    int GetEntry ( const CHostAddress& HostAddr,
+                   const qint64        iCurTimeMs );
+
+    QByteArray      vecbySecret;
+    CVector<CEntry> vecEntries;
+    QMutex          Mutex;
+
+    QAtomicInt      iAdmittedKeys[CONN_ADM_NUM_ADMITTED_KEYS];
+    int             iAdmittedKeyIdx;
+    QAtomicInt      iPreCheckWindow;
+    QAtomicInt      iNumPreChecks;
+};
+
+
+// Connection less message rate limiter ----------------------------------------
+/*
+  Every connection less message (and every reply the server generates without
+  a connected channel) must take tokens from the bucket of its source address
+  and from a global bucket. The buckets of the source addresses are stored in
+  a table of fixed size, if the table is full, the least recently used entry
+  is replaced. This class is only used in the main thread.
+*/
+class CCLRateLimiter
+{
+public:
+    CCLRateLimiter();
+
+    void Reset();
+
+    bool Allow ( const CHostAddress& HostAddr,
+                 const int           iCost = 1 );
+
+    static int GetMessageCost ( const int iRecID,
+                                const int iNumServerListFrags );
+
+    // the messages of this address are never dropped (used for the central
+    // server which our registration depends on)
+    void SetExemptAddress ( const CHostAddress& HostAddr )
+        { iExemptInetAddr = HostAddr.InetAddr.toIPv4Address(); }
+
+    // the counters can be read by any thread
+    int GetNumDroppedSource() { return iNumDroppedSource.fetchAndAddRelaxed ( 0 ); }
+    int GetNumDroppedGlobal() { return iNumDroppedGlobal.fetchAndAddRelaxed ( 0 ); }
+
+protected:
+    class CTokenBucket
+    {
+    public:
+        CTokenBucket() : dTokens ( 0 ), iLastUpdateMs ( 0 ) {}
+
+        void Init ( const double dBurst, const qint64 iCurTimeMs )
+            { dTokens = dBurst; iLastUpdateMs = iCurTimeMs; }
+
+        void Update ( const double dRate,
+                      const double dBurst,
+                      const qint64 iCurTimeMs );
+
+        double dTokens;
+        qint64 iLastUpdateMs;
+    };
+
+    class CEntry
+    {
+    public:
+        CEntry() : iInetAddr ( 0 ), bUsed ( false ),
+            iPrev ( INVALID_CL_RATE_LIMIT_ENTRY ), iNext ( INVALID_CL_RATE_LIMIT_ENTRY ) {}
+
+        quint32      iInetAddr;
+        bool         bUsed;
+        CTokenBucket Bucket;
+
+        // doubly linked list in order of the last usage
+        int          iPrev;
+        int          iNext;
+    };
+
+    int  GetEntry ( const quint32 iInetAddr, const qint64 iCurTimeMs );
+    void Unlink ( const int iIdx );
+    void PushFront ( const int iIdx );
+
+    CVector<CEntry>     vecEntries;
+    QHash<quint32, int> EntryIdx;
+    int                 iHead; // most recently used
+    int                 iTail; // least recently used
+    CTokenBucket        GlobalBucket;
+    quint32             iExemptInetAddr;
+
+    QAtomicInt          iNumDroppedSource;
+    QAtomicInt          iNumDroppedGlobal;
+};
+
+
+// the codec modes only hold constant tables, they are shared by the encoders
+// and decoders of all channels (and of all rooms in the multi-room mode)
+class CServerCodecModes
+{
+public:
+    CServerCodecModes();
+    virtual ~CServerCodecModes();
+
+    cc6_CELTMode*   CeltModeMono;
+    cc6_CELTMode*   CeltModeStereo;
+    OpusCustomMode* OpusMode;
+    OpusCustomMode* OpusModeSmall;
+};
+
+
+class CRoomMixerPool;
+
 class CServer : public QObject
 {
     Q_OBJECT
 
 public:
     CServer ( const int      iNewMaxNumChan,
+              const int      iNewMaxNumListeners,
               const QString& strLoggingFileName,
               const quint16  iPortNumber,
               const QString& strHTMLStatusFileName,
@@ -123,22 +366,41 @@ public:
               const QString& strServerNameForHTMLStatusFile,
               const QString& strCentralServer,
               const QString& strServerInfo,
+              const QString& strServerListFileName,
+              const QString& strServerGroup,
+              const QString& strUpstreamServer,
+              const QString& strMixStreamFileName,
+              const QString& strNRecordingDirName,
+              const QString& strMixTapName,
               const QString& strNewWelcomeMessage,
-              const bool     bNCentServPingServerInList );
+              const bool     bNCentServPingServerInList,
+              const bool     bNUseSmallFrameSize,
+              const bool     bNRecordingSyncToDisk,
+              const bool     bNMixTapGroupRead,
+              CServerCodecModes* pNCodecModes = NULL );
+
+    virtual ~CServer();
 
     void Start();
     void Stop();
-    bool IsRunning() { return HighPrecisionTimer.isActive(); }
+    bool IsRunning() { return ( pRoomMixerPool != NULL ) ?
+                              ( iRoomRunning.fetchAndAddAcquire ( 0 ) != 0 ) :
+                              HighPrecisionTimer.isActive(); }
 
-    bool PutAudioData ( const CVector<uint8_t>& vecbyRecBuf,
-                        const int               iNumBytesRead,
-                        const CHostAddress&     HostAdr,
-                        int&                    iCurChanID );
+    // in the multi-room mode the timer of the room mixer pool is used instead
+    // of the timer of this server (must be set before the server is started)
+    void SetRoomMixerPool ( CRoomMixerPool* pNRoomMixerPool )
+        { pRoomMixerPool = pNRoomMixerPool; }
+
+    EPutDataStat PutAudioData ( const CVector<uint8_t>& vecbyRecBuf,
+                                const int               iNumBytesRead,
+                                const CHostAddress&     HostAdr,
+                                int&                    iCurChanID );
 
     void GetConCliParam ( CVector<CHostAddress>& vecHostAddresses,
                           CVector<QString>&      vecsName,
                           CVector<int>&          veciJitBufNumFrames,
-                          CVector<int>&          veciNetwFrameSizeFact );
+                          CVector<int>&          veciNetwBlockSizeSamples );
 
 
     // Server list management --------------------------------------------------
@@ -186,6 +448,8 @@ public:
 
     bool GetAutoRunMinimized() { return bAutoRunMinimized; }
 
+    // number of connection less messages dropped by the rate limiter
+
 protected:
     // access functions for actual channels
     bool IsConnected ( const int iChanNum )
@@ -200,6 +464,7 @@ protected:
     CVector<CChannelInfo> CreateChannelList();
     void CreateAndSendChanListForAllConChannels();
     void CreateAndSendChanListForThisChan ( const int iCurChanID );
+    void UpdateAndSendChanList ( const int iReqChanID );
     void CreateAndSendChatTextForAllConChannels ( const int      iCurChanID,
                                                   const QString& strChatText );
     void WriteHTMLChannelList();
@@ -216,22 +481,42 @@ protected:
     // do not use the vector class since CChannel does not have appropriate
     // copy constructor/operator
     CChannel                   vecChannels[MAX_NUM_CHANNELS];
+
+    // address keys of the channels for the lock-free pre-check of received
+    // audio packets (zero if the channel is not connected)
+    QAtomicInt                 iChanAddrKeys[MAX_NUM_CHANNELS];
     int                        iMaxNumChannels;
+    int                        iServerFrameSizeSamples;
     CProtocol                  ConnLessProtocol;
+    CConnAdmission             ConnAdmission;
+    CCLRateLimiter             CLRateLimiter;
     QMutex                     Mutex;
 
-    // audio encoder/decoder
-    cc6_CELTMode*              CeltModeMono[MAX_NUM_CHANNELS];
+    // audio encoder/decoder (the codec modes are owned by this server if no
+    // shared codec modes are given)
+    CServerCodecModes*         pOwnCodecModes;
+    CServerCodecModes*         pCodecModes;
     cc6_CELTEncoder*           CeltEncoderMono[MAX_NUM_CHANNELS];
     cc6_CELTDecoder*           CeltDecoderMono[MAX_NUM_CHANNELS];
-    cc6_CELTMode*              CeltModeStereo[MAX_NUM_CHANNELS];
     cc6_CELTEncoder*           CeltEncoderStereo[MAX_NUM_CHANNELS];
     cc6_CELTDecoder*           CeltDecoderStereo[MAX_NUM_CHANNELS];
-    OpusCustomMode*            OpusMode[MAX_NUM_CHANNELS];
     OpusCustomEncoder*         OpusEncoderMono[MAX_NUM_CHANNELS];
     OpusCustomDecoder*         OpusDecoderMono[MAX_NUM_CHANNELS];
     OpusCustomEncoder*         OpusEncoderStereo[MAX_NUM_CHANNELS];
     OpusCustomDecoder*         OpusDecoderStereo[MAX_NUM_CHANNELS];
+    OpusCustomEncoder*         OpusEncoderMonoSmall[MAX_NUM_CHANNELS];
+    OpusCustomDecoder*         OpusDecoderMonoSmall[MAX_NUM_CHANNELS];
+    OpusCustomEncoder*         OpusEncoderStereoSmall[MAX_NUM_CHANNELS];
+    OpusCustomDecoder*         OpusDecoderStereoSmall[MAX_NUM_CHANNELS];
+
+    // number of coded bytes the OPUS encoder bit rates are currently set to
+    int                        iOpusEncMonoNumCodedBytes[MAX_NUM_CHANNELS];
+    int                        iOpusEncStereoNumCodedBytes[MAX_NUM_CHANNELS];
+    int                        iOpusEncMonoSmallNumCodedBytes[MAX_NUM_CHANNELS];
+    int                        iOpusEncStereoSmallNumCodedBytes[MAX_NUM_CHANNELS];
+
+    // clock drift compensation
+    CClockDriftComp            DriftComp[MAX_NUM_CHANNELS];
 
     CVector<QString>           vstrChatColors;
     CVector<int>               vecChanIDsCurConChan;
@@ -242,11 +527,52 @@ protected:
     CVector<int16_t>           vecsSendData;
     CVector<uint8_t>           vecbyCodedData;
 
+    // cascading: the submix of the local clients is sent to the upstream
+    // server and the mix of the upstream server is an additional source
+    CServerUplink*             pUplink;
+    CVector<double>            vecdUnityGains;
+    CVector<int16_t>           vecsUplinkData;
+
+    // the listeners get the room mix (all sources with unity gain)
+    CServerListeners           Listeners;
+    CVector<int16_t>           vecsRoomMix;
+
+    // the room mix can also be written as an encoded stream (e.g. in a pipe)
+    CMixStreamWriter*          pMixStream;
+
+    // multitrack recording of the decoded audio of all clients
+    CSessionRecorder*          pRecorder;
+    QString                    strRecordingDirName;
+
+    // the room mix and the audio of all clients for local processes
+    CMixTap*                   pMixTap;
+
+    // if the server runs with the small frame size, the audio frames of the
+    // clients which use the default frame size span multiple timer ticks
+    CVector<CVector<int16_t> > vecvecsChanDecFrame;
+    CVector<CVector<int16_t> > vecvecsChanEncFrame;
+    int                        iServerTickCnt;
+
+    // load measurement: processing time of the timer ticks in the current
+    // measurement interval
+    QElapsedTimer              LoadMeasTimer;
+    qint64                     iLoadBusyNs;
+
+    // the last sent connected clients list with its version and the list
+    // version each channel has received (for the incremental list updates)
+    CVector<CChannelInfo>      vecChanListLast;
+    int                        iChanListVersion;
+    CVector<int>               veciChanListVersion;
+    QMutex                     MutexChanList;
+
     // actual working objects
     CHighPrioSocket            Socket;
 
     // logging
     CServerLogging             Logging;
+    QTimer                     TimerLogDropped;
+    int                        iLastLogNumDroppedSource;
+    int                        iLastLogNumDroppedGlobal;
 
     // HTML file server status
     bool                       bWriteStatusHTMLFile;
@@ -255,6 +581,11 @@ protected:
 
     CHighPrecisionTimer        HighPrecisionTimer;
 
+    // multi-room mode: the mixer is called by the room mixer pool
+    CRoomMixerPool*            pRoomMixerPool;
+    QAtomicInt                 iRoomRunning; // read by the room mixer pool
+    bool                       bRoomIdlePending;
+
     // server list
     CServerListManager         ServerListManager;
 
@@ -270,17 +601,23 @@ signals:
 
 public slots:
     void OnTimer();
+    void OnTimerLogDropped();
 
-    void OnSendProtMessage ( int              iChID,
-                             CVector<uint8_t> vecMessage );
+    void OnSendProtMessage ( int                     iChID,
+                             const CVector<uint8_t>& vecMessage );
 
     void OnNewConnection ( int          iChID,
                            CHostAddress RecHostAddr );
 
     void OnServerFull ( CHostAddress RecHostAddr );
 
-    void OnSendCLProtMessage ( CHostAddress     InetAddr,
-                               CVector<uint8_t> vecMessage );
+    void OnConnChallengeRequired ( CHostAddress RecHostAddr );
+
+    void OnCLConnChallengeRespReceived ( CHostAddress InetAddr,
+                                         quint32      iCookie );
+
+    void OnSendCLProtMessage ( CHostAddress            InetAddr,
+                               const CVector<uint8_t>& vecMessage );
 
     void OnProtcolCLMessageReceived ( int              iRecID,
                                       CVector<uint8_t> vecbyMesBodyData,
@@ -314,8 +651,8 @@ public slots:
         }
     }
 
-    void OnCLReqServerList ( CHostAddress InetAddr )
-        { ServerListManager.CentralServerQueryServerList ( InetAddr ); }
+    void OnCLReqServerList ( CHostAddress InetAddr, bool bFragmentsSupported )
+        { ServerListManager.CentralServerQueryServerList ( InetAddr, bFragmentsSupported ); }
 
     void OnCLReqVersionAndOS ( CHostAddress InetAddr )
         { ConnLessProtocol.CreateCLVersionAndOSMes ( InetAddr ); }
@@ -331,32 +668,59 @@ public slots:
         ServerListManager.CentralServerUnregisterServer ( InetAddr );
     }
 
+    void OnCLServerLoadReceived ( CHostAddress InetAddr,
+                                  int          iNumClients,
+                                  int          iTickHeadroom,
+                                  QString      strGroup )
+    {
+        ServerListManager.CentralServerUpdateServerLoad ( InetAddr,
+                                                          iNumClients,
+                                                          iTickHeadroom,
+                                                          strGroup );
+    }
+
+    void OnCLReqGroupServer ( CHostAddress InetAddr,
+                              QString      strGroup,
+                              int          iNumClients )
+    {
+        ServerListManager.CentralServerQueryGroupServer ( InetAddr,
+                                                          strGroup,
+                                                          iNumClients );
+    }
+
     void OnCLDisconnection ( CHostAddress InetAddr );
 
+    void OnCLReqListen ( CHostAddress InetAddr,
+                         quint32      iCookie,
+                         int          iAudComprType,
+                         int          iNumAudioChannels,
+                         int          iNetwFrameSize,
+                         int          iFrameSizeSamples );
+
 
     // CODE TAG: MAX_NUM_CHANNELS_TAG
     // make sure we have MAX_NUM_CHANNELS connections!!!
     // send message
-    void OnSendProtMessCh0  ( CVector<uint8_t> mess ) { OnSendProtMessage ( 0,  mess ); }
-    void OnSendProtMessCh1  ( CVector<uint8_t> mess ) { OnSendProtMessage ( 1,  mess ); }
-    void OnSendProtMessCh2  ( CVector<uint8_t> mess ) { OnSendProtMessage ( 2,  mess ); }
-    void OnSendProtMessCh3  ( CVector<uint8_t> mess ) { OnSendProtMessage ( 3,  mess ); }
-    void OnSendProtMessCh4  ( CVector<uint8_t> mess ) { OnSendProtMessage ( 4,  mess ); }
-    void OnSendProtMessCh5  ( CVector<uint8_t> mess ) { OnSendProtMessage ( 5,  mess ); }
-    void OnSendProtMessCh6  ( CVector<uint8_t> mess ) { OnSendProtMessage ( 6,  mess ); }
-    void OnSendProtMessCh7  ( CVector<uint8_t> mess ) { OnSendProtMessage ( 7,  mess ); }
-    void OnSendProtMessCh8  ( CVector<uint8_t> mess ) { OnSendProtMessage ( 8,  mess ); }
-    void OnSendProtMessCh9  ( CVector<uint8_t> mess ) { OnSendProtMessage ( 9,  mess ); }
-    void OnSendProtMessCh10 ( CVector<uint8_t> mess ) { OnSendProtMessage ( 10, mess ); }
-    void OnSendProtMessCh11 ( CVector<uint8_t> mess ) { OnSendProtMessage ( 11, mess ); }
-    void OnSendProtMessCh12 ( CVector<uint8_t> mess ) { OnSendProtMessage ( 12, mess ); }
-    void OnSendProtMessCh13 ( CVector<uint8_t> mess ) { OnSendProtMessage ( 13, mess ); }
-    void OnSendProtMessCh14 ( CVector<uint8_t> mess ) { OnSendProtMessage ( 14, mess ); }
-    void OnSendProtMessCh15 ( CVector<uint8_t> mess ) { OnSendProtMessage ( 15, mess ); }
-    void OnSendProtMessCh16 ( CVector<uint8_t> mess ) { OnSendProtMessage ( 16, mess ); }
-    void OnSendProtMessCh17 ( CVector<uint8_t> mess ) { OnSendProtMessage ( 17, mess ); }
-    void OnSendProtMessCh18 ( CVector<uint8_t> mess ) { OnSendProtMessage ( 18, mess ); }
-    void OnSendProtMessCh19 ( CVector<uint8_t> mess ) { OnSendProtMessage ( 19, mess ); }
+    void OnSendProtMessCh0  ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 0,  mess ); }
+    void OnSendProtMessCh1  ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 1,  mess ); }
+    void OnSendProtMessCh2  ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 2,  mess ); }
+    void OnSendProtMessCh3  ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 3,  mess ); }
+    void OnSendProtMessCh4  ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 4,  mess ); }
+    void OnSendProtMessCh5  ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 5,  mess ); }
+    void OnSendProtMessCh6  ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 6,  mess ); }
+    void OnSendProtMessCh7  ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 7,  mess ); }
+    void OnSendProtMessCh8  ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 8,  mess ); }
+    void OnSendProtMessCh9  ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 9,  mess ); }
+    void OnSendProtMessCh10 ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 10, mess ); }
+    void OnSendProtMessCh11 ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 11, mess ); }
+    void OnSendProtMessCh12 ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 12, mess ); }
+    void OnSendProtMessCh13 ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 13, mess ); }
+    void OnSendProtMessCh14 ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 14, mess ); }
+    void OnSendProtMessCh15 ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 15, mess ); }
+    void OnSendProtMessCh16 ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 16, mess ); }
+    void OnSendProtMessCh17 ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 17, mess ); }
+    void OnSendProtMessCh18 ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 18, mess ); }
+    void OnSendProtMessCh19 ( const CVector<uint8_t>& mess ) { OnSendProtMessage ( 19, mess ); }
 
     void OnReqConnClientsListCh0()  { CreateAndSendChanListForThisChan ( 0 ); }
     void OnReqConnClientsListCh1()  { CreateAndSendChanListForThisChan ( 1 ); }
@@ -443,4 +807,78 @@ public slots:
     void OnServerAutoSockBufSizeChangeCh19 ( int iNNumFra ) { vecChannels[19].CreateJitBufMes ( iNNumFra ); }
 };
 
+
+// Room mixer pool -------------------------------------------------------------
+// Multi-room mode: one server process hosts a number of independent rooms
+// (one CServer object per room, each with its own port, channels and mixer).
+// The mixers of all rooms are called on the same timer tick and the rooms are
+// distributed over a pool of worker threads (one thread per processor core,
+// the timer thread also processes rooms).
+class CRoomMixerPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    CRoomMixerPool ( const int iFrameSizeSamples,
+                     const int iNumRooms );
+
+    virtual ~CRoomMixerPool();
+
+    void AddRoom ( CServer* pRoom ) { vecpRooms.Add ( pRoom ); }
+
+    // the timer is started by the rooms if a client connects and is stopped
+    // if no room is running anymore
+    void Start() { HighPrecisionTimer.Start(); }
+    void Stop();
+
+    // blocks until the current timer tick is done (if any), after a room was
+    // stopped its mixer is not called anymore when this function returns
+    void WaitForTick() { QMutexLocker locker ( &TickMutex ); }
+
+    int GetNumWorkers() const { return vecpWorkers.Size(); }
+
+    // the codec modes are shared by all rooms
+    CServerCodecModes* GetCodecModes() { return &CodecModes; }
+
+    // main loop of the worker threads
+    void WorkerLoop();
+
+protected:
+    class CWorker : public QThread
+    {
+    public:
+        CWorker ( CRoomMixerPool* pNPool ) : pPool ( pNPool ) {}
+
+    protected:
+        virtual void run() { pPool->WorkerLoop(); }
+
+        CRoomMixerPool* pPool;
+    };
+
+    void ProcessRooms();
+
+    virtual void customEvent ( QEvent* pEvent );
+
+    CVector<CServer*>   vecpRooms;
+    CVector<CWorker*>   vecpWorkers;
+    CHighPrecisionTimer HighPrecisionTimer;
+    CServerCodecModes   CodecModes;
+
+    // the tick counter is incremented on each timer tick, the rooms are then
+    // taken one by one by the workers (next room index) until all rooms are
+    // done
+    QMutex              Mutex;
+    QMutex              TickMutex; // locked during the whole timer tick
+    QWaitCondition      WaitCondTick;
+    QWaitCondition      WaitCondDone;
+    int                 iTickCnt;
+    int                 iNextRoom;
+    int                 iNumRoomsDone;
+    bool                bRun;
+    bool                bIdlePending;
+
+public slots:
+    void OnTimer();
+};
+
 #endif /* !defined ( SERVER_HOIHGE7LOKIH83JH8_3_43445KJIUHF1912__INCLUDED_ ) */
@@ -435,14 +435,14 @@ void CServerDlg::OnTimer()
     CVector<CHostAddress> vecHostAddresses;
     CVector<QString>      vecsName;
     CVector<int>          veciJitBufNumFrames;
-    CVector<int>          veciNetwFrameSizeFact;
+    CVector<int>          veciNetwBlockSizeSamples;
 
     ListViewMutex.lock();
     {
         pServer->GetConCliParam ( vecHostAddresses,
                                   vecsName,
                                   veciJitBufNumFrames,
-                                  veciNetwFrameSizeFact );
+                                  veciNetwBlockSizeSamples );
 
         // we assume that all vectors have the same length
         const int iNumChannels = vecHostAddresses.Size();
@@ -466,8 +466,8 @@ void CServerDlg::OnTimer()
                 // out network block size
                 vecpListViewItems[i]->setText ( 3,
                     QString().setNum ( static_cast<double> (
-                    veciNetwFrameSizeFact[i] * SYSTEM_BLOCK_DURATION_MS_FLOAT
-                    ), 'f', 2 ) );
+                    veciNetwBlockSizeSamples[i] ) / SYSTEM_SAMPLE_RATE_HZ * 1000,
+                    'f', 2 ) );
 
                 vecpListViewItems[i]->setHidden ( false );
             }
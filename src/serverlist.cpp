@@ -23,12 +23,126 @@
 \******************************************************************************/
 
 #include "serverlist.h"
+#ifdef _WIN32
+# include <io.h>
+#else
+# include <stdio.h>
+# include <unistd.h>
+#endif
 
 
 /* Implementation *************************************************************/
+// Server list snapshot writer -------------------------------------------------
+void CServerListSnapshotWriter::Start ( const QString& strNewFileName )
+{
+    strFileName = strNewFileName;
+    bRun        = true;
+
+    start ( QThread::LowestPriority );
+}
+
+void CServerListSnapshotWriter::Stop()
+{
+    // disable run flag so that the thread loop can be exit (a pending
+    // snapshot is still written)
+    Mutex.lock();
+    {
+        bRun = false;
+        WaitCondition.wakeOne();
+    }
+    Mutex.unlock();
+
+    // give thread some time to terminate
+    wait ( 5000 );
+}
+
+void CServerListSnapshotWriter::Put ( const QByteArray& vecbyNewSnapshot )
+{
+    Mutex.lock();
+    {
+        vecbySnapshot = vecbyNewSnapshot;
+        bPending      = true;
+        WaitCondition.wakeOne();
+    }
+    Mutex.unlock();
+}
+
+void CServerListSnapshotWriter::run()
+{
+    QByteArray vecbyCurSnapshot;
+
+    Mutex.lock();
+
+    while ( bRun || bPending )
+    {
+        if ( !bPending )
+        {
+            WaitCondition.wait ( &Mutex );
+            continue;
+        }
+
+        // take the snapshot and write it without holding the lock
+        vecbyCurSnapshot = vecbySnapshot;
+        bPending         = false;
+
+        Mutex.unlock();
+        {
+            WriteFile ( vecbyCurSnapshot );
+        }
+        Mutex.lock();
+    }
+
+    Mutex.unlock();
+}
+
+bool CServerListSnapshotWriter::WriteFile ( const QByteArray& vecbyCurSnapshot )
+{
+    // the snapshot is written to a temporary file first which is synced to
+    // the disk and then atomically replaces the old snapshot so that a crash
+    // while writing does not destroy the last snapshot
+    const QString strTmpFileName = strFileName + SERVLIST_SNAPSHOT_TMP_SUFFIX;
+    QFile         SnapshotFile ( strTmpFileName );
+
+    if ( !SnapshotFile.open ( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        return false;
+    }
+
+    bool bWriteOK =
+        ( SnapshotFile.write ( vecbyCurSnapshot ) == vecbyCurSnapshot.size() ) &&
+        SnapshotFile.flush();
+
+#ifdef _WIN32
+    bWriteOK = bWriteOK && ( _commit ( SnapshotFile.handle() ) == 0 );
+#else
+    bWriteOK = bWriteOK && ( fsync ( SnapshotFile.handle() ) == 0 );
+#endif
+
+    SnapshotFile.close();
+
+    if ( !bWriteOK )
+    {
+        return false;
+    }
+
+    // QFile::rename() does not replace an existing file
+#ifdef _WIN32
+    return MoveFileExW ( reinterpret_cast<const wchar_t*> ( strTmpFileName.utf16() ),
+                         reinterpret_cast<const wchar_t*> ( strFileName.utf16() ),
+                         MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) != 0;
+#else
+    return rename ( QFile::encodeName ( strTmpFileName ).constData(),
+                    QFile::encodeName ( strFileName ).constData() ) == 0;
+#endif
+}
+
+
+// Server list manager ---------------------------------------------------------
 CServerListManager::CServerListManager ( const quint16  iNPortNum,
                                          const QString& sNCentServAddr,
                                          const QString& strServerInfo,
+                                         const QString& strNSnapshotFileName,
+                                         const QString& strNServerGroup,
                                          const int      iNumChannels,
                                          const bool     bNCentServPingServerInList,
                                          CProtocol*     pNConLProt )
@@ -38,6 +152,20 @@ CServerListManager::CServerListManager ( const quint16  iNPortNum,
       bCentServPingServerInList       ( bNCentServPingServerInList ),
       pConnLessProtocol               ( pNConLProt )
 {
+    // init the registry state
+    vecvecExpiryWheel.Init ( SERVLIST_EXPIRY_WHEEL_SIZE );
+    iExpiryTick           = 0;
+    iListVersion          = 0;
+    iCacheListVersion     = SERVLIST_INVALID_IDX; // cache is not yet valid
+    iHolePunchListVersion = SERVLIST_INVALID_IDX;
+    iSnapshotListVersion  = SERVLIST_INVALID_IDX;
+    strSnapshotFileName   = strNSnapshotFileName;
+
+    // init the load of this server (no client connected)
+    strServerGroup         = strNServerGroup.left ( MAX_LEN_SERVER_GROUP );
+    iSlaveLoadNumClients   = 0;
+    iSlaveLoadTickHeadroom = 100;
+
     // set the central server address
     SetCentralServerAddress ( sNCentServAddr );
 
@@ -56,7 +184,8 @@ CServerListManager::CServerListManager ( const quint16  iNPortNum,
 
     // per definition, the very first entry is this server and this entry will
     // never be deleted
-    ServerList.clear();
+    ServerList.Init ( 0 );
+    ServerListIdx.clear();
 
     // init server list entry (server info for this server) with defaults, per
     // definition the client substitudes the IP address of the central server
@@ -92,7 +221,7 @@ CServerListManager::CServerListManager ( const quint16  iNPortNum,
     }
 
     // per definition, the first entry in the server list is the own server
-    ServerList.append ( ThisServerListEntry );
+    ServerList.Add ( ThisServerListEntry );
 
     // parse the predefined server infos (if any) according to definition:
     // [server1 address];[server1 name];[server1 city]; ...
@@ -140,8 +269,15 @@ CServerListManager::CServerListManager ( const quint16  iNPortNum,
                 iCountry );
         }
 
-        // add the new server to the server list
-        ServerList.append ( NewServerListEntry );
+        // add the new server to the server list (the predefined servers are
+        // in the address index but they never expire)
+        if ( !ServerListIdx.contains ( GetAddressKey ( NewServerListEntry.HostAddr ) ) )
+        {
+            ServerListIdx.insert ( GetAddressKey ( NewServerListEntry.HostAddr ),
+                                   ServerList.Size() );
+        }
+
+        ServerList.Add ( NewServerListEntry );
 
         // we have used four items and have created one predefined server
         // (adjust counters)
@@ -149,6 +285,28 @@ CServerListManager::CServerListManager ( const quint16  iNPortNum,
         iNumPredefinedServers++;
     }
 
+    // load the registered servers of the last run and start the thread which
+    // writes the snapshots of the server list (central server only)
+    if ( !bIsCentralServer )
+    {
+        strSnapshotFileName = "";
+    }
+
+    if ( !strSnapshotFileName.isEmpty() )
+    {
+        // the temporary file is only used if the last snapshot is missing or
+        // unreadable (e.g. the server was stopped while writing the very
+        // first snapshot)
+        if ( !LoadSnapshot ( strSnapshotFileName ) )
+        {
+            LoadSnapshot ( strSnapshotFileName + SERVLIST_SNAPSHOT_TMP_SUFFIX );
+        }
+
+        iSnapshotListVersion = iListVersion;
+
+        SnapshotWriter.Start ( strSnapshotFileName );
+    }
+
 
     // Connections -------------------------------------------------------------
     QObject::connect ( &TimerPollList, SIGNAL ( timeout() ),
@@ -162,6 +320,25 @@ CServerListManager::CServerListManager ( const quint16  iNPortNum,
 
     QObject::connect ( &TimerRegistering, SIGNAL ( timeout() ),
         this, SLOT ( OnTimerRegistering() ) );
+
+    QObject::connect ( &TimerHolePunch, SIGNAL ( timeout() ),
+        this, SLOT ( OnTimerHolePunch() ) );
+}
+
+CServerListManager::~CServerListManager()
+{
+    if ( !strSnapshotFileName.isEmpty() )
+    {
+        // write the current state of the server list on shutdown
+        if ( bIsCentralServer && bEnabled )
+        {
+            QMutexLocker locker ( &Mutex );
+
+            SnapshotWriter.Put ( CreateSnapshot() );
+        }
+
+        SnapshotWriter.Stop();
+    }
 }
 
 void CServerListManager::SetCentralServerAddress ( const QString sNCentServAddr )
@@ -184,6 +361,14 @@ void CServerListManager::SetCentralServerAddress ( const QString sNCentServAddr
               ( !bUseDefaultCentralServerAddress )
             );
 
+        // servers on the same host (e.g. the other rooms of a multi-room
+        // server) register from the loopback address which is not reachable
+        // for the clients, we list them with the address of this host instead
+        if ( bIsCentralServer && CentralServerPublicAddr.isNull() )
+        {
+            CentralServerPublicAddr = NetworkUtil::GetLocalAddress();
+        }
+
         bEnabled = true;
     }
     else
@@ -243,6 +428,8 @@ void CServerListManager::Update()
         if ( bIsCentralServer )
         {
             TimerPollList.stop();
+            TimerHolePunch.stop();
+            HolePunchQueue.clear();
 
             if ( bCentServPingServerInList )
             {
@@ -263,7 +450,7 @@ void CServerListManager::OnTimerPingServerInList()
 {
     QMutexLocker locker ( &Mutex );
 
-    const int iCurServerListSize = ServerList.size();
+    const int iCurServerListSize = ServerList.Size();
 
     // send ping to list entries except of the very first one (which is the central
     // server entry) and the predefined servers
@@ -278,65 +465,136 @@ void CServerListManager::OnTimerPollList()
 {
     QMutexLocker locker ( &Mutex );
 
-    // Check all list entries except of the very first one (which is the central
-    // server entry) and the predefined servers if they are still valid.
-    // Note that we have to use "ServerList.size()" function in the for loop
-    // since we may remove elements from the server list inside the for loop.
-    for ( int iIdx = 1 + iNumPredefinedServers; iIdx < ServerList.size(); iIdx++ )
+    // advance the expiry wheel by one tick and remove all entries which expire
+    // on this tick, entries which were registered again in the meantime have
+    // a later expiry tick and are kept
+    iExpiryTick++;
+
+    CVector<quint64>& vecCurSlot =
+        vecvecExpiryWheel[iExpiryTick % SERVLIST_EXPIRY_WHEEL_SIZE];
+
+    const int iNumKeys = vecCurSlot.Size();
+
+    for ( int i = 0; i < iNumKeys; i++ )
     {
-        // 1 minute = 60 * 1000 ms
-        if ( ServerList[iIdx].RegisterTime.elapsed() >
-                ( SERVLIST_TIME_OUT_MINUTES * 60000 ) )
+        const int iIdx = ServerListIdx.value ( vecCurSlot[i], SERVLIST_INVALID_IDX );
+
+        if ( ( iIdx > iNumPredefinedServers ) &&
+             ( ServerList[iIdx].iExpireTick == iExpiryTick ) )
         {
-            // remove this list entry
-            ServerList.removeAt ( iIdx );
+            RemoveEntry ( iIdx );
         }
     }
+
+    // the slot is reused for the entries which expire in a full wheel turn
+    vecCurSlot.Init ( 0 );
+
+    // write a new snapshot of the server list
+    if ( !strSnapshotFileName.isEmpty() &&
+         ( ( iSnapshotListVersion != iListVersion ) ||
+           ( iExpiryTick % SERVLIST_SNAPSHOT_NUM_TICKS == 0 ) ) )
+    {
+        SnapshotWriter.Put ( CreateSnapshot() );
+        iSnapshotListVersion = iListVersion;
+    }
+
+    // remove the clients from the hole punching history which may trigger the
+    // hole punching again
+    const qint64 iCurTimeMs = QDateTime::currentMSecsSinceEpoch();
+
+    QHash<quint64, qint64>::iterator it = HolePunchLastTimeMs.begin();
+
+    while ( it != HolePunchLastTimeMs.end() )
+    {
+        if ( iCurTimeMs - it.value() >= SERVLIST_HOLE_PUNCH_DEDUP_MS )
+        {
+            it = HolePunchLastTimeMs.erase ( it );
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+bool CServerListManager::IsSameServerInfo ( const CServerCoreInfo& ServerInfo1,
+                                            const CServerCoreInfo& ServerInfo2 )
+{
+    return ( ServerInfo1.iLocalPortNumber == ServerInfo2.iLocalPortNumber ) &&
+           ( ServerInfo1.strName          == ServerInfo2.strName ) &&
+           ( ServerInfo1.strTopic         == ServerInfo2.strTopic ) &&
+           ( ServerInfo1.eCountry         == ServerInfo2.eCountry ) &&
+           ( ServerInfo1.strCity          == ServerInfo2.strCity ) &&
+           ( ServerInfo1.iMaxNumClients   == ServerInfo2.iMaxNumClients ) &&
+           ( ServerInfo1.bPermanentOnline == ServerInfo2.bPermanentOnline );
+}
+
+void CServerListManager::ScheduleExpiry ( const int iIdx,
+                                          const int iNumTicks )
+{
+    // note that the mutex must be locked by the caller
+    ServerList[iIdx].iExpireTick = iExpiryTick + iNumTicks;
+
+    vecvecExpiryWheel[ServerList[iIdx].iExpireTick % SERVLIST_EXPIRY_WHEEL_SIZE].Add (
+        GetAddressKey ( ServerList[iIdx].HostAddr ) );
 }
 
-void CServerListManager::CentralServerRegisterServer ( const CHostAddress&    InetAddr,
+void CServerListManager::RemoveEntry ( const int iIdx )
+{
+    // note that the mutex must be locked by the caller
+    const int iLastIdx = ServerList.Size() - 1;
+
+    ServerListIdx.remove ( GetAddressKey ( ServerList[iIdx].HostAddr ) );
+
+    // the last entry is moved to the position of the removed entry so that
+    // no other entry has to be moved
+    if ( iIdx != iLastIdx )
+    {
+        ServerList[iIdx] = ServerList[iLastIdx];
+        ServerListIdx.insert ( GetAddressKey ( ServerList[iIdx].HostAddr ), iIdx );
+    }
+
+    ServerList.pop_back();
+    iListVersion++;
+}
+
+void CServerListManager::CentralServerRegisterServer ( const CHostAddress&    SourceAddr,
                                                        const CServerCoreInfo& ServerInfo )
 {
     QMutexLocker locker ( &Mutex );
 
     if ( bIsCentralServer && bEnabled )
     {
-        const int iCurServerListSize = ServerList.size();
-        
-        // check for maximum allowed number of servers in the server list
-        if ( iCurServerListSize < MAX_NUM_SERVERS_IN_SERVER_LIST )
-        {
-            // define invalid index used as a flag
-            const int ciInvalidIdx = -1;
+        const CHostAddress InetAddr = GetRegistrationAddress ( SourceAddr );
 
-            // Check if server is already registered. Use address to identify
-            // a server. The very first list entry must not be checked since
-            // this is per definition the central server (i.e., this server)
-            int iSelIdx = ciInvalidIdx; // initialize with an illegal value
-            for ( int iIdx = 1; iIdx < iCurServerListSize; iIdx++ )
-            {
-                if ( ServerList[iIdx].HostAddr == InetAddr )
-                {
-                    // store entry index
-                    iSelIdx = iIdx;
+        // Check if server is already registered. Use address to identify
+        // a server. The very first list entry is not in the address index
+        // since this is per definition the central server (i.e., this server).
+        const int iSelIdx = ServerListIdx.value ( GetAddressKey ( InetAddr ),
+                                                  SERVLIST_INVALID_IDX );
 
-                    // entry found, leave for-loop
-                    continue;
-                }
-            }
-
-            // if server is not yet registered, we have to create a new entry
-            if ( iSelIdx == ciInvalidIdx )
+        // if server is not yet registered, we have to create a new entry
+        if ( iSelIdx == SERVLIST_INVALID_IDX )
+        {
+            // check for maximum allowed number of servers in the server list
+            if ( ServerList.Size() < MAX_NUM_SERVERS_IN_SERVER_LIST )
             {
                 // create a new server list entry and init with received data
-                ServerList.append ( CServerListEntry ( InetAddr, ServerInfo ) );
+                ServerListIdx.insert ( GetAddressKey ( InetAddr ), ServerList.Size() );
+                ServerList.Add ( CServerListEntry ( InetAddr, ServerInfo ) );
+                ScheduleExpiry ( ServerList.Size() - 1 );
+                iListVersion++;
             }
-            else
+        }
+        else
+        {
+            // do not update the information in the predefined servers
+            if ( iSelIdx > iNumPredefinedServers )
             {
-                // do not update the information in the predefined servers
-                if ( iSelIdx > iNumPredefinedServers )
+                // update all data and call update registration function (the
+                // list version is only changed if the data was changed)
+                if ( !IsSameServerInfo ( ServerList[iSelIdx], ServerInfo ) )
                 {
-                    // update all data and call update registration function
                     ServerList[iSelIdx].iLocalPortNumber = ServerInfo.iLocalPortNumber;
                     ServerList[iSelIdx].strName          = ServerInfo.strName;
                     ServerList[iSelIdx].strTopic         = ServerInfo.strTopic;
@@ -345,103 +603,552 @@ void CServerListManager::CentralServerRegisterServer ( const CHostAddress&    In
                     ServerList[iSelIdx].iMaxNumClients   = ServerInfo.iMaxNumClients;
                     ServerList[iSelIdx].bPermanentOnline = ServerInfo.bPermanentOnline;
 
-                    ServerList[iSelIdx].UpdateRegistration();
+                    iListVersion++;
                 }
+
+                ServerList[iSelIdx].bConfirmed = true;
+                ServerList[iSelIdx].UpdateRegistration();
+                ScheduleExpiry ( iSelIdx );
             }
         }
     }
 }
 
-void CServerListManager::CentralServerUnregisterServer ( const CHostAddress& InetAddr )
+void CServerListManager::CentralServerUnregisterServer ( const CHostAddress& SourceAddr )
 {
     QMutexLocker locker ( &Mutex );
 
     if ( bIsCentralServer && bEnabled )
     {
-        const int iCurServerListSize = ServerList.size();
+        const CHostAddress InetAddr = GetRegistrationAddress ( SourceAddr );
 
         // Find the server to unregister in the list. The very first list entry
-        // must not be checked since this is per definition the central server
-        // (i.e., this server), also the predefined servers must not be checked.
-        for ( int iIdx = 1 + iNumPredefinedServers; iIdx < iCurServerListSize; iIdx++ )
+        // must not be removed since this is per definition the central server
+        // (i.e., this server), also the predefined servers must not be removed
+        // (the expiry wheel ignores the address of a removed entry).
+        const int iIdx = ServerListIdx.value ( GetAddressKey ( InetAddr ),
+                                               SERVLIST_INVALID_IDX );
+
+        if ( iIdx > iNumPredefinedServers )
         {
-            if ( ServerList[iIdx].HostAddr == InetAddr )
-            {
-                // remove this list entry
-                ServerList.removeAt ( iIdx );
-
-                // entry found, leave for-loop (it is important to exit the
-                // for loop since when we remove an item from the server list,
-                // "iCurServerListSize" is not correct anymore and we could get
-                // a segmentation fault)
-                break;
-            }
+            RemoveEntry ( iIdx );
         }
     }
 }
 
-void CServerListManager::CentralServerQueryServerList ( const CHostAddress& InetAddr )
+void CServerListManager::UpdateCache()
+{
+    // note that the mutex must be locked by the caller
+    if ( iCacheListVersion == iListVersion )
+    {
+        return;
+    }
+
+    const int iCurServerListSize = ServerList.Size();
+    const int iLegacyListSize    =
+        min ( iCurServerListSize, MAX_NUM_SERVERS_IN_LEGACY_SERVER_LIST );
+
+    // copy the list (the message preparation requires a vector of the base
+    // class)
+    CVector<CServerInfo> vecServerInfo ( iCurServerListSize );
+
+    for ( int iIdx = 0; iIdx < iCurServerListSize; iIdx++ )
+    {
+        vecServerInfo[iIdx] = ServerList[iIdx];
+    }
+
+    // prepare the fragments for the new clients
+    CProtocol::PrepareCLServerListFragmentMes ( iListVersion,
+                                                vecServerInfo,
+                                                vecvecbyCacheFragData,
+                                                veciCacheEntryFrag,
+                                                veciCacheEntryPos );
+
+    // prepare the single message for the old clients
+    vecServerInfo.resize ( iLegacyListSize );
+
+    CProtocol::PrepareCLServerListMes ( vecServerInfo,
+                                        vecbyCacheLegacyData,
+                                        veciCacheLegacyEntryPos );
+
+    // index of the entries by the IP address (except of the very first entry
+    // since this is this server (central server) per definition)
+    CacheEntriesByIpAddr.clear();
+
+    for ( int iIdx = 1; iIdx < iCurServerListSize; iIdx++ )
+    {
+        CacheEntriesByIpAddr.insert (
+            ServerList[iIdx].HostAddr.InetAddr.toIPv4Address(), iIdx );
+    }
+
+    iCacheListVersion = iListVersion;
+}
+
+CHostAddress CServerListManager::GetRegistrationAddress ( const CHostAddress& InetAddr )
+{
+    // a server registering from the loopback address runs on this host, it is
+    // listed with the address of this host (and its own port number) so that
+    // the clients can reach it (if the address of this host is unknown, the
+    // loopback address is kept)
+    if ( ( InetAddr.InetAddr == QHostAddress ( QHostAddress::LocalHost ) ) &&
+         !CentralServerPublicAddr.isNull() )
+    {
+        return CHostAddress ( CentralServerPublicAddr, InetAddr.iPort );
+    }
+
+    return InetAddr;
+}
+
+CHostAddress CServerListManager::GetLocalHostAddress ( const int iIdx )
+{
+    // the address of the client which is requesting the list is the same
+    // address as one server in the list -> in this case he has to connect to
+    // the local host address
+    // take the local port number instead of the received port number since
+    // some NAT (network address translation) might have changed the port,
+    // note that the predefined servers are treated differently, for these we
+    // assume that the received port number is the same as the actual port
+    // number
+    return CHostAddress ( QHostAddress ( QHostAddress::LocalHost ),
+                          ( iIdx > iNumPredefinedServers ) ?
+                          ServerList[iIdx].iLocalPortNumber :
+                          ServerList[iIdx].HostAddr.iPort );
+}
+
+void CServerListManager::CentralServerQueryServerList ( const CHostAddress& InetAddr,
+                                                        const bool          bFragmentsSupported )
 {
     QMutexLocker locker ( &Mutex );
 
     if ( bIsCentralServer && bEnabled )
     {
-        const int iCurServerListSize = ServerList.size();
+        // the prepared messages are only rebuilt if the server list has changed
+        UpdateCache();
+
+        // entries with the same IP address as the requesting client must be
+        // changed to the local host address for this client
+        const QList<int> veciSameAddrIdx =
+            CacheEntriesByIpAddr.values ( InetAddr.InetAddr.toIPv4Address() );
+
+        if ( bFragmentsSupported )
+        {
+            const int iNumFrags = vecvecbyCacheFragData.Size();
+
+            for ( int iFrag = 0; iFrag < iNumFrags; iFrag++ )
+            {
+                bool bPatched = false;
+
+                for ( int i = 0; i < veciSameAddrIdx.size(); i++ )
+                {
+                    const int iIdx = veciSameAddrIdx[i];
 
-        // allocate memory for the entire list
-        CVector<CServerInfo> vecServerInfo ( iCurServerListSize );
+                    if ( veciCacheEntryFrag[iIdx] == iFrag )
+                    {
+                        if ( !bPatched )
+                        {
+                            vecbyPatchedData.assign ( vecvecbyCacheFragData[iFrag].begin(),
+                                                      vecvecbyCacheFragData[iFrag].end() );
+                            bPatched = true;
+                        }
+
+                        CProtocol::PatchCLServerListEntryAddress ( vecbyPatchedData,
+                                                                   veciCacheEntryPos[iIdx],
+                                                                   GetLocalHostAddress ( iIdx ) );
+                    }
+                }
 
-        // copy the list (we have to copy it since the message requires
-        // a vector but the list is actually stored in a QList object and
-        // not in a vector object
-        for ( int iIdx = 0; iIdx < iCurServerListSize; iIdx++ )
+                pConnLessProtocol->CreatePreparedCLServerListFragmentMes ( InetAddr,
+                    bPatched ? vecbyPatchedData : vecvecbyCacheFragData[iFrag] );
+            }
+        }
+        else
         {
-            // copy list item
-            vecServerInfo[iIdx] = ServerList[iIdx];
+            // old clients only support a server list which is sent in one
+            // message, therefore the list is limited for these clients
+            bool bPatched = false;
 
-            if ( iIdx > 0 )
+            for ( int i = 0; i < veciSameAddrIdx.size(); i++ )
             {
-                // check if the address of the client which is requesting the
-                // list is the same address as one server in the list -> in this
-                // case he has to connect to the local host address
-                if ( vecServerInfo[iIdx].HostAddr.InetAddr == InetAddr.InetAddr )
+                const int iIdx = veciSameAddrIdx[i];
+
+                if ( iIdx < veciCacheLegacyEntryPos.Size() )
                 {
-                    vecServerInfo[iIdx].HostAddr.InetAddr =
-                        QHostAddress ( QHostAddress::LocalHost );
-
-                    // take the local port number instead of the received port
-                    // number since some NAT (network address translation) might
-                    // have changed the port, note that the predefined servers
-                    // are treated differently, for these we assume that the
-                    // received port number is the same as the actual port
-                    // number
-                    if ( iIdx > iNumPredefinedServers )
+                    if ( !bPatched )
                     {
-                        vecServerInfo[iIdx].HostAddr.iPort =
-                            ServerList[iIdx].iLocalPortNumber;
+                        vecbyPatchedData.assign ( vecbyCacheLegacyData.begin(),
+                                                  vecbyCacheLegacyData.end() );
+                        bPatched = true;
                     }
+
+                    CProtocol::PatchCLServerListEntryAddress ( vecbyPatchedData,
+                                                               veciCacheLegacyEntryPos[iIdx],
+                                                               GetLocalHostAddress ( iIdx ) );
                 }
-                else
+            }
+
+            pConnLessProtocol->CreatePreparedCLServerListMes ( InetAddr,
+                bPatched ? vecbyPatchedData : vecbyCacheLegacyData );
+        }
+
+        // the registered servers shall open their NAT for the client
+        QueueHolePunching ( InetAddr );
+    }
+}
+
+void CServerListManager::CentralServerUpdateServerLoad ( const CHostAddress& SourceAddr,
+                                                         const int           iNumClients,
+                                                         const int           iTickHeadroom,
+                                                         const QString&      strGroup )
+{
+    QMutexLocker locker ( &Mutex );
+
+    if ( bIsCentralServer && bEnabled )
+    {
+        const CHostAddress InetAddr = GetRegistrationAddress ( SourceAddr );
+
+        // only the load of registered servers is stored
+        const int iIdx = ServerListIdx.value ( GetAddressKey ( InetAddr ),
+                                               SERVLIST_INVALID_IDX );
+
+        if ( iIdx > iNumPredefinedServers )
+        {
+            ServerList[iIdx].strGroup          = strGroup;
+            ServerList[iIdx].iLoadNumClients   = iNumClients;
+            ServerList[iIdx].iLoadTickHeadroom = iTickHeadroom;
+            ServerList[iIdx].iLoadTimeMs       = QDateTime::currentMSecsSinceEpoch();
+        }
+    }
+}
+
+void CServerListManager::CentralServerQueryGroupServer ( const CHostAddress& InetAddr,
+                                                         const QString&      strGroup,
+                                                         const int           iNumClients )
+{
+    QMutexLocker locker ( &Mutex );
+
+    if ( bIsCentralServer && bEnabled && !strGroup.isEmpty() )
+    {
+        const qint64 iCurTimeMs = QDateTime::currentMSecsSinceEpoch();
+        int          iSelIdx    = SERVLIST_INVALID_IDX;
+        int          iSelLoad   = 0;
+
+        // search for the least loaded server of the group which can host the
+        // requested number of clients, the load of a server is the higher
+        // value of the used client slots and the used part of the timer tick
+        // (both in percent)
+        for ( int iIdx = 1 + iNumPredefinedServers; iIdx < ServerList.Size(); iIdx++ )
+        {
+            const CServerListEntry& Entry = ServerList[iIdx];
+
+            if ( Entry.bConfirmed &&
+                 ( Entry.strGroup == strGroup ) &&
+                 ( iCurTimeMs - Entry.iLoadTimeMs < SERVLIST_LOAD_MAX_AGE_MS ) &&
+                 ( Entry.iMaxNumClients - Entry.iLoadNumClients >= iNumClients ) &&
+                 ( Entry.iLoadTickHeadroom >= SERVLIST_GROUP_MIN_HEADROOM ) )
+            {
+                const int iCurLoad =
+                    max ( 100 * Entry.iLoadNumClients / max ( 1, Entry.iMaxNumClients ),
+                          100 - Entry.iLoadTickHeadroom );
+
+                if ( ( iSelIdx == SERVLIST_INVALID_IDX ) || ( iCurLoad < iSelLoad ) )
                 {
-                    // create "send empty message" for all registered servers
-                    // (except of the very first list entry since this is this
-                    // server (central server) per definition) and also it is
-                    // not required to send this message, if the server is on
-                    // the same computer
-                    pConnLessProtocol->CreateCLSendEmptyMesMes ( 
-                        vecServerInfo[iIdx].HostAddr,
-                        InetAddr );
+                    iSelIdx  = iIdx;
+                    iSelLoad = iCurLoad;
                 }
             }
         }
 
-        // send the server list to the client
-        pConnLessProtocol->CreateCLServerListMes ( InetAddr, vecServerInfo );
+        if ( iSelIdx == SERVLIST_INVALID_IDX )
+        {
+            // no server of the group is available
+            pConnLessProtocol->CreateCLGroupServerMes ( InetAddr, CHostAddress() );
+            return;
+        }
+
+        // the clients are counted on the selected server until the next load
+        // report so that a number of requests in a short time are distributed
+        // over the servers of the group
+        ServerList[iSelIdx].iLoadNumClients += iNumClients;
+
+        if ( ServerList[iSelIdx].HostAddr.InetAddr == InetAddr.InetAddr )
+        {
+            // the client has the same IP address as the server
+            pConnLessProtocol->CreateCLGroupServerMes ( InetAddr,
+                                                        GetLocalHostAddress ( iSelIdx ) );
+        }
+        else
+        {
+            pConnLessProtocol->CreateCLGroupServerMes ( InetAddr,
+                                                        ServerList[iSelIdx].HostAddr );
+
+            // the selected server shall open its NAT for the client
+            pConnLessProtocol->CreateCLSendEmptyMesMes ( ServerList[iSelIdx].HostAddr,
+                                                         InetAddr );
+        }
+    }
+}
+
+void CServerListManager::QueueHolePunching ( const CHostAddress& InetAddr )
+{
+    // note that the mutex must be locked by the caller
+    const qint64  iCurTimeMs = QDateTime::currentMSecsSinceEpoch();
+    const quint64 iKey       = GetAddressKey ( InetAddr );
+
+    // the client repeats the request if the list was not received, in this
+    // case the hole punching was already done for this client
+    QHash<quint64, qint64>::const_iterator it = HolePunchLastTimeMs.constFind ( iKey );
+
+    if ( ( it != HolePunchLastTimeMs.constEnd() ) &&
+         ( iCurTimeMs - it.value() < SERVLIST_HOLE_PUNCH_DEDUP_MS ) )
+    {
+        return;
+    }
+
+    // limit the memory of the history (it is cleaned up by the poll timer)
+    if ( HolePunchLastTimeMs.size() >= SERVLIST_HOLE_PUNCH_MAX_RECENT )
+    {
+        HolePunchLastTimeMs.clear();
+    }
+
+    HolePunchLastTimeMs.insert ( iKey, iCurTimeMs );
+
+    // if too many clients are waiting, the client has to request the list
+    // again later
+    if ( HolePunchQueue.size() < SERVLIST_HOLE_PUNCH_MAX_QUEUE )
+    {
+        // take the addresses of all registered servers (except of the very
+        // first list entry since this is this server (central server) per
+        // definition), the list is only created again if it has changed
+        if ( iHolePunchListVersion != iListVersion )
+        {
+            vecHolePunchServerAddr.clear();
+
+            for ( int iIdx = 1; iIdx < ServerList.Size(); iIdx++ )
+            {
+                vecHolePunchServerAddr.append ( ServerList[iIdx].HostAddr );
+            }
+
+            iHolePunchListVersion = iListVersion;
+        }
+
+        HolePunchQueue.append ( CHolePunchJob ( InetAddr, vecHolePunchServerAddr ) );
+
+        if ( !TimerHolePunch.isActive() )
+        {
+            TimerHolePunch.start ( SERVLIST_HOLE_PUNCH_TIMER_MS );
+        }
     }
 }
 
+void CServerListManager::OnTimerHolePunch()
+{
+    QMutexLocker locker ( &Mutex );
+
+    int iNumSent = 0;
+
+    while ( !HolePunchQueue.isEmpty() &&
+            ( iNumSent < SERVLIST_HOLE_PUNCH_BATCH_SIZE ) )
+    {
+        CHolePunchJob& CurJob = HolePunchQueue.first();
+
+        // create "send empty message" for all servers of the job, it is not
+        // required to send this message, if the server is on the same
+        // computer
+        while ( ( CurJob.iNextServerIdx < CurJob.vecServerAddr.size() ) &&
+                ( iNumSent < SERVLIST_HOLE_PUNCH_BATCH_SIZE ) )
+        {
+            const CHostAddress& ServerAddr =
+                CurJob.vecServerAddr.at ( CurJob.iNextServerIdx );
+
+            if ( !( ServerAddr.InetAddr == CurJob.ClientAddr.InetAddr ) )
+            {
+                pConnLessProtocol->CreateCLSendEmptyMesMes ( ServerAddr,
+                                                             CurJob.ClientAddr );
+
+                iNumSent++;
+            }
+
+            CurJob.iNextServerIdx++;
+        }
+
+        // continue with the next client if all servers are done
+        if ( CurJob.iNextServerIdx >= CurJob.vecServerAddr.size() )
+        {
+            HolePunchQueue.removeFirst();
+        }
+    }
+
+    if ( HolePunchQueue.isEmpty() )
+    {
+        TimerHolePunch.stop();
+    }
+}
+
+
+QByteArray CServerListManager::CreateSnapshot()
+{
+    // note that the mutex must be locked by the caller
+    QByteArray  vecbySnapshot;
+    QDataStream Stream ( &vecbySnapshot, QIODevice::WriteOnly );
+
+    Stream.setVersion ( QDataStream::Qt_4_6 );
+
+    // only the registered servers are stored (the very first entry and the
+    // predefined servers are given by the command line arguments)
+    const int iFirstIdx   = 1 + iNumPredefinedServers;
+    const int iNumEntries = max ( 0, ServerList.Size() - iFirstIdx );
+
+    Stream << static_cast<quint32> ( SERVLIST_SNAPSHOT_MAGIC )
+           << static_cast<quint16> ( SERVLIST_SNAPSHOT_VERSION )
+           << static_cast<quint32> ( iNumEntries );
+
+    for ( int iIdx = iFirstIdx; iIdx < ServerList.Size(); iIdx++ )
+    {
+        const CServerListEntry& Entry = ServerList[iIdx];
+
+        Stream << static_cast<quint32> ( Entry.HostAddr.InetAddr.toIPv4Address() )
+               << static_cast<quint16> ( Entry.HostAddr.iPort )
+               << static_cast<quint16> ( Entry.iLocalPortNumber )
+               << static_cast<quint16> ( Entry.eCountry )
+               << static_cast<quint8>  ( Entry.iMaxNumClients )
+               << static_cast<quint8>  ( Entry.bPermanentOnline )
+               << static_cast<qint64>  ( Entry.iRegisterTimeMs )
+               << Entry.strName.toUtf8()
+               << Entry.strTopic.toUtf8()
+               << Entry.strCity.toUtf8();
+    }
+
+    return vecbySnapshot;
+}
+
+bool CServerListManager::LoadSnapshot ( const QString& strFileName )
+{
+    QFile SnapshotFile ( strFileName );
+
+    if ( !SnapshotFile.open ( QIODevice::ReadOnly ) )
+    {
+        return false;
+    }
+
+    QDataStream Stream ( &SnapshotFile );
+    Stream.setVersion ( QDataStream::Qt_4_6 );
+
+    quint32 iMagic;
+    quint16 iVersion;
+    quint32 iNumEntries;
+
+    Stream >> iMagic >> iVersion >> iNumEntries;
+
+    if ( ( Stream.status() != QDataStream::Ok ) ||
+         ( iMagic != SERVLIST_SNAPSHOT_MAGIC ) ||
+         ( iVersion != SERVLIST_SNAPSHOT_VERSION ) )
+    {
+        return false;
+    }
+
+    QMutexLocker locker ( &Mutex );
+
+    const qint64 iCurTimeMs = QDateTime::currentMSecsSinceEpoch();
+
+    for ( quint32 i = 0; i < iNumEntries; i++ )
+    {
+        quint32    iIpAddr;
+        quint16    iPort;
+        quint16    iLocalPort;
+        quint16    iCountry;
+        quint8     iMaxNumClients;
+        quint8     iPermanentOnline;
+        qint64     iRegisterTimeMs;
+        QByteArray strUTF8Name;
+        QByteArray strUTF8Topic;
+        QByteArray strUTF8City;
+
+        Stream >> iIpAddr >> iPort >> iLocalPort >> iCountry >> iMaxNumClients
+               >> iPermanentOnline >> iRegisterTimeMs
+               >> strUTF8Name >> strUTF8Topic >> strUTF8City;
+
+        if ( Stream.status() != QDataStream::Ok )
+        {
+            // the file is corrupt, the entries which were read so far are kept
+            break;
+        }
+
+        // the entry keeps its original registration time, i.e., entries
+        // which are already too old are not loaded
+        const qint64 iAgeTicks = ( iCurTimeMs - iRegisterTimeMs ) /
+            ( SERVLIST_POLL_TIME_MINUTES * 60000 );
+
+        const CHostAddress InetAddr ( QHostAddress ( iIpAddr ), iPort );
+
+        if ( ( iAgeTicks < 0 ) ||
+             ( iAgeTicks >= SERVLIST_EXPIRY_NUM_TICKS ) ||
+             ( ServerList.Size() >= MAX_NUM_SERVERS_IN_SERVER_LIST ) ||
+             ServerListIdx.contains ( GetAddressKey ( InetAddr ) ) )
+        {
+            continue;
+        }
+
+        CServerListEntry NewEntry (
+            InetAddr,
+            iLocalPort,
+            QString::fromUtf8 ( strUTF8Name ).left ( MAX_LEN_SERVER_NAME ),
+            QString::fromUtf8 ( strUTF8Topic ).left ( MAX_LEN_SERVER_TOPIC ),
+            static_cast<QLocale::Country> ( iCountry ),
+            QString::fromUtf8 ( strUTF8City ).left ( MAX_LEN_SERVER_CITY ),
+            iMaxNumClients,
+            iPermanentOnline != 0 );
+
+        NewEntry.iRegisterTimeMs = iRegisterTimeMs;
+        NewEntry.bConfirmed      = false;
+
+        ServerListIdx.insert ( GetAddressKey ( InetAddr ), ServerList.Size() );
+        ServerList.Add ( NewEntry );
+
+        // an unconfirmed entry is removed early if the server does not
+        // register again
+        ScheduleExpiry ( ServerList.Size() - 1,
+                         min ( SERVLIST_EXPIRY_NUM_TICKS - static_cast<int> ( iAgeTicks ),
+                               SERVLIST_UNCONFIRMED_NUM_TICKS ) );
+    }
+
+    iListVersion++;
+
+    return true;
+}
+
 
 /* Slave server functionality *************************************************/
+void CServerListManager::SetServerLoad ( const int iNumClients,
+                                         const int iTickHeadroom )
+{
+    QMutexLocker locker ( &Mutex );
+
+    iSlaveLoadNumClients   = iNumClients;
+    iSlaveLoadTickHeadroom = iTickHeadroom;
+}
+
+CHostAddress CServerListManager::GetCentralServerHostAddress()
+{
+    QMutexLocker locker ( &Mutex );
+
+    return SlaveCurCentServerHostAddress;
+}
+
+int CServerListManager::GetNumServerListFragments()
+{
+    QMutexLocker locker ( &Mutex );
+
+    if ( bIsCentralServer && bEnabled )
+    {
+        // the prepared messages are only rebuilt if the server list has changed
+        UpdateCache();
+
+        return vecvecbyCacheFragData.Size();
+    }
+
+    return 0;
+}
+
 void CServerListManager::OnTimerPingCentralServer()
 {
     QMutexLocker locker ( &Mutex );
@@ -449,9 +1156,13 @@ void CServerListManager::OnTimerPingCentralServer()
     // first check if central server address is valid
     if ( !( SlaveCurCentServerHostAddress == CHostAddress() ) )
     {
-        // send empty message to central server to keep NAT port open -> we do
-        // not require any answer from the central server
-        pConnLessProtocol->CreateCLEmptyMes ( SlaveCurCentServerHostAddress );
+        // send the current load to the central server, this message also
+        // keeps the NAT port open -> we do not require any answer from the
+        // central server (old central servers just ignore the message)
+        pConnLessProtocol->CreateCLServerLoadMes ( SlaveCurCentServerHostAddress,
+                                                   iSlaveLoadNumClients,
+                                                   iSlaveLoadTickHeadroom,
+                                                   strServerGroup );
     }
 }
 
@@ -480,6 +1191,12 @@ void CServerListManager::SlaveServerRegisterServer ( const bool bIsRegister )
             // register server
             pConnLessProtocol->CreateCLRegisterServerMes ( SlaveCurCentServerHostAddress,
                                                            ServerList[0] );
+
+            // the load is reported together with the registration
+            pConnLessProtocol->CreateCLServerLoadMes ( SlaveCurCentServerHostAddress,
+                                                       iSlaveLoadNumClients,
+                                                       iSlaveLoadTickHeadroom,
+                                                       strServerGroup );
         }
         else
         {
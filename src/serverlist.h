@@ -63,13 +63,62 @@ private network.
 #include <QObject>
 #include <QLocale>
 #include <QList>
+#include <QVector>
+#include <QHash>
 #include <QTimer>
 #include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+#include <QFile>
+#include <QDataStream>
 #include "global.h"
 #include "util.h"
 #include "protocol.h"
 
 
+/* Definitions ****************************************************************/
+// number of ticks of the poll timer after which a registered server expires
+// (one additional tick since the registration may happen right before the
+// next tick), the expiry wheel has one slot more than this number of ticks
+#define SERVLIST_EXPIRY_NUM_TICKS       ( SERVLIST_TIME_OUT_MINUTES / SERVLIST_POLL_TIME_MINUTES + 1 )
+#define SERVLIST_EXPIRY_WHEEL_SIZE      ( SERVLIST_EXPIRY_NUM_TICKS + 1 )
+
+// invalid index in the server list used as a flag
+#define SERVLIST_INVALID_IDX            ( -1 )
+
+// the "send empty message" messages for the NAT hole punching are sent by a
+// timer in batches, a client which requests the server list again within the
+// given time does not trigger the messages again
+#define SERVLIST_HOLE_PUNCH_TIMER_MS    10 // ms
+#define SERVLIST_HOLE_PUNCH_BATCH_SIZE  100
+#define SERVLIST_HOLE_PUNCH_DEDUP_MS    30000 // ms
+#define SERVLIST_HOLE_PUNCH_MAX_QUEUE   1000
+#define SERVLIST_HOLE_PUNCH_MAX_RECENT  10000
+
+// an entry which was loaded from the snapshot file expires if the server does
+// not register again within the registration interval (plus one tick)
+#define SERVLIST_UNCONFIRMED_NUM_TICKS  ( SERVLIST_REGIST_INTERV_MINUTES / SERVLIST_POLL_TIME_MINUTES + 2 )
+
+// the snapshot of the server list is written on every change of the list
+// (checked on each tick) and at least after the given number of ticks so that
+// the registration times are kept up to date
+#define SERVLIST_SNAPSHOT_NUM_TICKS     5
+
+// snapshot file format identification
+#define SERVLIST_SNAPSHOT_MAGIC         0x4A534C53 // "JSLS"
+#define SERVLIST_SNAPSHOT_VERSION       1
+
+// the snapshot is written to a temporary file which then replaces the old
+// snapshot file
+#define SERVLIST_SNAPSHOT_TMP_SUFFIX    ".tmp"
+
+// a reported server load is valid for some ping intervals of the slave server
+#define SERVLIST_LOAD_MAX_AGE_MS        ( 3 * SERVLIST_UPDATE_PING_SERVERS_MS )
+
+// minimum tick headroom in percent of a server which is selected for a group
+#define SERVLIST_GROUP_MIN_HEADROOM     20 // %
+
+
 /* Classes ********************************************************************/
 class CServerListEntry : public CServerInfo
 {
@@ -82,7 +131,9 @@ public:
                       QLocale::AnyCountry,
                       "",
                       0,
-                      false ) { UpdateRegistration(); }
+                      false ), iExpireTick ( 0 ), bConfirmed ( true ),
+                      iLoadNumClients ( 0 ), iLoadTickHeadroom ( 0 ),
+                      iLoadTimeMs ( 0 ) { UpdateRegistration(); }
 
     CServerListEntry ( const CHostAddress&     NHAddr,
                        const quint16           NLocPort,
@@ -99,7 +150,9 @@ public:
                         NeCountry,
                         NsCity,
                         NiMaxNumClients,
-                        NbPermOnline ) { UpdateRegistration(); }
+                        NbPermOnline ), iExpireTick ( 0 ), bConfirmed ( true ),
+                        iLoadNumClients ( 0 ), iLoadTickHeadroom ( 0 ),
+                        iLoadTimeMs ( 0 ) { UpdateRegistration(); }
 
     CServerListEntry ( const CHostAddress&    NHAddr,
                        const CServerCoreInfo& NewCoreServerInfo )
@@ -110,14 +163,79 @@ public:
                         NewCoreServerInfo.eCountry,
                         NewCoreServerInfo.strCity,
                         NewCoreServerInfo.iMaxNumClients,
-                        NewCoreServerInfo.bPermanentOnline )
-        { UpdateRegistration(); }
+                        NewCoreServerInfo.bPermanentOnline ),
+          iExpireTick ( 0 ), bConfirmed ( true ), iLoadNumClients ( 0 ),
+          iLoadTickHeadroom ( 0 ), iLoadTimeMs ( 0 ) { UpdateRegistration(); }
+
+    void UpdateRegistration()
+        { iRegisterTimeMs = QDateTime::currentMSecsSinceEpoch(); }
+
+public:
+    // time on which the entry was registered (ms since epoch)
+    qint64 iRegisterTimeMs;
+
+    // tick of the expiry wheel on which the entry expires if it is not
+    // registered again before
+    int    iExpireTick;
+
+    // an entry which was loaded from the snapshot file is not confirmed until
+    // the server registers again
+    bool   bConfirmed;
+
+    // load which was reported by the server, the load is only valid if it was
+    // reported recently (time in ms since epoch, zero if no report exists)
+    QString strGroup;
+    int     iLoadNumClients;
+    int     iLoadTickHeadroom;
+    qint64  iLoadTimeMs;
+};
+
+
+// Hole punching job ------------------------------------------------------------
+// The addresses of the servers are taken when the job of a client is queued
+// so that changes of the server list do not cause skipped or repeated servers
+// (the address list is implicitly shared by all jobs of the same list version).
+class CHolePunchJob
+{
+public:
+    CHolePunchJob() : iNextServerIdx ( 0 ) {}
 
-    void UpdateRegistration() { RegisterTime.start(); }
+    CHolePunchJob ( const CHostAddress&          NClientAddr,
+                    const QVector<CHostAddress>& vecNServerAddr ) :
+        ClientAddr     ( NClientAddr ),
+        vecServerAddr  ( vecNServerAddr ),
+        iNextServerIdx ( 0 ) {}
 
+    CHostAddress          ClientAddr;
+    QVector<CHostAddress> vecServerAddr;
+    int                   iNextServerIdx;
+};
+
+
+// Server list snapshot writer -------------------------------------------------
+// Writes the snapshots of the server list in a low priority thread so that
+// the file access does not block the main thread. Only the latest snapshot is
+// written, a snapshot which was not yet written is replaced by a new one.
+class CServerListSnapshotWriter : public QThread
+{
 public:
-    // time on which the entry was registered
-    QTime RegisterTime;
+    CServerListSnapshotWriter() : bRun ( false ), bPending ( false ) {}
+
+    void Start ( const QString& strNewFileName );
+    void Stop();
+    void Put ( const QByteArray& vecbyNewSnapshot );
+
+protected:
+    virtual void run();
+
+    bool WriteFile ( const QByteArray& vecbyCurSnapshot );
+
+    QString        strFileName;
+    QByteArray     vecbySnapshot;
+    bool           bRun;
+    bool           bPending;
+    QMutex         Mutex;
+    QWaitCondition WaitCondition;
 };
 
 class CServerListManager : public QObject
@@ -128,10 +246,14 @@ public:
     CServerListManager ( const quint16  iNPortNum,
                          const QString& sNCentServAddr,
                          const QString& strServerInfo,
+                         const QString& strNSnapshotFileName,
+                         const QString& strNServerGroup,
                          const int      iNumChannels,
                          const bool     bNCentServPingServerInList,
                          CProtocol*     pNConLProt );
 
+    virtual ~CServerListManager();
+
     // the update has to be called if any change to the server list
     // properties was done
     void Update();
@@ -150,12 +272,34 @@ public:
 
     bool GetIsCentralServer() const { return bIsCentralServer; }
 
+    // address of the central server this server is registered at (invalid
+    // if not registered)
+    CHostAddress GetCentralServerHostAddress();
+
+    // number of datagrams of the server list reply (zero if this server does
+    // not provide a server list)
+    int GetNumServerListFragments();
+
     void CentralServerRegisterServer ( const CHostAddress&    InetAddr,
                                        const CServerCoreInfo& ServerInfo );
 
     void CentralServerUnregisterServer ( const CHostAddress& InetAddr );
 
-    void CentralServerQueryServerList ( const CHostAddress& InetAddr );
+    void CentralServerQueryServerList ( const CHostAddress& InetAddr,
+                                        const bool          bFragmentsSupported );
+
+    void CentralServerUpdateServerLoad ( const CHostAddress& InetAddr,
+                                         const int           iNumClients,
+                                         const int           iTickHeadroom,
+                                         const QString&      strGroup );
+
+    void CentralServerQueryGroupServer ( const CHostAddress& InetAddr,
+                                         const QString&      strGroup,
+                                         const int           iNumClients );
+
+    // the load of this server is reported to the central server
+    void SetServerLoad ( const int iNumClients,
+                         const int iTickHeadroom );
 
     void SlaveServerUnregister() { SlaveServerRegisterServer ( false ); }
 
@@ -163,23 +307,42 @@ public:
     // stored in the first entry of the list, we assume here that the first
     // entry is correctly created in the constructor of the class
     void SetServerName ( const QString& strNewName )
-        { ServerList[0].strName = strNewName; }
+        { ServerList[0].strName = strNewName; iListVersion++; }
 
     QString GetServerName() { return ServerList[0].strName; }
 
     void SetServerCity ( const QString& strNewCity )
-        { ServerList[0].strCity = strNewCity; }
+        { ServerList[0].strCity = strNewCity; iListVersion++; }
 
     QString GetServerCity() { return ServerList[0].strCity; }
 
     void SetServerCountry ( const QLocale::Country eNewCountry )
-        { ServerList[0].eCountry = eNewCountry; }
+        { ServerList[0].eCountry = eNewCountry; iListVersion++; }
 
     QLocale::Country GetServerCountry() { return ServerList[0].eCountry; }
 
 protected:
     void SlaveServerRegisterServer ( const bool bIsRegister );
 
+    static quint64 GetAddressKey ( const CHostAddress& HostAddr )
+    {
+        return ( static_cast<quint64> ( HostAddr.InetAddr.toIPv4Address() ) << 16 ) |
+               HostAddr.iPort;
+    }
+
+    static bool IsSameServerInfo ( const CServerCoreInfo& ServerInfo1,
+                                   const CServerCoreInfo& ServerInfo2 );
+
+    void ScheduleExpiry ( const int iIdx,
+                          const int iNumTicks = SERVLIST_EXPIRY_NUM_TICKS );
+    void RemoveEntry ( const int iIdx );
+    void UpdateCache();
+    CHostAddress GetLocalHostAddress ( const int iIdx );
+    CHostAddress GetRegistrationAddress ( const CHostAddress& InetAddr );
+    void QueueHolePunching ( const CHostAddress& InetAddr );
+    QByteArray CreateSnapshot();
+    bool LoadSnapshot ( const QString& strFileName );
+
     QTimer                  TimerPollList;
     QTimer                  TimerRegistering;
     QTimer                  TimerPingServerInList;
@@ -187,7 +350,44 @@ protected:
 
     QMutex                  Mutex;
 
-    QList<CServerListEntry> ServerList;
+    // the registered servers are stored in a vector with an index which maps
+    // the server address to the position in the vector, a server which is
+    // removed is replaced by the last entry of the vector
+    CVector<CServerListEntry>  ServerList;
+    QHash<quint64, int>        ServerListIdx;
+
+    // the expiry wheel has one slot per poll timer tick, each slot holds the
+    // addresses of the entries which expire on this tick (an entry which was
+    // registered again in the meantime is ignored on the old tick)
+    CVector<CVector<quint64> > vecvecExpiryWheel;
+    int                        iExpiryTick;
+
+    // the version is changed on every change of the server list
+    int                        iListVersion;
+
+    // cache of the prepared server list messages which is rebuilt if the list
+    // version has changed, for each IP address the entries are stored which
+    // must be changed for a client with the same IP address
+    int                        iCacheListVersion;
+    CVector<uint8_t>           vecbyCacheLegacyData;
+    CVector<int>               veciCacheLegacyEntryPos;
+    CVector<CVector<uint8_t> > vecvecbyCacheFragData;
+    CVector<int>               veciCacheEntryFrag;
+    CVector<int>               veciCacheEntryPos;
+    QMultiHash<quint32, int>   CacheEntriesByIpAddr;
+    CVector<uint8_t>           vecbyPatchedData;
+
+    // NAT hole punching for the clients which requested the server list
+    QList<CHolePunchJob>       HolePunchQueue;
+    QVector<CHostAddress>      vecHolePunchServerAddr;
+    int                        iHolePunchListVersion;
+    QHash<quint64, qint64>     HolePunchLastTimeMs;
+    QTimer                     TimerHolePunch;
+
+    // persistent snapshots of the server list
+    QString                    strSnapshotFileName;
+    int                        iSnapshotListVersion;
+    CServerListSnapshotWriter  SnapshotWriter;
 
     quint16                 iPortNumber;
     QString                 strCentralServerAddress;
@@ -199,12 +399,22 @@ protected:
 
     CHostAddress            SlaveCurCentServerHostAddress;
 
+    // address of the central server as seen from the network, servers which
+    // register from the loopback address are listed with this address
+    QHostAddress            CentralServerPublicAddr;
+
+    // load of this server which is reported to the central server
+    QString                 strServerGroup;
+    int                     iSlaveLoadNumClients;
+    int                     iSlaveLoadTickHeadroom;
+
     CProtocol*              pConnLessProtocol;
 
 public slots:
     void OnTimerPollList();
     void OnTimerPingServerInList();
     void OnTimerPingCentralServer();
+    void OnTimerHolePunch();
     void OnTimerRegistering() { SlaveServerRegisterServer ( true ); }
 };
 
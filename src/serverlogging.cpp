@@ -366,6 +366,39 @@ void CServerLogging::AddServerStopped()
     HistoryGraph.Update();
 }
 
+void CServerLogging::AddCLMessagesDropped ( const int iNumDroppedSource,
+                                            const int iNumDroppedGlobal )
+{
+    // the counters of the rate limiter since the server start (note that
+    // this line has more fields than the other lines and is therefore ignored
+    // when the log file is parsed)
+    const QString strLogStr = CurTimeDatetoLogString() +
+        ",, connection less messages dropped, source limit: " +
+        QString::number ( iNumDroppedSource ) + ", server limit: " +
+        QString::number ( iNumDroppedGlobal );
+
+#ifndef _WIN32
+    QTextStream tsConsoleStream ( stdout );
+    tsConsoleStream << strLogStr << endl; // on console
+#endif
+    *this << strLogStr; // in log file
+}
+
+void CServerLogging::AddRecordingStopped ( const int iNumDroppedSamples )
+{
+    // the audio which the disk writer could not take during the session
+    // (this line is ignored when the log file is parsed, too)
+    const QString strLogStr = CurTimeDatetoLogString() +
+        ",, recording stopped, dropped samples: " +
+        QString::number ( iNumDroppedSamples );
+
+#ifndef _WIN32
+    QTextStream tsConsoleStream ( stdout );
+    tsConsoleStream << strLogStr << endl; // on console
+#endif
+    *this << strLogStr; // in log file
+}
+
 void CServerLogging::operator<< ( const QString& sNewStr )
 {
     if ( bDoLogging )
@@ -124,6 +124,9 @@ public:
     void EnableHistory ( const QString& strHistoryFileName );
     void AddNewConnection ( const QHostAddress& ClientInetAddr );
     void AddServerStopped();
+    void AddCLMessagesDropped ( const int iNumDroppedSource,
+                                const int iNumDroppedGlobal );
+    void AddRecordingStopped ( const int iNumDroppedSamples );
     void ParseLogFile ( const QString& strFileName );
 
 protected:
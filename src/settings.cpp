@@ -231,6 +231,31 @@ void CSettings::Load()
             pClient->SetAudioQuality ( static_cast<EAudioQuality> ( iValue ) );
         }
 
+        // audio redundancy
+        if ( GetNumericIniSet ( IniXMLDocument, "client", "audioredundancy",
+             0, MAX_NUM_REDUNDANT_PACKETS, iValue ) )
+        {
+            pClient->SetAudioRedundancy ( iValue );
+        }
+
+        // uncompressed audio flag
+        if ( GetFlagIniSet ( IniXMLDocument, "client", "audiouncompressed", bValue ) )
+        {
+            pClient->SetAudioUncompressed ( bValue );
+        }
+
+        // bit rate adaptation flag
+        if ( GetFlagIniSet ( IniXMLDocument, "client", "bitrateadapt", bValue ) )
+        {
+            pClient->SetBitrateAdaptation ( bValue );
+        }
+
+        // small frame size flag
+        if ( GetFlagIniSet ( IniXMLDocument, "client", "smallframesize", bValue ) )
+        {
+            pClient->SetSmallFrameSize ( bValue );
+        }
+
         // central server address
         pClient->SetServerListCentralServerAddress (
             GetIniSetting ( IniXMLDocument, "client", "centralservaddr" ) );
@@ -431,6 +456,22 @@ void CSettings::Save()
         SetNumericIniSet ( IniXMLDocument, "client", "audioquality",
             static_cast<int> ( pClient->GetAudioQuality() ) );
 
+        // audio redundancy
+        SetNumericIniSet ( IniXMLDocument, "client", "audioredundancy",
+            pClient->GetAudioRedundancy() );
+
+        // uncompressed audio flag
+        SetFlagIniSet ( IniXMLDocument, "client", "audiouncompressed",
+            pClient->GetAudioUncompressed() );
+
+        // bit rate adaptation flag
+        SetFlagIniSet ( IniXMLDocument, "client", "bitrateadapt",
+            pClient->GetBitrateAdaptation() );
+
+        // small frame size flag
+        SetFlagIniSet ( IniXMLDocument, "client", "smallframesize",
+            pClient->GetSmallFrameSize() );
+
         // central server address
         PutIniSetting ( IniXMLDocument, "client", "centralservaddr",
             pClient->GetServerListCentralServerAddress() );
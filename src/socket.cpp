@@ -27,6 +27,69 @@
 
 
 /* Implementation *************************************************************/
+// Received protocol messages queue --------------------------------------------
+void CProtocolMessageQueue::Init ( const int iNewNumSlots,
+                                   const int iNewSlotSizeBytes )
+{
+    // allocate memory for all slots
+    vecSlots.Init ( iNewNumSlots );
+
+    for ( int i = 0; i < iNewNumSlots; i++ )
+    {
+        vecSlots[i].vecbyData.Init ( iNewSlotSizeBytes );
+    }
+
+    iPutPos = 0;
+    iGetPos = 0;
+    iNumUsedSlots.fetchAndStoreOrdered ( 0 );
+}
+
+bool CProtocolMessageQueue::Put ( const CVector<uint8_t>& vecbyData,
+                                  const int               iNumBytes,
+                                  const quint32           iInetAddr,
+                                  const quint16           iPort )
+{
+    const int iNumSlots = vecSlots.Size();
+
+    // check if a free slot is available and the data fits in the slot
+    if ( ( iNumUsedSlots.fetchAndAddOrdered ( 0 ) >= iNumSlots ) ||
+         ( iNumBytes > vecSlots[iPutPos].vecbyData.Size() ) )
+    {
+        return true; // return error code
+    }
+
+    CSlot& CurSlot = vecSlots[iPutPos];
+
+    memcpy ( &CurSlot.vecbyData[0], &vecbyData.front(), iNumBytes );
+    CurSlot.iNumBytes = iNumBytes;
+    CurSlot.iInetAddr = iInetAddr;
+    CurSlot.iPort     = iPort;
+
+    iPutPos = ( iPutPos + 1 ) % iNumSlots;
+
+    // the slot must be completely written before it is made visible to the
+    // consumer (the ordered atomic operation acts as a memory barrier)
+    iNumUsedSlots.fetchAndAddOrdered ( 1 );
+
+    return false; // no error
+}
+
+CHostAddress CProtocolMessageQueue::GetHostAddress() const
+{
+    return CHostAddress ( QHostAddress ( vecSlots[iGetPos].iInetAddr ),
+                          vecSlots[iGetPos].iPort );
+}
+
+void CProtocolMessageQueue::Remove()
+{
+    iGetPos = ( iGetPos + 1 ) % vecSlots.Size();
+
+    // free the slot for the producer
+    iNumUsedSlots.fetchAndAddOrdered ( -1 );
+}
+
+
+// Socket ----------------------------------------------------------------------
 void CSocket::Init ( const quint16 iPortNumber )
 {
 #ifdef _WIN32
@@ -44,6 +107,10 @@ void CSocket::Init ( const quint16 iPortNumber )
     // allocate memory for network receive and send buffer in samples
     vecbyRecBuf.Init ( MAX_SIZE_BYTES_NETW_BUF );
 
+    // preallocate the received protocol messages queue so that no memory
+    // allocation is required in the real-time receive thread
+    ProtMessQueue.Init ( NUM_PROT_MESS_QUEUE_SLOTS, MAX_SIZE_BYTES_NETW_BUF );
+
     // preinitialize socket in address (only the port number is missing)
     sockaddr_in UdpSocketInAddr;
     UdpSocketInAddr.sin_family      = AF_INET;
@@ -52,7 +119,18 @@ void CSocket::Init ( const quint16 iPortNumber )
     // initialize the listening socket
     bool bSuccess;
 
-    if ( bIsClient )
+    if ( bIsClient && ( iPortNumber == 0 ) )
+    {
+        // a port which is chosen by the operating system (used by the uplink
+        // of a server which must not take one of the ports of the server or
+        // of the other rooms of the server)
+        UdpSocketInAddr.sin_port = htons ( 0 );
+
+        bSuccess = ( bind ( UdpSocket ,
+                            (sockaddr*) &UdpSocketInAddr,
+                            sizeof ( sockaddr_in ) ) == 0 );
+    }
+    else if ( bIsClient )
     {
         // Per definition use the port number plus ten for the client to make
         // it possible to run server and client on the same computer. If the
@@ -133,6 +211,10 @@ void CSocket::Init ( const quint16 iPortNumber )
         QObject::connect ( this,
             SIGNAL ( ServerFull ( CHostAddress ) ),
             pServer, SLOT ( OnServerFull ( CHostAddress ) ) );
+
+        QObject::connect ( this,
+            SIGNAL ( ConnChallengeRequired ( CHostAddress ) ),
+            pServer, SLOT ( OnConnChallengeRequired ( CHostAddress ) ) );
     }
 }
 
@@ -211,8 +293,9 @@ void CSocket::OnDataReceived()
     The strategy of this function is that only the "put audio" function is
     called directly (i.e. the high thread priority is used) and all other less
     important things like protocol parsing and acting on protocol messages is
-    done in the low priority thread. To get a thread transition, we have to
-    use the signal/slot mechanism (i.e. we use messages for that).
+    done in the protocol worker thread. To avoid any memory allocation in this
+    real-time thread, protocol messages are only classified here and the raw
+    datagram is copied in a preallocated slot of the protocol messages queue.
 */
 
     // read block from network interface and query address of sender
@@ -236,40 +319,26 @@ void CSocket::OnDataReceived()
         return;
     }
 
-    // convert address of client
-    RecHostAddr.InetAddr.setAddress ( ntohl ( SenderAddr.sin_addr.s_addr ) );
-    RecHostAddr.iPort = ntohs ( SenderAddr.sin_port );
-
-
     // check if this is a protocol message
-    int              iRecCounter;
-    int              iRecID;
-    CVector<uint8_t> vecbyMesBodyData;
-
-    if ( !CProtocol::ParseMessageFrame ( vecbyRecBuf,
-                                         iNumBytesRead,
-                                         vecbyMesBodyData,
-                                         iRecCounter,
-                                         iRecID ) )
+    if ( CProtocol::IsProtocolMessage ( vecbyRecBuf, iNumBytesRead ) )
     {
-        // this is a protocol message, check the type of the message
-        if ( CProtocol::IsConnectionLessMessageID ( iRecID ) )
+        // put the datagram in the queue and wake up the protocol worker thread
+        // (if the queue is full, the message is dropped which is handled by
+        // the retransmission mechanism of the protocol)
+        if ( !ProtMessQueue.Put ( vecbyRecBuf,
+                                  iNumBytesRead,
+                                  ntohl ( SenderAddr.sin_addr.s_addr ),
+                                  ntohs ( SenderAddr.sin_port ) ) )
         {
-
-// TODO a copy of the vector is used -> avoid malloc in real-time routine
-
-            emit ProtcolCLMessageReceived ( iRecID, vecbyMesBodyData, RecHostAddr );
-        }
-        else
-        {
-
-// TODO a copy of the vector is used -> avoid malloc in real-time routine
-
-            emit ProtcolMessageReceived ( iRecCounter, iRecID, vecbyMesBodyData, RecHostAddr );
+            ProtMessSemaphore.release();
         }
     }
     else
     {
+        // convert address of client
+        RecHostAddr.InetAddr.setAddress ( ntohl ( SenderAddr.sin_addr.s_addr ) );
+        RecHostAddr.iPort = ntohs ( SenderAddr.sin_port );
+
         // this is most probably a regular audio packet
         if ( bIsClient )
         {
@@ -303,8 +372,9 @@ void CSocket::OnDataReceived()
 
             int iCurChanID;
 
-            if ( pServer->PutAudioData ( vecbyRecBuf, iNumBytesRead, RecHostAddr, iCurChanID ) )
+            switch ( pServer->PutAudioData ( vecbyRecBuf, iNumBytesRead, RecHostAddr, iCurChanID ) )
             {
+            case PS_NEW_CONNECTION:
                 // we have a new connection, emit a signal
                 emit NewConnection ( iCurChanID, RecHostAddr );
 
@@ -315,14 +385,82 @@ void CSocket::OnDataReceived()
                     QCoreApplication::postEvent ( pServer,
                         new CCustomEvent ( MS_PACKET_RECEIVED, 0, 0 ) );
                 }
-            }
+                break;
 
-            // check if no channel is available
-            if ( iCurChanID == INVALID_CHANNEL_ID )
-            {
+            case PS_UNKNOWN_SENDER:
+                // the sender is not known, it has to answer a challenge
+                // before a channel is allocated
+                emit ConnChallengeRequired ( RecHostAddr );
+                break;
+
+            case PS_SERVER_FULL:
                 // fire message for the state that no free channel is available
                 emit ServerFull ( RecHostAddr );
+                break;
+
+            default:
+                // do nothing
+                break;
             }
         }
     }
 }
+
+void CSocket::DispatchProtocolMessages()
+{
+    // wait for a new protocol message in the queue
+    ProtMessSemaphore.acquire();
+
+    if ( ProtMessQueue.IsEmpty() )
+    {
+        // we were woken up without a new message (e.g., on shutdown)
+        return;
+    }
+
+    int iRecCounter;
+    int iRecID;
+
+    if ( !CProtocol::ParseMessageFrame ( ProtMessQueue.GetData(),
+                                         ProtMessQueue.GetNumBytes(),
+                                         vecbyMesBodyData,
+                                         iRecCounter,
+                                         iRecID ) )
+    {
+        // the message is delivered to the channel/server in the main thread
+        // via a queued signal/slot connection
+        if ( CProtocol::IsConnectionLessMessageID ( iRecID ) )
+        {
+            emit ProtcolCLMessageReceived ( iRecID,
+                                            vecbyMesBodyData,
+                                            ProtMessQueue.GetHostAddress() );
+        }
+        else if ( iRecID == PROTMESSID_MESS_CONTAINER )
+        {
+            // a container is unpacked here and each contained message is
+            // delivered as if it was received in its own datagram
+            const CHostAddress HostAddr = ProtMessQueue.GetHostAddress();
+            int                iPos     = 0;
+
+            while ( !CProtocol::GetContainedMessage ( vecbyMesBodyData,
+                                                      iPos,
+                                                      vecbyContainedMesBody,
+                                                      iRecCounter,
+                                                      iRecID ) )
+            {
+                emit ProtcolMessageReceived ( iRecCounter,
+                                              iRecID,
+                                              vecbyContainedMesBody,
+                                              HostAddr );
+            }
+        }
+        else
+        {
+            emit ProtcolMessageReceived ( iRecCounter,
+                                          iRecID,
+                                          vecbyMesBodyData,
+                                          ProtMessQueue.GetHostAddress() );
+        }
+    }
+
+    ProtMessQueue.Remove();
+}
@@ -29,6 +29,8 @@
 #include <QMessageBox>
 #include <QThread>
 #include <QMutex>
+#include <QSemaphore>
+#include <QAtomicInt>
 #include <vector>
 #include "global.h"
 #include "protocol.h"
@@ -50,8 +52,61 @@ class CChannel; // forward declaration of CChannel
 // number of ports we try to bind until we give up
 #define NUM_SOCKET_PORTS_TO_TRY         50
 
+// number of slots of the received protocol messages queue (each slot has the
+// size of a complete network packet)
+#define NUM_PROT_MESS_QUEUE_SLOTS       64
+
 
 /* Classes ********************************************************************/
+/* Received protocol messages queue ----------------------------------------- */
+// Lock-free single producer/single consumer queue with preallocated slots of
+// fixed size. The network receive thread puts the raw protocol datagrams in
+// the queue and the protocol worker thread takes them out. Since all memory is
+// allocated on initialization, no memory allocation is done in the real-time
+// receive thread.
+class CProtocolMessageQueue
+{
+public:
+    CProtocolMessageQueue() : iPutPos ( 0 ), iGetPos ( 0 ), iNumUsedSlots ( 0 ) {}
+
+    void Init ( const int iNewNumSlots,
+                const int iNewSlotSizeBytes );
+
+    // producer side (network receive thread)
+    bool Put ( const CVector<uint8_t>& vecbyData,
+               const int               iNumBytes,
+               const quint32           iInetAddr,
+               const quint16           iPort );
+
+    // consumer side (protocol worker thread)
+    bool IsEmpty() { return iNumUsedSlots.fetchAndAddOrdered ( 0 ) == 0; }
+    const CVector<uint8_t>& GetData() const { return vecSlots[iGetPos].vecbyData; }
+    int GetNumBytes() const { return vecSlots[iGetPos].iNumBytes; }
+    CHostAddress GetHostAddress() const;
+    void Remove();
+
+protected:
+    class CSlot
+    {
+    public:
+        CSlot() : iNumBytes ( 0 ), iInetAddr ( 0 ), iPort ( 0 ) {}
+
+        CVector<uint8_t> vecbyData;
+        int              iNumBytes;
+
+        // we store the plain IPv4 address since the QHostAddress may allocate
+        // memory on setting a new address
+        quint32          iInetAddr;
+        quint16          iPort;
+    };
+
+    CVector<CSlot> vecSlots;
+    int            iPutPos; // only modified by the producer
+    int            iGetPos; // only modified by the consumer
+    QAtomicInt     iNumUsedSlots;
+};
+
+
 /* Base socket class -------------------------------------------------------- */
 class CSocket : public QObject
 {
@@ -78,6 +133,9 @@ public:
     bool GetAndResetbJitterBufferOKFlag();
     void Close();
 
+    void DispatchProtocolMessages();
+    void StopProtocolMessagesDispatch() { ProtMessSemaphore.release(); }
+
 protected:
     void Init ( const quint16 iPortNumber = LLCON_DEFAULT_PORT_NUMBER );
 
@@ -91,6 +149,11 @@ protected:
 
     CVector<uint8_t> vecbyRecBuf;
     CHostAddress     RecHostAddr;
+
+    CProtocolMessageQueue ProtMessQueue;
+    QSemaphore            ProtMessSemaphore;
+    CVector<uint8_t>      vecbyMesBodyData;
+    CVector<uint8_t>      vecbyContainedMesBody;
     QHostAddress     SenderAddress;
     quint16          SenderPort;
 
@@ -112,6 +175,8 @@ signals:
 
     void ServerFull ( CHostAddress RecHostAddr );
 
+    void ConnChallengeRequired ( CHostAddress RecHostAddr );
+
     void InvalidPacketReceived ( CHostAddress RecHostAddr );
 
     void ProtcolMessageReceived ( int              iRecCounter,
@@ -146,10 +211,15 @@ public:
     virtual ~CHighPrioSocket()
     {
         NetworkWorkerThread.Stop();
+        ProtocolWorkerThread.Stop();
     }
 
     void Start()
     {
+        // starts the protocol worker thread which parses the received protocol
+        // messages in a normal priority thread
+        ProtocolWorkerThread.start ( QThread::NormalPriority );
+
         // starts the high priority socket receive thread (with using blocking
         // socket request call)
         NetworkWorkerThread.start ( QThread::TimeCriticalPriority );
@@ -206,6 +276,43 @@ protected:
         bool     bRun;
     };
 
+    class CProtocolThread : public QThread
+    {
+    public:
+        CProtocolThread ( CSocket* pNewSocket = NULL, QObject* parent = 0 ) :
+          QThread ( parent ), pSocket ( pNewSocket ), bRun ( true ) {}
+
+        void Stop()
+        {
+            // disable run flag so that the thread loop can be exit
+            bRun = false;
+
+            // to leave blocking wait for new protocol messages
+            pSocket->StopProtocolMessagesDispatch();
+
+            // give thread some time to terminate
+            wait ( 5000 );
+        }
+
+        void SetSocket ( CSocket* pNewSocket ) { pSocket = pNewSocket; }
+
+    protected:
+        void run() {
+            if ( pSocket != NULL )
+            {
+                while ( bRun )
+                {
+                    // this function is a blocking function (waiting for
+                    // protocol messages to be put in the queue)
+                    pSocket->DispatchProtocolMessages();
+                }
+            }
+        }
+
+        CSocket* pSocket;
+        bool     bRun;
+    };
+
     void Init()
     {
         // Creation of the new socket thread which has to have the highest
@@ -216,6 +323,7 @@ protected:
         Socket.moveToThread ( &NetworkWorkerThread );
 
         NetworkWorkerThread.SetSocket ( &Socket );
+        ProtocolWorkerThread.SetSocket ( &Socket );
 
         // connect the "InvalidPacketReceived" signal
         QObject::connect ( &Socket,
@@ -223,8 +331,9 @@ protected:
             SIGNAL ( InvalidPacketReceived ( CHostAddress ) ) );
     }
 
-    CSocketThread NetworkWorkerThread;
-    CSocket       Socket;
+    CSocketThread   NetworkWorkerThread;
+    CProtocolThread ProtocolWorkerThread;
+    CSocket         Socket;
 
 signals:
     void InvalidPacketReceived ( CHostAddress RecHostAddr );
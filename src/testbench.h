@@ -42,38 +42,52 @@ class CTestbench : public QObject
     Q_OBJECT
 
 public:
-    CTestbench ( QString sNewAddress, quint16 iNewPort ) :
+    // if the network is not used, the generated messages are only passed to
+    // ProcessMessage() and no timer is started (used by the protocol fuzzer)
+    CTestbench ( QString    sNewAddress,
+                 quint16    iNewPort,
+                 const bool bUseNetwork = true ) :
         sAddress ( sNewAddress ),
         iPort    ( iNewPort )
     {
-        // bind socket (try 100 port numbers)
-        quint16 iPortIncrement = 0;     // start value: port nubmer plus ten
-        bool    bSuccess       = false; // initialization for while loop
+        // connect protocol signals
+        QObject::connect ( &Protocol, SIGNAL ( MessReadyForSending ( CVector<uint8_t> ) ),
+            this, SLOT ( OnSendProtMessage ( CVector<uint8_t> ) ) );
+
+        QObject::connect ( &Protocol,
+            SIGNAL ( CLMessReadyForSending ( CHostAddress, CVector<uint8_t> ) ),
+            this, SLOT ( OnSendCLProtMessage ( CHostAddress, CVector<uint8_t> ) ) );
 
-        while ( !bSuccess && ( iPortIncrement <= 100 ) )
+        if ( bUseNetwork )
         {
-            bSuccess = UdpSocket.bind ( QHostAddress( QHostAddress::Any ),
-                                        22222 + iPortIncrement );
+            // bind socket (try 100 port numbers)
+            quint16 iPortIncrement = 0;     // start value: port nubmer plus ten
+            bool    bSuccess       = false; // initialization for while loop
 
-            iPortIncrement++;
-        }
+            while ( !bSuccess && ( iPortIncrement <= 100 ) )
+            {
+                bSuccess = UdpSocket.bind ( QHostAddress( QHostAddress::Any ),
+                                            22222 + iPortIncrement );
 
-        // connect protocol signal
-        QObject::connect ( &Protocol, SIGNAL ( MessReadyForSending ( CVector<uint8_t> ) ),
-            this, SLOT ( OnSendProtMessage ( CVector<uint8_t> ) ) );
+                iPortIncrement++;
+            }
 
-        // connect and start the timer (testbench heartbeat)
-        QObject::connect ( &Timer, SIGNAL ( timeout() ),
-            this, SLOT ( OnTimer() ) );
+            // connect and start the timer (testbench heartbeat)
+            QObject::connect ( &Timer, SIGNAL ( timeout() ),
+                this, SLOT ( OnTimer() ) );
 
-        Timer.start ( 1 ); // 1 ms
+            Timer.start ( 1 ); // 1 ms
+        }
     }
 
+    virtual ~CTestbench() {}
+
 protected:
     int GenRandomIntInRange ( const int iStart, const int iEnd ) const
     {
-        return static_cast<int> ( iStart +
-            ( ( static_cast<double> ( iEnd - iStart + 1 ) * rand() ) / RAND_MAX ) );
+        // note that rand() can return RAND_MAX, therefore we use the modulo
+        // to stay in the range
+        return iStart + rand() % ( iEnd - iStart + 1 );
     }
 
     QString GenRandomString() const
@@ -95,8 +109,14 @@ protected:
     CProtocol  Protocol;
     QUdpSocket UdpSocket;
 
-public slots:
-    void OnTimer()
+    virtual void ProcessMessage ( const CVector<uint8_t>& vecMessage )
+    {
+        UdpSocket.writeDatagram (
+            (const char*) &vecMessage.front(),
+            vecMessage.Size(), QHostAddress ( sAddress ), iPort );
+    }
+
+    void GenRandomMessage()
     {
         CVector<CChannelInfo>  vecChanInfo ( 1 );
         CNetworkTransportProps NetTrProps;
@@ -104,9 +124,11 @@ public slots:
         CVector<CServerInfo>   vecServerInfo ( 1 );
         CHostAddress           CurHostAddress ( QHostAddress ( sAddress ), iPort );
         CChannelCoreInfo       ChannelCoreInfo;
+        CVector<int>           veciRemovedChanIDs ( 1 );
+        CVector<uint8_t>       vecData;
 
         // generate random protocol message
-        switch ( GenRandomIntInRange ( 0, 26 ) )
+        switch ( GenRandomIntInRange ( 0, 34 ) )
         {
         case 0: // PROTMESSID_JITT_BUF_SIZE
             Protocol.CreateJitBufMes ( GenRandomIntInRange ( 0, 10 ) );
@@ -273,7 +295,66 @@ public slots:
                                                 GenRandomIntInRange ( -100, 100 ) );
             break;
 
-        case 26:
+        case 26: // PROTMESSID_SUPPORTED_FEATURES
+            Protocol.CreateSupportedFeaturesMes ( GenRandomIntInRange ( 0, 255 ) );
+            break;
+
+        case 27: // PROTMESSID_RECEIVER_REPORT
+            Protocol.CreateReceiverReportMes ( GenRandomIntInRange ( -2, 1000 ),
+                                               GenRandomIntInRange ( -2, 1000 ) );
+            break;
+
+        case 28: // PROTMESSID_CONN_CLIENTS_LIST_DELTA
+            veciRemovedChanIDs[0]  = GenRandomIntInRange ( -2, 20 );
+            vecChanInfo[0].iChanID = GenRandomIntInRange ( -2, 20 );
+            vecChanInfo[0].iIpAddr = GenRandomIntInRange ( 0, 100000 );
+            vecChanInfo[0].strName = GenRandomString();
+
+            CProtocol::PrepareConClientListDeltaMes ( GenRandomIntInRange ( 0, 10 ),
+                                                      GenRandomIntInRange ( 0, 10 ),
+                                                      veciRemovedChanIDs,
+                                                      vecChanInfo,
+                                                      vecData );
+
+            Protocol.CreatePreparedConClientListDeltaMes ( vecData );
+            break;
+
+        case 29: // PROTMESSID_CLM_SERVER_LIST_FRAGMENT
+            vecServerInfo[0].HostAddr = CurHostAddress;
+            vecServerInfo[0].strName  = GenRandomString();
+
+            Protocol.CreateCLServerListFragmentMes ( CurHostAddress,
+                                                     GenRandomIntInRange ( 0, 10 ),
+                                                     vecServerInfo );
+            break;
+
+        case 30: // PROTMESSID_CLM_SERVER_LOAD
+            Protocol.CreateCLServerLoadMes ( CurHostAddress,
+                                             GenRandomIntInRange ( 0, 255 ),
+                                             GenRandomIntInRange ( 0, 110 ),
+                                             GenRandomString() );
+            break;
+
+        case 31: // PROTMESSID_CLM_REQ_GROUP_SERVER
+            Protocol.CreateCLReqGroupServerMes ( CurHostAddress,
+                                                 GenRandomString(),
+                                                 GenRandomIntInRange ( 0, 255 ) );
+            break;
+
+        case 32: // PROTMESSID_CLM_GROUP_SERVER
+            Protocol.CreateCLGroupServerMes ( CurHostAddress, CurHostAddress );
+            break;
+
+        case 33: // PROTMESSID_CLM_REQ_LISTEN
+            Protocol.CreateCLReqListenMes ( CurHostAddress,
+                                            GenRandomIntInRange ( 0, 65535 ),
+                                            static_cast<EAudComprType> ( GenRandomIntInRange ( 0, 3 ) ),
+                                            GenRandomIntInRange ( 1, 2 ),
+                                            GenRandomIntInRange ( 0, 1000 ),
+                                            GenRandomIntInRange ( 64, 128 ) );
+            break;
+
+        case 34:
             // arbitrary "audio" packet (with random sizes)
             CVector<uint8_t> vecMessage ( GenRandomIntInRange ( 1, 1000 ) );
             OnSendProtMessage ( vecMessage );
@@ -281,16 +362,23 @@ public slots:
         }
     }
 
-    void OnSendProtMessage ( CVector<uint8_t> vecMessage )
+public slots:
+    void OnTimer() { GenRandomMessage(); }
+
+    void OnSendProtMessage ( const CVector<uint8_t>& vecMessage )
     {
-        UdpSocket.writeDatagram (
-            (const char*) &( (CVector<uint8_t>) vecMessage )[0],
-            vecMessage.Size(), QHostAddress ( sAddress ), iPort );
+        ProcessMessage ( vecMessage );
 
         // reset protocol so that we do not have to wait for an acknowledge to
         // send the next message
         Protocol.Reset();
     }
+
+    void OnSendCLProtMessage ( CHostAddress,
+                               const CVector<uint8_t>& vecMessage )
+    {
+        ProcessMessage ( vecMessage );
+    }
 };
 
 #endif /* !defined ( TESTBENCH_HOIHJH8_3_43445KJIUHF1912__INCLUDED_ ) */
@@ -0,0 +1,344 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2014
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#include "uplink.h"
+
+
+/* Implementation *************************************************************/
+CServerUplink::CServerUplink ( const int      iNTickFrameSizeSamples,
+                               const QString& strNName ) :
+    Channel               ( false ), /* we need a client channel -> "false" */
+    Socket                ( &Channel, 0 ), /* any free port */
+    iTickFrameSizeSamples ( iNTickFrameSizeSamples ),
+    iNumTicksPerFrame     ( SYSTEM_FRAME_SIZE_SAMPLES / iNTickFrameSizeSamples ),
+    iMutedChanID          ( UPLINK_INVALID_CHAN_ID )
+{
+    int iOpusError;
+
+    // the fader of the uplink in the upstream server shows the given name with
+    // a random suffix, this generated fader tag identifies our own channel in
+    // the connected clients list of the upstream server (the name alone is not
+    // unique, e.g. if two servers with the same name cascade into it)
+    const QString strTagId = " " +
+        QUuid::createUuid().toString().mid ( 1, UPLINK_TAG_ID_LEN ).toUpper();
+
+    ChannelInfo.strName =
+        strNName.left ( MAX_LEN_FADER_TAG - strTagId.length() ) + strTagId;
+
+    // the submix is always transmitted in stereo with the default frame size
+    OpusMode = opus_custom_mode_create ( SYSTEM_SAMPLE_RATE_HZ,
+                                         SYSTEM_FRAME_SIZE_SAMPLES,
+                                         &iOpusError );
+
+    OpusEncoder = opus_custom_encoder_create ( OpusMode,
+                                               2,
+                                               &iOpusError );
+
+    OpusDecoder = opus_custom_decoder_create ( OpusMode,
+                                               2,
+                                               &iOpusError );
+
+    // same settings as for the encoders of the client
+    opus_custom_encoder_ctl ( OpusEncoder,
+                              OPUS_SET_VBR ( 0 ) );
+
+    opus_custom_encoder_ctl ( OpusEncoder,
+                              OPUS_SET_APPLICATION ( OPUS_APPLICATION_RESTRICTED_LOWDELAY ) );
+
+    opus_custom_encoder_ctl ( OpusEncoder,
+                              OPUS_SET_BITRATE (
+                                  CalcBitRateBitsPerSecFromCodedBytes (
+                                      UPLINK_NUM_CODED_BYTES ) ) );
+
+#ifdef USE_LOW_COMPLEXITY_CELT_ENC
+    // set encoder low complexity
+    opus_custom_encoder_ctl ( OpusEncoder,
+                              OPUS_SET_COMPLEXITY ( 1 ) );
+#endif
+
+    // no memory must be allocated in the timer of the server
+    vecsEncFrame.Init   ( 2 * SYSTEM_FRAME_SIZE_SAMPLES );
+    vecsDecFrame.Init   ( 2 * SYSTEM_FRAME_SIZE_SAMPLES );
+    vecbyCodedData.Init ( MAX_SIZE_BYTES_NETW_BUF );
+
+    DriftComp.Init ( 2, SYSTEM_FRAME_SIZE_SAMPLES );
+
+    // the upstream server shall use an auto jitter buffer, too
+    Channel.SetDoAutoSockBufSize ( true );
+
+
+    // Connections -------------------------------------------------------------
+    // connections for the protocol mechanism
+    QObject::connect ( &Channel,
+        SIGNAL ( MessReadyForSending ( CVector<uint8_t> ) ),
+        this, SLOT ( OnSendProtMessage ( CVector<uint8_t> ) ) );
+
+    QObject::connect ( &Channel,
+        SIGNAL ( DetectedCLMessage ( CVector<uint8_t>, int, CHostAddress ) ),
+        this, SLOT ( OnDetectedCLMessage ( CVector<uint8_t>, int, CHostAddress ) ) );
+
+    QObject::connect ( &Channel, SIGNAL ( ReqJittBufSize() ),
+        this, SLOT ( OnReqJittBufSize() ) );
+
+    QObject::connect ( &Channel, SIGNAL ( ReqChanInfo() ),
+        this, SLOT ( OnReqChanInfo() ) );
+
+    QObject::connect ( &Channel, SIGNAL ( NewConnection() ),
+        this, SLOT ( OnNewConnection() ) );
+
+    QObject::connect ( &Channel,
+        SIGNAL ( ConClientListMesReceived ( CVector<CChannelInfo> ) ),
+        this, SLOT ( OnConClientListMesReceived ( CVector<CChannelInfo> ) ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLMessReadyForSending ( CHostAddress, CVector<uint8_t> ) ),
+        this, SLOT ( OnSendCLProtMessage ( CHostAddress, CVector<uint8_t> ) ) );
+
+    QObject::connect ( &ConnLessProtocol,
+        SIGNAL ( CLConnChallengeReceived ( CHostAddress, quint32 ) ),
+        this, SLOT ( OnCLConnChallengeReceived ( CHostAddress, quint32 ) ) );
+
+
+    // start the socket (it is important to start the socket after all
+    // initializations and connections)
+    Socket.Start();
+}
+
+CServerUplink::~CServerUplink()
+{
+    // leave the upstream server immediately instead of waiting for the time-out
+    Stop();
+
+    opus_custom_decoder_destroy ( OpusDecoder );
+    opus_custom_encoder_destroy ( OpusEncoder );
+    opus_custom_mode_destroy    ( OpusMode );
+}
+
+bool CServerUplink::SetUpstreamAddr ( const QString& strNAddr )
+{
+    CHostAddress HostAddress;
+
+    if ( NetworkUtil().ParseNetworkAddress ( strNAddr,
+                                             HostAddress ) )
+    {
+        // apply address to the channel
+        Channel.SetAddress ( HostAddress );
+
+        return true;
+    }
+    else
+    {
+        return false; // invalid address
+    }
+}
+
+void CServerUplink::Start()
+{
+    if ( !IsRunning() )
+    {
+        // the upstream server is a current server, therefore we can use the
+        // OPUS codec right from the start
+        Channel.SetAudioStreamProperties ( CT_OPUS,
+                                           UPLINK_NUM_CODED_BYTES,
+                                           FRAME_SIZE_FACTOR_PREFERRED,
+                                           2 );
+
+        // the upstream server assigns a new channel to us
+        iMutedChanID = UPLINK_INVALID_CHAN_ID;
+        DriftComp.Reset();
+
+        Channel.SetEnable ( true );
+    }
+}
+
+void CServerUplink::Stop()
+{
+    if ( IsRunning() )
+    {
+        Channel.SetEnable ( false );
+
+        // send disconnect message to the upstream server (if it gets lost, the
+        // upstream server disconnects the channel after the time-out)
+        ConnLessProtocol.CreateCLDisconnection ( Channel.GetAddress() );
+    }
+}
+
+void CServerUplink::PutLocalSubmix ( const CVector<int16_t>& vecsData,
+                                     const int               iTickCnt )
+{
+    // collect the submixes of all timer ticks of the current audio frame
+    const int iTickPhase      = iTickCnt % iNumTicksPerFrame;
+    const int iTickNumSamples = 2 * iTickFrameSizeSamples;
+
+    std::copy ( vecsData.begin(),
+                vecsData.begin() + iTickNumSamples,
+                vecsEncFrame.begin() + iTickPhase * iTickNumSamples );
+
+    // the audio frame is encoded and sent at its last timer tick
+    if ( iTickPhase == iNumTicksPerFrame - 1 )
+    {
+        opus_custom_encode ( OpusEncoder,
+                             &vecsEncFrame[0],
+                             SYSTEM_FRAME_SIZE_SAMPLES,
+                             &vecbyCodedData[0],
+                             UPLINK_NUM_CODED_BYTES );
+
+        Channel.PrepAndSendPacket ( &Socket,
+                                    vecbyCodedData,
+                                    UPLINK_NUM_CODED_BYTES );
+
+        // update socket buffer size
+        Channel.UpdateSocketBufferSize();
+    }
+}
+
+void CServerUplink::GetUpstreamMix ( CVector<int16_t>& vecsData,
+                                     const int         iTickCnt )
+{
+    // the complete frame is decoded at the first timer tick of the audio frame
+    const int iTickPhase = iTickCnt % iNumTicksPerFrame;
+
+    if ( iTickPhase == 0 )
+    {
+        // the clock of the upstream server is not synchronized with our timer
+        const int iNumBlocksToDecode = DriftComp.Update (
+            Channel.GetSockBufFillLevel(),
+            Channel.GetSockBufTargetFillLevel() );
+
+        for ( int k = 0; k < iNumBlocksToDecode; k++ )
+        {
+            int iNumCodedBytes = UPLINK_NUM_CODED_BYTES;
+
+            const EGetDataStat eGetStat =
+                Channel.GetData ( vecbyCodedData, iNumCodedBytes );
+
+            if ( eGetStat == GS_BUFFER_OK )
+            {
+                opus_custom_decode ( OpusDecoder,
+                                     &vecbyCodedData[0],
+                                     iNumCodedBytes,
+                                     &vecsDecFrame[0],
+                                     SYSTEM_FRAME_SIZE_SAMPLES );
+            }
+            else if ( Channel.IsConnected() )
+            {
+                // lost packet
+                opus_custom_decode ( OpusDecoder,
+                                     NULL,
+                                     UPLINK_NUM_CODED_BYTES,
+                                     &vecsDecFrame[0],
+                                     SYSTEM_FRAME_SIZE_SAMPLES );
+            }
+            else
+            {
+                // not (yet) connected to the upstream server
+                vecsDecFrame.Reset ( 0 );
+            }
+
+            DriftComp.Put ( &vecsDecFrame[0] );
+        }
+
+        // get the resampled block for mixing
+        DriftComp.Get ( &vecsDecFrame[0] );
+    }
+
+    // copy the part of the decoded frame which belongs to the current tick
+    const int iTickNumSamples = 2 * iTickFrameSizeSamples;
+
+    std::copy ( vecsDecFrame.begin() + iTickPhase * iTickNumSamples,
+                vecsDecFrame.begin() + ( iTickPhase + 1 ) * iTickNumSamples,
+                vecsData.begin() );
+}
+
+void CServerUplink::OnSendProtMessage ( const CVector<uint8_t>& vecMessage )
+{
+    // the protocol queries me to call the function to send the message
+    // send it through the network
+    Socket.SendPacket ( vecMessage, Channel.GetAddress() );
+}
+
+void CServerUplink::OnSendCLProtMessage ( CHostAddress            InetAddr,
+                                          const CVector<uint8_t>& vecMessage )
+{
+    // the protocol queries me to call the function to send the message
+    // send it through the network
+    Socket.SendPacket ( vecMessage, InetAddr );
+}
+
+void CServerUplink::OnDetectedCLMessage ( CVector<uint8_t> vecbyMesBodyData,
+                                          int              iRecID,
+                                          CHostAddress     RecHostAddr )
+{
+    // connection less messages are always processed
+    ConnLessProtocol.ParseConnectionLessMessageBody ( vecbyMesBodyData,
+                                                      iRecID,
+                                                      RecHostAddr );
+}
+
+void CServerUplink::OnCLConnChallengeReceived ( CHostAddress InetAddr,
+                                                quint32      iCookie )
+{
+    // only answer the challenge of the upstream server
+    if ( IsRunning() && ( InetAddr == Channel.GetAddress() ) )
+    {
+        ConnLessProtocol.CreateCLConnChallengeRespMes ( InetAddr, iCookie );
+    }
+}
+
+void CServerUplink::OnNewConnection()
+{
+    // same as in the client: send infos and request the connected clients
+    // list (which we need to find our own channel in the upstream server)
+    Channel.SetRemoteInfo ( ChannelInfo );
+    Channel.CreateReqConnClientsList();
+    OnReqJittBufSize();
+    Channel.CreateSupportedFeaturesMes ( PROT_SUPPORTED_FEATURES );
+}
+
+void CServerUplink::OnReqJittBufSize()
+{
+    // the upstream server shall use an auto jitter buffer
+    Channel.CreateJitBufMes ( AUTO_NET_BUF_SIZE_FOR_PROTOCOL );
+}
+
+void CServerUplink::OnConClientListMesReceived ( CVector<CChannelInfo> vecChanInfo )
+{
+    // The mix we get from the upstream server must not contain our own submix
+    // since our local clients already hear it without the network delay. The
+    // protocol does not tell us which channel is ours, therefore we identify
+    // it by our generated fader tag.
+    for ( int i = 0; i < vecChanInfo.Size(); i++ )
+    {
+        if ( vecChanInfo[i].strName == ChannelInfo.strName )
+        {
+            if ( vecChanInfo[i].iChanID != iMutedChanID )
+            {
+                iMutedChanID = vecChanInfo[i].iChanID;
+                Channel.SetRemoteChanGain ( iMutedChanID, 0 );
+            }
+
+            return;
+        }
+    }
+}
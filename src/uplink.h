@@ -0,0 +1,122 @@
+/******************************************************************************\
+ * Copyright (c) 2004-2014
+ *
+ * Author(s):
+ *  Volker Fischer
+ *
+ ******************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+\******************************************************************************/
+
+#if !defined ( UPLINK_HOIH94537KJHSD_3_4344JHGF9845IUHF1912__INCLUDED_ )
+#define UPLINK_HOIH94537KJHSD_3_4344JHGF9845IUHF1912__INCLUDED_
+
+#include <QObject>
+#include <QUuid>
+#include "opus_custom.h"
+#include "global.h"
+#include "socket.h"
+#include "channel.h"
+#include "protocol.h"
+#include "util.h"
+#include "resample.h"
+
+
+/* Definitions ****************************************************************/
+// the submix is sent with the same number of coded bytes as the stereo high
+// quality setting of the client
+#define UPLINK_NUM_CODED_BYTES              142
+
+// number of random hex digits appended to the fader tag of the uplink
+#define UPLINK_TAG_ID_LEN                   4
+
+// no channel of the upstream server is assigned to the uplink yet
+#define UPLINK_INVALID_CHAN_ID              ( -1 )
+
+
+/* Classes ********************************************************************/
+// The uplink connects a server to an upstream server like a client does (so
+// that no modification of the upstream server is required). There is no sound
+// card, instead the uplink is called by the timer of the server: at each timer
+// tick the submix of the local clients is put into the uplink and the mix of
+// the upstream server is taken from it as an additional source for the local
+// clients.
+class CServerUplink : public QObject
+{
+    Q_OBJECT
+
+public:
+    CServerUplink ( const int      iNTickFrameSizeSamples,
+                    const QString& strNName );
+
+    virtual ~CServerUplink();
+
+    bool SetUpstreamAddr ( const QString& strNAddr );
+
+    void Start();
+    void Stop();
+    bool IsRunning() { return Channel.IsEnabled(); }
+
+    // both functions must be called at each timer tick with the stereo audio
+    // data of one tick (the tick counter defines the position of the tick in
+    // the audio frame)
+    void PutLocalSubmix ( const CVector<int16_t>& vecsData,
+                          const int               iTickCnt );
+
+    void GetUpstreamMix ( CVector<int16_t>& vecsData,
+                          const int         iTickCnt );
+
+protected:
+    CChannel           Channel;
+    CProtocol          ConnLessProtocol;
+    CHighPrioSocket    Socket;
+    CChannelCoreInfo   ChannelInfo;
+
+    int                iTickFrameSizeSamples;
+    int                iNumTicksPerFrame;
+
+    OpusCustomMode*    OpusMode;
+    OpusCustomEncoder* OpusEncoder;
+    OpusCustomDecoder* OpusDecoder;
+
+    CVector<int16_t>   vecsEncFrame;
+    CVector<int16_t>   vecsDecFrame;
+    CVector<uint8_t>   vecbyCodedData;
+
+    // clock drift compensation for the audio of the upstream server
+    CClockDriftComp    DriftComp;
+
+    // the channel of the uplink in the upstream server which is muted in the
+    // mix we get from the upstream server
+    int                iMutedChanID;
+
+public slots:
+    void OnSendProtMessage ( const CVector<uint8_t>& vecMessage );
+    void OnSendCLProtMessage ( CHostAddress            InetAddr,
+                               const CVector<uint8_t>& vecMessage );
+    void OnDetectedCLMessage ( CVector<uint8_t> vecbyMesBodyData,
+                               int              iRecID,
+                               CHostAddress     RecHostAddr );
+    void OnCLConnChallengeReceived ( CHostAddress InetAddr,
+                                     quint32      iCookie );
+    void OnNewConnection();
+    void OnReqJittBufSize();
+    void OnReqChanInfo() { Channel.SetRemoteInfo ( ChannelInfo ); }
+    void OnConClientListMesReceived ( CVector<CChannelInfo> vecChanInfo );
+};
+
+#endif /* !defined ( UPLINK_HOIH94537KJHSD_3_4344JHGF9845IUHF1912__INCLUDED_ ) */
@@ -101,40 +101,99 @@ double CStereoSignalLevelMeter::CalcLogResult ( const double& dLinearLevel )
 
 
 // CRC -------------------------------------------------------------------------
-void CCRC::Reset()
-{
-    // init state shift-register with ones. Set all registers to "1" with
-    // bit-wise not operation
-    iStateShiftReg = ~uint32_t ( 0 );
-}
-
-void CCRC::AddByte ( const uint8_t byNewInput )
+/*
+    The CRC uses the generator polynomial x^16 + x^12 + x^5 + 1. In the bit wise
+    implementation the shift-register is rotated by one bit, the new data bit is
+    added to the LSB and the polynomial is added if the LSB is set. Shifting in
+    a complete byte only depends on the high byte of the register added to the
+    input byte, the low byte is simply moved to the high byte. Therefore the
+    effect of the high byte can be stored in a table (table 0). Table k stores
+    the effect of a byte followed by k zero bytes which enables us to process
+    four bytes at once with independent table look-ups (slice-by-4).
+*/
+class CCRCTables
 {
-    for ( int i = 0; i < 8; i++ )
+public:
+    CCRCTables()
     {
-        // shift bits in shift-register for transistion
-        iStateShiftReg <<= 1;
+        const uint32_t iPoly = ( 1 << 5 ) | ( 1 << 12 );
+        int            i, j;
 
-        // take bit, which was shifted out of the register-size and place it
-        // at the beginning (LSB)
-        // (If condition is not satisfied, implicitely a "0" is added)
-        if ( ( iStateShiftReg & iBitOutMask) > 0 )
+        for ( i = 0; i < 256; i++ )
         {
-            iStateShiftReg |= 1;
-        }
+            // bit wise CRC calculation of the high byte with zero input
+            uint32_t iState = static_cast<uint32_t> ( i ) << 8;
 
-        // add new data bit to the LSB
-        if ( ( byNewInput & ( 1 << ( 8 - i - 1 ) ) ) > 0 )
-        {
-            iStateShiftReg ^= 1;
+            for ( j = 0; j < 8; j++ )
+            {
+                // shift bits and place the bit which was shifted out at the
+                // LSB, add mask if the LSB is set
+                iState <<= 1;
+
+                if ( iState & ( 1 << 16 ) )
+                {
+                    iState |= 1;
+                }
+
+                if ( iState & 1 )
+                {
+                    iState ^= iPoly;
+                }
+            }
+
+            iTable[0][i] = static_cast<uint16_t> ( iState & 0xFFFF );
         }
 
-        // add mask to shift-register if first bit is true
-        if ( iStateShiftReg & 1 )
+        // effect of the additional zero bytes
+        for ( j = 1; j < 4; j++ )
         {
-            iStateShiftReg ^= iPoly;
+            for ( i = 0; i < 256; i++ )
+            {
+                iTable[j][i] = static_cast<uint16_t> (
+                    ( ( iTable[j - 1][i] << 8 ) & 0xFF00 ) ^
+                    iTable[0][iTable[j - 1][i] >> 8] );
+            }
         }
     }
+
+    uint16_t iTable[4][256];
+};
+
+// the tables are calculated once on program start
+static const CCRCTables CRCTables;
+
+void CCRC::Reset()
+{
+    // init state shift-register with ones
+    iStateShiftReg = 0xFFFF;
+}
+
+void CCRC::AddByte ( const uint8_t byNewInput )
+{
+    iStateShiftReg = ( ( iStateShiftReg << 8 ) & 0xFF00 ) ^
+        CRCTables.iTable[0][( ( iStateShiftReg >> 8 ) ^ byNewInput ) & 0xFF];
+}
+
+void CCRC::AddBytes ( const uint8_t* pbyNewInput,
+                      const int      iNumBytes )
+{
+    int i = 0;
+
+    // process four bytes at once
+    for ( ; i + 4 <= iNumBytes; i += 4 )
+    {
+        iStateShiftReg =
+            CRCTables.iTable[3][( ( iStateShiftReg >> 8 ) ^ pbyNewInput[i] ) & 0xFF] ^
+            CRCTables.iTable[2][( iStateShiftReg ^ pbyNewInput[i + 1] ) & 0xFF] ^
+            CRCTables.iTable[1][pbyNewInput[i + 2]] ^
+            CRCTables.iTable[0][pbyNewInput[i + 3]];
+    }
+
+    // remaining bytes
+    for ( ; i < iNumBytes; i++ )
+    {
+        AddByte ( pbyNewInput[i] );
+    }
 }
 
 uint32_t CCRC::GetCRC()
@@ -142,8 +201,119 @@ uint32_t CCRC::GetCRC()
     // return inverted shift-register (1's complement)
     iStateShiftReg = ~iStateShiftReg;
 
-    // remove bit which where shifted out of the shift-register frame
-    return iStateShiftReg & ( iBitOutMask - 1 );
+    // remove bits which are outside the 16 bit shift-register frame
+    return iStateShiftReg & 0xFFFF;
+}
+
+
+// Bit rate adaptation ---------------------------------------------------------
+void CBitrateAdaptation::Init ( const int iNNumLevels )
+{
+    // we start with the highest level (which is the level the user has
+    // selected)
+    iNumLevels         = iNNumLevels;
+    iCurLevel          = iNumLevels - 1;
+    dRemoteLossRate    = 0;
+    dLocalLossRate     = 0;
+    iNumHoldPeriods    = BITRATE_ADAPT_NUM_HOLD_PERIODS;
+    iNumGoodPeriods    = 0;
+    iNumReqGoodPeriods = BITRATE_ADAPT_MIN_NUM_GOOD_PERIODS;
+    bIsProbing         = false;
+}
+
+double CBitrateAdaptation::CalcLossRate ( const double dOldLossRate,
+                                          const int    iNumFrames,
+                                          const int    iNumLostFrames )
+{
+    if ( iNumFrames <= 0 )
+    {
+        return dOldLossRate;
+    }
+
+    // IIR filter for smoothing the measured loss rate
+    return ( 1.0 - BITRATE_ADAPT_LOSS_WEIGHT ) * dOldLossRate +
+        BITRATE_ADAPT_LOSS_WEIGHT * iNumLostFrames / iNumFrames;
+}
+
+void CBitrateAdaptation::PutRemoteStatistics ( const int iNumFrames,
+                                               const int iNumLostFrames )
+{
+    dRemoteLossRate =
+        CalcLossRate ( dRemoteLossRate, iNumFrames, iNumLostFrames );
+}
+
+bool CBitrateAdaptation::PutLocalStatistics ( const int iNumFrames,
+                                              const int iNumLostFrames )
+{
+    dLocalLossRate =
+        CalcLossRate ( dLocalLossRate, iNumFrames, iNumLostFrames );
+
+    // after a change, the buffers at both sides are re-initialized which
+    // causes some losses, therefore we wait some periods before evaluating
+    // the loss rates again
+    if ( iNumHoldPeriods > 0 )
+    {
+        iNumHoldPeriods--;
+        dRemoteLossRate = 0;
+        dLocalLossRate  = 0;
+        return false;
+    }
+
+    const double dLossRate = std::max ( dRemoteLossRate, dLocalLossRate );
+    const int    iOldLevel = iCurLevel;
+
+    if ( dLossRate > BITRATE_ADAPT_LOSS_RATE_DOWN )
+    {
+        if ( iCurLevel > 0 )
+        {
+            iCurLevel--;
+
+            // if the probe of the higher level failed, we wait longer until
+            // the next probe is done
+            if ( bIsProbing )
+            {
+                iNumReqGoodPeriods = std::min ( 2 * iNumReqGoodPeriods,
+                    BITRATE_ADAPT_MAX_NUM_GOOD_PERIODS );
+            }
+        }
+
+        iNumGoodPeriods = 0;
+        bIsProbing      = false;
+    }
+    else if ( dLossRate < BITRATE_ADAPT_LOSS_RATE_UP )
+    {
+        iNumGoodPeriods++;
+
+        if ( iNumGoodPeriods >= iNumReqGoodPeriods )
+        {
+            if ( bIsProbing )
+            {
+                // the last probe was successful
+                iNumReqGoodPeriods = BITRATE_ADAPT_MIN_NUM_GOOD_PERIODS;
+                bIsProbing         = false;
+            }
+
+            if ( iCurLevel < iNumLevels - 1 )
+            {
+                iCurLevel++;
+                bIsProbing = true;
+            }
+
+            iNumGoodPeriods = 0;
+        }
+    }
+    else
+    {
+        iNumGoodPeriods = 0;
+    }
+
+    if ( iCurLevel != iOldLevel )
+    {
+        iNumHoldPeriods = BITRATE_ADAPT_NUM_HOLD_PERIODS;
+        return true;
+    }
+
+    return false;
 }
 
 
@@ -506,6 +676,23 @@ bool NetworkUtil::ParseNetworkAddress ( QString       strAddress,
     return true;
 }
 
+QHostAddress NetworkUtil::GetLocalAddress()
+{
+    // "connecting" a UDP socket does not send any packet, it only selects the
+    // network interface which is used to reach the given (public) address,
+    // the address of this interface is then the local address of this host
+    QUdpSocket Socket;
+
+    Socket.connectToHost ( QHostAddress ( "1.1.1.1" ), 53 );
+
+    if ( Socket.waitForConnected ( 1000 ) )
+    {
+        return Socket.localAddress();
+    }
+
+    return QHostAddress(); // no network interface available
+}
+
 
 // Instrument picture data base ------------------------------------------------
 CVector<CInstPictures::CInstPictProps>& CInstPictures::GetTable()
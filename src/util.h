@@ -27,6 +27,7 @@
 
 #include <QHostAddress>
 #include <QHostInfo>
+#include <QUdpSocket>
 #include <QMenu>
 #include <QWhatsThis>
 #include <QTextBrowser>
@@ -52,6 +53,17 @@ using namespace std; // because of the library: "vector"
 /* Definitions ****************************************************************/
 #define METER_FLY_BACK              2
 
+// bit rate adaptation: loss rate thresholds for stepping the audio quality
+// down/up, weight of the new value for the loss rate IIR filter, number of
+// statistic periods to wait after a change and the minimum/maximum number of
+// good periods before the next higher quality is probed
+#define BITRATE_ADAPT_LOSS_RATE_DOWN        0.02
+#define BITRATE_ADAPT_LOSS_RATE_UP          0.005
+#define BITRATE_ADAPT_LOSS_WEIGHT           0.3
+#define BITRATE_ADAPT_NUM_HOLD_PERIODS      3
+#define BITRATE_ADAPT_MIN_NUM_GOOD_PERIODS  10
+#define BITRATE_ADAPT_MAX_NUM_GOOD_PERIODS  160
+
 
 /* Global functions ***********************************************************/
 // converting double to short
@@ -80,10 +92,37 @@ void DebugError ( const QString& pchErDescr,
                   const double   dPar2 );
 
 // calculate the bit rate in bits per second from the number of coded bytes
-inline int CalcBitRateBitsPerSecFromCodedBytes ( const int iCeltNumCodedBytes )
+inline int CalcBitRateBitsPerSecFromCodedBytes ( const int iCeltNumCodedBytes,
+                                                 const int iFrameSizeSamples = SYSTEM_FRAME_SIZE_SAMPLES )
 {
     return ( SYSTEM_SAMPLE_RATE_HZ * iCeltNumCodedBytes * 8 ) /
-        SYSTEM_FRAME_SIZE_SAMPLES;
+        iFrameSizeSamples;
+}
+
+// uncompressed audio transport: 16 bit samples in little endian byte order
+// (for stereo the samples are interleaved)
+inline void PcmEncode ( const int16_t* psIn,
+                        uint8_t*       pbyOut,
+                        const int      iNumSamples )
+{
+    for ( int i = 0; i < iNumSamples; i++ )
+    {
+        const uint16_t iCurSample = static_cast<uint16_t> ( psIn[i] );
+
+        pbyOut[2 * i]     = static_cast<uint8_t> ( iCurSample & 0xFF );
+        pbyOut[2 * i + 1] = static_cast<uint8_t> ( iCurSample >> 8 );
+    }
+}
+
+inline void PcmDecode ( const uint8_t* pbyIn,
+                        int16_t*       psOut,
+                        const int      iNumSamples )
+{
+    for ( int i = 0; i < iNumSamples; i++ )
+    {
+        psOut[i] = static_cast<int16_t> ( pbyIn[2 * i] |
+            ( static_cast<uint16_t> ( pbyIn[2 * i + 1] ) << 8 ) );
+    }
 }
 
 
@@ -444,7 +483,8 @@ enum EAudComprType
     // used for protocol -> enum values must be fixed!
     CT_NONE = 0,
     CT_CELT = 1,
-    CT_OPUS = 2
+    CT_OPUS = 2,
+    CT_PCM = 3
 };
 
 
@@ -836,7 +876,9 @@ public:
         iNumAudioChannels      ( 0 ),
         iSampleRate            ( 0 ),
         eAudioCodingType       ( CT_NONE ),
-        iAudioCodingArg        ( 0 ) {}
+        iVersion               ( 0 ),
+        iAudioCodingArg        ( 0 ),
+        iNumRedundantPackets   ( 0 ) {}
 
     CNetworkTransportProps ( const uint32_t      iNBNPS,
                              const uint16_t      iNBSF,
@@ -844,14 +886,30 @@ public:
                              const uint32_t      iNSR,
                              const EAudComprType eNACT,
                              const uint32_t      iNVers,
-                             const int32_t       iNACA ) :
+                             const int32_t       iNACA,
+                             const uint32_t      iNNRP = 0 ) :
         iBaseNetworkPacketSize ( iNBNPS ),
         iBlockSizeFact         ( iNBSF ),
         iNumAudioChannels      ( iNNACH ),
         iSampleRate            ( iNSR ),
         eAudioCodingType       ( eNACT ),
         iVersion               ( iNVers ),
-        iAudioCodingArg        ( iNACA ) {}
+        iAudioCodingArg        ( iNACA ),
+        iNumRedundantPackets   ( iNNRP ) {}
+
+    // for OPUS and the uncompressed audio the audio coder argument defines
+    // the frame size, all other values select the default frame size
+    int GetFrameSizeSamples() const
+    {
+        if ( ( ( eAudioCodingType == CT_OPUS ) ||
+               ( eAudioCodingType == CT_PCM ) ) &&
+             ( iAudioCodingArg == SYSTEM_FRAME_SIZE_SAMPLES_SMALL ) )
+        {
+            return SYSTEM_FRAME_SIZE_SAMPLES_SMALL;
+        }
+
+        return SYSTEM_FRAME_SIZE_SAMPLES;
+    }
 
     uint32_t      iBaseNetworkPacketSize;
     uint16_t      iBlockSizeFact;
@@ -860,6 +918,7 @@ public:
     EAudComprType eAudioCodingType;
     uint32_t      iVersion;
     int32_t       iAudioCodingArg;
+    uint32_t      iNumRedundantPackets;
 };
 
 
@@ -869,6 +928,8 @@ class NetworkUtil
 public:
     static bool ParseNetworkAddress ( QString       strAddress,
                                       CHostAddress& HostAddress );
+
+    static QHostAddress GetLocalAddress();
 };
 
 
@@ -960,17 +1021,15 @@ protected:
 class CCRC
 {
 public:
-    CCRC() : iPoly ( ( 1 << 5 ) | ( 1 << 12 ) ), iBitOutMask ( 1 << 16 )
-        { Reset(); }
+    CCRC() { Reset(); }
 
     void Reset();
     void AddByte ( const uint8_t byNewInput );
+    void AddBytes ( const uint8_t* pbyNewInput, const int iNumBytes );
     bool CheckCRC ( const uint32_t iCRC ) { return iCRC == GetCRC(); }
     uint32_t GetCRC();
 
 protected:
-    uint32_t iPoly;
-    uint32_t iBitOutMask;
     uint32_t iStateShiftReg;
 };
 
@@ -1107,4 +1166,42 @@ protected:
     bool            bPreviousState;
 };
 
+
+// Bit rate adaptation ---------------------------------------------------------
+// Selects an audio quality level (where level 0 is the lowest bit rate) based
+// on the loss rates (lost/concealed frames) measured at both sides of the
+// connection. On high loss the level is decreased immediately, after a number
+// of periods with low loss the next higher level is probed. If a probe fails,
+// the number of periods until the next probe is doubled.
+class CBitrateAdaptation
+{
+public:
+    CBitrateAdaptation() { Init ( 1 ); }
+
+    void Init ( const int iNNumLevels );
+
+    void PutRemoteStatistics ( const int iNumFrames,
+                               const int iNumLostFrames );
+
+    // returns true if the level has changed
+    bool PutLocalStatistics ( const int iNumFrames,
+                              const int iNumLostFrames );
+
+    int GetLevel() const { return iCurLevel; }
+
+protected:
+    double CalcLossRate ( const double dOldLossRate,
+                          const int    iNumFrames,
+                          const int    iNumLostFrames );
+
+    int    iNumLevels;
+    int    iCurLevel;
+    double dRemoteLossRate;
+    double dLocalLossRate;
+    int    iNumHoldPeriods;
+    int    iNumGoodPeriods;
+    int    iNumReqGoodPeriods;
+    bool   bIsProbing;
+};
+
 #endif /* !defined ( UTIL_HOIH934256GEKJH98_3_43445KJIUHF1912__INCLUDED_ ) */